@@ -0,0 +1,509 @@
+// 协议与会话热路径基准: 包头编解码, 推送打包, protobuf 编解码, /api 请求体解析, 口令哈希, 在线会话表争用, 扇出推送, 连接池取还, 嵌入式存储
+// 输入数据固定 (固定种子), 不同提交的结果可直接对比, 见 readme "5.11 微基准"
+//
+// DbPool / RedisPool 的基准需要真实的 Postgres / Redis: 设置 IM_BENCH_CONFIG=../config.yaml 后才会运行
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../common/config/config.h"
+#include "im.pb.h"
+#include "packet.h"
+#include "session_manager.h"
+#include "push_packet.h"
+#include "push_dispatcher.h"
+#include "flat_json.h"
+#include "rate_limiter.h"
+#include "db_pool.h"
+#include "redis_pool.h"
+#include "embedded_store.h"
+#include "password_hasher.h"
+
+namespace {
+
+im::ChatMsg MakeChatMsg(size_t content_size, int64_t msg_id = 1234567890123) {
+    im::ChatMsg msg;
+    msg.set_msg_id(msg_id);
+    msg.set_from_uid(100001);
+    msg.set_to_uid(100002);
+    msg.set_session_id(42);
+    msg.set_msg_type(im::MSG_TEXT);
+    msg.set_content(std::string(content_size, 'x'));
+    msg.set_create_time(1700000000000);
+    return msg;
+}
+
+// ---- 包头 ----
+
+void BM_EncodeHeader(benchmark::State& state) {
+    PacketHeader header{HEADER_LEN + 128, 1, 0x1003, 0};
+    uint8_t buffer[HEADER_LEN];
+    for (auto _ : state) {
+        header.seq_id++;
+        PacketHelper::EncodeHeader(header, buffer);
+        benchmark::DoNotOptimize(buffer);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeHeader);
+
+void BM_DecodeHeader(benchmark::State& state) {
+    uint8_t buffer[HEADER_LEN];
+    PacketHelper::EncodeHeader({HEADER_LEN + 128, 1, 0x1003, 7}, buffer);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer);
+        PacketHeader h = PacketHelper::DecodeHeader(buffer);
+        benchmark::DoNotOptimize(h);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeHeader);
+
+// Arg: body 字节数
+void BM_BuildPacket(benchmark::State& state) {
+    std::string body(state.range(0), 'x');
+    uint32_t seq = 0;
+    for (auto _ : state) {
+        std::string packet = PacketHelper::BuildPacket(0x1004, ++seq, body);
+        benchmark::DoNotOptimize(packet.data());
+    }
+    state.SetBytesProcessed(state.iterations() * (HEADER_LEN + body.size()));
+}
+BENCHMARK(BM_BuildPacket)->Arg(16)->Arg(256)->Arg(4096);
+
+// ---- 推送打包 / protobuf ----
+
+// Arg: 消息正文字节数
+void BM_PackPushMsg(benchmark::State& state) {
+    im::ChatMsg msg = MakeChatMsg(state.range(0));
+    for (auto _ : state) {
+        std::string packet = PackPushMsg(msg);
+        benchmark::DoNotOptimize(packet.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PackPushMsg)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_ChatMsg_Serialize(benchmark::State& state) {
+    im::ChatMsg msg = MakeChatMsg(state.range(0));
+    std::string out;
+    for (auto _ : state) {
+        msg.SerializeToString(&out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_ChatMsg_Serialize)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_ChatMsg_Parse(benchmark::State& state) {
+    std::string bytes = MakeChatMsg(state.range(0)).SerializeAsString();
+    im::ChatMsg msg;
+    for (auto _ : state) {
+        bool ok = msg.ParseFromString(bytes);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_ChatMsg_Parse)->Arg(16)->Arg(256)->Arg(4096);
+
+// Arg: 一次同步返回的消息条数 (正文 64 字节)
+im::SyncMsgRes MakeSyncRes(int count) {
+    im::SyncMsgRes res;
+    res.set_err_code(0);
+    for (int i = 0; i < count; ++i) *res.add_msgs() = MakeChatMsg(64, 1234567890123 + i);
+    return res;
+}
+
+void BM_SyncMsgRes_Serialize(benchmark::State& state) {
+    im::SyncMsgRes res = MakeSyncRes(state.range(0));
+    std::string out;
+    for (auto _ : state) {
+        res.SerializeToString(&out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_SyncMsgRes_Serialize)->Arg(1)->Arg(20)->Arg(100);
+
+void BM_SyncMsgRes_Parse(benchmark::State& state) {
+    std::string bytes = MakeSyncRes(state.range(0)).SerializeAsString();
+    im::SyncMsgRes res;
+    for (auto _ : state) {
+        bool ok = res.ParseFromString(bytes);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_SyncMsgRes_Parse)->Arg(1)->Arg(20)->Arg(100);
+
+// ---- /api 请求体 ----
+
+void BM_FlatJson_ParseLogin(benchmark::State& state) {
+    const std::string body = R"({"email":"user100001@example.com","password":"p@ssw0rd\u00e9","device_id":"web-7f3a9c"})";
+    im::HttpLoginReq req;
+    for (auto _ : state) {
+        FlatJson j;
+        bool ok = j.Parse(body) && j.GetString("email", *req.mutable_email()) &&
+                  j.GetString("password", *req.mutable_password()) && j.GetString("device_id", *req.mutable_device_id());
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_FlatJson_ParseLogin);
+
+// ---- 限流 ----
+
+// Arg: 活跃 uid 数; 超过桶表容量 (65536) 后开始淘汰
+void BM_RateLimiter_Check(benchmark::State& state) {
+    RateLimiter limiter(65536);
+    limiter.SetRules({{0x1003, 20, 40, 200, 400}});
+    const int64_t users = state.range(0);
+    uint64_t now_ms = 0;
+    int64_t uid = 0;
+    for (auto _ : state) {
+        uid = uid + 1 < users ? uid + 1 : 0;
+        now_ms += uid == 0;
+        benchmark::DoNotOptimize(limiter.Check(0x1003, uid + 1, static_cast<uint64_t>(uid) * 7, now_ms));
+    }
+    state.counters["evictions"] = static_cast<double>(limiter.Evictions());
+}
+BENCHMARK(BM_RateLimiter_Check)->Arg(1000)->Arg(30000)->Arg(200000);
+
+// ---- 口令哈希 ----
+
+// Arg: scrypt_log_n, 用于挑选 auth.password_hash 的参数: 单次耗时 x QPS 决定需要的哈希线程数
+void BM_PasswordHash_Verify(benchmark::State& state) {
+    PasswordHasherOptions options;
+    options.threads = 1;
+    options.scrypt_log_n = static_cast<int>(state.range(0));
+    PasswordHasher hasher(options);
+    std::string stored = hasher.Hash("p@ssw0rd");
+    for (auto _ : state) {
+        bool ok = hasher.Verify("p@ssw0rd", stored);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PasswordHash_Verify)->Arg(12)->Arg(14)->Arg(15)->Arg(16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ---- 在线会话表 ----
+
+// 代替 uWS::WebSocket: send 只累加字节数 (在会话表的锁内调用, 不需要原子操作)
+struct FakeSocket {
+    uint64_t sent_bytes = 0;
+    void send(std::string_view data) { sent_bytes += data.size(); }
+};
+
+constexpr int64_t kOnlineUsers = 100000;
+
+// 所有基准线程共享一张预先填满 kOnlineUsers 个会话的表
+struct SessionFixture {
+    SessionRegistry<FakeSocket> registry;
+    std::vector<FakeSocket> sockets;
+
+    SessionFixture() : sockets(kOnlineUsers) {
+        for (int64_t uid = 0; uid < kOnlineUsers; ++uid) registry.Add(uid, &sockets[uid]);
+    }
+};
+
+SessionFixture& Sessions() {
+    static SessionFixture fixture;
+    return fixture;
+}
+
+// 每线程固定种子的 uid 序列, 避免在计时循环里生成随机数
+std::vector<int64_t> UidSequence(int thread_index, int64_t range) {
+    std::mt19937_64 rng(0x5eed + thread_index);
+    std::uniform_int_distribution<int64_t> dist(0, range - 1);
+    std::vector<int64_t> uids(4096);
+    for (auto& uid : uids) uid = dist(rng);
+    return uids;
+}
+
+void BM_Session_Push(benchmark::State& state) {
+    auto& registry = Sessions().registry;
+    std::vector<int64_t> uids = UidSequence(state.thread_index(), kOnlineUsers);
+    std::string packet = PackPushMsg(MakeChatMsg(64));
+    size_t i = 0;
+    for (auto _ : state) {
+        bool ok = registry.With(uids[i++ & 4095], [&packet](FakeSocket* ws) { ws->send(packet); });
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 一半查找不在线的 uid (推送给离线用户, 走 miss 分支)
+void BM_Session_Lookup(benchmark::State& state) {
+    auto& registry = Sessions().registry;
+    std::vector<int64_t> uids = UidSequence(state.thread_index(), kOnlineUsers * 2);
+    size_t i = 0;
+    for (auto _ : state) {
+        bool ok = registry.With(uids[i++ & 4095], [](FakeSocket* ws) { benchmark::DoNotOptimize(ws); });
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 登录 / 断开: 每个线程在自己的 uid 段上增删, 与其他线程的推送争同一把锁
+void BM_Session_AddRemove(benchmark::State& state) {
+    auto& registry = Sessions().registry;
+    FakeSocket socket;
+    int64_t base = kOnlineUsers + static_cast<int64_t>(state.thread_index()) * 1000000;
+    int64_t n = 0;
+    for (auto _ : state) {
+        int64_t uid = base + (n++ % 1024);
+        registry.Add(uid, &socket);
+        registry.Remove(uid, &socket);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 1 个线程做登录/断开, 其余线程推送
+void BM_Session_Mixed(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        BM_Session_AddRemove(state);
+    } else {
+        BM_Session_Push(state);
+    }
+}
+
+#define SESSION_BENCH_ARGS ->ThreadRange(1, 64)->UseRealTime()
+
+BENCHMARK(BM_Session_Push) SESSION_BENCH_ARGS;
+BENCHMARK(BM_Session_Lookup) SESSION_BENCH_ARGS;
+BENCHMARK(BM_Session_AddRemove) SESSION_BENCH_ARGS;
+BENCHMARK(BM_Session_Mixed)->ThreadRange(2, 64)->UseRealTime();
+
+// ---- 扇出推送 ----
+
+// 按系统调用计数的假连接: cork 外每次 send 算一次 write, cork 内的 send 在 cork 结束时合并成一次
+struct CorkSocket {
+    uint64_t writes = 0;
+    bool corked = false;
+    bool pending = false;
+    unsigned int getBufferedAmount() const { return 0; }
+    void send(std::string_view data) {
+        benchmark::DoNotOptimize(data.data());
+        if (corked) {
+            pending = true;
+        } else {
+            ++writes;
+        }
+    }
+    template <typename Fn>
+    void cork(Fn&& fn) {
+        corked = true;
+        fn();
+        corked = false;
+        if (pending) ++writes;
+        pending = false;
+    }
+};
+
+struct FanoutFixture {
+    SessionRegistry<CorkSocket> registry;
+    std::vector<CorkSocket> sockets;
+
+    explicit FanoutFixture(int64_t recipients) : sockets(recipients) {
+        for (int64_t uid = 0; uid < recipients; ++uid) registry.Add(uid, &sockets[uid]);
+    }
+
+    uint64_t Writes() const {
+        uint64_t writes = 0;
+        for (const auto& ws : sockets) writes += ws.writes;
+        return writes;
+    }
+};
+
+void ReportFanout(benchmark::State& state, const FanoutFixture& fixture, uint64_t copied_bytes) {
+    double pushes = static_cast<double>(state.iterations()) * state.range(0) * state.range(1);
+    state.counters["writes_per_push"] = fixture.Writes() / pushes;
+    state.counters["copied_bytes_per_push"] = copied_bytes / pushes;
+    state.SetItemsProcessed(static_cast<int64_t>(pushes));
+}
+
+// 一轮 loop 里 range(1) 条消息各自扇出给 range(0) 个在线用户
+// 旧路径: 每个接收者一份包的拷贝, 逐条直接 send
+void BM_Fanout_CopyPerRecipient(benchmark::State& state) {
+    FanoutFixture fixture(state.range(0));
+    std::string packet = PackPushMsg(MakeChatMsg(256));
+    uint64_t copied_bytes = 0;
+    for (auto _ : state) {
+        for (int64_t n = 0; n < state.range(1); ++n) {
+            for (int64_t uid = 0; uid < state.range(0); ++uid) {
+                std::string copy = packet;
+                copied_bytes += copy.size();
+                fixture.registry.With(uid, [&copy](CorkSocket* ws) { ws->send(copy); });
+            }
+        }
+    }
+    ReportFanout(state, fixture, copied_bytes);
+}
+
+// 新路径: 每条消息封一个共享推送包, 经 PushDispatcher 在一次 Drain 里按连接 cork 写出
+void BM_Fanout_SharedCorked(benchmark::State& state) {
+    FanoutFixture fixture(state.range(0));
+    PushDispatcher<CorkSocket> dispatcher(fixture.registry, [] {});
+    std::string packet = PackPushMsg(MakeChatMsg(256));
+    uint64_t copied_bytes = 0;
+    for (auto _ : state) {
+        for (int64_t n = 0; n < state.range(1); ++n) {
+            PushBuffer buffer = MakePushBuffer(packet);
+            copied_bytes += buffer->size();
+            for (int64_t uid = 0; uid < state.range(0); ++uid) dispatcher.Push(uid, buffer);
+        }
+        dispatcher.Drain();
+    }
+    ReportFanout(state, fixture, copied_bytes);
+}
+
+#define FANOUT_BENCH_ARGS ->ArgsProduct({{100, 1000}, {1, 4}})
+
+BENCHMARK(BM_Fanout_CopyPerRecipient) FANOUT_BENCH_ARGS;
+BENCHMARK(BM_Fanout_SharedCorked) FANOUT_BENCH_ARGS;
+
+// ---- 嵌入式存储 ----
+
+// 数据写到临时目录 (后台每秒 fsync), 测的是日志追加 + 索引的开销; 预置 1000 对好友, 每个收件箱 1000 条消息
+EmbeddedStore& Embedded() {
+    static std::unique_ptr<EmbeddedStore> store = [] {
+        char dir[] = "/tmp/hotpath_bench.XXXXXX";
+        SegmentedLogOptions options;
+        options.dir = mkdtemp(dir) ? dir : "/tmp/hotpath_bench";
+        options.sync_interval_ms = 1000;
+        auto s = std::make_unique<EmbeddedStore>(options);
+        s->Open();
+        for (int i = 0; i < 2000; ++i) s->CreateUser("u" + std::to_string(i), "pw", std::to_string(i) + "@bench");
+        for (int64_t uid = 1; uid <= 2000; uid += 2) {
+            int64_t req_id;
+            s->CreateFriendRequest(uid, uid + 1, "", req_id);
+            s->AcceptFriendRequest(req_id);
+        }
+        std::string content(64, 'x');
+        for (int64_t n = 1; n <= 1000; ++n) {
+            for (int64_t uid = 1; uid <= 2000; uid += 200) s->SaveMessage(std::to_string(n * 10000 + uid), uid + 1, uid, content);
+        }
+        return s;
+    }();
+    return *store;
+}
+
+std::atomic<int64_t> bench_msg_id{1LL << 40};
+
+void BM_Embedded_SaveMessage(benchmark::State& state) {
+    auto& store = Embedded();
+    std::string content(state.range(0), 'x');
+    std::vector<int64_t> uids = UidSequence(state.thread_index(), 2000);
+    size_t i = 0;
+    for (auto _ : state) {
+        int64_t to = uids[i++ & 4095] + 1;
+        int64_t seq = store.SaveMessage(std::to_string(bench_msg_id.fetch_add(1, std::memory_order_relaxed)), to + 1, to, content);
+        benchmark::DoNotOptimize(seq);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Embedded_SaveMessage)->Arg(64)->Arg(1024)->ThreadRange(1, 16)->UseRealTime();
+
+// 一页离线消息 (100 条, 正文从日志读回)
+void BM_Embedded_GetOfflineMsgs(benchmark::State& state) {
+    auto& store = Embedded();
+    for (auto _ : state) {
+        auto msgs = store.GetofflineMsgs(1, 0);
+        benchmark::DoNotOptimize(msgs.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Embedded_GetOfflineMsgs)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_Embedded_AreFriends(benchmark::State& state) {
+    auto& store = Embedded();
+    std::vector<int64_t> uids = UidSequence(state.thread_index(), 2000);
+    size_t i = 0;
+    for (auto _ : state) {
+        int64_t uid = uids[i++ & 4095] + 1;
+        bool ok = store.AreFriends(uid, uid % 2 ? uid + 1 : uid - 1);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Embedded_AreFriends)->ThreadRange(1, 64)->UseRealTime();
+
+// ---- 真实连接池 ----
+
+// 按 IM_BENCH_CONFIG 指向的配置建池, 未设置或加载失败返回 nullptr
+Config* BenchConfig() {
+    static Config* config = []() -> Config* {
+        const char* path = std::getenv("IM_BENCH_CONFIG");
+        if (!path || !Config::Instance().Load(path)) return nullptr;
+        return &Config::Instance();
+    }();
+    return config;
+}
+
+PoolOptions BenchPoolOptions(const Config::PoolConfig& cfg) {
+    PoolOptions options;
+    options.min_pool = cfg.max_pool;  // 预先建满, 计时循环里不建连
+    options.max_pool = cfg.max_pool;
+    options.acquire_timeout_ms = cfg.acquire_timeout_ms;
+    options.keepalive_interval_sec = 3600;
+    return options;
+}
+
+DbPool* SharedDbPool() {
+    static std::unique_ptr<DbPool> pool = []() -> std::unique_ptr<DbPool> {
+        Config* config = BenchConfig();
+        if (!config) return nullptr;
+        const auto& db = config->GetPostgresConfig();
+        std::string conninfo = "dbname=" + db.dbname + " user=" + db.user + " password=" + db.password +
+                               " hostaddr=" + db.host + " port=" + std::to_string(db.port) + " connect_timeout=3";
+        return std::make_unique<DbPool>(conninfo, BenchPoolOptions(config->GetPoolsConfig().postgres));
+    }();
+    return pool.get();
+}
+
+RedisPool* SharedRedisPool() {
+    static std::unique_ptr<RedisPool> pool = []() -> std::unique_ptr<RedisPool> {
+        Config* config = BenchConfig();
+        if (!config) return nullptr;
+        const auto& redis = config->GetRedisConfig();
+        return std::make_unique<RedisPool>(redis.host, redis.port, redis.password, BenchPoolOptions(config->GetPoolsConfig().redis));
+    }();
+    return pool.get();
+}
+
+template <typename Pool>
+void RunPoolBench(benchmark::State& state, Pool* pool) {
+    if (!pool) {
+        state.SkipWithError("IM_BENCH_CONFIG not set");
+        return;
+    }
+    for (auto _ : state) {
+        auto g = pool->Acquire();
+        if (!g) {
+            state.SkipWithError("acquire timeout");
+            break;
+        }
+        benchmark::DoNotOptimize(g.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_DbPool_AcquireRelease(benchmark::State& state) {
+    RunPoolBench(state, SharedDbPool());
+}
+
+void BM_RedisPool_AcquireRelease(benchmark::State& state) {
+    RunPoolBench(state, SharedRedisPool());
+}
+
+BENCHMARK(BM_DbPool_AcquireRelease) SESSION_BENCH_ARGS;
+BENCHMARK(BM_RedisPool_AcquireRelease) SESSION_BENCH_ARGS;
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,553 @@
+// 端到端压测: 建立 N 条 WebSocket 连接到网关, LoginReq 登录后按给定速率发送 MsgSendReq,
+// 统计建连速率、发送回执 (MsgSendRes) 延迟、端到端推送 (MsgPush) 延迟和吞吐, 输出 JSON 报告
+//
+// 用法: im_loadgen [--config ../config.yaml] [--host 127.0.0.1] [--port 8000] [--connections 1000]
+//                  [--uid-base 1] [--rate 1000] [--seconds 30] [--connect-rate 0] [--connect-timeout 30]
+//                  [--threads 4] [--payload 64] [--token <password>] [--report report.json]
+//
+// 第 i 条连接以 uid = uid-base + i 登录, 与相邻连接 (i ^ 1) 两两互发, 这些用户之间需要已是好友.
+// 默认用 config.yaml 中 auth 的当前密钥本地签发会话令牌 (网关本地校验); --token 指定时改用旧的密码登录.
+// 消息正文带发送时刻, 收到推送的连接据此计算端到端延迟, 并回 MsgAck 避免网关重传.
+// --rate 为所有连接合计的每秒发送条数, --connect-rate 为每秒新建连接数 (0 不限).
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "../common/config/config.h"
+#include "../common/auth/session_token.h"
+#include "packet.h"
+#include "im.pb.h"
+
+namespace {
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8000;
+    int connections = 1000;
+    int64_t uid_base = 1;
+    double rate = 1000;
+    int seconds = 30;
+    double connect_rate = 0;
+    int connect_timeout = 30;
+    int threads = 4;
+    size_t payload = 64;
+    std::string token;
+    // 每次运行不同, 重跑时 seq_id 从头计数也不会撞上 logic server 发送去重窗口里上一轮的记录
+    std::string device_id = "loadgen-" + std::to_string(getpid()) + "-" + std::to_string(time(nullptr));
+};
+
+// 压测各阶段, 由主线程推进
+enum Phase { kConnect = 0, kSend = 1, kDrain = 2, kStop = 3 };
+
+struct Conn {
+    enum State { kIdle, kConnecting, kHandshake, kLogin, kReady, kClosed };
+    int fd = -1;
+    State state = kIdle;
+    int64_t uid = 0;
+    int64_t peer = 0;
+    int64_t connect_start_ns = 0;
+    uint32_t next_seq = 1;
+    std::string in;
+    std::string out;
+    bool want_write = false;
+    std::unordered_map<uint32_t, int64_t> pending;  // seq_id -> 发送时刻
+};
+
+struct WorkerStats {
+    int64_t established = 0;
+    int64_t failed = 0;
+    int64_t first_connect_ns = 0;
+    int64_t last_ready_ns = 0;
+    int64_t sent = 0;
+    int64_t acked = 0;
+    int64_t send_errors = 0;
+    int64_t pushes = 0;
+    int64_t disconnects = 0;
+    std::vector<int64_t> setup_ns;
+    std::vector<int64_t> ack_ns;
+    std::vector<int64_t> push_ns;
+};
+
+std::atomic<int> phase{kConnect};
+std::atomic<int> settled{0};  // 已登录成功或失败的连接数
+
+class Worker {
+public:
+    Worker(const Options& options, std::vector<std::pair<int64_t, std::string>> users, const sockaddr_in& addr, int index)
+        : options_(options), addr_(addr), rng_(index * 7919 + 1) {
+        conns_.resize(users.size());
+        for (size_t i = 0; i < users.size(); ++i) {
+            conns_[i].uid = users[i].first;
+            conns_[i].peer = options.uid_base + ((users[i].first - options.uid_base) ^ 1);
+            tokens_.push_back(std::move(users[i].second));
+        }
+        double share = static_cast<double>(users.size()) / std::max(options.connections, 1);
+        rate_ = options.rate * share;
+        connect_rate_ = options.connect_rate * share;
+        epfd_ = epoll_create1(0);
+    }
+
+    ~Worker() {
+        for (auto& c : conns_) {
+            if (c.fd >= 0) close(c.fd);
+        }
+        if (epfd_ >= 0) close(epfd_);
+    }
+
+    void Run() {
+        int64_t start = NowNs();
+        size_t opened = 0;
+        int64_t send_start = 0;
+        size_t rr = 0;
+        std::vector<epoll_event> events(256);
+        while (phase.load() != kStop) {
+            int64_t now = NowNs();
+            // 按 connect-rate 逐步建连
+            while (opened < conns_.size() &&
+                   (connect_rate_ <= 0 || opened < (now - start) / 1e9 * connect_rate_ + 1)) {
+                StartConnect(conns_[opened++]);
+            }
+            if (phase.load() == kSend) {
+                if (send_start == 0) send_start = now;
+                double target = (now - send_start) / 1e9 * rate_;
+                size_t attempts = 0;
+                while (stats_.sent + stats_.send_errors < target && attempts < conns_.size()) {
+                    Conn& c = conns_[rr++ % conns_.size()];
+                    if (c.state != Conn::kReady) {
+                        ++attempts;
+                        continue;
+                    }
+                    SendMsg(c);
+                    attempts = 0;
+                }
+            }
+            int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), 1);
+            for (int i = 0; i < n; ++i) {
+                Conn& c = conns_[events[i].data.u64];
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    Fail(c);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) OnWritable(c);
+                if ((events[i].events & EPOLLIN) && c.state != Conn::kClosed) OnReadable(c);
+            }
+        }
+    }
+
+    WorkerStats& Stats() { return stats_; }
+
+private:
+    void StartConnect(Conn& c) {
+        c.connect_start_ns = NowNs();
+        if (stats_.first_connect_ns == 0) stats_.first_connect_ns = c.connect_start_ns;
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (c.fd < 0) {
+            Fail(c);
+            return;
+        }
+        int on = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        int rc = connect(c.fd, reinterpret_cast<const sockaddr*>(&addr_), sizeof(addr_));
+        if (rc < 0 && errno != EINPROGRESS) {
+            Fail(c);
+            return;
+        }
+        c.state = Conn::kConnecting;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u64 = &c - conns_.data();
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+        c.want_write = true;
+    }
+
+    void Fail(Conn& c) {
+        if (c.state == Conn::kClosed) return;
+        if (c.state == Conn::kReady) {
+            ++stats_.disconnects;
+        } else {
+            ++stats_.failed;
+            settled.fetch_add(1);
+        }
+        if (c.fd >= 0) {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+            close(c.fd);
+            c.fd = -1;
+        }
+        c.state = Conn::kClosed;
+        c.pending.clear();
+    }
+
+    void UpdateEvents(Conn& c, bool want_write) {
+        if (c.want_write == want_write) return;
+        c.want_write = want_write;
+        epoll_event ev{};
+        ev.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.u64 = &c - conns_.data();
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    void Flush(Conn& c) {
+        while (!c.out.empty()) {
+            ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                Fail(c);
+                return;
+            }
+            c.out.erase(0, n);
+        }
+        UpdateEvents(c, !c.out.empty());
+    }
+
+    void OnWritable(Conn& c) {
+        if (c.state == Conn::kConnecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0) {
+                Fail(c);
+                return;
+            }
+            // Sec-WebSocket-Key 只需是 16 字节的 base64, 压测不校验 Accept
+            c.out = "GET /ws HTTP/1.1\r\nHost: " + options_.host + ":" + std::to_string(options_.port) +
+                    "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+            c.state = Conn::kHandshake;
+        }
+        Flush(c);
+    }
+
+    // 客户端帧必须带掩码
+    void WsSend(Conn& c, const std::string& payload, uint8_t opcode = 0x2) {
+        std::string frame;
+        frame.push_back(static_cast<char>(0x80 | opcode));
+        size_t len = payload.size();
+        if (len < 126) {
+            frame.push_back(static_cast<char>(0x80 | len));
+        } else if (len < 65536) {
+            frame.push_back(static_cast<char>(0x80 | 126));
+            frame.push_back(static_cast<char>(len >> 8));
+            frame.push_back(static_cast<char>(len & 0xFF));
+        } else {
+            frame.push_back(static_cast<char>(0x80 | 127));
+            for (int i = 7; i >= 0; --i) frame.push_back(static_cast<char>((static_cast<uint64_t>(len) >> (i * 8)) & 0xFF));
+        }
+        uint32_t mask = static_cast<uint32_t>(rng_());
+        char key[4];
+        std::memcpy(key, &mask, 4);
+        frame.append(key, 4);
+        size_t offset = frame.size();
+        frame.append(payload);
+        for (size_t i = 0; i < len; ++i) frame[offset + i] ^= key[i & 3];
+        c.out.append(frame);
+        Flush(c);
+    }
+
+    void OnReadable(Conn& c) {
+        char buf[16384];
+        while (true) {
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c.in.append(buf, n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                Fail(c);
+                return;
+            }
+            break;
+        }
+        if (c.state == Conn::kHandshake) {
+            size_t end = c.in.find("\r\n\r\n");
+            if (end == std::string::npos) return;
+            if (c.in.compare(0, 12, "HTTP/1.1 101") != 0) {
+                Fail(c);
+                return;
+            }
+            c.in.erase(0, end + 4);
+            c.state = Conn::kLogin;
+            im::LoginReq req;
+            req.set_uid(c.uid);
+            req.set_token(tokens_[&c - conns_.data()]);
+            req.set_device_id(options_.device_id);
+            std::string body;
+            req.SerializeToString(&body);
+            WsSend(c, PacketHelper::BuildPacket(0x1001, c.next_seq++, body));
+        }
+        // 服务端帧不带掩码, uWS 不分片发送
+        while (c.state != Conn::kClosed && c.in.size() >= 2) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(c.in.data());
+            uint8_t opcode = p[0] & 0x0F;
+            uint64_t len = p[1] & 0x7F;
+            size_t header = 2;
+            if (len == 126) {
+                if (c.in.size() < 4) return;
+                len = (static_cast<uint64_t>(p[2]) << 8) | p[3];
+                header = 4;
+            } else if (len == 127) {
+                if (c.in.size() < 10) return;
+                len = 0;
+                for (int i = 0; i < 8; ++i) len = (len << 8) | p[2 + i];
+                header = 10;
+            }
+            if (c.in.size() < header + len) return;
+            std::string payload = c.in.substr(header, len);
+            c.in.erase(0, header + len);
+            if (opcode == 0x2) {
+                OnPacket(c, payload);
+            } else if (opcode == 0x9) {
+                WsSend(c, payload, 0xA);
+            } else if (opcode == 0x8) {
+                Fail(c);
+            }
+        }
+    }
+
+    void OnPacket(Conn& c, const std::string& packet) {
+        if (packet.size() < HEADER_LEN) return;
+        PacketHeader header = PacketHelper::DecodeHeader(reinterpret_cast<const uint8_t*>(packet.data()));
+        const char* body = packet.data() + HEADER_LEN;
+        int body_len = static_cast<int>(packet.size() - HEADER_LEN);
+        int64_t now = NowNs();
+        if (header.cmd_id == 0x1002) {
+            im::LoginRes res;
+            if (!res.ParseFromArray(body, body_len) || res.err_code() != im::ERR_SUCCESS) {
+                Fail(c);
+                return;
+            }
+            c.state = Conn::kReady;
+            ++stats_.established;
+            stats_.setup_ns.push_back(now - c.connect_start_ns);
+            stats_.last_ready_ns = now;
+            settled.fetch_add(1);
+        } else if (header.cmd_id == 0x1004) {
+            auto it = c.pending.find(header.seq_id);
+            if (it == c.pending.end()) return;
+            im::MsgSendRes res;
+            if (res.ParseFromArray(body, body_len) && res.err_code() == im::ERR_SUCCESS) {
+                ++stats_.acked;
+                stats_.ack_ns.push_back(now - it->second);
+            } else {
+                ++stats_.send_errors;
+            }
+            c.pending.erase(it);
+        } else if (header.cmd_id == 0x1005) {
+            im::MsgPush push;
+            if (!push.ParseFromArray(body, body_len)) return;
+            const std::string& content = push.msg().content();
+            if (content.compare(0, 3, "lg:") == 0) {
+                ++stats_.pushes;
+                stats_.push_ns.push_back(now - std::atoll(content.c_str() + 3));
+            }
+            if (push.msg().msg_id() != 0) {
+                im::MsgAck ack;
+                ack.set_msg_id(push.msg().msg_id());
+                ack.set_from_uid(push.msg().from_uid());
+                std::string ack_body;
+                ack.SerializeToString(&ack_body);
+                WsSend(c, PacketHelper::BuildPacket(0x100A, c.next_seq++, ack_body));
+            }
+        }
+    }
+
+    void SendMsg(Conn& c) {
+        int64_t now = NowNs();
+        im::MsgSendReq req;
+        auto* msg = req.mutable_msg();
+        msg->set_from_uid(c.uid);
+        msg->set_to_uid(c.peer);
+        msg->set_msg_type(im::MSG_TEXT);
+        std::string content = "lg:" + std::to_string(now) + ":";
+        if (content.size() < options_.payload) content.append(options_.payload - content.size(), 'x');
+        msg->set_content(content);
+        std::string body;
+        req.SerializeToString(&body);
+        uint32_t seq = c.next_seq++;
+        c.pending[seq] = now;
+        ++stats_.sent;
+        WsSend(c, PacketHelper::BuildPacket(0x1003, seq, body));
+    }
+
+    Options options_;
+    sockaddr_in addr_;
+    std::vector<Conn> conns_;
+    std::vector<std::string> tokens_;
+    std::mt19937 rng_;
+    double rate_ = 0;
+    double connect_rate_ = 0;
+    int epfd_ = -1;
+    WorkerStats stats_;
+};
+
+std::string Percentiles(std::vector<int64_t>& samples) {
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) -> double {
+        if (samples.empty()) return 0;
+        size_t i = std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()));
+        return samples[i] / 1000.0;
+    };
+    double sum = 0;
+    for (int64_t v : samples) sum += v;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"count\":%zu,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+                  samples.size(), samples.empty() ? 0.0 : sum / samples.size() / 1000.0, at(0.5), at(0.9), at(0.99),
+                  at(0.999), samples.empty() ? 0.0 : samples.back() / 1000.0);
+    return buf;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string config_file = "../config.yaml";
+    std::string report_file;
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--config")) config_file = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--host")) options.host = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--port")) options.port = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--connections")) options.connections = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--uid-base")) options.uid_base = std::atoll(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--rate")) options.rate = std::atof(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--seconds")) options.seconds = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--connect-rate")) options.connect_rate = std::atof(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--connect-timeout")) options.connect_timeout = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--threads")) options.threads = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--payload")) options.payload = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--token")) options.token = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--report")) report_file = argv[i + 1];
+    }
+    if (options.connections % 2 != 0) {
+        ++options.connections;
+        spdlog::warn("connections rounded up to {} so every user has a peer", options.connections);
+    }
+    options.threads = std::max(1, std::min(options.threads, options.connections));
+
+    std::unique_ptr<SessionTokenCodec> codec;
+    if (options.token.empty()) {
+        Config& config = Config::Instance();
+        if (!config.Load(config_file)) return 1;
+        codec = std::make_unique<SessionTokenCodec>(config.GetAuthConfig());
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    hostent* host = gethostbyname(options.host.c_str());
+    if (host == nullptr) {
+        spdlog::error("cannot resolve {}", options.host);
+        return 1;
+    }
+    std::memcpy(&addr.sin_addr, host->h_addr, host->h_length);
+
+    // 相邻两个 uid 在同一线程, 互为收发对象
+    std::vector<std::unique_ptr<Worker>> workers;
+    int per_thread = (options.connections / 2 + options.threads - 1) / options.threads * 2;
+    for (int t = 0, next = 0; t < options.threads && next < options.connections; ++t) {
+        std::vector<std::pair<int64_t, std::string>> users;
+        for (int i = 0; i < per_thread && next < options.connections; ++i, ++next) {
+            int64_t uid = options.uid_base + next;
+            users.emplace_back(uid, codec ? codec->Issue(uid, options.device_id) : options.token);
+        }
+        workers.push_back(std::make_unique<Worker>(options, std::move(users), addr, t));
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& w : workers) threads.emplace_back(&Worker::Run, w.get());
+
+    auto connect_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.connect_timeout);
+    while (settled.load() < options.connections && std::chrono::steady_clock::now() < connect_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto send_start = std::chrono::steady_clock::now();
+    phase = kSend;
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    double send_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - send_start).count();
+    // 给在途的回执和推送留出时间
+    phase = kDrain;
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    phase = kStop;
+    for (auto& t : threads) t.join();
+
+    WorkerStats total;
+    for (auto& w : workers) {
+        WorkerStats& s = w->Stats();
+        total.established += s.established;
+        total.failed += s.failed;
+        if (s.first_connect_ns && (!total.first_connect_ns || s.first_connect_ns < total.first_connect_ns)) {
+            total.first_connect_ns = s.first_connect_ns;
+        }
+        total.last_ready_ns = std::max(total.last_ready_ns, s.last_ready_ns);
+        total.sent += s.sent;
+        total.acked += s.acked;
+        total.send_errors += s.send_errors;
+        total.pushes += s.pushes;
+        total.disconnects += s.disconnects;
+        total.setup_ns.insert(total.setup_ns.end(), s.setup_ns.begin(), s.setup_ns.end());
+        total.ack_ns.insert(total.ack_ns.end(), s.ack_ns.begin(), s.ack_ns.end());
+        total.push_ns.insert(total.push_ns.end(), s.push_ns.begin(), s.push_ns.end());
+    }
+    double setup_elapsed = total.last_ready_ns > total.first_connect_ns ? (total.last_ready_ns - total.first_connect_ns) / 1e9 : 0;
+
+    // 延迟单位均为微秒
+    char head[1024];
+    std::snprintf(head, sizeof(head),
+                  "{\"config\":{\"host\":\"%s\",\"port\":%d,\"connections\":%d,\"threads\":%d,\"rate\":%.1f,\"seconds\":%d,"
+                  "\"connect_rate\":%.1f,\"payload\":%zu},"
+                  "\"connect\":{\"established\":%lld,\"failed\":%lld,\"disconnects\":%lld,\"setup_per_sec\":%.1f,\"setup_latency_us\":",
+                  options.host.c_str(), options.port, options.connections, options.threads, options.rate, options.seconds,
+                  options.connect_rate, options.payload, static_cast<long long>(total.established),
+                  static_cast<long long>(total.failed), static_cast<long long>(total.disconnects),
+                  setup_elapsed > 0 ? total.established / setup_elapsed : 0.0);
+    std::string report = head + Percentiles(total.setup_ns) + "},";
+    char send[512];
+    std::snprintf(send, sizeof(send),
+                  "\"send\":{\"sent\":%lld,\"acked\":%lld,\"errors\":%lld,\"seconds\":%.2f,\"sent_per_sec\":%.1f,\"acked_per_sec\":%.1f,\"ack_latency_us\":",
+                  static_cast<long long>(total.sent), static_cast<long long>(total.acked),
+                  static_cast<long long>(total.send_errors), send_elapsed, total.sent / send_elapsed,
+                  total.acked / send_elapsed);
+    report += send + Percentiles(total.ack_ns) + "},";
+    char push[256];
+    std::snprintf(push, sizeof(push), "\"push\":{\"received\":%lld,\"received_per_sec\":%.1f,\"latency_us\":",
+                  static_cast<long long>(total.pushes), total.pushes / send_elapsed);
+    report += push + Percentiles(total.push_ns) + "}}\n";
+
+    if (report_file.empty()) {
+        std::fputs(report.c_str(), stdout);
+    } else {
+        FILE* f = std::fopen(report_file.c_str(), "w");
+        if (f == nullptr) {
+            spdlog::error("cannot write report to {}", report_file);
+            std::fputs(report.c_str(), stdout);
+            return 1;
+        }
+        std::fputs(report.c_str(), f);
+        std::fclose(f);
+        spdlog::info("report written to {}", report_file);
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+// 连接池争用基准: ConnectionPool<Traits> 对比原先的 mutex + condition_variable + deque 实现
+// 连接是内存对象, 只测量 Acquire/Release 本身的开销
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "connection_pool.h"
+
+namespace {
+
+struct FakeConn {
+    int64_t uses = 0;
+};
+
+struct FakeConnTraits {
+    using Handle = FakeConn*;
+    static constexpr const char* kName = "FakePool";
+
+    FakeConn* Create() { return new FakeConn(); }
+    void Destroy(FakeConn* c) { delete c; }
+    bool IsHealthy(FakeConn* c) { return c != nullptr; }
+    bool Ping(FakeConn* c) { return c != nullptr; }
+};
+
+// 原 DbPool/RedisPool 的实现 (全局 mutex, 每次 Acquire/Release 都加锁并 notify_one)
+class LegacyPool {
+public:
+    LegacyPool(size_t min_pool, size_t max_pool) : max_pool_(max_pool) {
+        for (size_t i = 0; i < min_pool; ++i) idle_.push_back({traits_.Create(), std::chrono::steady_clock::now()});
+        total_created_ = idle_.size();
+    }
+    ~LegacyPool() {
+        for (auto& c : idle_) traits_.Destroy(c.conn);
+    }
+
+    struct ConnGuard {
+        FakeConn* conn = nullptr;
+        LegacyPool* pool = nullptr;
+        ~ConnGuard() {
+            if (pool && conn) pool->Release(conn);
+        }
+    };
+
+    std::unique_ptr<ConnGuard> Acquire(int timeout_ms = 5000) {
+        using namespace std::chrono;
+        auto start = steady_clock::now();
+        auto deadline = start + milliseconds(timeout_ms);
+        auto make_guard = [&](FakeConn* c) {
+            stats_.RecordAcquire(duration_cast<microseconds>(steady_clock::now() - start).count(), true);
+            auto g = std::make_unique<ConnGuard>();
+            g->conn = c;
+            g->pool = this;
+            return g;
+        };
+        std::unique_lock lk(mu_);
+        while (true) {
+            if (!idle_.empty()) {
+                FakeConn* c = idle_.back().conn;
+                idle_.pop_back();
+                return make_guard(c);
+            }
+            if (total_created_ < max_pool_) {
+                ++total_created_;
+                lk.unlock();
+                FakeConn* c = traits_.Create();
+                lk.lock();
+                return make_guard(c);
+            }
+            if (cv_.wait_until(lk, deadline) == std::cv_status::timeout) {
+                stats_.RecordAcquire(duration_cast<microseconds>(steady_clock::now() - start).count(), false);
+                return nullptr;
+            }
+        }
+    }
+
+private:
+    struct IdleConn {
+        FakeConn* conn;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    void Release(FakeConn* conn) {
+        std::unique_lock lk(mu_);
+        idle_.push_back({conn, std::chrono::steady_clock::now()});
+        lk.unlock();
+        cv_.notify_one();
+    }
+
+    FakeConnTraits traits_;
+    size_t max_pool_;
+    std::deque<IdleConn> idle_;
+    size_t total_created_ = 0;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    PoolStats stats_;
+};
+
+PoolOptions BenchOptions(size_t max_pool) {
+    PoolOptions options;
+    options.min_pool = max_pool;
+    options.max_pool = max_pool;
+    options.keepalive_interval_sec = 3600;
+    return options;
+}
+
+// 池在所有基准线程间共享, 按池大小缓存
+template <typename Pool, typename Factory>
+Pool& SharedPool(size_t max_pool, Factory make) {
+    static std::mutex mu;
+    static std::map<size_t, std::unique_ptr<Pool>> pools;
+    std::lock_guard<std::mutex> lk(mu);
+    auto& p = pools[max_pool];
+    if (!p) p = make(max_pool);
+    return *p;
+}
+
+void BM_LegacyPool_AcquireRelease(benchmark::State& state) {
+    auto& pool = SharedPool<LegacyPool>(state.range(0), [](size_t n) {
+        return std::make_unique<LegacyPool>(n, n);
+    });
+    for (auto _ : state) {
+        auto g = pool.Acquire();
+        g->conn->uses++;
+        benchmark::DoNotOptimize(g->conn);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ConnectionPool_AcquireRelease(benchmark::State& state) {
+    using Pool = ConnectionPool<FakeConnTraits>;
+    auto& pool = SharedPool<Pool>(state.range(0), [](size_t n) {
+        return std::make_unique<Pool>(FakeConnTraits{}, BenchOptions(n));
+    });
+    for (auto _ : state) {
+        auto g = pool.Acquire();
+        g.get()->uses++;
+        benchmark::DoNotOptimize(g.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Arg: 池大小 (20 = DbPool 默认上限, 50 = RedisPool 默认上限)
+#define POOL_BENCH_ARGS ->Arg(20)->Arg(50)->ThreadRange(1, 64)->UseRealTime()
+
+BENCHMARK(BM_LegacyPool_AcquireRelease) POOL_BENCH_ARGS;
+BENCHMARK(BM_ConnectionPool_AcquireRelease) POOL_BENCH_ARGS;
+
+}  // namespace
+
+BENCHMARK_MAIN();
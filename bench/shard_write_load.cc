@@ -0,0 +1,110 @@
+// 消息分片写入压测: 对同一批分片依次使用前 1..N 个分片, 多线程调用 PooledDbClient::SaveMessage,
+// 输出每种分片数下的写入吞吐, 用于验证吞吐随分片数近似线性增长
+//
+// 用法: shard_write_load [--config ../config.yaml] [--shards 1,2,4] [--threads 32] [--seconds 10] [--users 100000]
+// 分片取自 postgres.message_shards; 测试数据写入 t_chat_msg, from_uid 固定为 0 以便清理
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "../common/config/config.h"
+#include "db_pool.h"
+#include "pool_db_client.h"
+#include "shard_router.h"
+
+namespace {
+
+std::vector<int> ParseList(const char* arg) {
+    std::vector<int> out;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(std::atoi(item.c_str()));
+    }
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string config_file = "../config.yaml";
+    std::vector<int> shard_counts;
+    int threads = 32;
+    int seconds = 10;
+    int64_t users = 100000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--config")) config_file = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--shards")) shard_counts = ParseList(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--threads")) threads = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--seconds")) seconds = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--users")) users = std::atoll(argv[i + 1]);
+    }
+
+    Config& config = Config::Instance();
+    if (!config.Load(config_file)) return 1;
+    const auto& db_cfg = config.GetPostgresConfig();
+    if (db_cfg.message_shards.empty()) {
+        spdlog::error("postgres.message_shards is empty");
+        return 1;
+    }
+    if (shard_counts.empty()) {
+        for (size_t n = 1; n <= db_cfg.message_shards.size(); n *= 2) shard_counts.push_back(static_cast<int>(n));
+    }
+
+    PoolOptions options;
+    options.min_pool = 1;
+    options.max_pool = static_cast<size_t>(threads);
+    std::vector<std::unique_ptr<DbPool>> pools;
+    for (const auto& shard : db_cfg.message_shards) {
+        std::string conninfo = "dbname=" + db_cfg.dbname + " user=" + db_cfg.user + " password=" + db_cfg.password +
+                               " hostaddr=" + shard.host + " port=" + std::to_string(shard.port) + " connect_timeout=3";
+        pools.push_back(std::make_unique<DbPool>(conninfo, options));
+    }
+
+    // 机器可读输出, 每种分片数一行 JSON
+    for (int count : shard_counts) {
+        if (count <= 0 || static_cast<size_t>(count) > pools.size()) continue;
+        std::vector<MessageShard> shards;
+        for (int i = 0; i < count; ++i) shards.push_back({db_cfg.message_shards[i].name, pools[i].get(), false});
+        ShardRouter router(shards);
+        PooledDbClient client(pools[0].get(), nullptr, &router);
+
+        std::atomic<bool> stop{false};
+        std::atomic<int64_t> ok{0};
+        std::atomic<int64_t> failed{0};
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937_64 rng(t * 7919 + count);
+                std::uniform_int_distribution<int64_t> pick(1, users);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    int64_t msg_id = std::chrono::system_clock::now().time_since_epoch().count();
+                    if (client.SaveMessage(std::to_string(msg_id), 0, pick(rng), "shard load test") > 0) {
+                        ok.fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        failed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop = true;
+        for (auto& w : workers) w.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("{\"shards\":%d,\"threads\":%d,\"seconds\":%.2f,\"writes\":%lld,\"failed\":%lld,\"writes_per_sec\":%.1f}\n",
+                    count, threads, elapsed, static_cast<long long>(ok.load()), static_cast<long long>(failed.load()),
+                    ok.load() / elapsed);
+        std::fflush(stdout);
+    }
+    return 0;
+}
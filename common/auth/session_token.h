@@ -0,0 +1,176 @@
+#pragma once
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include "../config/config.h"
+
+// 吊销表: HSET IM:AUTH:REVOKED <uid> <not_before>, iat <= not_before 的令牌全部失效
+// iat 与 not_before 都是毫秒, 登出后同一秒内重新登录签发的令牌不会被误判为已吊销
+inline const char* kRevokedTokensKey = "IM:AUTH:REVOKED";
+
+// 旧版本写入的是秒级时间戳, 小于该值的按秒处理
+inline constexpr int64_t kSecondTimestampBound = 100000000000LL;
+
+inline int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 秒级 iat 取该秒的起点, 秒级 not_before 取该秒的终点, 与按秒比较时的判定结果一致
+inline int64_t IssuedAtMs(int64_t issued_at) {
+    return issued_at < kSecondTimestampBound ? issued_at * 1000 : issued_at;
+}
+
+inline int64_t NotBeforeMs(int64_t not_before) {
+    return not_before < kSecondTimestampBound ? not_before * 1000 + 999 : not_before;
+}
+
+inline bool RevokedBy(int64_t issued_at_ms, int64_t not_before_ms) {
+    return issued_at_ms <= not_before_ms;
+}
+
+struct SessionToken {
+    int64_t uid = 0;
+    std::string device_id;
+    int64_t issued_at = 0;   // 毫秒
+    int64_t expires_at = 0;  // 秒
+    std::string key_id;
+};
+
+inline std::string Base64UrlEncode(const std::string& in) {
+    static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    uint32_t val = 0;
+    int bits = 0;
+    for (unsigned char c : in) {
+        val = (val << 8) | c;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out.push_back(table[(val >> bits) & 0x3F]);
+        }
+    }
+    if (bits > 0) {
+        out.push_back(table[(val << (6 - bits)) & 0x3F]);
+    }
+    return out;
+}
+
+inline bool Base64UrlDecode(const std::string& in, std::string& out) {
+    out.clear();
+    out.reserve(in.size() * 3 / 4);
+    uint32_t val = 0;
+    int bits = 0;
+    for (char c : in) {
+        int d;
+        if (c >= 'A' && c <= 'Z') d = c - 'A';
+        else if (c >= 'a' && c <= 'z') d = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') d = c - '0' + 52;
+        else if (c == '-') d = 62;
+        else if (c == '_') d = 63;
+        else return false;
+        val = (val << 6) | static_cast<uint32_t>(d);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((val >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
+
+// 无状态会话令牌: v1.<kid>.<base64url(uid|device|iat|exp)>.<base64url(HMAC-SHA256)>
+// 签名使用 active key, 校验时接受 key ring 中的任意 key, 便于轮换
+class SessionTokenCodec {
+public:
+    enum class VerifyResult { OK, MALFORMED, UNKNOWN_KEY, BAD_SIGNATURE, EXPIRED };
+
+    SessionTokenCodec(const std::string& active_key_id,
+                      const std::unordered_map<std::string, std::string>& keys,
+                      int64_t ttl_sec)
+        : active_key_id_(active_key_id), keys_(keys), ttl_sec_(ttl_sec) {}
+
+    explicit SessionTokenCodec(const Config::AuthConfig& cfg)
+        : SessionTokenCodec(cfg.active_key_id, cfg.keys, cfg.token_ttl_sec) {}
+
+    static bool LooksSigned(const std::string& token) {
+        return token.compare(0, 3, "v1.") == 0;
+    }
+
+    std::string Issue(int64_t uid, const std::string& device_id, int64_t now_ms = NowMs()) const {
+        auto it = keys_.find(active_key_id_);
+        if (it == keys_.end()) {
+            return "";
+        }
+        std::string payload = std::to_string(uid) + "|" + device_id + "|" +
+                              std::to_string(now_ms) + "|" + std::to_string(now_ms / 1000 + ttl_sec_);
+        std::string signing_input = "v1." + active_key_id_ + "." + Base64UrlEncode(payload);
+        return signing_input + "." + Base64UrlEncode(Sign(it->second, signing_input));
+    }
+
+    // 令牌需与登录请求的 uid 一致; 签发时绑定了设备的令牌只能在该设备上使用
+    static bool Matches(const SessionToken& token, int64_t uid, const std::string& device_id) {
+        return token.uid == uid && (token.device_id.empty() || token.device_id == device_id);
+    }
+
+    VerifyResult Verify(const std::string& token, SessionToken& out) const {
+        if (!LooksSigned(token)) return VerifyResult::MALFORMED;
+        size_t kid_end = token.find('.', 3);
+        if (kid_end == std::string::npos) return VerifyResult::MALFORMED;
+        size_t payload_end = token.find('.', kid_end + 1);
+        if (payload_end == std::string::npos) return VerifyResult::MALFORMED;
+
+        std::string kid = token.substr(3, kid_end - 3);
+        auto it = keys_.find(kid);
+        if (it == keys_.end()) return VerifyResult::UNKNOWN_KEY;
+
+        std::string sig;
+        if (!Base64UrlDecode(token.substr(payload_end + 1), sig)) return VerifyResult::MALFORMED;
+        std::string expected = Sign(it->second, token.substr(0, payload_end));
+        if (sig.size() != expected.size() ||
+            CRYPTO_memcmp(sig.data(), expected.data(), sig.size()) != 0) {
+            return VerifyResult::BAD_SIGNATURE;
+        }
+
+        std::string payload;
+        if (!Base64UrlDecode(token.substr(kid_end + 1, payload_end - kid_end - 1), payload)) {
+            return VerifyResult::MALFORMED;
+        }
+        // device_id 可能包含 '|', uid 取第一段, iat/exp 取最后两段
+        size_t p1 = payload.find('|');
+        size_t p3 = payload.rfind('|');
+        size_t p2 = p3 == std::string::npos || p3 == 0 ? std::string::npos : payload.rfind('|', p3 - 1);
+        if (p1 == std::string::npos || p2 == std::string::npos || p2 <= p1) return VerifyResult::MALFORMED;
+        try {
+            out.uid = std::stoll(payload.substr(0, p1));
+            out.device_id = payload.substr(p1 + 1, p2 - p1 - 1);
+            out.issued_at = IssuedAtMs(std::stoll(payload.substr(p2 + 1, p3 - p2 - 1)));
+            out.expires_at = std::stoll(payload.substr(p3 + 1));
+        } catch (const std::exception&) {
+            return VerifyResult::MALFORMED;
+        }
+        out.key_id = kid;
+
+        if (out.expires_at <= time(nullptr)) return VerifyResult::EXPIRED;
+        return VerifyResult::OK;
+    }
+
+private:
+    static std::string Sign(const std::string& secret, const std::string& data) {
+        unsigned char mac[EVP_MAX_MD_SIZE];
+        unsigned int mac_len = 0;
+        HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+             reinterpret_cast<const unsigned char*>(data.data()), data.size(), mac, &mac_len);
+        return std::string(reinterpret_cast<char*>(mac), mac_len);
+    }
+
+    std::string active_key_id_;
+    std::unordered_map<std::string, std::string> keys_;
+    int64_t ttl_sec_;
+};
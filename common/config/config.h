@@ -1,5 +1,13 @@
 #pragma once
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
 #include <yaml-cpp/yaml.h>
 #include <spdlog/spdlog.h>
 
@@ -11,24 +19,164 @@ public:
         std::string password;
     };
 
+    struct PostgresEndpoint {
+        std::string host;
+        int port;
+    };
+
+    struct MessageShardConfig {
+        std::string name;   // 参与一致性哈希, 上线后不可更改
+        std::string host;
+        int port;
+        bool migrating;     // 新加入的分片, 存量数据迁移完成前为 true
+    };
+
     struct PostgresConfig {
         std::string host;
         int port;
         std::string user;
         std::string password;
         std::string dbname;
+        // 只读副本, 账号与库名同主库
+        std::vector<PostgresEndpoint> replicas;
+        int replica_max_lag_ms;
+        int read_your_writes_ms;
+        int replica_check_interval_ms;
+        // 消息存储分片, 为空时消息表在主库
+        std::vector<MessageShardConfig> message_shards;
     };
 
     struct GrpcConfig {
         std::string logic_server_addr;
-        std::string gateway_server_addr;
+        std::string gateway_server_addr;        // 本网关对 logic server 公布的推送地址
         std::string logic_server_listen_addr;
         std::string gateway_server_listen_addr;
+        // 网关侧负载均衡的 logic server 列表, 未配置时为 [logic_server_addr]
+        std::vector<std::string> logic_server_addrs;
+        std::string gateway_id;                 // 未配置时取 gateway_server_addr, 多网关时必须唯一
+        int gateway_lease_ttl_sec;
     };
 
     struct SeaweedFSConfig {
         std::string master_endpoint;
         std::string public_endpoint;
+        int connect_timeout_ms;
+        int request_timeout_ms;
+        int max_idle_conns;   // 每个 endpoint 保留的 keep-alive 连接数
+        int assign_batch;       // 预取 fid 的批量 (/dir/assign?count=N), <= 1 关闭预取
+        int assign_low_water;   // 池内 fid 少于此数时后台补充
+        int fid_ttl_sec;
+        int fid_cache_capacity;   // 对象 key -> fid 的本地 LRU 容量, 完整映射在 Postgres (t_object_fid)
+        // 网关 /api/upload 流式代理
+        int upload_max_mb;
+        int upload_max_pending_kb;   // 上游积压超过此值时暂停读取客户端
+        int upload_timeout_sec;
+    };
+
+    // 口令哈希 (scrypt) 的独立线程池; 排队超过 max_queue 的登录/注册直接回复繁忙
+    struct PasswordHashConfig {
+        int threads;
+        int max_queue;
+        int scrypt_log_n;   // N = 2^log_n, 内存约 128 * r * N 字节
+        int scrypt_r;
+        int scrypt_p;
+    };
+
+    struct AuthConfig {
+        std::string active_key_id;
+        std::unordered_map<std::string, std::string> keys;  // kid -> secret
+        int token_ttl_sec;
+        int revocation_refresh_sec;
+        bool allow_dev_key;   // 仅本地开发: keys 为空时使用内置密钥, 该密钥公开, 生产环境必须关闭
+        PasswordHashConfig password_hash;
+    };
+
+    struct PoolConfig {
+        int min_pool;
+        int max_pool;
+        int max_pool_limit;   // 运行时 max 可调到的上限 (决定槽位数), 只在启动时生效
+        int acquire_timeout_ms;
+        int idle_timeout_sec;
+        int keepalive_interval_sec;
+    };
+
+    struct PoolsConfig {
+        PoolConfig postgres;
+        PoolConfig redis;
+        int stats_log_interval_sec;
+    };
+
+    struct LogConfig {
+        size_t queue_size;                          // 异步日志队列条数, 满时丢最旧的
+        int flush_interval_sec;
+        std::string level;
+        std::map<std::string, std::string> modules;  // 模块 logger 的初始级别
+    };
+
+    // 网关 /ws 的连接参数. uWS 在注册路由时固定这些值, 运行时修改只能在启动值以内收紧:
+    // 超过 max_payload_kb 的上行包丢弃, 待发送字节超过 max_backpressure_kb 的连接跳过推送
+    struct WsConfig {
+        int max_payload_kb;
+        int idle_timeout_sec;        // 只在启动时生效
+        int max_backpressure_kb;
+    };
+
+    // 排空 / 平滑重启: 收到 SIGTERM 或新进程请求交接后停止 accept, 在 drain_sec 内分散关闭客户端连接
+    struct DrainConfig {
+        int drain_sec;
+        int unregister_batch;        // 会话路由删除每批条数 (一次 Redis 往返)
+        std::string control_socket;  // 新旧进程交接用的 Unix socket, 为空时不支持交接
+    };
+
+    // 上行请求按 cmd 配置的令牌桶, rate 为每秒令牌数, <= 0 表示该维度不限
+    struct RateLimitRuleConfig {
+        int cmd;
+        double uid_rate;
+        double uid_burst;
+        double ip_rate;
+        double ip_burst;
+    };
+
+    struct RateLimitConfig {
+        bool enabled;
+        int table_capacity;   // 桶表槽位数, 只在启动时生效
+        std::vector<RateLimitRuleConfig> rules;
+        std::vector<std::string> exempt_ips;   // 不受限流的来源地址 (压测机等)
+    };
+
+    struct GatewayConfig {
+        WsConfig ws;
+        DrainConfig drain;
+        RateLimitConfig rate_limit;
+    };
+
+    struct TraceConfig {
+        int sample_every;    // 网关每 N 个请求采样一个 (按 trace id 取模), 0 关闭
+        int ring_capacity;   // 每个线程保留的最近 span 数
+    };
+
+    struct MetricsConfig {
+        std::string logic_listen_addr;  // logic server 的 /metrics 监听地址, 为空则不启动; 网关直接挂在 uWS 端口上
+        // /debug/* (日志级别 / 追踪导出 / 配置重载) 只在管理端口上提供, 默认只监听本机; 为空则不提供
+        std::string gateway_admin_addr;
+        std::string logic_admin_addr;
+    };
+
+    struct StorageConfig {
+        std::string backend;       // "postgres": Postgres + Redis; "embedded": 本地日志, 单机部署 / 压测
+        std::string data_dir;      // embedded 的日志目录
+        size_t segment_bytes;
+        int sync_interval_ms;      // 0 表示每次写入都 fdatasync
+    };
+
+    // 发送去重: 客户端超时重发的 MsgSendReq 按 (uid, device, seq_id) 返回首次的结果
+    struct SendDedupConfig {
+        int window_sec;    // 进程内窗口与 Redis 标记的有效期, 应大于客户端的最长重试间隔
+        int max_entries;   // 进程内窗口的条目上限, 超出后提前轮换, 更早的重发由 Redis 兜底
+    };
+
+    struct MessageConfig {
+        SendDedupConfig send_dedup;
     };
 
     struct ServerConfig {
@@ -36,45 +184,71 @@ public:
         PostgresConfig postgres;
         GrpcConfig grpc;
         SeaweedFSConfig seaweedfs;
+        AuthConfig auth;
+        PoolsConfig pools;
+        MetricsConfig metrics;
+        TraceConfig trace;
+        LogConfig log;
+        StorageConfig storage;
+        GatewayConfig gateway;
+        MessageConfig message;
     };
 
+    using ReloadListener = std::function<void(const ServerConfig&)>;
+
     static Config& Instance() {
         static Config instance;
         return instance;
     }
 
+    // 启动时调用一次. Get*Config() 返回的是这份启动配置, 之后不再改变, 可以长期持有引用
     bool Load(const std::string& config_file = "config.yaml") {
-        try {
-            YAML::Node config = YAML::LoadFile(config_file);
-
-            // Redis
-            config_.redis.host = config["redis"]["host"].as<std::string>("0.0.0.0");
-            config_.redis.port = config["redis"]["port"].as<int>(6379);
-            config_.redis.password = config["redis"]["password"].as<std::string>("redis_pwd_123");
-
-            // PostgreSQL
-            config_.postgres.host = config["postgres"]["host"].as<std::string>("127.0.0.1");
-            config_.postgres.port = config["postgres"]["port"].as<int>(5432);
-            config_.postgres.user = config["postgres"]["user"].as<std::string>("admin");
-            config_.postgres.password = config["postgres"]["password"].as<std::string>("admin_pwd");
-            config_.postgres.dbname = config["postgres"]["dbname"].as<std::string>("LetsChat");
+        if (!Parse(config_file, config_)) return false;
+        {
+            std::lock_guard<std::mutex> lk(reload_mu_);
+            path_ = config_file;
+        }
+        Publish(std::make_shared<const ServerConfig>(config_));
+        spdlog::info("Configuration loaded successfully");
+        return true;
+    }
 
-            // gRPC
-            config_.grpc.logic_server_addr = config["grpc"]["logic_server_addr"].as<std::string>("0.0.0.0:50051");
-            config_.grpc.gateway_server_addr = config["grpc"]["gateway_server_addr"].as<std::string>("0.0.0.0:50052");
-            config_.grpc.logic_server_listen_addr = config["grpc"]["logic_server_listen_addr"].as<std::string>("0.0.0.0:50051");
-            config_.grpc.gateway_server_listen_addr = config["grpc"]["gateway_server_listen_addr"].as<std::string>("0.0.0.0:50052");
+    // 重新读取配置文件并发布新快照, 再在调用线程上依次通知 OnReload 注册的回调.
+    // 文件解析失败或取值不合法时保留当前快照, 返回 false
+    bool Reload() {
+        std::lock_guard<std::mutex> lk(reload_mu_);
+        if (path_.empty()) return false;
+        ServerConfig fresh;
+        if (!Parse(path_, fresh)) return false;
+        auto snapshot = std::make_shared<const ServerConfig>(std::move(fresh));
+        Publish(snapshot);
+        spdlog::warn("Configuration reloaded from {} (version {})", path_, Version());
+        for (const auto& listener : listeners_) listener(*snapshot);
+        return true;
+    }
 
-            // SeaweedFS
-            config_.seaweedfs.master_endpoint = config["seaweedfs"]["master_endpoint"].as<std::string>("http://127.0.0.1:9333");
-            config_.seaweedfs.public_endpoint = config["seaweedfs"]["public_endpoint"].as<std::string>("http://127.0.0.1:8080");
+    // 回调在执行 Reload 的线程上调用 (配置监视线程或管理接口), 需自行保证线程安全
+    void OnReload(ReloadListener listener) {
+        std::lock_guard<std::mutex> lk(reload_mu_);
+        listeners_.push_back(std::move(listener));
+    }
 
-            spdlog::info("Configuration loaded successfully");
-            return true;
-        } catch (const std::exception& e) {
-            spdlog::error("Failed to load config: {}", e.what());
-            return false;
+    // 当前生效的配置快照, 热路径上读取可热更新的参数用.
+    // 每个线程缓存一份快照指针, 版本号未变时只有一次 acquire 读, 不加锁;
+    // 返回的快照由调用方持有, 之后的重新加载不会使它失效
+    std::shared_ptr<const ServerConfig> Current() const {
+        thread_local std::shared_ptr<const ServerConfig> cached;
+        thread_local uint64_t cached_version = 0;
+        uint64_t version = version_.load(std::memory_order_acquire);
+        if (version != cached_version || !cached) {
+            cached = std::atomic_load_explicit(&current_, std::memory_order_acquire);
+            cached_version = version;
         }
+        return cached;
+    }
+
+    uint64_t Version() const {
+        return version_.load(std::memory_order_acquire);
     }
 
     const ServerConfig& GetConfig() const {
@@ -97,7 +271,252 @@ public:
         return config_.seaweedfs;
     }
 
+    const AuthConfig& GetAuthConfig() const {
+        return config_.auth;
+    }
+
+    const PoolsConfig& GetPoolsConfig() const {
+        return config_.pools;
+    }
+
+    const MetricsConfig& GetMetricsConfig() const {
+        return config_.metrics;
+    }
+
+    const TraceConfig& GetTraceConfig() const {
+        return config_.trace;
+    }
+
+    const LogConfig& GetLogConfig() const {
+        return config_.log;
+    }
+
+    const StorageConfig& GetStorageConfig() const {
+        return config_.storage;
+    }
+
+    const MessageConfig& GetMessageConfig() const {
+        return config_.message;
+    }
+
 private:
     Config() = default;
-    ServerConfig config_;
+
+    static bool Parse(const std::string& config_file, ServerConfig& out) {
+        try {
+            YAML::Node config = YAML::LoadFile(config_file);
+
+            // Redis
+            out.redis.host = config["redis"]["host"].as<std::string>("0.0.0.0");
+            out.redis.port = config["redis"]["port"].as<int>(6379);
+            out.redis.password = config["redis"]["password"].as<std::string>("redis_pwd_123");
+
+            // PostgreSQL
+            out.postgres.host = config["postgres"]["host"].as<std::string>("127.0.0.1");
+            out.postgres.port = config["postgres"]["port"].as<int>(5432);
+            out.postgres.user = config["postgres"]["user"].as<std::string>("admin");
+            out.postgres.password = config["postgres"]["password"].as<std::string>("admin_pwd");
+            out.postgres.dbname = config["postgres"]["dbname"].as<std::string>("LetsChat");
+            out.postgres.replicas.clear();
+            for (const auto& replica : config["postgres"]["replicas"]) {
+                out.postgres.replicas.push_back({replica["host"].as<std::string>(), replica["port"].as<int>(5432)});
+            }
+            out.postgres.replica_max_lag_ms = config["postgres"]["replica_max_lag_ms"].as<int>(1000);
+            out.postgres.read_your_writes_ms = config["postgres"]["read_your_writes_ms"].as<int>(3000);
+            out.postgres.replica_check_interval_ms = config["postgres"]["replica_check_interval_ms"].as<int>(1000);
+            out.postgres.message_shards.clear();
+            for (const auto& shard : config["postgres"]["message_shards"]) {
+                out.postgres.message_shards.push_back({shard["name"].as<std::string>(),
+                                                           shard["host"].as<std::string>(),
+                                                           shard["port"].as<int>(5432),
+                                                           shard["state"].as<std::string>("active") == "migrating"});
+            }
+
+            // gRPC
+            out.grpc.logic_server_addr = config["grpc"]["logic_server_addr"].as<std::string>("0.0.0.0:50051");
+            out.grpc.gateway_server_addr = config["grpc"]["gateway_server_addr"].as<std::string>("0.0.0.0:50052");
+            out.grpc.logic_server_listen_addr = config["grpc"]["logic_server_listen_addr"].as<std::string>("0.0.0.0:50051");
+            out.grpc.gateway_server_listen_addr = config["grpc"]["gateway_server_listen_addr"].as<std::string>("0.0.0.0:50052");
+            out.grpc.logic_server_addrs.clear();
+            for (const auto& addr : config["grpc"]["logic_server_addrs"]) {
+                out.grpc.logic_server_addrs.push_back(addr.as<std::string>());
+            }
+            if (out.grpc.logic_server_addrs.empty()) {
+                out.grpc.logic_server_addrs.push_back(out.grpc.logic_server_addr);
+            }
+            out.grpc.gateway_id = config["grpc"]["gateway_id"].as<std::string>("");
+            if (out.grpc.gateway_id.empty()) out.grpc.gateway_id = out.grpc.gateway_server_addr;
+            out.grpc.gateway_lease_ttl_sec = config["grpc"]["gateway_lease_ttl_sec"].as<int>(15);
+
+            // SeaweedFS
+            out.seaweedfs.master_endpoint = config["seaweedfs"]["master_endpoint"].as<std::string>("http://127.0.0.1:9333");
+            out.seaweedfs.public_endpoint = config["seaweedfs"]["public_endpoint"].as<std::string>("http://127.0.0.1:8080");
+            out.seaweedfs.connect_timeout_ms = config["seaweedfs"]["connect_timeout_ms"].as<int>(1000);
+            out.seaweedfs.request_timeout_ms = config["seaweedfs"]["request_timeout_ms"].as<int>(3000);
+            out.seaweedfs.max_idle_conns = config["seaweedfs"]["max_idle_conns"].as<int>(8);
+            out.seaweedfs.assign_batch = config["seaweedfs"]["assign_batch"].as<int>(64);
+            out.seaweedfs.assign_low_water = config["seaweedfs"]["assign_low_water"].as<int>(16);
+            out.seaweedfs.fid_ttl_sec = config["seaweedfs"]["fid_ttl_sec"].as<int>(60);
+            out.seaweedfs.fid_cache_capacity = config["seaweedfs"]["fid_cache_capacity"].as<int>(100000);
+            const auto& upload_node = config["seaweedfs"]["upload_proxy"];
+            out.seaweedfs.upload_max_mb = upload_node["max_upload_mb"].as<int>(64);
+            out.seaweedfs.upload_max_pending_kb = upload_node["max_pending_kb"].as<int>(256);
+            out.seaweedfs.upload_timeout_sec = upload_node["timeout_sec"].as<int>(30);
+
+            // Auth
+            out.auth.active_key_id = config["auth"]["active_key_id"].as<std::string>("default");
+            out.auth.token_ttl_sec = config["auth"]["token_ttl_sec"].as<int>(7 * 24 * 3600);
+            out.auth.revocation_refresh_sec = config["auth"]["revocation_refresh_sec"].as<int>(5);
+            out.auth.keys.clear();
+            for (const auto& key : config["auth"]["keys"]) {
+                out.auth.keys[key["id"].as<std::string>()] = key["secret"].as<std::string>();
+            }
+            out.auth.allow_dev_key = config["auth"]["allow_dev_key"].as<bool>(false);
+            if (out.auth.keys.empty()) {
+                if (!out.auth.allow_dev_key) {
+                    spdlog::error("No auth keys configured; set auth.keys, or auth.allow_dev_key for local development only");
+                    return false;
+                }
+                spdlog::warn("No auth keys configured, using built-in development key (auth.allow_dev_key)");
+                out.auth.keys[out.auth.active_key_id] = "letschat_dev_secret";
+            }
+            const auto& hash_node = config["auth"]["password_hash"];
+            out.auth.password_hash.threads = hash_node["threads"].as<int>(2);
+            out.auth.password_hash.max_queue = hash_node["max_queue"].as<int>(64);
+            out.auth.password_hash.scrypt_log_n = hash_node["scrypt_log_n"].as<int>(14);
+            out.auth.password_hash.scrypt_r = hash_node["scrypt_r"].as<int>(8);
+            out.auth.password_hash.scrypt_p = hash_node["scrypt_p"].as<int>(1);
+
+            // Connection pools
+            auto load_pool = [](const YAML::Node& node, int min_pool, int max_pool, int acquire_timeout_ms) {
+                PoolConfig pool;
+                pool.min_pool = node["min"].as<int>(min_pool);
+                pool.max_pool = node["max"].as<int>(max_pool);
+                pool.max_pool_limit = node["max_limit"].as<int>(pool.max_pool * 2);
+                pool.acquire_timeout_ms = node["acquire_timeout_ms"].as<int>(acquire_timeout_ms);
+                pool.idle_timeout_sec = node["idle_timeout_sec"].as<int>(300);
+                pool.keepalive_interval_sec = node["keepalive_interval_sec"].as<int>(30);
+                return pool;
+            };
+            out.pools.postgres = load_pool(config["pool"]["postgres"], 2, 20, 5000);
+            out.pools.redis = load_pool(config["pool"]["redis"], 2, 50, 2000);
+            out.pools.stats_log_interval_sec = config["pool"]["stats_log_interval_sec"].as<int>(60);
+
+            // Metrics
+            out.metrics.logic_listen_addr = config["metrics"]["logic_listen_addr"].as<std::string>("0.0.0.0:9102");
+            out.metrics.gateway_admin_addr = config["metrics"]["gateway_admin_addr"].as<std::string>("127.0.0.1:9101");
+            out.metrics.logic_admin_addr = config["metrics"]["logic_admin_addr"].as<std::string>("127.0.0.1:9103");
+
+            // Tracing
+            out.trace.sample_every = config["trace"]["sample_every"].as<int>(1000);
+            out.trace.ring_capacity = config["trace"]["ring_capacity"].as<int>(4096);
+
+            // Logging
+            out.log.queue_size = config["log"]["queue_size"].as<size_t>(8192);
+            out.log.flush_interval_sec = config["log"]["flush_interval_sec"].as<int>(1);
+            out.log.level = config["log"]["level"].as<std::string>("info");
+            out.log.modules.clear();
+            for (const auto& module : config["log"]["modules"]) {
+                out.log.modules[module.first.as<std::string>()] = module.second.as<std::string>();
+            }
+
+            // Gateway
+            const auto& ws_node = config["gateway"]["ws"];
+            out.gateway.ws.max_payload_kb = ws_node["max_payload_kb"].as<int>(16);
+            out.gateway.ws.idle_timeout_sec = ws_node["idle_timeout_sec"].as<int>(60);
+            out.gateway.ws.max_backpressure_kb = ws_node["max_backpressure_kb"].as<int>(64);
+            const auto& drain_node = config["gateway"]["drain"];
+            out.gateway.drain.drain_sec = drain_node["drain_sec"].as<int>(30);
+            out.gateway.drain.unregister_batch = drain_node["unregister_batch"].as<int>(500);
+            out.gateway.drain.control_socket = drain_node["control_socket"].as<std::string>("/tmp/im_gateway.sock");
+            const auto& limit_node = config["gateway"]["rate_limit"];
+            out.gateway.rate_limit.enabled = limit_node["enabled"].as<bool>(true);
+            out.gateway.rate_limit.table_capacity = limit_node["table_capacity"].as<int>(65536);
+            out.gateway.rate_limit.rules.clear();
+            for (const auto& rule : limit_node["rules"]) {
+                out.gateway.rate_limit.rules.push_back({rule["cmd"].as<int>(),
+                                                        rule["uid_rate"].as<double>(0),
+                                                        rule["uid_burst"].as<double>(0),
+                                                        rule["ip_rate"].as<double>(0),
+                                                        rule["ip_burst"].as<double>(0)});
+            }
+            out.gateway.rate_limit.exempt_ips.clear();
+            for (const auto& ip : limit_node["exempt_ips"]) {
+                out.gateway.rate_limit.exempt_ips.push_back(ip.as<std::string>());
+            }
+
+            const auto& dedup_node = config["message"]["send_dedup"];
+            out.message.send_dedup.window_sec = dedup_node["window_sec"].as<int>(300);
+            out.message.send_dedup.max_entries = dedup_node["max_entries"].as<int>(1000000);
+
+            // Storage backend
+            out.storage.backend = config["storage"]["backend"].as<std::string>("postgres");
+            out.storage.data_dir = config["storage"]["embedded"]["data_dir"].as<std::string>("./data");
+            out.storage.segment_bytes = config["storage"]["embedded"]["segment_mb"].as<size_t>(64) << 20;
+            out.storage.sync_interval_ms = config["storage"]["embedded"]["sync_interval_ms"].as<int>(100);
+
+            return Validate(out);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to load config: {}", e.what());
+            return false;
+        }
+    }
+
+    // 只检查热更新会直接套用的参数, 不合法时整份配置不生效
+    static bool Validate(const ServerConfig& cfg) {
+        for (const auto* pool : {&cfg.pools.postgres, &cfg.pools.redis}) {
+            if (pool->max_pool < 1 || pool->min_pool < 0 || pool->min_pool > pool->max_pool || pool->acquire_timeout_ms < 0) {
+                spdlog::error("Invalid config: pool min={} max={} acquire_timeout_ms={}", pool->min_pool, pool->max_pool,
+                              pool->acquire_timeout_ms);
+                return false;
+            }
+        }
+        const auto& ws = cfg.gateway.ws;
+        if (ws.max_payload_kb < 1 || ws.idle_timeout_sec < 0 || ws.max_backpressure_kb < 0) {
+            spdlog::error("Invalid config: gateway.ws max_payload_kb={} idle_timeout_sec={} max_backpressure_kb={}", ws.max_payload_kb,
+                          ws.idle_timeout_sec, ws.max_backpressure_kb);
+            return false;
+        }
+        for (const auto& rule : cfg.gateway.rate_limit.rules) {
+            if (rule.cmd <= 0 || rule.cmd > 0xFFFF || (rule.uid_rate > 0 && rule.uid_burst < 1) ||
+                (rule.ip_rate > 0 && rule.ip_burst < 1)) {
+                spdlog::error("Invalid config: gateway.rate_limit rule cmd={:#x} needs burst >= 1 when rate > 0", rule.cmd);
+                return false;
+            }
+        }
+        for (const auto& ip : cfg.gateway.rate_limit.exempt_ips) {
+            unsigned char addr[16];
+            if (inet_pton(AF_INET, ip.c_str(), addr) != 1 && inet_pton(AF_INET6, ip.c_str(), addr) != 1) {
+                spdlog::error("Invalid config: gateway.rate_limit.exempt_ips entry {} is not an IP address", ip);
+                return false;
+            }
+        }
+        auto valid_level = [](const std::string& level) {
+            return spdlog::level::from_str(level) != spdlog::level::off || level == "off";
+        };
+        if (!valid_level(cfg.log.level)) {
+            spdlog::error("Invalid config: log.level={}", cfg.log.level);
+            return false;
+        }
+        for (const auto& kv : cfg.log.modules) {
+            if (!valid_level(kv.second)) {
+                spdlog::error("Invalid config: log.modules.{}={}", kv.first, kv.second);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Publish(std::shared_ptr<const ServerConfig> snapshot) {
+        std::atomic_store_explicit(&current_, std::move(snapshot), std::memory_order_release);
+        version_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    ServerConfig config_;   // 启动配置
+
+    std::mutex reload_mu_;
+    std::string path_;
+    std::vector<ReloadListener> listeners_;
+    std::shared_ptr<const ServerConfig> current_;
+    std::atomic<uint64_t> version_{0};
 };
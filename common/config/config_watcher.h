@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include "config.h"
+
+// 监视配置文件, 变化后调用 Config::Reload.
+//
+// inotify 监视的是所在目录而不是文件本身: 编辑器和 ConfigMap 更新多是写临时文件再 rename 覆盖,
+// 直接监视文件会在第一次替换后失效. ConfigMap 挂载时 config.yaml 是指向 ..data/ 的符号链接, 更新只替换
+// ..data 链接, 目录里没有 config.yaml 自身的事件; 因此目录里有其它事件时再 stat 一次 (跟随符号链接),
+// 文件的 inode / 修改时间 / 大小变了也重新加载. 同一次保存往往产生多个事件, 最后一个事件后静默 debounce_ms 才重新加载.
+class ConfigWatcher {
+public:
+    explicit ConfigWatcher(const std::string& path, int debounce_ms = 200) : path_(path), debounce_ms_(debounce_ms) {
+        size_t slash = path_.rfind('/');
+        dir_ = slash == std::string::npos ? "." : (slash == 0 ? "/" : path_.substr(0, slash));
+        name_ = slash == std::string::npos ? path_ : path_.substr(slash + 1);
+    }
+
+    ~ConfigWatcher() { Stop(); }
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    bool Start() {
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0) {
+            spdlog::error("ConfigWatcher: inotify_init1 failed: errno={}", errno);
+            return false;
+        }
+        if (inotify_add_watch(fd_, dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            spdlog::error("ConfigWatcher: cannot watch {}: errno={}", dir_, errno);
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        stamp_ = Stamp();
+        worker_ = std::thread(&ConfigWatcher::Run, this);
+        spdlog::info("Watching {} for configuration changes", path_);
+        return true;
+    }
+
+    void Stop() {
+        stop_.store(true);
+        if (worker_.joinable()) worker_.join();
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    using FileStamp = std::tuple<dev_t, ino_t, time_t, long, off_t>;
+
+    // 跟随符号链接; 文件暂时不存在 (替换途中) 时返回全零
+    FileStamp Stamp() const {
+        struct stat st;
+        if (stat(path_.c_str(), &st) != 0) return FileStamp{};
+        return FileStamp{st.st_dev, st.st_ino, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size};
+    }
+
+    // 读完当前可读的事件, 返回是否需要重新加载: 有目标文件的事件, 或有其它事件且目标文件已变化
+    bool DrainEvents() {
+        alignas(inotify_event) char buf[4096];
+        bool matched = false;
+        bool other = false;
+        while (true) {
+            ssize_t n = read(fd_, buf, sizeof(buf));
+            if (n <= 0) break;
+            for (char* p = buf; p < buf + n;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len > 0 && name_ == event->name) matched = true;
+                else other = true;
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (!matched && !other) return false;
+        FileStamp stamp = Stamp();
+        bool changed = stamp != stamp_;
+        stamp_ = stamp;
+        return matched || changed;
+    }
+
+    void Run() {
+        // 停止标志最多 500ms 检查一次
+        bool pending = false;
+        auto due = std::chrono::steady_clock::now();
+        while (!stop_.load()) {
+            int timeout_ms = 500;
+            if (pending) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now()).count();
+                timeout_ms = left > 0 ? static_cast<int>(std::min<int64_t>(left, 500)) : 0;
+            }
+            pollfd pfd{fd_, POLLIN, 0};
+            if (poll(&pfd, 1, timeout_ms) > 0 && DrainEvents()) {
+                pending = true;
+                due = std::chrono::steady_clock::now() + std::chrono::milliseconds(debounce_ms_);
+                continue;
+            }
+            if (pending && std::chrono::steady_clock::now() >= due) {
+                pending = false;
+                if (!Config::Instance().Reload()) spdlog::error("Configuration reload failed, keeping previous settings");
+            }
+        }
+    }
+
+    std::string path_;
+    std::string dir_;
+    std::string name_;
+    FileStamp stamp_{};  // 只在监视线程读写 (Start 时在线程启动前初始化)
+    int debounce_ms_;
+    int fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread worker_;
+};
+
+// /debug/config/reload 的处理: 手动触发一次重新加载, 返回生效的配置版本
+inline std::string HandleConfigReload() {
+    bool ok = Config::Instance().Reload();
+    std::string version = std::to_string(Config::Instance().Version());
+    return ok ? "reloaded, version " + version + "\n" : "reload failed, keeping version " + version + "\n";
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+// 异步日志: 所有 logger 共用一个有界队列和一个后台写出线程, 业务线程只负责入队;
+// 队列满时丢弃最旧的记录, 不阻塞调用方. 每个模块一个 logger, 级别可在运行时修改.
+// 消息正文等大字段只在 debug 级别打印, spdlog 在级别不满足时不会格式化参数.
+namespace logging {
+
+struct Options {
+    size_t queue_size = 8192;                      // 队列条数上限
+    int flush_interval_sec = 1;
+    std::string level = "info";                    // 默认级别
+    std::map<std::string, std::string> modules;    // 模块 -> 级别
+};
+
+namespace detail {
+struct State {
+    std::mutex mu;
+    spdlog::sink_ptr sink;
+    std::map<std::string, std::string> module_levels;
+};
+inline State& GetState() {
+    static State state;
+    return state;
+}
+}  // namespace detail
+
+// 进程启动时调用一次, 之后 spdlog::info 等默认 logger 调用也走异步队列
+inline void Init(const std::string& pattern, const Options& options) {
+    auto& state = detail::GetState();
+    std::lock_guard<std::mutex> lk(state.mu);
+    spdlog::init_thread_pool(options.queue_size, 1);
+    state.sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    state.module_levels = options.modules;
+    auto logger = std::make_shared<spdlog::async_logger>("main", state.sink, spdlog::thread_pool(),
+                                                         spdlog::async_overflow_policy::overrun_oldest);
+    spdlog::set_default_logger(logger);
+    spdlog::set_pattern(pattern);
+    spdlog::set_level(spdlog::level::from_str(options.level));
+    spdlog::flush_on(spdlog::level::err);
+    if (options.flush_interval_sec > 0) spdlog::flush_every(std::chrono::seconds(options.flush_interval_sec));
+}
+
+// 模块 logger, 热路径上用 static 缓存返回值
+inline std::shared_ptr<spdlog::logger> Get(const std::string& module) {
+    auto& state = detail::GetState();
+    std::lock_guard<std::mutex> lk(state.mu);
+    if (auto existing = spdlog::get(module)) return existing;
+    if (!state.sink) return spdlog::default_logger();  // 未 Init (工具程序) 时直接用默认 logger
+    auto logger = std::make_shared<spdlog::async_logger>(module, state.sink, spdlog::thread_pool(),
+                                                         spdlog::async_overflow_policy::overrun_oldest);
+    spdlog::initialize_logger(logger);  // 继承全局格式和级别
+    auto it = state.module_levels.find(module);
+    if (it != state.module_levels.end()) logger->set_level(spdlog::level::from_str(it->second));
+    return logger;
+}
+
+// module 为 "*" 时修改全部 logger; 返回 false 表示模块或级别不存在
+inline bool SetLevel(const std::string& module, const std::string& level) {
+    auto lvl = spdlog::level::from_str(level);
+    if (lvl == spdlog::level::off && level != "off") return false;
+    if (module == "*") {
+        spdlog::set_level(lvl);
+        return true;
+    }
+    auto logger = spdlog::get(module);
+    if (!logger) return false;
+    logger->set_level(lvl);
+    auto& state = detail::GetState();
+    std::lock_guard<std::mutex> lk(state.mu);
+    state.module_levels[module] = level;
+    return true;
+}
+
+// 配置热更新时整体套用: 先设默认级别, 再按模块覆盖, 之前经 /debug/loglevel 做的修改一并被覆盖
+inline void ApplyLevels(const std::string& level, const std::map<std::string, std::string>& modules) {
+    spdlog::set_level(spdlog::level::from_str(level));
+    auto& state = detail::GetState();
+    {
+        std::lock_guard<std::mutex> lk(state.mu);
+        state.module_levels = modules;
+    }
+    for (const auto& kv : modules) {
+        if (auto logger = spdlog::get(kv.first)) logger->set_level(spdlog::level::from_str(kv.second));
+    }
+}
+
+inline std::string DescribeLevels() {
+    std::string out;
+    spdlog::apply_all([&out](std::shared_ptr<spdlog::logger> logger) {
+        auto name = spdlog::level::to_string_view(logger->level());
+        out += logger->name() + "=" + std::string(name.data(), name.size()) + "\n";
+    });
+    return out;
+}
+
+// /debug/loglevel 的处理: 没有 level 参数时列出当前级别
+inline std::string HandleLevelRequest(const std::string& module, const std::string& level) {
+    if (level.empty()) return DescribeLevels();
+    if (!SetLevel(module.empty() ? "*" : module, level)) return "unknown module or level\n";
+    spdlog::warn("log level of {} set to {}", module.empty() ? "*" : module, level);
+    return DescribeLevels();
+}
+
+// 热路径日志限流: 每秒最多放行 per_sec 条, 其余只计数, 放行时把此前被抑制的条数交给调用方一并打印
+class RateLimit {
+public:
+    explicit RateLimit(uint32_t per_sec) : per_sec_(per_sec) {}
+
+    bool Allow(uint64_t& suppressed) {
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t window = window_.load(std::memory_order_relaxed);
+        if (now != window && window_.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+            count_.store(0, std::memory_order_relaxed);
+        }
+        if (count_.fetch_add(1, std::memory_order_relaxed) < per_sec_) {
+            suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+private:
+    uint32_t per_sec_;
+    std::atomic<int64_t> window_{0};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
+
+// 按 RateLimit 限流打印; 有被抑制的记录时先补一行计数
+template <typename... Args>
+inline void Limited(RateLimit& limit, const std::shared_ptr<spdlog::logger>& logger, spdlog::level::level_enum lvl,
+                    spdlog::format_string_t<Args...> fmt, Args&&... args) {
+    if (!logger->should_log(lvl)) return;
+    uint64_t suppressed = 0;
+    if (!limit.Allow(suppressed)) return;
+    if (suppressed) logger->log(lvl, "({} similar messages suppressed)", suppressed);
+    logger->log(lvl, fmt, std::forward<Args>(args)...);
+}
+
+}  // namespace logging
@@ -0,0 +1,257 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Prometheus 指标, gateway / logic server 共用
+//
+// 计数器和直方图按线程分片: 每个线程固定写自己的分片 (独占缓存行, relaxed 原子加), 热路径上没有锁也没有共享写;
+// 只有抓取 /metrics 时才把各分片求和. 指标对象在启动阶段通过 Registry 注册, 热路径只持有裸指针.
+namespace metrics {
+
+constexpr size_t kShards = 32;
+
+// 线程首次记录时按轮转分配分片, 线程数不超过 kShards 时互不共享
+inline size_t ThreadShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+public:
+    void Inc(uint64_t n = 1) { shards_[ThreadShard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t Value() const {
+        uint64_t sum = 0;
+        for (const auto& s : shards_) sum += s.value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards_[kShards];
+};
+
+class Gauge {
+public:
+    void Set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void Add(int64_t d) { value_.fetch_add(d, std::memory_order_relaxed); }
+    int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// 延迟直方图, 以微秒记录, 导出时换算为秒 (Prometheus 约定)
+class Histogram {
+public:
+    explicit Histogram(std::vector<uint64_t> bounds_us) : bounds_us_(std::move(bounds_us)) {
+        std::sort(bounds_us_.begin(), bounds_us_.end());
+        for (auto& s : shards_) s.buckets.reset(new std::atomic<uint64_t>[bounds_us_.size() + 1]());
+    }
+
+    void ObserveUs(uint64_t us) {
+        size_t i = std::lower_bound(bounds_us_.begin(), bounds_us_.end(), us) - bounds_us_.begin();
+        Shard& s = shards_[ThreadShard()];
+        s.buckets[i].fetch_add(1, std::memory_order_relaxed);
+        s.sum_us.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    const std::vector<uint64_t>& BoundsUs() const { return bounds_us_; }
+
+    // 各桶非累计计数 (最后一个为 +Inf) 与总和
+    void Collect(std::vector<uint64_t>& buckets, uint64_t& sum_us) const {
+        buckets.assign(bounds_us_.size() + 1, 0);
+        sum_us = 0;
+        for (const auto& s : shards_) {
+            for (size_t i = 0; i < buckets.size(); ++i) buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+            sum_us += s.sum_us.load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<uint64_t> sum_us{0};
+    };
+    std::vector<uint64_t> bounds_us_;
+    Shard shards_[kShards];
+};
+
+// 100us ~ 5s
+inline std::vector<uint64_t> DefaultLatencyBucketsUs() {
+    return {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000};
+}
+
+// 只计一段代码而非整个作用域时使用
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+    uint64_t ElapsedUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 作用域计时, 析构时写入直方图; h 为空时不计时
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram* h) : h_(h), start_(h ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+    ~ScopedTimer() {
+        if (h_) {
+            h_->ObserveUs(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count());
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram* h_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Prometheus 文本格式的辅助函数, 供自定义 collector 使用
+inline std::string FormatLabels(const Labels& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return "";
+    std::string out = "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i) out += ",";
+        out += labels[i].first + "=\"" + labels[i].second + "\"";
+    }
+    if (!extra.empty()) {
+        if (!labels.empty()) out += ",";
+        out += extra;
+    }
+    return out + "}";
+}
+
+// 桶上界用最短表示 (le="0.0001")
+inline std::string FormatSeconds(uint64_t us) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.6g", us / 1e6);
+    return buf;
+}
+
+// 按非累计桶输出一组 histogram 样本 (_bucket / _sum / _count)
+inline void AppendHistogram(std::string& out, const std::string& name, const Labels& labels,
+                            const std::vector<uint64_t>& bounds_us, const std::vector<uint64_t>& buckets, uint64_t sum_us) {
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        cumulative += buckets[i];
+        std::string le = i < bounds_us.size() ? FormatSeconds(bounds_us[i]) : "+Inf";
+        out += name + "_bucket" + FormatLabels(labels, "le=\"" + le + "\"") + " " + std::to_string(cumulative) + "\n";
+    }
+    char sum[32];
+    std::snprintf(sum, sizeof(sum), "%.6f", sum_us / 1e6);
+    out += name + "_sum" + FormatLabels(labels) + " " + sum + "\n";
+    out += name + "_count" + FormatLabels(labels) + " " + std::to_string(cumulative) + "\n";
+}
+
+class Registry {
+public:
+    static Registry& Instance() {
+        static Registry instance;
+        return instance;
+    }
+
+    // 同名同标签重复注册返回同一个对象
+    Counter* GetCounter(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        return Get<Counter>(name, help, "counter", labels, [] { return std::make_unique<Counter>(); });
+    }
+
+    Gauge* GetGauge(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        return Get<Gauge>(name, help, "gauge", labels, [] { return std::make_unique<Gauge>(); });
+    }
+
+    Histogram* GetHistogram(const std::string& name, const std::string& help, const Labels& labels = {},
+                            std::vector<uint64_t> bounds_us = DefaultLatencyBucketsUs()) {
+        return Get<Histogram>(name, help, "histogram", labels,
+                              [&bounds_us] { return std::make_unique<Histogram>(bounds_us); });
+    }
+
+    // 抓取时才计算的指标 (会话数、连接池快照等), 回调直接追加完整的文本格式
+    void AddCollector(std::function<void(std::string&)> collector) {
+        std::lock_guard<std::mutex> lk(mu_);
+        collectors_.push_back(std::move(collector));
+    }
+
+    std::string Expose() const {
+        std::string out;
+        std::vector<std::function<void(std::string&)>> collectors;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            std::vector<uint64_t> buckets;
+            uint64_t sum_us = 0;
+            for (const auto& kv : families_) {
+                const Family& f = kv.second;
+                out += "# HELP " + kv.first + " " + f.help + "\n";
+                out += "# TYPE " + kv.first + " " + f.type + "\n";
+                for (const auto& series : f.series) {
+                    if (f.type == "counter") {
+                        out += kv.first + FormatLabels(series.labels) + " " +
+                               std::to_string(static_cast<const Counter*>(series.metric.get())->Value()) + "\n";
+                    } else if (f.type == "gauge") {
+                        out += kv.first + FormatLabels(series.labels) + " " +
+                               std::to_string(static_cast<const Gauge*>(series.metric.get())->Value()) + "\n";
+                    } else {
+                        auto* h = static_cast<const Histogram*>(series.metric.get());
+                        h->Collect(buckets, sum_us);
+                        AppendHistogram(out, kv.first, series.labels, h->BoundsUs(), buckets, sum_us);
+                    }
+                }
+            }
+            collectors = collectors_;
+        }
+        for (const auto& c : collectors) c(out);
+        return out;
+    }
+
+private:
+    struct Series {
+        Labels labels;
+        std::shared_ptr<void> metric;
+    };
+    struct Family {
+        std::string help;
+        std::string type;
+        std::vector<Series> series;
+    };
+
+    template <typename T, typename Make>
+    T* Get(const std::string& name, const std::string& help, const char* type, const Labels& labels, Make make) {
+        std::lock_guard<std::mutex> lk(mu_);
+        Family& f = families_[name];
+        if (f.type.empty()) {
+            f.help = help;
+            f.type = type;
+        }
+        for (auto& s : f.series) {
+            if (s.labels == labels) return static_cast<T*>(s.metric.get());
+        }
+        std::shared_ptr<T> metric = make();
+        f.series.push_back({labels, metric});
+        return metric.get();
+    }
+
+    mutable std::mutex mu_;
+    std::map<std::string, Family> families_;
+    std::vector<std::function<void(std::string&)>> collectors_;
+};
+
+}  // namespace metrics
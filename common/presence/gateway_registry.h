@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// 多网关部署下的 Redis 约定, gateway / logic server 共用
+//
+//   IM:GATEWAY:<gateway_id>   -> 网关对外的推送地址 (ip:port), 带 TTL 的租约, 网关周期续期
+//   IM:USER:SESS:<uid>        -> 用户会话所在网关的 gateway_id
+//
+// 网关宕机后租约自然过期, logic server 解析不到地址即视为该网关上的用户离线
+constexpr const char* kGatewayLeaseKeyPrefix = "IM:GATEWAY:";
+constexpr const char* kUserSessionKeyPrefix = "IM:USER:SESS:";
+
+// 网关调用 LogicService 时通过 gRPC metadata 携带自身 id (key 必须小写)
+constexpr const char* kGatewayIdMetadataKey = "x-im-gateway-id";
+
+// LogicService 在健康检查服务中注册的名字, 网关侧 round_robin 按它摘除不健康的后端
+constexpr const char* kLogicHealthServiceName = "im.LogicService";
+
+inline std::string GatewayLeaseKey(const std::string& gateway_id) {
+    return kGatewayLeaseKeyPrefix + gateway_id;
+}
+
+inline std::string UserSessionKey(int64_t uid) {
+    return kUserSessionKeyPrefix + std::to_string(uid);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdio>
+
+// 单元测试用的断言: 失败时打印位置并计数, 继续执行后面的检查; 不受 NDEBUG 影响.
+// 测试程序的 main 以 return test::Report(); 结束, 有失败时返回非零供 ctest 判定.
+namespace test {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline int Report() {
+    if (Failures() == 0) {
+        std::printf("all checks passed\n");
+        return 0;
+    }
+    std::fprintf(stderr, "%d check(s) failed\n", Failures());
+    return 1;
+}
+
+}  // namespace test
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++test::Failures();                                                       \
+        }                                                                             \
+    } while (0)
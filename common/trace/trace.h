@@ -0,0 +1,246 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+// 请求级延迟追踪: gateway -> logic -> 存储 / 推送
+//
+// 网关按 (连接, seq_id) 生成 trace id 并按 sample_every 采样, 采样中的请求通过 gRPC metadata 和推送帧继续传递.
+// 各阶段用 Span 记录起止时间, 写入当前线程自己的环形缓冲 (只有本线程和偶尔的导出会碰到它的锁, 不存在争用),
+// 满了覆盖最旧的记录; 线程退出后缓冲留给之后新建的线程复用. 导出为 Chrome trace 格式 (chrome://tracing / Perfetto 可直接打开),
+// 时间戳取系统时钟, 多个进程导出的文件可以合并后按 trace_id 对齐.
+namespace trace {
+
+constexpr const char* kTraceIdMetadataKey = "x-im-trace-id";
+
+struct SpanRecord {
+    uint64_t trace_id;
+    const char* name;  // 必须是静态字符串
+    int64_t start_us;  // 系统时钟, 微秒
+    int64_t dur_us;
+};
+
+inline int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t Mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// 同一进程内 (连接, seq_id) 唯一; 混入进程随机盐, 避免多个网关生成相同的 id
+inline uint64_t MakeTraceId(uint64_t conn_id, uint32_t seq_id) {
+    static const uint64_t salt = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    uint64_t id = Mix64(salt ^ ((conn_id << 32) | seq_id));
+    return id ? id : 1;
+}
+
+inline std::string FormatTraceId(uint64_t id) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(id));
+    return buf;
+}
+
+// 非法输入返回 0 (不追踪)
+inline uint64_t ParseTraceId(std::string_view s) {
+    if (s.empty() || s.size() > 16) return 0;
+    uint64_t id = 0;
+    for (char c : s) {
+        int v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else return 0;
+        id = (id << 4) | v;
+    }
+    return id;
+}
+
+class ThreadRing {
+public:
+    ThreadRing(size_t capacity, uint32_t tid) : slots_(std::max<size_t>(capacity, 1)), tid_(tid) {}
+
+    void Record(const SpanRecord& r) {
+        std::lock_guard<std::mutex> lk(mu_);
+        slots_[next_ % slots_.size()] = r;
+        ++next_;
+    }
+
+    // trace_id 为 0 时导出全部
+    void Collect(uint64_t trace_id, std::vector<SpanRecord>& out) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        size_t n = std::min<size_t>(next_, slots_.size());
+        for (size_t i = next_ - n; i < next_; ++i) {
+            const SpanRecord& r = slots_[i % slots_.size()];
+            if (trace_id == 0 || r.trace_id == trace_id) out.push_back(r);
+        }
+    }
+
+    uint32_t Tid() const { return tid_; }
+    size_t Capacity() const { return slots_.size(); }
+
+private:
+    mutable std::mutex mu_;
+    std::vector<SpanRecord> slots_;
+    uint64_t next_ = 0;
+    uint32_t tid_;
+};
+
+class Tracer {
+public:
+    // 不析构: 进程退出时仍在运行的线程退出时还会归还缓冲
+    static Tracer& Instance() {
+        static Tracer* instance = new Tracer();
+        return *instance;
+    }
+
+    // 启动时调用; 之后新建的线程缓冲按新容量分配
+    void Configure(const std::string& process_name, size_t ring_capacity, uint32_t sample_every) {
+        std::lock_guard<std::mutex> lk(mu_);
+        process_name_ = process_name;
+        ring_capacity_ = ring_capacity;
+        sample_every_.store(sample_every, std::memory_order_relaxed);
+    }
+
+    // sample_every 为 0 时关闭采样, 1 为全量
+    bool ShouldSample(uint64_t trace_id) const {
+        uint32_t n = sample_every_.load(std::memory_order_relaxed);
+        return n != 0 && trace_id % n == 0;
+    }
+
+    void Record(uint64_t trace_id, const char* name, int64_t start_us, int64_t dur_us) {
+        LocalRing().Record({trace_id, name, start_us, dur_us});
+    }
+
+    // Chrome trace JSON (traceEvents, "X" 完整事件)
+    std::string DumpChromeTrace(uint64_t trace_id = 0) const {
+        struct Event {
+            SpanRecord r;
+            uint32_t tid;
+        };
+        std::vector<Event> events;
+        std::string process_name;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            process_name = process_name_;
+            std::vector<SpanRecord> spans;
+            for (const auto& ring : rings_) {
+                spans.clear();
+                ring->Collect(trace_id, spans);
+                for (const auto& r : spans) events.push_back({r, ring->Tid()});
+            }
+        }
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.r.start_us < b.r.start_us; });
+
+        std::string pid = std::to_string(getpid());
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":0,\"args\":{\"name\":\"" + process_name + "\"}}";
+        for (const auto& e : events) {
+            out += ",{\"name\":\"";
+            out += e.r.name;
+            out += "\",\"cat\":\"im\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + std::to_string(e.tid) +
+                   ",\"ts\":" + std::to_string(e.r.start_us) + ",\"dur\":" + std::to_string(e.r.dur_us) +
+                   ",\"args\":{\"trace_id\":\"" + FormatTraceId(e.r.trace_id) + "\"}}";
+        }
+        return out + "]}";
+    }
+
+private:
+    Tracer() = default;
+
+    // 线程退出时缓冲归还到 free_, 新线程优先复用, 缓冲数不超过同时存活的线程数峰值;
+    // 归还的缓冲仍在 rings_ 中, 已记录的 span 在被复用覆盖前照常导出
+    struct LocalHandle {
+        std::shared_ptr<ThreadRing> ring;
+        explicit LocalHandle(Tracer* tracer) : ring(tracer->AcquireRing()) {}
+        ~LocalHandle() { Tracer::Instance().ReleaseRing(std::move(ring)); }
+    };
+
+    ThreadRing& LocalRing() {
+        thread_local LocalHandle handle(this);
+        return *handle.ring;
+    }
+
+    std::shared_ptr<ThreadRing> AcquireRing() {
+        std::lock_guard<std::mutex> lk(mu_);
+        while (!free_.empty()) {
+            std::shared_ptr<ThreadRing> ring = std::move(free_.back());
+            free_.pop_back();
+            if (ring->Capacity() == std::max<size_t>(ring_capacity_, 1)) return ring;
+            // 容量已重新配置: 丢弃旧缓冲
+            rings_.erase(std::find(rings_.begin(), rings_.end(), ring));
+        }
+        rings_.push_back(std::make_shared<ThreadRing>(ring_capacity_, ++next_tid_));
+        return rings_.back();
+    }
+
+    void ReleaseRing(std::shared_ptr<ThreadRing> ring) {
+        std::lock_guard<std::mutex> lk(mu_);
+        free_.push_back(std::move(ring));
+    }
+
+    mutable std::mutex mu_;
+    std::string process_name_ = "im";
+    size_t ring_capacity_ = 4096;
+    std::atomic<uint32_t> sample_every_{0};
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    std::vector<std::shared_ptr<ThreadRing>> free_;  // 所属线程已退出, 待复用
+    uint32_t next_tid_ = 0;
+};
+
+// 当前线程正在处理的请求的 trace id, 0 表示未采样
+inline uint64_t& CurrentTraceId() {
+    thread_local uint64_t id = 0;
+    return id;
+}
+
+// 在请求入口设置追踪上下文, 离开作用域时恢复
+class ScopedTrace {
+public:
+    explicit ScopedTrace(uint64_t trace_id) : prev_(CurrentTraceId()) { CurrentTraceId() = trace_id; }
+    ~ScopedTrace() { CurrentTraceId() = prev_; }
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    uint64_t prev_;
+};
+
+// 记录当前作用域为一个阶段; 未采样时只读一次线程局部变量
+class Span {
+public:
+    explicit Span(const char* name) : trace_id_(CurrentTraceId()), name_(name) {
+        if (trace_id_) {
+            start_us_ = NowUs();
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~Span() {
+        if (trace_id_) {
+            int64_t dur = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count();
+            Tracer::Instance().Record(trace_id_, name_, start_us_, dur);
+        }
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    uint64_t trace_id_;
+    const char* name_;
+    int64_t start_us_ = 0;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace trace
@@ -0,0 +1,41 @@
+-- 消息表迁移: msg_id 由 VARCHAR 改为 BIGINT, 增加按接收方 / 群连续递增的 seq 列和 seq 计数器表 t_msg_seq.
+-- 离线同步和已送达游标改为按 seq 翻页, 不再依赖各节点时钟生成的 msg_id.
+--
+-- 执行步骤:
+--   1. 停掉全部 logic server; 分片部署时确认没有处于 migrating 状态的分片 (shard_rebalance 已跑完).
+--   2. 在主库和 postgres.message_shards 的每个分片上各执行一次, 整个脚本在一个事务里, 失败整体回滚:
+--        psql -v ON_ERROR_STOP=1 -1 -h <host> -U admin -d LetsChat -f 001_msg_seq.sql
+--      脚本不可重复执行 (ADD COLUMN / CREATE TABLE 会报错), 避免对已在使用的 seq 重新编号.
+--   3. 删除 Redis 中旧的已送达游标 (值为 msg_id, 新版本改用 IM:USER:SEQ_CURSOR:<uid>):
+--        redis-cli -a <password> --scan --pattern 'IM:USER:CURSOR:*' | xargs -r redis-cli -a <password> DEL
+--   4. 启动新版本的 logic server.
+
+-- 单聊
+ALTER TABLE t_chat_msg ALTER COLUMN msg_id TYPE BIGINT USING msg_id::bigint;
+ALTER TABLE t_chat_msg ADD COLUMN seq BIGINT;
+UPDATE t_chat_msg m SET seq = s.seq
+FROM (SELECT id, row_number() OVER (PARTITION BY to_uid ORDER BY msg_id, id) AS seq FROM t_chat_msg) s
+WHERE m.id = s.id;
+ALTER TABLE t_chat_msg ALTER COLUMN seq SET NOT NULL;
+CREATE UNIQUE INDEX idx_chat_msg_to_uid_seq ON t_chat_msg (to_uid, seq);
+CREATE INDEX IF NOT EXISTS idx_chat_msg_to_uid ON t_chat_msg (to_uid, msg_id);
+
+-- 群聊
+ALTER TABLE t_group_msg ALTER COLUMN msg_id TYPE BIGINT USING msg_id::bigint;
+ALTER TABLE t_group_msg ADD COLUMN seq BIGINT;
+UPDATE t_group_msg m SET seq = s.seq
+FROM (SELECT id, row_number() OVER (PARTITION BY group_id ORDER BY msg_id, id) AS seq FROM t_group_msg) s
+WHERE m.id = s.id;
+ALTER TABLE t_group_msg ALTER COLUMN seq SET NOT NULL;
+CREATE UNIQUE INDEX idx_group_msg_group_id_seq ON t_group_msg (group_id, seq);
+CREATE INDEX IF NOT EXISTS idx_group_msg_group_id ON t_group_msg (group_id, msg_id);
+
+-- seq 计数器
+CREATE TABLE t_msg_seq (
+    scope SMALLINT NOT NULL,     -- 1: 单聊, owner_id 为接收方 uid; 2: 群聊, owner_id 为群ID
+    owner_id BIGINT NOT NULL,
+    last_seq BIGINT NOT NULL,    -- 已分配的最大 seq
+    PRIMARY KEY (scope, owner_id)
+);
+INSERT INTO t_msg_seq (scope, owner_id, last_seq) SELECT 1, to_uid, max(seq) FROM t_chat_msg GROUP BY to_uid;
+INSERT INTO t_msg_seq (scope, owner_id, last_seq) SELECT 2, group_id, max(seq) FROM t_group_msg GROUP BY group_id;
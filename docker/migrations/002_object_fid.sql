@@ -0,0 +1,14 @@
+-- 上传对象表: 对象 key -> SeaweedFS fid 的映射由 Logic Server 进程内存改为持久化到主库,
+-- 任意节点都能按 key 查到 fid 并生成下载地址 (本地只保留有界 LRU 缓存).
+--
+-- 执行步骤:
+--   1. 只在主库执行一次, 消息分片 (postgres.message_shards) 上不需要:
+--        psql -v ON_ERROR_STOP=1 -1 -h <host> -U admin -d LetsChat -f 002_object_fid.sql
+--      脚本可重复执行, 表已存在时不做任何改动; 可以在旧版本 logic server 运行时执行.
+--   2. 滚动升级 logic server. 升级前上传的对象只记录在旧进程内存中, 不会迁入此表, 其下载地址在旧进程退出后失效.
+
+CREATE TABLE IF NOT EXISTS t_object_fid (
+    object_key VARCHAR(512) PRIMARY KEY,  -- {uid}/{时间戳}_{文件名}
+    fid VARCHAR(64) NOT NULL,             -- SeaweedFS 文件 id
+    create_time BIGINT NOT NULL
+);
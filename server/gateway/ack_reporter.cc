@@ -0,0 +1,88 @@
+#include "ack_reporter.h"
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+#include "../../common/metrics/metrics.h"
+
+AckReporter::AckReporter(im::LogicService::Stub* stub, int flush_interval_ms, size_t flush_batch, size_t max_backlog)
+    : stub_(stub), flush_interval_ms_(flush_interval_ms), flush_batch_(flush_batch), max_backlog_(max_backlog) {}
+
+AckReporter::~AckReporter() {
+    Stop();
+}
+
+void AckReporter::Start() {
+    worker_ = std::thread(&AckReporter::Run, this);
+}
+
+void AckReporter::Stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void AckReporter::Add(int64_t uid, int64_t msg_id) {
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        queue_.emplace_back(uid, msg_id);
+        full = queue_.size() >= flush_batch_;
+    }
+    if (full) cv_.notify_one();
+}
+
+bool AckReporter::Flush(std::vector<std::pair<int64_t, int64_t>>& batch) {
+    // 按 uid 聚合, 同一用户的确认放在一个 UserMsgAcks 里
+    std::sort(batch.begin(), batch.end());
+    im::MsgAckReport report;
+    im::UserMsgAcks* current = nullptr;
+    for (const auto& ack : batch) {
+        if (!current || current->uid() != ack.first) {
+            current = report.add_acks();
+            current->set_uid(ack.first);
+        }
+        current->add_msg_ids(ack.second);
+    }
+    im::MsgAckReportRes res;
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(2));
+    static metrics::Histogram* latency = metrics::Registry::Instance().GetHistogram(
+        "im_gateway_logic_rpc_seconds", "Gateway to logic server gRPC latency", {{"method", "ReportAcks"}});
+    metrics::Stopwatch timer;
+    grpc::Status status = stub_->ReportAcks(&context, report, &res);
+    latency->ObserveUs(timer.ElapsedUs());
+    if (!status.ok() || res.err_code() != im::ERR_SUCCESS) {
+        spdlog::warn("ReportAcks failed ({} acks): {}", batch.size(), status.error_message());
+        return false;
+    }
+    return true;
+}
+
+void AckReporter::Run() {
+    std::vector<std::pair<int64_t, int64_t>> batch;
+    std::unique_lock<std::mutex> lk(mu_);
+    while (true) {
+        cv_.wait_for(lk, std::chrono::milliseconds(flush_interval_ms_),
+                     [this] { return stop_ || queue_.size() >= flush_batch_; });
+        if (queue_.empty() && batch.empty()) {
+            if (stop_) break;
+            continue;
+        }
+        batch.insert(batch.end(), queue_.begin(), queue_.end());
+        queue_.clear();
+        bool stopping = stop_;
+        lk.unlock();
+
+        if (batch.size() > max_backlog_) {
+            spdlog::warn("ack backlog {} exceeds {}, dropping oldest", batch.size(), max_backlog_);
+            batch.erase(batch.begin(), batch.end() - max_backlog_);
+        }
+        if (Flush(batch) || stopping) batch.clear();
+
+        lk.lock();
+        if (stopping) break;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "im_service.grpc.pb.h"
+
+// 客户端 MsgAck 攒批后经 LogicService::ReportAcks 上报, 用于推进用户的已送达游标
+// 上报失败的批次留到下次重试, 积压超过 max_backlog 时丢弃最旧的 (只影响同步时的去重, 不丢消息)
+class AckReporter {
+public:
+    AckReporter(im::LogicService::Stub* stub, int flush_interval_ms = 200, size_t flush_batch = 512, size_t max_backlog = 65536);
+    ~AckReporter();
+
+    void Start();
+    void Stop();
+
+    void Add(int64_t uid, int64_t msg_id);
+
+private:
+    void Run();
+    bool Flush(std::vector<std::pair<int64_t, int64_t>>& batch);
+
+    im::LogicService::Stub* stub_;
+    int flush_interval_ms_;
+    size_t flush_batch_;
+    size_t max_backlog_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<std::pair<int64_t, int64_t>> queue_;  // (uid, msg_id)
+    bool stop_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,170 @@
+#include "delivery_tracker.h"
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+#include "../../common/log/logging.h"
+
+DeliveryTracker::DeliveryTracker(SendFn send, const DeliveryOptions& options)
+    : send_(std::move(send)), options_(options) {
+    if (options_.window == 0) options_.window = 1;
+    if (options_.tick_ms <= 0) options_.tick_ms = 100;
+    if (options_.wheel_slots == 0) options_.wheel_slots = 64;
+    wheel_.resize(options_.wheel_slots);
+}
+
+DeliveryTracker::~DeliveryTracker() {
+    Stop();
+}
+
+void DeliveryTracker::Start() {
+    ticker_ = std::thread(&DeliveryTracker::TickLoop, this);
+}
+
+void DeliveryTracker::Stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (ticker_.joinable()) ticker_.join();
+}
+
+bool DeliveryTracker::Deliver(int64_t uid, int64_t msg_id, PushBuffer packet) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = sessions_.find(uid);
+    if (it == sessions_.end()) {
+        // 首条消息直接尝试写入, 用户不在本网关时不建立会话状态
+        InFlight entry{std::move(packet), 0};
+        if (!SendLocked(uid, msg_id, entry)) return false;
+        sessions_[uid].inflight.emplace(msg_id, std::move(entry));
+        return true;
+    }
+    Session& session = it->second;
+    if (session.inflight.count(msg_id)) return true;
+    if (session.inflight.size() < options_.window && session.pending.empty()) {
+        InFlight entry{std::move(packet), 0};
+        if (!SendLocked(uid, msg_id, entry)) {
+            sessions_.erase(it);
+            return false;
+        }
+        session.inflight.emplace(msg_id, std::move(entry));
+        return true;
+    }
+    if (session.pending.size() >= options_.max_pending) {
+        ++stats_.overflow;
+        static logging::RateLimit limit(10);
+        logging::Limited(limit, logging::Get("push"), spdlog::level::warn, "delivery window overflow uid={} msg_id={}, left for sync", uid, msg_id);
+        return true;
+    }
+    session.pending.emplace_back(msg_id, std::move(packet));
+    return true;
+}
+
+bool DeliveryTracker::OnAck(int64_t uid, int64_t msg_id) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = sessions_.find(uid);
+    if (it == sessions_.end()) return false;
+    if (it->second.inflight.erase(msg_id) == 0) return false;
+    ++stats_.acked;
+    FillWindowLocked(uid, it->second);
+    return true;
+}
+
+void DeliveryTracker::OnSessionOpened(int64_t uid, uint64_t conn_id) {
+    std::lock_guard<std::mutex> lk(mu_);
+    Session& session = sessions_[uid];
+    if (session.conn_id == conn_id) return;
+    session = Session();
+    session.conn_id = conn_id;
+}
+
+void DeliveryTracker::OnSessionClosed(int64_t uid, uint64_t conn_id) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = sessions_.find(uid);
+    if (it != sessions_.end() && (it->second.conn_id == conn_id || it->second.conn_id == 0)) sessions_.erase(it);
+}
+
+DeliveryStats DeliveryTracker::Stats() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return stats_;
+}
+
+bool DeliveryTracker::SendLocked(int64_t uid, int64_t msg_id, InFlight& entry) {
+    if (!send_(uid, entry.packet)) return false;
+    if (entry.attempts == 0) {
+        ++stats_.sent;
+    } else {
+        ++stats_.retransmits;
+    }
+    ++entry.attempts;
+    ScheduleLocked(uid, msg_id, entry.attempts);
+    return true;
+}
+
+void DeliveryTracker::FillWindowLocked(int64_t uid, Session& session) {
+    while (session.inflight.size() < options_.window && !session.pending.empty()) {
+        auto next = std::move(session.pending.front());
+        session.pending.pop_front();
+        InFlight entry{std::move(next.second), 0};
+        if (!SendLocked(uid, next.first, entry)) {
+            sessions_.erase(uid);
+            return;
+        }
+        session.inflight.emplace(next.first, std::move(entry));
+    }
+}
+
+// 第 n 次发送后的超时为 initial_rto * 2^(n-1), 不超过 max_rto
+void DeliveryTracker::ScheduleLocked(int64_t uid, int64_t msg_id, int attempts) {
+    int64_t rto = options_.initial_rto_ms;
+    for (int i = 1; i < attempts && rto < options_.max_rto_ms; ++i) rto *= 2;
+    rto = std::min<int64_t>(rto, options_.max_rto_ms);
+    size_t ticks = std::max<size_t>(1, static_cast<size_t>(rto / options_.tick_ms));
+    size_t slot = (wheel_pos_ + ticks) % wheel_.size();
+    wheel_[slot].push_back({uid, msg_id, attempts, (ticks - 1) / wheel_.size()});
+}
+
+void DeliveryTracker::FireLocked(const Timer& timer) {
+    auto sit = sessions_.find(timer.uid);
+    if (sit == sessions_.end()) return;
+    Session& session = sit->second;
+    auto fit = session.inflight.find(timer.msg_id);
+    if (fit == session.inflight.end() || fit->second.attempts != timer.attempts) return;
+
+    if (fit->second.attempts >= options_.max_attempts) {
+        ++stats_.given_up;
+        static logging::RateLimit limit(10);
+        logging::Limited(limit, logging::Get("push"), spdlog::level::warn, "delivery give up uid={} msg_id={} after {} attempts",
+                         timer.uid, timer.msg_id, fit->second.attempts);
+        session.inflight.erase(fit);
+        FillWindowLocked(timer.uid, session);
+        return;
+    }
+    if (!SendLocked(timer.uid, timer.msg_id, fit->second)) {
+        sessions_.erase(sit);
+    }
+}
+
+void DeliveryTracker::TickLoop() {
+    using namespace std::chrono;
+    auto next_tick = steady_clock::now() + milliseconds(options_.tick_ms);
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!cv_.wait_until(lk, next_tick, [this] { return stop_; })) {
+        next_tick += milliseconds(options_.tick_ms);
+        wheel_pos_ = (wheel_pos_ + 1) % wheel_.size();
+
+        std::vector<Timer> due;
+        auto& slot = wheel_[wheel_pos_];
+        for (size_t i = 0; i < slot.size();) {
+            if (slot[i].rounds == 0) {
+                due.push_back(slot[i]);
+                slot[i] = slot.back();
+                slot.pop_back();
+            } else {
+                --slot[i].rounds;
+                ++i;
+            }
+        }
+        for (const auto& timer : due) FireLocked(timer);
+    }
+}
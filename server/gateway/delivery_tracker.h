@@ -0,0 +1,96 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "push_dispatcher.h"
+
+struct DeliveryOptions {
+    size_t window = 64;          // 每个会话已发出未确认的消息上限
+    size_t max_pending = 1024;   // 窗口满时排队的上限, 超出直接丢弃 (客户端同步时补齐)
+    int tick_ms = 100;           // 时间轮精度
+    size_t wheel_slots = 64;
+    int initial_rto_ms = 1000;
+    int max_rto_ms = 8000;
+    int max_attempts = 5;        // 含首次发送, 用尽后放弃, 未确认的消息留给同步
+};
+
+struct DeliveryStats {
+    uint64_t sent = 0;
+    uint64_t retransmits = 0;
+    uint64_t acked = 0;
+    uint64_t given_up = 0;
+    uint64_t overflow = 0;
+};
+
+// 下行消息的端到端确认: 每个会话维护一个按 msg_id 排序的在途窗口,
+// 客户端 MsgAck 后移出窗口并补发排队的消息; 超时未确认的由时间轮驱动指数退避重传
+class DeliveryTracker {
+public:
+    // 写入用户连接, 用户不在本网关时返回 false; 首发与重传共用同一个推送包
+    using SendFn = std::function<bool(int64_t uid, const PushBuffer& packet)>;
+
+    explicit DeliveryTracker(SendFn send, const DeliveryOptions& options = DeliveryOptions());
+    ~DeliveryTracker();
+
+    void Start();
+    void Stop();
+
+    // 返回 false 表示用户不在本网关; 窗口已满时进入排队, 仍返回 true
+    bool Deliver(int64_t uid, int64_t msg_id, PushBuffer packet);
+
+    // 返回该消息是否仍在窗口中
+    bool OnAck(int64_t uid, int64_t msg_id);
+
+    // 用户在新连接上登录: 丢弃旧连接的窗口 (由新连接的同步补齐), 之后的窗口归属 conn_id
+    void OnSessionOpened(int64_t uid, uint64_t conn_id);
+
+    // 连接断开时丢弃它的窗口, 未确认的消息由重连后的同步补齐; 用户已在新连接上登录时不受影响
+    void OnSessionClosed(int64_t uid, uint64_t conn_id);
+
+    DeliveryStats Stats() const;
+
+private:
+    struct InFlight {
+        PushBuffer packet;
+        int attempts;
+    };
+
+    struct Session {
+        uint64_t conn_id = 0;  // 0 表示登录登记之前已有推送, 尚未绑定连接
+        std::map<int64_t, InFlight> inflight;
+        std::deque<std::pair<int64_t, PushBuffer>> pending;
+    };
+
+    struct Timer {
+        int64_t uid;
+        int64_t msg_id;
+        int attempts;     // 与 InFlight::attempts 不一致说明已确认或已重传, 直接忽略
+        size_t rounds;    // 还需绕时间轮的圈数
+    };
+
+    bool SendLocked(int64_t uid, int64_t msg_id, InFlight& entry);
+    void FillWindowLocked(int64_t uid, Session& session);
+    void ScheduleLocked(int64_t uid, int64_t msg_id, int attempts);
+    void FireLocked(const Timer& timer);
+    void TickLoop();
+
+    SendFn send_;
+    DeliveryOptions options_;
+
+    mutable std::mutex mu_;
+    std::unordered_map<int64_t, Session> sessions_;
+    std::vector<std::vector<Timer>> wheel_;
+    size_t wheel_pos_ = 0;
+    DeliveryStats stats_;
+
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread ticker_;
+};
@@ -0,0 +1,225 @@
+#include "flat_json.h"
+#include <cstring>
+
+namespace {
+
+void SkipSpace(std::string_view s, size_t& pos) {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r')) ++pos;
+}
+
+// pos 指向开头的引号; 成功时 pos 移到结尾引号之后
+bool ScanString(std::string_view s, size_t& pos, std::string_view& out, bool& escaped) {
+    size_t begin = ++pos;
+    escaped = false;
+    while (pos < s.size()) {
+        char c = s[pos];
+        if (c == '"') {
+            out = s.substr(begin, pos - begin);
+            ++pos;
+            return true;
+        }
+        if (c == '\\') {
+            escaped = true;
+            pos += 2;
+            continue;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) return false;
+        ++pos;
+    }
+    return false;
+}
+
+// 数字 / true / false / null, 只检查字符集, 具体格式在取值时校验
+bool ScanLiteral(std::string_view s, size_t& pos, std::string_view& out) {
+    size_t begin = pos;
+    while (pos < s.size() && s[pos] != '\0' && std::strchr("0123456789+-.eEtruefalsn", s[pos]) != nullptr) ++pos;
+    if (pos == begin) return false;
+    out = s.substr(begin, pos - begin);
+    return true;
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ReadHex4(std::string_view s, size_t pos, uint32_t& out) {
+    if (pos + 4 > s.size()) return false;
+    out = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        int v = HexValue(s[pos + i]);
+        if (v < 0) return false;
+        out = (out << 4) | static_cast<uint32_t>(v);
+    }
+    return true;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool Unescape(std::string_view s, std::string& out) {
+    out.clear();
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\') {
+            out += s[i];
+            continue;
+        }
+        if (++i >= s.size()) return false;
+        switch (s[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!ReadHex4(s, i + 1, cp)) return false;
+                i += 4;
+                // 代理对
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (i + 2 >= s.size() || s[i + 1] != '\\' || s[i + 2] != 'u' || !ReadHex4(s, i + 3, low) ||
+                        low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    i += 6;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return false;
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool FlatJson::Parse(std::string_view body) {
+    count_ = 0;
+    size_t pos = 0;
+    SkipSpace(body, pos);
+    if (pos >= body.size() || body[pos] != '{') return false;
+    ++pos;
+    SkipSpace(body, pos);
+    if (pos < body.size() && body[pos] == '}') {
+        ++pos;
+        SkipSpace(body, pos);
+        return pos == body.size();
+    }
+    while (true) {
+        SkipSpace(body, pos);
+        if (pos >= body.size() || body[pos] != '"') return false;
+        Field field;
+        bool key_escaped;
+        if (!ScanString(body, pos, field.key, key_escaped)) return false;
+        if (key_escaped) field.key = std::string_view();
+        SkipSpace(body, pos);
+        if (pos >= body.size() || body[pos] != ':') return false;
+        ++pos;
+        SkipSpace(body, pos);
+        if (pos >= body.size()) return false;
+        if (body[pos] == '"') {
+            field.is_string = true;
+            if (!ScanString(body, pos, field.value, field.escaped)) return false;
+        } else {
+            field.is_string = false;
+            field.escaped = false;
+            if (!ScanLiteral(body, pos, field.value)) return false;
+        }
+        // 超出上限的字段丢弃 (本接口的请求体不会有这么多字段)
+        if (count_ < kMaxFields) fields_[count_++] = field;
+        SkipSpace(body, pos);
+        if (pos >= body.size()) return false;
+        if (body[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        if (body[pos] != '}') return false;
+        ++pos;
+        SkipSpace(body, pos);
+        return pos == body.size();
+    }
+}
+
+const FlatJson::Field* FlatJson::Find(std::string_view key) const {
+    for (size_t i = 0; i < count_; ++i) {
+        if (fields_[i].key == key) return &fields_[i];
+    }
+    return nullptr;
+}
+
+bool FlatJson::GetString(std::string_view key, std::string& out) const {
+    const Field* field = Find(key);
+    if (field == nullptr || !field->is_string) return false;
+    if (!field->escaped) {
+        out.assign(field->value.data(), field->value.size());
+        return true;
+    }
+    return Unescape(field->value, out);
+}
+
+bool FlatJson::GetInt64(std::string_view key, int64_t& out) const {
+    const Field* field = Find(key);
+    if (field == nullptr || field->is_string || field->value.empty()) return false;
+    std::string_view v = field->value;
+    bool negative = v[0] == '-';
+    if (negative) v.remove_prefix(1);
+    if (v.empty() || v.size() > 19) return false;
+    uint64_t n = 0;
+    for (char c : v) {
+        if (c < '0' || c > '9') return false;
+        n = n * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (n > static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0)) return false;
+    out = negative ? static_cast<int64_t>(0 - n) : static_cast<int64_t>(n);
+    return true;
+}
+
+void AppendJsonString(std::string& out, std::string_view s) {
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += kHex[(c >> 4) & 0xF];
+                    out += kHex[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
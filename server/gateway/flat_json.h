@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// /api/* 小请求体的单遍 JSON 解析: 只接受一层对象, 值为字符串 / 数字 / true / false / null,
+// 解析时只记录各字段在原文中的位置, 不建 DOM, 取值时才解码转义. 嵌套对象或数组按格式错误处理.
+// 调用方保证 body 在 FlatJson 使用期间有效
+class FlatJson {
+public:
+    static constexpr size_t kMaxFields = 16;
+
+    bool Parse(std::string_view body);
+
+    // 字段不存在或不是字符串时返回 false
+    bool GetString(std::string_view key, std::string& out) const;
+    // 字段不存在, 不是整数或越界时返回 false
+    bool GetInt64(std::string_view key, int64_t& out) const;
+
+private:
+    struct Field {
+        std::string_view key;    // 原文 (不含引号), 含转义的键不会被匹配到
+        std::string_view value;  // 字符串不含引号, 其他类型为原文
+        bool is_string;
+        bool escaped;            // 字符串中含反斜杠, 取值时需要解码
+    };
+
+    const Field* Find(std::string_view key) const;
+
+    Field fields_[kMaxFields];
+    size_t count_ = 0;
+};
+
+// 把 s 以 JSON 字符串 (带引号, 转义控制字符) 追加到 out
+void AppendJsonString(std::string& out, std::string_view s);
@@ -0,0 +1,114 @@
+// FlatJson 的字段查找、转义解码、整数边界和格式错误, AppendJsonString 的转义
+#include "flat_json.h"
+#include <string>
+#include "../../common/test/check.h"
+
+namespace {
+
+void TestFields() {
+    FlatJson j;
+    CHECK(j.Parse(R"( { "uid" : 42, "token":"abc", "ok": true, "none": null } )"));
+    int64_t uid = 0;
+    std::string token;
+    CHECK(j.GetInt64("uid", uid) && uid == 42);
+    CHECK(j.GetString("token", token) && token == "abc");
+    // 类型不符或不存在
+    CHECK(!j.GetString("uid", token));
+    CHECK(!j.GetInt64("token", uid));
+    CHECK(!j.GetInt64("ok", uid));
+    CHECK(!j.GetString("missing", token));
+
+    CHECK(j.Parse("{}"));
+    CHECK(!j.GetString("token", token));
+    // 重新 Parse 不残留上一次的字段
+    CHECK(j.Parse(R"({"a":"1"})"));
+    CHECK(!j.GetInt64("uid", uid));
+}
+
+void TestEscapes() {
+    FlatJson j;
+    CHECK(j.Parse(R"({"s":"a\"b\\c\/d\n\t","u":"你好","e":"😀"})"));
+    std::string s;
+    CHECK(j.GetString("s", s) && s == "a\"b\\c/d\n\t");
+    CHECK(j.GetString("u", s) && s == "\xe4\xbd\xa0\xe5\xa5\xbd");
+    CHECK(j.GetString("e", s) && s == "\xf0\x9f\x98\x80");
+
+    // 非法转义在取值时才发现
+    CHECK(j.Parse(R"({"bad":"\x","lone":"\udc00","half":"\ud83d"})"));
+    CHECK(!j.GetString("bad", s));
+    CHECK(!j.GetString("lone", s));
+    CHECK(!j.GetString("half", s));
+
+    // 含转义的键不会被匹配到
+    CHECK(j.Parse(R"({"u\u0069d":"1"})"));
+    CHECK(!j.GetString("uid", s));
+}
+
+void TestInt64Bounds() {
+    FlatJson j;
+    int64_t v = 0;
+    CHECK(j.Parse(R"({"max":9223372036854775807,"min":-9223372036854775808,"over":9223372036854775808,"neg":-5,"frac":1.5,"exp":1e3,"big":12345678901234567890})"));
+    CHECK(j.GetInt64("max", v) && v == INT64_MAX);
+    CHECK(j.GetInt64("min", v) && v == INT64_MIN);
+    CHECK(j.GetInt64("neg", v) && v == -5);
+    CHECK(!j.GetInt64("over", v));
+    CHECK(!j.GetInt64("frac", v));
+    CHECK(!j.GetInt64("exp", v));
+    CHECK(!j.GetInt64("big", v));
+}
+
+void TestMalformed() {
+    FlatJson j;
+    CHECK(!j.Parse(""));
+    CHECK(!j.Parse("[]"));
+    CHECK(!j.Parse("{"));
+    CHECK(!j.Parse(R"({"a":1)"));
+    CHECK(!j.Parse(R"({"a":1,})"));
+    CHECK(!j.Parse(R"({"a" 1})"));
+    CHECK(!j.Parse(R"({a:1})"));
+    CHECK(!j.Parse(R"({"a":{"b":1}})"));
+    CHECK(!j.Parse(R"({"a":[1]})"));
+    CHECK(!j.Parse(R"({"a":"unterminated})"));
+    CHECK(!j.Parse(R"({"a":"x"} trailing)"));
+    CHECK(!j.Parse(std::string("{\"a\":\"x\ny\"}")));
+    CHECK(!j.Parse(R"({"a":"\)"));
+}
+
+void TestFieldLimit() {
+    std::string body = "{";
+    for (size_t i = 0; i < FlatJson::kMaxFields + 4; ++i) {
+        if (i) body += ',';
+        body += "\"f" + std::to_string(i) + "\":" + std::to_string(i);
+    }
+    body += '}';
+    FlatJson j;
+    CHECK(j.Parse(body));
+    int64_t v = 0;
+    CHECK(j.GetInt64("f0", v) && v == 0);
+    CHECK(j.GetInt64("f" + std::to_string(FlatJson::kMaxFields - 1), v));
+    // 超出上限的字段被丢弃
+    CHECK(!j.GetInt64("f" + std::to_string(FlatJson::kMaxFields), v));
+}
+
+void TestAppendJsonString() {
+    std::string out;
+    AppendJsonString(out, std::string("a\"b\\c\nd\r\te\x01", 11));
+    CHECK(out == "\"a\\\"b\\\\c\\nd\\r\\te\\u0001\"");
+    // 转义后的结果能被 FlatJson 读回
+    std::string body = "{\"k\":" + out + "}";
+    FlatJson j;
+    std::string back;
+    CHECK(j.Parse(body) && j.GetString("k", back) && back == std::string("a\"b\\c\nd\r\te\x01", 11));
+}
+
+}  // namespace
+
+int main() {
+    TestFields();
+    TestEscapes();
+    TestInt64Bounds();
+    TestMalformed();
+    TestFieldLimit();
+    TestAppendJsonString();
+    return test::Report();
+}
@@ -0,0 +1,119 @@
+#include "handover.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr char kTakeoverRequest[] = "TAKEOVER\n";
+constexpr char kTakeoverReply[] = "OK\n";
+
+bool MakeAddr(const std::string& path, sockaddr_un& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// 在 deadline 前读到一行, 超时或对端关闭返回 false
+bool ReadLine(int fd, std::string& line, int timeout_ms) {
+    char c;
+    while (line.size() < 64) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0) return false;
+        if (read(fd, &c, 1) != 1) return false;
+        line.push_back(c);
+        if (c == '\n') return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+HandoverServer::HandoverServer(const std::string& path, TakeoverFn on_takeover)
+    : path_(path), on_takeover_(std::move(on_takeover)) {}
+
+HandoverServer::~HandoverServer() {
+    Stop();
+}
+
+bool HandoverServer::Start() {
+    sockaddr_un addr;
+    if (!MakeAddr(path_, addr)) {
+        spdlog::error("Handover socket path invalid: {}", path_);
+        return false;
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) return false;
+    unlink(path_.c_str());
+    if (bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 4) < 0) {
+        spdlog::error("Handover socket {} failed: {}", path_, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    worker_ = std::thread(&HandoverServer::Serve, this);
+    spdlog::info("Handover socket listening on {}", path_);
+    return true;
+}
+
+void HandoverServer::Stop() {
+    if (stop_.exchange(true)) return;
+    if (listen_fd_ >= 0) shutdown(listen_fd_, SHUT_RDWR);  // 唤醒阻塞中的 accept
+    if (worker_.joinable()) worker_.join();
+    if (listen_fd_ >= 0) close(listen_fd_);
+    listen_fd_ = -1;
+    if (!handed_over_) unlink(path_.c_str());
+}
+
+void HandoverServer::Serve() {
+    while (!stop_) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (stop_) break;
+            if (errno == EINTR) continue;
+            spdlog::error("Handover accept failed: {}", strerror(errno));
+            break;
+        }
+        bool taken = HandleConnection(fd);
+        close(fd);
+        if (taken) break;  // 只交接一次, 新进程随后在同一路径上重新监听
+    }
+}
+
+bool HandoverServer::HandleConnection(int fd) {
+    std::string line;
+    if (!ReadLine(fd, line, 1000) || line != kTakeoverRequest) {
+        spdlog::warn("Handover socket: unexpected request");
+        return false;
+    }
+    spdlog::warn("Handover requested by a new gateway process, draining");
+    handed_over_ = true;
+    on_takeover_();
+    (void)!write(fd, kTakeoverReply, sizeof(kTakeoverReply) - 1);
+    return true;
+}
+
+bool RequestTakeover(const std::string& path, int timeout_ms) {
+    sockaddr_un addr;
+    if (!MakeAddr(path, addr)) return false;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        // 没有旧进程: 首次启动, 或上一个进程已退出只留下 socket 文件
+        if (errno != ENOENT && errno != ECONNREFUSED) spdlog::warn("Handover connect {} failed: {}", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    bool ok = write(fd, kTakeoverRequest, sizeof(kTakeoverRequest) - 1) == static_cast<ssize_t>(sizeof(kTakeoverRequest) - 1);
+    std::string line;
+    ok = ok && ReadLine(fd, line, timeout_ms) && line == kTakeoverReply;
+    close(fd);
+    if (!ok) spdlog::warn("Handover: previous gateway did not acknowledge takeover");
+    return ok;
+}
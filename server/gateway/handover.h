@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// 网关平滑重启的控制通道 (Unix socket).
+//
+// 新进程先以 SO_REUSEPORT 与旧进程同时监听对外端口 (uSockets / gRPC 默认开启), 再连上控制 socket 发送 TAKEOVER;
+// 旧进程收到后停止 accept 并开始排空连接, 回复 OK. 之后新进程接管控制 socket 路径, 供下一次升级使用.
+// 两个进程使用同一 gateway_id, 会话路由与租约在交接期间保持有效.
+class HandoverServer {
+public:
+    using TakeoverFn = std::function<void()>;
+
+    HandoverServer(const std::string& path, TakeoverFn on_takeover);
+    ~HandoverServer();
+
+    HandoverServer(const HandoverServer&) = delete;
+    HandoverServer& operator=(const HandoverServer&) = delete;
+
+    // 路径上残留的 socket 文件 (旧进程已退出) 会被删除后重新绑定
+    bool Start();
+    void Stop();
+
+private:
+    void Serve();
+    bool HandleConnection(int fd);
+
+    std::string path_;
+    TakeoverFn on_takeover_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    bool handed_over_ = false;   // 路径已归新进程, 退出时不再删除
+    std::thread worker_;
+};
+
+// 新进程调用: 请求 path 上的旧进程让出端口. 没有旧进程 (路径不存在或无人监听) 时返回 false
+bool RequestTakeover(const std::string& path, int timeout_ms = 3000);
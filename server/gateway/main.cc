@@ -8,63 +8,555 @@
 #include <grpcpp/client_context.h>
 #include <grpcpp/create_channel.h>
 #include <thread>
-#include <nlohmann/json.hpp>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <future>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
 #include "../../common/config/config.h"
+#include "../../common/config/config_watcher.h"
+#include "../../common/auth/session_token.h"
+#include "../../common/presence/gateway_registry.h"
+#include "../../common/metrics/metrics.h"
+#include "../../common/trace/trace.h"
+#include "../../common/log/logging.h"
+#include "presence_store.h"
+#include "delivery_tracker.h"
+#include "ack_reporter.h"
+#include "session_manager.h"
+#include "push_dispatcher.h"
+#include "flat_json.h"
+#include "upload_proxy.h"
+#include "handover.h"
+#include "rate_limiter.h"
 
 std::unique_ptr<im::LogicService::Stub> logic_stub;
-using json = nlohmann::json;
+std::unique_ptr<SessionTokenCodec> token_codec;
+std::unique_ptr<PresenceStore> presence_store;
+std::unique_ptr<DeliveryTracker> delivery_tracker;
+std::unique_ptr<AckReporter> ack_reporter;
+std::unique_ptr<UploadProxy> upload_proxy;
+std::unique_ptr<RateLimiter> rate_limiter;   // 只在 loop 线程访问
+// 模块 logger, main 中初始化异步日志后赋值
+std::shared_ptr<spdlog::logger> ws_log;
+std::shared_ptr<spdlog::logger> push_log;
 
 struct PerSocketData {
     int64_t uid = 0; 
+    uint64_t conn_id = 0;  // 进程内唯一, 与 seq_id 一起生成 trace id
+    uint64_t ip_key = 0;   // 限流用的客户端地址哈希, 建连时计算
+    std::string device_id; // 登录时记录, 随 MsgSendReq 带给 logic server 做重发去重
 };
 
+std::atomic<uint64_t> next_conn_id{1};
+
+using GatewaySocket = uWS::WebSocket<false, true, PerSocketData>;
+
 class SessionManager{
     public:
     static SessionManager& GetInstance(){
         static SessionManager instance;
         return instance;
     }
-    void AddSession(int64_t uid, uWS::WebSocket<false, true, PerSocketData>* ws){
-        std::lock_guard<std::mutex> lock(mutex_);
-        sessions_[uid] = ws;
+    void AddSession(int64_t uid, GatewaySocket* ws){
+        sessions_.Add(uid , ws);
     }
 
-    void RemoveSession(int64_t uid){
-        std::lock_guard<std::mutex> lock(mutex_);
-        if(sessions_.find(uid) != sessions_.end()){
-            sessions_.erase(uid);
-        }
+    void RemoveSession(int64_t uid, GatewaySocket* ws){
+        sessions_.Remove(uid , ws);
+    }
+    // 推送统一交给 loop 线程写出; 必须在 gRPC 服务启动前, 在 loop 线程 (main) 上绑定
+    void BindLoop(uWS::Loop* loop){
+        dispatcher_ = std::make_unique<PushDispatcher<GatewaySocket>>(sessions_ , [loop]{
+            loop->defer([]{ SessionManager::GetInstance().dispatcher_->Drain(); });
+        });
+    }
+    // 任意线程调用, 推送包在所有接收者之间共享
+    bool PushToUser(int64_t uid, PushBuffer packet) {
+        return dispatcher_->Push(uid , std::move(packet));
     }
-    bool PushToUser(int64_t uid, const std::string& data) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = sessions_.find(uid);
-        if (it != sessions_.end()) {
-            it->second->send(data, uWS::OpCode::BINARY);
-            return true;
+    PushDispatchStats PushStats() const {
+        return dispatcher_->Stats();
+    }
+    void SetMaxBackpressure(size_t bytes){
+        dispatcher_->SetMaxBackpressure(bytes);
+    }
+    // 只在 loop 线程 (/metrics 处理函数) 中调用, getBufferedAmount 读取的是 loop 线程的状态
+    void CollectGauges(size_t& sessions , uint64_t& buffered_bytes){
+        sessions = 0;
+        buffered_bytes = 0;
+        sessions_.ForEach([&](int64_t , GatewaySocket* ws){
+            ++sessions;
+            buffered_bytes += ws->getBufferedAmount();
+        });
+    }
+    private:
+    SessionRegistry<GatewaySocket> sessions_;
+    std::unique_ptr<PushDispatcher<GatewaySocket>> dispatcher_;
+};
+// 按 cmd_id 统计上行请求数与处理延迟, 表在首次调用时建好, 之后只读
+struct CmdMetrics {
+    metrics::Counter* requests;
+    metrics::Histogram* latency;
+    std::string span_name;
+    metrics::Counter* limited_uid;
+    metrics::Counter* limited_ip;
+};
+
+CmdMetrics& MetricsForCmd(uint16_t cmd_id){
+    static std::unordered_map<uint16_t , CmdMetrics> table = []{
+        std::unordered_map<uint16_t , CmdMetrics> t;
+        auto& registry = metrics::Registry::Instance();
+        for(uint16_t cmd : {0x1001 , 0x1003 , 0x1006 , 0x1008 , 0x100A , 0}){
+            char label[8];
+            snprintf(label , sizeof(label) , "0x%04X" , cmd);
+            std::string name = cmd == 0 ? "other" : label;
+            t[cmd] = {registry.GetCounter("im_gateway_requests_total" , "Client requests by cmd_id" , {{"cmd" , name}}),
+                      registry.GetHistogram("im_gateway_request_seconds" , "Client request handling latency by cmd_id" , {{"cmd" , name}}),
+                      "gw.cmd." + name,
+                      registry.GetCounter("im_gateway_rate_limited_total" , "Client requests rejected by rate limit" , {{"cmd" , name} , {"scope" , "uid"}}),
+                      registry.GetCounter("im_gateway_rate_limited_total" , "Client requests rejected by rate limit" , {{"cmd" , name} , {"scope" , "ip"}})};
         }
+        return t;
+    }();
+    auto it = table.find(cmd_id);
+    return it != table.end() ? it->second : table[0];
+}
+
+// 网关到 logic server 的调用延迟, 调用处用 static 缓存指针
+metrics::Histogram* LogicRpcLatency(const char* method){
+    return metrics::Registry::Instance().GetHistogram("im_gateway_logic_rpc_seconds" , "Gateway to logic server gRPC latency" , {{"method" , method}});
+}
+
+std::vector<RateLimitRule> ToRateLimitRules(const Config::RateLimitConfig& cfg){
+    std::vector<RateLimitRule> rules;
+    if(!cfg.enabled) return rules;
+    for(const auto& r : cfg.rules){
+        rules.push_back({static_cast<uint16_t>(r.cmd) , static_cast<float>(r.uid_rate) , static_cast<float>(r.uid_burst) ,
+                         static_cast<float>(r.ip_rate) , static_cast<float>(r.ip_burst)});
+    }
+    return rules;
+}
+
+// 地址已在加载配置时校验过
+std::vector<uint64_t> ToExemptIpKeys(const Config::RateLimitConfig& cfg){
+    std::vector<uint64_t> keys;
+    for(const auto& ip : cfg.exempt_ips){
+        RateLimiter::TextIpKeys(ip , keys);
+    }
+    return keys;
+}
+
+// 被限流的请求回复对应响应 (err_code = ERR_RATE_LIMITED), 不转发给 logic server; 没有响应的命令 (如 MsgAck) 直接丢弃
+template <typename Res>
+void ReplyRateLimited(GatewaySocket* ws , const PacketHeader& header , uint16_t res_cmd){
+    Res res;
+    res.set_err_code(im::ERR_RATE_LIMITED);
+    res.set_err_msg("rate limited");
+    std::string res_body;
+    res.SerializeToString(&res_body);
+    ws->send(PacketHelper::BuildPacket(res_cmd , header.seq_id , res_body , header.version) , uWS::OpCode::BINARY);
+}
+
+bool AllowRequest(GatewaySocket* ws , const PacketHeader& header , CmdMetrics& cmd_metrics){
+    const PerSocketData* data = ws->getUserData();
+    uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    RateLimiter::Result result = rate_limiter->Check(header.cmd_id , data->uid , data->ip_key , now_ms);
+    if(result == RateLimiter::Result::OK) return true;
+
+    (result == RateLimiter::Result::UID_LIMITED ? cmd_metrics.limited_uid : cmd_metrics.limited_ip)->Inc();
+    static logging::RateLimit limit(10);
+    logging::Limited(limit , ws_log , spdlog::level::warn , "Rate limited cmd={:#x} uid={} by {}" , header.cmd_id , data->uid ,
+                     result == RateLimiter::Result::UID_LIMITED ? "uid" : "ip");
+    switch(header.cmd_id){
+        case 0x1001: ReplyRateLimited<im::LoginRes>(ws , header , 0x1002); break;
+        case 0x1003: ReplyRateLimited<im::MsgSendRes>(ws , header , 0x1004); break;
+        case 0x1006: ReplyRateLimited<im::SyncMsgRes>(ws , header , 0x1007); break;
+        case 0x1008: ReplyRateLimited<im::GetUploadUrlRes>(ws , header , 0x1009); break;
+        default: break;
+    }
+    return false;
+}
+
+// 调用 logic server: 记录延迟; 当前请求处于采样追踪中时带上 trace id 并记录 span
+template <typename Call>
+grpc::Status CallLogic(metrics::Histogram* latency , const char* span_name , grpc::ClientContext& context , Call&& call){
+    uint64_t trace_id = trace::CurrentTraceId();
+    if(trace_id != 0){
+        context.AddMetadata(trace::kTraceIdMetadataKey , trace::FormatTraceId(trace_id));
+    }
+    trace::Span span(span_name);
+    metrics::Stopwatch timer;
+    grpc::Status status = call();
+    latency->ObserveUs(timer.ElapsedUs());
+    return status;
+}
+
+// /api/* 的 HTTP 接口: loop 线程收齐请求体并解析, 用 gRPC 回调接口异步调用 logic server, 不阻塞 loop;
+// 完成回调在 gRPC 线程上执行, 经 Loop::defer 回到 loop 线程 cork 写出响应.
+// 客户端提前断开 (onAborted) 时取消 RPC, 之后的完成回调不再触碰已失效的 res
+constexpr size_t kMaxApiBodyBytes = 16 * 1024;
+
+template <typename Req , typename Res>
+struct ApiCall {
+    uWS::HttpResponse<false>* res = nullptr;
+    uWS::Loop* loop = nullptr;
+    bool aborted = false;    // 以下两个只在 loop 线程读写
+    bool finished = false;   // 请求体已处理 (已响应或已发起 RPC), 忽略之后的数据
+    std::string body;
+    grpc::ClientContext context;
+    Req req;
+    Res reply;
+};
+
+std::string ApiError(int code , std::string_view msg){
+    std::string out = "{\"code\":" + std::to_string(code) + ",\"msg\":";
+    AppendJsonString(out , msg);
+    out += "}";
+    return out;
+}
+
+void EndApiResponse(uWS::HttpResponse<false>* res , const std::string& body){
+    res->cork([res , &body]{
+        res->writeHeader("Access-Control-Allow-Origin", "*");
+        res->end(body);
+    });
+}
+
+// HTTP 接口的身份: Authorization: Bearer <签名令牌>, 只在网关本地校验 (未知 kid / 旧式令牌一律拒绝)
+bool VerifyBearerToken(std::string_view authorization , int64_t& uid){
+    constexpr std::string_view kPrefix = "Bearer ";
+    if(authorization.substr(0 , kPrefix.size()) != kPrefix){
         return false;
     }
-    private:
-    std::mutex mutex_;
-    std::unordered_map<int64_t, uWS::WebSocket<false, true, PerSocketData>*> sessions_;
+    SessionToken token;
+    if(token_codec->Verify(std::string(authorization.substr(kPrefix.size())) , token) != SessionTokenCodec::VerifyResult::OK ||
+       presence_store->IsRevoked(token.uid , token.issued_at)){
+        return false;
+    }
+    uid = token.uid;
+    return true;
+}
+
+// 文件名会拼进对象 key 和上传地址的查询串, 只保留安全字符
+std::string SanitizeFileName(std::string_view name){
+    std::string out;
+    for(char c : name.substr(0 , 128)){
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '_' ||
+                    static_cast<unsigned char>(c) >= 0x80;
+        out += safe ? c : '_';
+    }
+    return out;
+}
+
+struct UploadUrlCall {
+    grpc::ClientContext context;
+    im::GetUploadUrlReq req;
+    im::GetUploadUrlRes reply;
 };
+
+// POST /api/upload?name=<文件名>, 请求体为文件内容: 先向 logic server 申请上传地址, 再由 UploadProxy 边收边转发
+void HandleUpload(uWS::HttpResponse<false>* res , uWS::HttpRequest* req){
+    int64_t uid = 0;
+    if(!VerifyBearerToken(req->getHeader("authorization") , uid)){
+        EndApiResponse(res , ApiError(401 , "Unauthorized"));
+        return;
+    }
+    std::string_view length_header = req->getHeader("content-length");
+    uint64_t content_length = 0;
+    for(char c : length_header){
+        if(c < '0' || c > '9' || content_length > upload_proxy->Options().max_upload_bytes){
+            content_length = UINT64_MAX;
+            break;
+        }
+        content_length = content_length * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if(length_header.empty() || content_length == 0){
+        EndApiResponse(res , ApiError(411 , "Content-Length required"));
+        return;
+    }
+    if(content_length > upload_proxy->Options().max_upload_bytes){
+        EndApiResponse(res , ApiError(413 , "File too large"));
+        return;
+    }
+    std::string name = SanitizeFileName(req->getQuery("name"));
+    if(name.empty()){
+        EndApiResponse(res , ApiError(400 , "Missing file name"));
+        return;
+    }
+
+    auto session = upload_proxy->Begin(res , content_length , req->getHeader("content-type"));
+    auto call = std::make_shared<UploadUrlCall>();
+    call->req.set_uid(uid);
+    call->req.set_file_name(name);
+    call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(5));
+    uWS::Loop* loop = uWS::Loop::get();
+    static metrics::Histogram* rpc_latency = LogicRpcLatency("GetUploadUrl");
+    metrics::Stopwatch timer;
+    logic_stub->async()->GetUploadUrl(&call->context , &call->req , &call->reply , [call , session , loop , timer](grpc::Status status){
+        rpc_latency->ObserveUs(timer.ElapsedUs());
+        // volume 主机名在 gRPC 线程上解析, loop 线程只按数值地址连接
+        auto target = std::make_shared<UploadTarget>();
+        bool ok = status.ok() && call->reply.err_code() == 0 &&
+                  ResolveUploadTarget(call->reply.upload_url() , call->reply.download_url() , *target);
+        loop->defer([session , target , ok]{
+            if(ok){
+                upload_proxy->Connect(session , *target);
+            }
+            else{
+                upload_proxy->Fail(session , 502 , "Storage unavailable");
+            }
+        });
+    });
+}
+
+// parse(FlatJson, Req&) 填请求, 返回 false 时回 400; start(context, req, res, done) 发起异步 RPC;
+// reply(status, req, res) 生成响应 JSON
+template <typename Req , typename Res , typename Parse , typename Start , typename Reply>
+void HandleApiCall(uWS::HttpResponse<false>* res , metrics::Histogram* latency , Parse parse , Start start , Reply reply){
+    auto call = std::make_shared<ApiCall<Req , Res>>();
+    call->res = res;
+    call->loop = uWS::Loop::get();
+    res->onAborted([call]{
+        call->aborted = true;
+        call->context.TryCancel();
+        static logging::RateLimit limit(10);
+        logging::Limited(limit , ws_log , spdlog::level::warn , "HTTP request aborted");
+    });
+    res->onData([call , latency , parse , start , reply](std::string_view chunk , bool is_last){
+        if(call->finished){
+            return;
+        }
+        if(call->body.size() + chunk.size() > kMaxApiBodyBytes){
+            call->finished = true;
+            EndApiResponse(call->res , ApiError(413 , "Body too large"));
+            return;
+        }
+        call->body.append(chunk);
+        if(!is_last){
+            return;
+        }
+        call->finished = true;
+        FlatJson j;
+        if(!j.Parse(call->body) || !parse(j , call->req)){
+            EndApiResponse(call->res , ApiError(400 , "Invalid JSON"));
+            return;
+        }
+        metrics::Stopwatch timer;
+        start(&call->context , &call->req , &call->reply , [call , latency , reply , timer](grpc::Status status){
+            latency->ObserveUs(timer.ElapsedUs());
+            call->loop->defer([call , reply , status = std::move(status)]{
+                if(call->aborted){
+                    return;
+                }
+                EndApiResponse(call->res , reply(status , call->req , call->reply));
+            });
+        });
+    });
+}
+
+// 交接期间本进程已不再监听推送端口, 连到本机推送端口的只会是新进程.
+// 旧推送流上给本进程找不到的用户 (已重连到新进程) 的推送经它转投, 流本身保留到连接排空;
+// 新进程也报告不在线的用户在 kForwardMissTtl 内不再转投, 直接回执不在线
+constexpr auto kForwardMissTtl = std::chrono::seconds(3);
+constexpr size_t kForwardMissSweep = 4096;
+std::mutex push_forward_mu;
+std::shared_ptr<im::GatewayService::Stub> push_forward;
+std::unordered_map<int64_t , std::chrono::steady_clock::time_point> forward_misses;
+
+void EnablePushForward(){
+    const std::string& listen_addr = Config::Instance().GetGrpcConfig().gateway_server_listen_addr;
+    size_t colon = listen_addr.rfind(':');
+    if(colon == std::string::npos){
+        push_log->error("Bad gateway_server_listen_addr {}, pushes for moved users will be dropped" , listen_addr);
+        return;
+    }
+    std::string target = "127.0.0.1" + listen_addr.substr(colon);
+    auto stub = im::GatewayService::NewStub(grpc::CreateChannel(target , grpc::InsecureChannelCredentials()));
+    std::lock_guard<std::mutex> lk(push_forward_mu);
+    push_forward = std::move(stub);
+    push_log->info("Forwarding pushes for moved users to {}" , target);
+}
+
+// 未在交接, 或该用户刚被新进程报告不在线时返回空
+std::shared_ptr<im::GatewayService::Stub> ForwardTarget(int64_t to_uid){
+    std::lock_guard<std::mutex> lk(push_forward_mu);
+    if(!push_forward) return nullptr;
+    auto it = forward_misses.find(to_uid);
+    if(it != forward_misses.end()){
+        if(std::chrono::steady_clock::now() < it->second) return nullptr;
+        forward_misses.erase(it);
+    }
+    return push_forward;
+}
+
+// 只记录新进程明确给出的结果, 超时/连接失败不算不在线
+void RecordForwardResult(int64_t to_uid , bool delivered){
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(push_forward_mu);
+    if(delivered){
+        forward_misses.erase(to_uid);
+        return;
+    }
+    if(forward_misses.size() >= kForwardMissSweep){
+        for(auto it = forward_misses.begin(); it != forward_misses.end();){
+            it = it->second <= now ? forward_misses.erase(it) : std::next(it);
+        }
+    }
+    forward_misses[to_uid] = now + kForwardMissTtl;
+}
+
+// 经新进程的 PushMsg 异步转投, 完成 (含超时) 后在 gRPC 回调线程上调用 done
+void ForwardPushAsync(std::shared_ptr<im::GatewayService::Stub> stub , int64_t to_uid , int64_t msg_id , const std::string& content ,
+                      std::function<void(bool)> done){
+    struct Call{
+        grpc::ClientContext context;
+        im::PushMsgReq req;
+        im::PushMsgRes res;
+    };
+    auto call = std::make_shared<Call>();
+    call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(2));
+    call->req.set_to_uid(to_uid);
+    call->req.set_msg_id(msg_id);
+    call->req.set_content(content);
+    auto* async = stub->async();
+    async->PushMsg(&call->context , &call->req , &call->res , [call , stub = std::move(stub) , to_uid , done = std::move(done)](grpc::Status status){
+        bool delivered = status.ok() && call->res.err_code() == 0;
+        if(status.ok()) RecordForwardResult(to_uid , delivered);
+        done(delivered);
+    });
+}
+
+// 同步转投, 只用于单条的 PushMsg; 未在交接或新进程也找不到该用户时返回 false
+bool ForwardPush(int64_t to_uid , int64_t msg_id , const std::string& content){
+    auto stub = ForwardTarget(to_uid);
+    if(!stub) return false;
+    std::promise<bool> result;
+    auto delivered = result.get_future();
+    ForwardPushAsync(std::move(stub) , to_uid , msg_id , content , [&result](bool ok){ result.set_value(ok); });
+    return delivered.get();
+}
+
 class GatewayServiceImpl final : public im::GatewayService::Service{
     grpc::Status PushMsg(grpc::ServerContext* context , const im::PushMsgReq* request , im::PushMsgRes* reply){
-        spdlog::info("RPC PushMsg recv : ToUId = {} , len = {}",request->to_uid() , request->content());
-        bool success = SessionManager::GetInstance().PushToUser(request->to_uid() , request->content());
+        push_log->debug("RPC PushMsg recv : ToUId = {} , len = {}",request->to_uid() , request->content().size());
+        PushBuffer packet = MakePushBuffer(request->content());
+        bool success = request->msg_id() != 0
+            ? delivery_tracker->Deliver(request->to_uid() , request->msg_id() , packet)
+            : SessionManager::GetInstance().PushToUser(request->to_uid() , packet);
+        if(!success){
+            success = ForwardPush(request->to_uid() , request->msg_id() , *packet);
+        }
         if(success){
             reply->set_err_code(0);
-            spdlog::info("<<< pushed to client successfully");
+            push_log->debug("<<< pushed to client successfully");
         }
         else{
             reply->set_err_code(-1);
             reply->set_err_msg("User not found locally");
-            spdlog::warn("<<<Push to User {} not found on this gateway" , request->to_uid());
+            static logging::RateLimit limit(10);
+            logging::Limited(limit , push_log , spdlog::level::warn , "<<<Push to User {} not found on this gateway" , request->to_uid());
         }
         return grpc::Status::OK;
     }
+
+    // logic server 的长连接推送流: 每批帧逐个投递后整批回执, 回执写不出去 (logic 端断开) 即结束
+    // 帧正文直接移入推送包; 同一批里连续的相同正文 (一条消息扇出给本网关的多个用户) 共用一个推送包
+    // 交接期间需要转投的帧并发异步发出, 不阻塞读循环; 它们的回执在转投全部完成后另成一批写回 (logic 按 frame_id 对账)
+    grpc::Status PushStream(grpc::ServerContext* context , grpc::ServerReaderWriter<im::PushResultBatch , im::PushBatch>* stream) override{
+        push_log->info("Push stream opened by {}" , context->peer());
+        // 转投批次: remaining 初始为 1 由读循环持有, 本批帧全部发出后释放, 避免先完成的回调提前写出半批
+        struct Forwarded{
+            im::PushResultBatch results;
+            size_t remaining = 1;
+        };
+        struct Writer{
+            grpc::ServerReaderWriter<im::PushResultBatch , im::PushBatch>* stream;
+            std::mutex mu;                  // 流的 Write 不能并发
+            std::condition_variable idle;
+            size_t forwarding = 0;          // 未写回的转投批次
+            bool broken = false;
+
+            bool Write(const im::PushResultBatch& results){
+                if(!broken && !stream->Write(results)) broken = true;
+                return !broken;
+            }
+            // 调用方持有 mu
+            void Release(Forwarded& batch){
+                if(--batch.remaining > 0) return;
+                if(batch.results.results_size() > 0) Write(batch.results);
+                --forwarding;
+                idle.notify_all();
+            }
+        } writer{stream};
+        im::PushBatch batch;
+        im::PushResultBatch results;
+        while(stream->Read(&batch)){
+            results.Clear();
+            std::shared_ptr<Forwarded> forwarded;
+            PushBuffer packet;
+            for(auto& frame : *batch.mutable_frames()){
+                // 带 msg_id 的帧进入会话的确认窗口, 客户端未确认时由时间轮重传
+                trace::ScopedTrace trace_ctx(frame.trace_id());
+                trace::Span span("gw.push_deliver");
+                if(!packet || *packet != frame.content()){
+                    packet = MakePushBuffer(std::move(*frame.mutable_content()));
+                }
+                bool ok = frame.msg_id() != 0
+                    ? delivery_tracker->Deliver(frame.to_uid() , frame.msg_id() , packet)
+                    : SessionManager::GetInstance().PushToUser(frame.to_uid() , packet);
+                std::shared_ptr<im::GatewayService::Stub> stub;
+                if(!ok && (stub = ForwardTarget(frame.to_uid()))){
+                    {
+                        std::lock_guard<std::mutex> lk(writer.mu);
+                        if(!forwarded){
+                            forwarded = std::make_shared<Forwarded>();
+                            ++writer.forwarding;
+                        }
+                        ++forwarded->remaining;
+                    }
+                    uint64_t frame_id = frame.frame_id();
+                    ForwardPushAsync(std::move(stub) , frame.to_uid() , frame.msg_id() , *packet ,
+                                     [&writer , forwarded , frame_id](bool delivered){
+                        std::lock_guard<std::mutex> lk(writer.mu);
+                        auto* result = forwarded->results.add_results();
+                        result->set_frame_id(frame_id);
+                        result->set_err_code(delivered ? 0 : -1);
+                        writer.Release(*forwarded);
+                    });
+                    continue;
+                }
+                auto* result = results.add_results();
+                result->set_frame_id(frame.frame_id());
+                result->set_err_code(ok ? 0 : -1);
+            }
+            std::lock_guard<std::mutex> lk(writer.mu);
+            if(forwarded) writer.Release(*forwarded);
+            if(results.results_size() > 0 && !writer.Write(results)){
+                break;
+            }
+        }
+        // 转投的回调还会写这条流, 等它们全部结束 (最长为转投超时) 再返回
+        {
+            std::unique_lock<std::mutex> lk(writer.mu);
+            writer.idle.wait(lk , [&writer]{ return writer.forwarding == 0; });
+        }
+        push_log->info("Push stream closed by {}" , context->peer());
+        return grpc::Status::OK;
+    }
 };
 
+// 推送服务; 排空时由其它线程 Shutdown, 锁保证 Shutdown 期间 server 不被析构
+std::mutex push_server_mu;
+grpc::Server* push_server = nullptr;
+std::promise<bool> grpc_started;
+
 void RunGrpcServer(){
         Config& config = Config::Instance();
         std::string server_address = config.GetGrpcConfig().gateway_server_listen_addr;
@@ -75,13 +567,160 @@ void RunGrpcServer(){
         builder.RegisterService(&service);
 
         std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+        {
+            std::lock_guard<std::mutex> lk(push_server_mu);
+            push_server = server.get();
+        }
+        grpc_started.set_value(server != nullptr);
+        if(!server){
+            spdlog::error("Gateway gRpc Server failed to listen on {}", server_address);
+            return;
+        }
         spdlog::info("Gateway gRpc Server listening on {}", server_address);
         server->Wait();
+        std::lock_guard<std::mutex> lk(push_server_mu);
+        push_server = nullptr;
     }
 
+// 立即停止监听推送端口, 已建立的推送流在 deadline 后被取消, logic server 随即重连 (交接时连到新进程).
+// 阻塞到所有推送流结束; 重复调用时等前一次完成后直接返回
+void ShutdownGrpcServer(std::chrono::system_clock::time_point deadline){
+    std::lock_guard<std::mutex> lk(push_server_mu);
+    if(push_server){
+        push_server->Shutdown(deadline);
+    }
+}
+
+void ShutdownGrpcServer(){
+    ShutdownGrpcServer(std::chrono::system_clock::now() + std::chrono::seconds(1));
+}
+
+// 排空: 停止 accept, 打乱顺序后在 drain_sec 内均匀关闭全部客户端连接 (1012 Service Restart),
+// 客户端的重连因此分散在整个窗口内, 不会同时涌向新进程 / 其它网关与 logic server.
+//   交接 (新进程同 gateway_id 已在监听): 推送端口立即停止监听, 新建的推送流都连到新进程; 已有的推送流保留到连接排空,
+//         其中发给已迁走用户的推送转投新进程. 会话路由和租约保持不变;
+//   SIGTERM (无后继): 推送服务保留到最后, 关闭连接的同时按批删除仍指向本网关的会话路由, 退出时删除租约.
+// 连接全部关闭后 uWS 的 run() 返回, main 收尾退出. 除 ticker 线程外只在 loop 线程访问
+struct GatewayDrain {
+    us_listen_socket_t* listen_socket = nullptr;
+    us_listen_socket_t* admin_socket = nullptr;   // 管理端口, 也要关掉 run() 才会返回
+    std::unordered_map<uint64_t , GatewaySocket*> connections;   // conn_id -> 连接, 含未登录的
+    bool draining = false;
+    bool handover = false;
+    std::vector<uint64_t> order;
+    size_t next = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::milliseconds window{0};
+    std::atomic<bool> done{false};
+    std::thread ticker;
+    std::thread push_shutdown;   // 交接时等待旧推送流结束
+};
+GatewayDrain drain;
+
+void DrainTick(){
+    if(drain.next >= drain.order.size()) return;
+    auto elapsed = std::chrono::steady_clock::now() - drain.start;
+    size_t target = drain.order.size();
+    if(elapsed < drain.window){
+        target = static_cast<size_t>(drain.order.size() * std::chrono::duration<double>(elapsed) / drain.window) + 1;
+        target = std::min(target , drain.order.size());
+    }
+    std::vector<int64_t> uids;
+    while(drain.next < target){
+        auto it = drain.connections.find(drain.order[drain.next++]);
+        if(it == drain.connections.end()) continue;   // 客户端已自行断开
+        GatewaySocket* ws = it->second;
+        if(!drain.handover && ws->getUserData()->uid != 0) uids.push_back(ws->getUserData()->uid);
+        ws->end(1012 , "server restart");   // 触发 close 回调, it 随之失效
+    }
+    presence_store->RemoveRoutes(uids);
+    if(drain.next >= drain.order.size()){
+        drain.done.store(true);
+        spdlog::warn("Drain finished: {} connections closed", drain.order.size());
+    }
+}
+
+void BeginDrain(bool handover){
+    if(drain.draining) return;
+    drain.draining = true;
+    drain.handover = handover;
+    if(drain.listen_socket){
+        us_listen_socket_close(0 , drain.listen_socket);
+        drain.listen_socket = nullptr;
+    }
+    if(drain.admin_socket){
+        us_listen_socket_close(0 , drain.admin_socket);
+        drain.admin_socket = nullptr;
+    }
+    if(handover) presence_store->KeepLeaseOnExit();
+
+    drain.order.reserve(drain.connections.size());
+    for(const auto& kv : drain.connections) drain.order.push_back(kv.first);
+    std::shuffle(drain.order.begin() , drain.order.end() , std::mt19937_64(std::random_device()()));
+    const int drain_sec = std::max(Config::Instance().GetConfig().gateway.drain.drain_sec , 0);
+    drain.window = std::chrono::seconds(drain_sec);
+    drain.start = std::chrono::steady_clock::now();
+    spdlog::warn("Draining {} connections over {}s ({})" , drain.order.size() , drain_sec , handover ? "handover" : "shutdown");
+    if(handover){
+        EnablePushForward();
+        auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(drain.order.empty() ? 0 : drain_sec) + std::chrono::seconds(1);
+        drain.push_shutdown = std::thread([deadline]{ ShutdownGrpcServer(deadline); });
+    }
+    if(drain.order.empty()){
+        drain.done.store(true);
+        return;
+    }
+
+    uWS::Loop* loop = uWS::Loop::get();
+    drain.ticker = std::thread([loop]{
+        while(!drain.done.load()){
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            loop->defer(DrainTick);
+        }
+    });
+}
+
+// SIGTERM / SIGINT 开始排空, 再收到一次直接退出. 信号在 main 开头对所有线程屏蔽, 只在这里同步等待
+void WaitForSignals(sigset_t signals , uWS::Loop* loop){
+    int sig = 0;
+    if(sigwait(&signals , &sig) != 0) return;
+    spdlog::warn("Received signal {}, draining (send again to exit immediately)" , sig);
+    loop->defer([]{ BeginDrain(false); });
+    if(sigwait(&signals , &sig) != 0) return;
+    spdlog::warn("Received signal {} again, exiting" , sig);
+    std::_Exit(1);
+}
+
+// logic server 通道: 多个后端按 round_robin 分发, 并通过 grpc.health.v1 健康检查摘除不可用节点
+std::shared_ptr<grpc::Channel> CreateLogicChannel(const std::vector<std::string>& addrs){
+    std::string target;
+    if(addrs.size() == 1){
+        target = addrs[0];
+    }
+    else{
+        target = "ipv4:";
+        for(size_t i = 0 ; i < addrs.size() ; ++i){
+            if(i > 0) target += ",";
+            target += addrs[i];
+        }
+    }
+    grpc::ChannelArguments args;
+    args.SetServiceConfigJSON(std::string(R"({"loadBalancingConfig":[{"round_robin":{}}],"healthCheckConfig":{"serviceName":")") +
+                              kLogicHealthServiceName + R"("}})");
+    spdlog::info("Logic Server target: {}", target);
+    return grpc::CreateCustomChannel(target , grpc::InsecureChannelCredentials() , args);
+}
+
 int main() {
+    // 先于任何线程创建, 让所有线程继承屏蔽, 信号只由 WaitForSignals 处理
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals , SIGTERM);
+    sigaddset(&stop_signals , SIGINT);
+    pthread_sigmask(SIG_BLOCK , &stop_signals , nullptr);
 
-    spdlog::set_pattern("[%H:%M:%S%z][%^%L%$][Gateway-uWS] %v");
+    const std::string log_pattern = "[%H:%M:%S%z][%^%L%$][Gateway-uWS][%n] %v";
+    spdlog::set_pattern(log_pattern);
     
     // Load configuration
     Config& config = Config::Instance();
@@ -90,16 +729,145 @@ int main() {
         return 1;
     }
 
+    const auto& log_cfg = config.GetLogConfig();
+    logging::Init(log_pattern , {log_cfg.queue_size , log_cfg.flush_interval_sec , log_cfg.level , log_cfg.modules});
+    ws_log = logging::Get("ws");
+    push_log = logging::Get("push");
+
     spdlog::info("Starting uWebSockets Gateway on port 8000...");
 
+    trace::Tracer::Instance().Configure("gateway" , config.GetTraceConfig().ring_capacity , config.GetTraceConfig().sample_every);
+
+    // uWS::App 在同一线程上复用这个 loop
+    SessionManager::GetInstance().BindLoop(uWS::Loop::get());
+    const auto& seaweedfs_cfg = config.GetSeaweedFSConfig();
+    UploadProxyOptions upload_options;
+    upload_options.max_upload_bytes = static_cast<uint64_t>(std::max(seaweedfs_cfg.upload_max_mb , 1)) << 20;
+    upload_options.max_pending_bytes = static_cast<size_t>(std::max(seaweedfs_cfg.upload_max_pending_kb , 16)) * 1024;
+    upload_options.timeout_sec = static_cast<unsigned int>(std::max(seaweedfs_cfg.upload_timeout_sec , 1));
+    upload_proxy = std::make_unique<UploadProxy>(uWS::Loop::get() , upload_options);
+
+    const auto& limit_cfg = config.GetConfig().gateway.rate_limit;
+    rate_limiter = std::make_unique<RateLimiter>(static_cast<size_t>(std::max(limit_cfg.table_capacity , 64)));
+    rate_limiter->SetRules(ToRateLimitRules(limit_cfg));
+    rate_limiter->SetExemptIps(ToExemptIpKeys(limit_cfg));
+
+    // 配置热更新: 日志级别、推送背压上限与限流规则; 上行包大小上限在消息处理时读取当前快照
+    const auto& ws_cfg = config.GetConfig().gateway.ws;
+    SessionManager::GetInstance().SetMaxBackpressure(static_cast<size_t>(ws_cfg.max_backpressure_kb) * 1024);
+    uWS::Loop* main_loop = uWS::Loop::get();
+    config.OnReload([main_loop](const Config::ServerConfig& cfg){
+        logging::ApplyLevels(cfg.log.level , cfg.log.modules);
+        SessionManager::GetInstance().SetMaxBackpressure(static_cast<size_t>(cfg.gateway.ws.max_backpressure_kb) * 1024);
+        // 桶表只在 loop 线程访问
+        main_loop->defer([rules = ToRateLimitRules(cfg.gateway.rate_limit) , exempt = ToExemptIpKeys(cfg.gateway.rate_limit)]() mutable {
+            rate_limiter->SetRules(rules);
+            rate_limiter->SetExemptIps(std::move(exempt));
+        });
+    });
+    static ConfigWatcher config_watcher("../config.yaml");
+    config_watcher.Start();
+
     std::thread grpc_thread(RunGrpcServer);
-    grpc_thread.detach();
 
     //初始化gRpc Channel
-    std::string logic_server_address = config.GetGrpcConfig().logic_server_addr;
-    auto channel = grpc::CreateChannel(logic_server_address , grpc::InsecureChannelCredentials());
-    logic_stub = im::LogicService::NewStub(channel);
-    spdlog::info("Connected to Logic Server at {}", logic_server_address);
+    const auto& grpc_cfg = config.GetGrpcConfig();
+    logic_stub = im::LogicService::NewStub(CreateLogicChannel(grpc_cfg.logic_server_addrs));
+
+    token_codec = std::make_unique<SessionTokenCodec>(config.GetAuthConfig());
+    presence_store = std::make_unique<PresenceStore>(config.GetRedisConfig(),
+                                                     grpc_cfg.gateway_id,
+                                                     grpc_cfg.gateway_server_addr,
+                                                     grpc_cfg.gateway_lease_ttl_sec,
+                                                     config.GetAuthConfig().revocation_refresh_sec,
+                                                     config.GetAuthConfig().token_ttl_sec,
+                                                     static_cast<size_t>(std::max(config.GetConfig().gateway.drain.unregister_batch , 1)));
+    spdlog::info("Gateway id = {} , push addr = {}", grpc_cfg.gateway_id, grpc_cfg.gateway_server_addr);
+    presence_store->Start();
+
+    delivery_tracker = std::make_unique<DeliveryTracker>([](int64_t uid , const PushBuffer& packet){
+        return SessionManager::GetInstance().PushToUser(uid , packet);
+    });
+    delivery_tracker->Start();
+    ack_reporter = std::make_unique<AckReporter>(logic_stub.get());
+    ack_reporter->Start();
+
+    std::thread(WaitForSignals , stop_signals , uWS::Loop::get()).detach();
+    // 交接完成后由本进程持有控制 socket, 供下一次升级使用
+    const std::string& control_socket = config.GetConfig().gateway.drain.control_socket;
+    std::unique_ptr<HandoverServer> handover_server;
+    if(!control_socket.empty()){
+        uWS::Loop* loop = uWS::Loop::get();
+        handover_server = std::make_unique<HandoverServer>(control_socket , [loop]{
+            loop->defer([]{ BeginDrain(true); });
+        });
+    }
+
+    // 会话数/待发送字节数/确认窗口统计在抓取时读取; 只会在 loop 线程的 /metrics 处理函数里触发
+    metrics::Registry::Instance().AddCollector([](std::string& out){
+        size_t sessions = 0;
+        uint64_t buffered_bytes = 0;
+        SessionManager::GetInstance().CollectGauges(sessions , buffered_bytes);
+        out += "# HELP im_gateway_sessions Logged-in WebSocket sessions\n# TYPE im_gateway_sessions gauge\n";
+        out += "im_gateway_sessions " + std::to_string(sessions) + "\n";
+        out += "# HELP im_gateway_outbound_buffered_bytes Bytes queued in WebSocket send buffers (backpressure)\n# TYPE im_gateway_outbound_buffered_bytes gauge\n";
+        out += "im_gateway_outbound_buffered_bytes " + std::to_string(buffered_bytes) + "\n";
+
+        PushDispatchStats push = SessionManager::GetInstance().PushStats();
+        out += "# HELP im_gateway_push_frames_total Push frames written to client connections\n# TYPE im_gateway_push_frames_total counter\n";
+        out += "im_gateway_push_frames_total " + std::to_string(push.frames) + "\n";
+        out += "# HELP im_gateway_push_flushes_total Corked connection writes carrying push frames\n# TYPE im_gateway_push_flushes_total counter\n";
+        out += "im_gateway_push_flushes_total " + std::to_string(push.flushes) + "\n";
+        out += "# HELP im_gateway_push_backpressured_total Push frames dropped because the connection send buffer was over limit\n# TYPE im_gateway_push_backpressured_total counter\n";
+        out += "im_gateway_push_backpressured_total " + std::to_string(push.backpressured) + "\n";
+
+        out += "# HELP im_gateway_rate_limit_evictions_total Token buckets evicted from a full probe window\n# TYPE im_gateway_rate_limit_evictions_total counter\n";
+        out += "im_gateway_rate_limit_evictions_total " + std::to_string(rate_limiter->Evictions()) + "\n";
+
+        DeliveryStats st = delivery_tracker->Stats();
+        out += "# HELP im_gateway_delivery_total Acknowledged delivery events\n# TYPE im_gateway_delivery_total counter\n";
+        for(const auto& kv : {std::make_pair("sent" , st.sent) , std::make_pair("retransmit" , st.retransmits) ,
+                              std::make_pair("acked" , st.acked) , std::make_pair("given_up" , st.given_up) ,
+                              std::make_pair("overflow" , st.overflow)}){
+            out += std::string("im_gateway_delivery_total{event=\"") + kv.first + "\"} " + std::to_string(kv.second) + "\n";
+        }
+    });
+
+    // 诊断接口只挂在管理端口上 (默认 127.0.0.1), 不随 8000 端口对外; 与主 App 共用同一个 loop 线程
+    uWS::App admin_app;
+    const std::string& admin_addr = config.GetMetricsConfig().gateway_admin_addr;
+    if(!admin_addr.empty()){
+        size_t colon = admin_addr.rfind(':');
+        std::string admin_host = colon == std::string::npos ? "" : admin_addr.substr(0 , colon);
+        int admin_port = colon == std::string::npos ? 0 : std::atoi(admin_addr.c_str() + colon + 1);
+        admin_app
+            // 查看 / 修改日志级别: ?module=push&level=debug, 不带 level 时只列出当前级别
+            .get("/debug/loglevel", [](auto *res, auto *req) {
+                std::string module(req->getQuery("module"));
+                std::string level(req->getQuery("level"));
+                res->end(logging::HandleLevelRequest(module , level));
+            })
+            // 立即重新加载配置文件 (平时由文件监视自动触发)
+            .get("/debug/config/reload", [](auto *res, auto *req) {
+                res->end(HandleConfigReload());
+            })
+            // 采样追踪导出 (Chrome trace 格式), 可按 trace_id 过滤
+            .get("/debug/traces", [](auto *res, auto *req) {
+                uint64_t trace_id = trace::ParseTraceId(req->getQuery("trace_id"));
+                res->writeHeader("Content-Type", "application/json");
+                res->end(trace::Tracer::Instance().DumpChromeTrace(trace_id));
+            })
+            .get("/metrics", [](auto *res, auto *req) {
+                res->writeHeader("Content-Type", "text/plain; version=0.0.4");
+                res->end(metrics::Registry::Instance().Expose());
+            })
+            .listen(admin_host , admin_port , [&admin_addr](auto *listen_socket) {
+                // 管理端口不可用不影响服务
+                if (listen_socket) spdlog::info("Admin listening on {}", admin_addr);
+                else spdlog::error("Failed to listen on admin addr {}", admin_addr);
+                drain.admin_socket = listen_socket;
+            });
+    }
 
     uWS::App()
         .options("/*", [](auto *res, auto *req) {
@@ -110,64 +878,106 @@ int main() {
         })
         .ws<PerSocketData>("/ws", {
             
+            // uWS 在注册时固定这些值: 包大小和背压以启动配置为硬上限, 运行时只能在其内收紧; 空闲超时改动需重启
             .compression = uWS::SHARED_COMPRESSOR,
-            .maxPayloadLength = 16 * 1024, 
-            .idleTimeout = 60,             
+            .maxPayloadLength = static_cast<unsigned int>(ws_cfg.max_payload_kb) * 1024,
+            .idleTimeout = static_cast<unsigned short>(std::clamp(ws_cfg.idle_timeout_sec , 0 , 960)),
+            .maxBackpressure = static_cast<unsigned int>(ws_cfg.max_backpressure_kb) * 1024,
 
             .open = [](auto *ws) {
-                spdlog::info("New Connection!");
+                ws->getUserData()->conn_id = next_conn_id.fetch_add(1 , std::memory_order_relaxed);
+                ws->getUserData()->ip_key = RateLimiter::IpKey(ws->getRemoteAddress());
+                ws_log->debug("New Connection!");
+                if(drain.draining){
+                    // 停止 accept 前已在队列中的连接
+                    ws->end(1012 , "server restart");
+                    return;
+                }
+                drain.connections.emplace(ws->getUserData()->conn_id , ws);
             },
             .message = [](auto *ws, std::string_view message, uWS::OpCode opCode) {
                 if (opCode != uWS::OpCode::BINARY) {
-                    spdlog::warn("Drop non-binary message");
+                    static logging::RateLimit limit(10);
+                    logging::Limited(limit , ws_log , spdlog::level::warn , "Drop non-binary message");
                     return;
                 }
 
                 // 长度校验
+                if (message.length() > static_cast<size_t>(Config::Instance().Current()->gateway.ws.max_payload_kb) * 1024) {
+                    static logging::RateLimit limit(10);
+                    logging::Limited(limit , ws_log , spdlog::level::warn , "Packet too large: {}", message.length());
+                    return;
+                }
                 if (message.length() < HEADER_LEN) {
-                    spdlog::warn("Packet too short: {}", message.length());
+                    static logging::RateLimit limit(10);
+                    logging::Limited(limit , ws_log , spdlog::level::warn , "Packet too short: {}", message.length());
                     return;
                 }
                 const uint8_t* buffer = reinterpret_cast<const uint8_t*>(message.data());
                 PacketHeader header = PacketHelper::DecodeHeader(buffer);
-                
+                CmdMetrics& cmd_metrics = MetricsForCmd(header.cmd_id);
+                cmd_metrics.requests->Inc();
+                metrics::ScopedTimer cmd_timer(cmd_metrics.latency);
+                uint64_t trace_id = trace::MakeTraceId(ws->getUserData()->conn_id , header.seq_id);
+                trace::ScopedTrace trace_ctx(trace::Tracer::Instance().ShouldSample(trace_id) ? trace_id : 0);
+                trace::Span cmd_span(cmd_metrics.span_name.c_str());
+                if(!AllowRequest(ws , header , cmd_metrics)){
+                    return;
+                }
+
                 if(header.cmd_id == 0x1001){
                     im::LoginReq req;
                     if(req.ParseFromArray(buffer + HEADER_LEN , header.length - HEADER_LEN)){
-                        spdlog::info(">>recv logincReq: uid = {}" , req.uid());
+                        ws_log->debug(">>recv logincReq: uid = {}" , req.uid());
                         im::LoginRes res;
-                        grpc::ClientContext context;
-                        grpc::Status status = logic_stub->Login(&context , req , &res);
-                        if(status.ok()){
-                            if(res.err_code() == im::ErrorCode::ERR_SUCCESS){
-                                spdlog::info("<<< rpc login success ! Session_id = {}" , res.session_id());
-                                ws->getUserData()->uid = req.uid();
-                                SessionManager::GetInstance().AddSession(req.uid() , ws);
+                        bool handled_locally = false;
+                        if(SessionTokenCodec::LooksSigned(req.token())){
+                            // 签名令牌在网关本地校验, 不访问 logic server / DB
+                            // 未知 kid (密钥轮换期间网关配置落后) 时回退到 logic server
+                            SessionToken token;
+                            auto result = token_codec->Verify(req.token() , token);
+                            if(result != SessionTokenCodec::VerifyResult::UNKNOWN_KEY){
+                                handled_locally = true;
+                                if(result == SessionTokenCodec::VerifyResult::OK &&
+                                   SessionTokenCodec::Matches(token , req.uid() , req.device_id()) &&
+                                   !presence_store->IsRevoked(token.uid , token.issued_at)){
+                                    res.set_err_code(im::ERR_SUCCESS);
+                                    res.set_session_id("sess_" + std::to_string(req.uid()));
+                                    res.set_server_time(time(nullptr));
+                                    presence_store->SetRoute(req.uid());
+                                }
+                                else{
+                                    res.set_err_code(im::ERR_AUTH_FAIL);
+                                    res.set_err_msg("Invalid token");
+                                }
                             }
-                            else{
-                                spdlog::warn("<<< RPC Login Failed: {}", res.err_msg());
+                        }
+                        if(!handled_locally){
+                            grpc::ClientContext context;
+                            // logic server 据此把会话路由登记到本网关
+                            context.AddMetadata(kGatewayIdMetadataKey , Config::Instance().GetGrpcConfig().gateway_id);
+                            static metrics::Histogram* rpc_latency = LogicRpcLatency("Login");
+                            grpc::Status status = CallLogic(rpc_latency , "gw.rpc.Login" , context , [&]{ return logic_stub->Login(&context , req , &res); });
+                            if(!status.ok()){
+                                static logging::RateLimit limit(10);
+                                logging::Limited(limit , ws_log , spdlog::level::err , "RPC Login Failed: {} - {}", (int)status.error_code(), status.error_message());
+                                return;
                             }
-                            std::string res_body;
-                            res.SerializeToString(&res_body);
-
-                            PacketHeader res_header;
-                            res_header.length = HEADER_LEN + res_body.size();
-                            res_header.version = header.version;
-                            res_header.cmd_id = 0x1002;
-                            res_header.seq_id = header.seq_id;
-
-                            uint8_t head_buffer[HEADER_LEN];
-                            PacketHelper::EncodeHeader(res_header , head_buffer);
-
-                            std::string send_data;
-                            send_data.append((char*)head_buffer , HEADER_LEN);
-                            send_data.append(res_body);
-
-                            ws->send(send_data , uWS::OpCode::BINARY);
+                        }
+                        if(res.err_code() == im::ErrorCode::ERR_SUCCESS){
+                            ws_log->debug("<<< login success ! Session_id = {}" , res.session_id());
+                            ws->getUserData()->uid = req.uid();
+                            ws->getUserData()->device_id = req.device_id();
+                            delivery_tracker->OnSessionOpened(req.uid() , ws->getUserData()->conn_id);
+                            SessionManager::GetInstance().AddSession(req.uid() , ws);
                         }
                         else{
-                            spdlog::error("RPC Call Failed: {} - {}", (int)status.error_code(), status.error_message());
+                            static logging::RateLimit limit(10);
+                            logging::Limited(limit , ws_log , spdlog::level::warn , "<<< Login Failed: uid = {} {}", req.uid() , res.err_msg());
                         }
+                        std::string res_body;
+                        res.SerializeToString(&res_body);
+                        ws->send(PacketHelper::BuildPacket(0x1002 , header.seq_id , res_body , header.version) , uWS::OpCode::BINARY);
                     }   
                 }
                 else if(header.cmd_id == 0x1003){
@@ -176,15 +986,21 @@ int main() {
                         req.ParseFromArray(buffer + HEADER_LEN , message.length() - HEADER_LEN)){
                             int64_t current_id = ws->getUserData()->uid;
                             if(current_id == 0){
-                                spdlog::warn("User not logged in , frop msg");
+                                static logging::RateLimit limit(10);
+                                logging::Limited(limit , ws_log , spdlog::level::warn , "User not logged in , drop msg");
                                 return;
                             }
                             req.mutable_msg()->set_from_uid(current_id);
-                            spdlog::info(">> Recv MsgSendReq: to {} content = {}" ,req.msg().to_uid() , req.msg().content());
+                            // 客户端超时重发时沿用原 seq_id, logic server 据此返回首次的结果
+                            req.set_device_id(ws->getUserData()->device_id);
+                            req.set_seq_id(header.seq_id);
+                            // 正文只在 debug 级别格式化
+                            ws_log->debug(">> Recv MsgSendReq: to {} content = {}" ,req.msg().to_uid() , req.msg().content());
 
                             im::MsgSendRes res;
                             grpc::ClientContext context;
-                            grpc::Status status = logic_stub->SendMsg(&context , req , &res);
+                            static metrics::Histogram* rpc_latency = LogicRpcLatency("SendMsg");
+                            grpc::Status status = CallLogic(rpc_latency , "gw.rpc.SendMsg" , context , [&]{ return logic_stub->SendMsg(&context , req , &res); });
                             if(status.ok()){
                                 std::string res_body;
                                 res.SerializeToString(&res_body);
@@ -203,10 +1019,11 @@ int main() {
                                 send_data.append(res_body);
 
                                 ws->send(send_data , uWS::OpCode::BINARY);
-                                spdlog::info("<<< Reply MsgSendRes : OK");
+                                ws_log->debug("<<< Reply MsgSendRes : OK");
                             }
                             else{
-                                spdlog::error("RPC SendMsg Failed: {}" , status.error_message());
+                                static logging::RateLimit limit(10);
+                                logging::Limited(limit , ws_log , spdlog::level::err , "RPC SendMsg Failed: {}" , status.error_message());
                             }
                         }
                 }
@@ -214,11 +1031,12 @@ int main() {
                     im::SyncMsgReq req;
                     if(message.length() >= HEADER_LEN + (header.length - HEADER_LEN) &&
                     req.ParseFromArray(buffer + HEADER_LEN , message.length() - HEADER_LEN)){
-                        spdlog::info(">>>Recv SyncMsgReq LastMsgID = {}",req.last_msg_id());
+                        ws_log->debug(">>>Recv SyncMsgReq LastSeq = {}",req.last_seq());
                         req.set_uid(ws->getUserData()->uid);
                         im::SyncMsgRes res;
                         grpc::ClientContext context;
-                        grpc::Status status = logic_stub->SyncMsg(&context , req , &res);
+                        static metrics::Histogram* rpc_latency = LogicRpcLatency("SyncMsg");
+                        grpc::Status status = CallLogic(rpc_latency , "gw.rpc.SyncMsg" , context , [&]{ return logic_stub->SyncMsg(&context , req , &res); });
 
                         if(status.ok()){
                             std::string res_body;
@@ -237,8 +1055,21 @@ int main() {
                             send_data.append((char*)head_buf , HEADER_LEN);
                             send_data.append(res_body);
                             ws->send(send_data , uWS::OpCode::BINARY);
-                            spdlog::info("<<<Reply SyncMsgRes: Count={}" , res.msgs_size());
+                            ws_log->debug("<<<Reply SyncMsgRes: Count={}" , res.msgs_size());
+                        }
+                    }
+                }
+                else if(header.cmd_id == 0x100A){
+                    im::MsgAck ack;
+                    if(message.length() >= HEADER_LEN + (header.length - HEADER_LEN) &&
+                       ack.ParseFromArray(buffer + HEADER_LEN , message.length() - HEADER_LEN)){
+                        int64_t uid = ws->getUserData()->uid;
+                        if(uid == 0){
+                            return;
                         }
+                        // 同步响应里的消息也可能被确认, 不在窗口中的确认同样上报
+                        delivery_tracker->OnAck(uid , ack.msg_id());
+                        ack_reporter->Add(uid , ack.msg_id());
                     }
                 }
                 else if (header.cmd_id == 0x1008) {
@@ -247,11 +1078,12 @@ int main() {
                         req.ParseFromArray(buffer + HEADER_LEN, message.length() - HEADER_LEN)) {
                         
                         req.set_uid(ws->getUserData()->uid);
-                        spdlog::info(">>> Recv GetUploadUrlReq");
+                        ws_log->debug(">>> Recv GetUploadUrlReq");
 
                         im::GetUploadUrlRes res;
                         grpc::ClientContext context;
-                        grpc::Status status = logic_stub->GetUploadUrl(&context, req, &res);
+                        static metrics::Histogram* rpc_latency = LogicRpcLatency("GetUploadUrl");
+                        grpc::Status status = CallLogic(rpc_latency , "gw.rpc.GetUploadUrl" , context , [&]{ return logic_stub->GetUploadUrl(&context, req, &res); });
 
                         if (status.ok()) {
                             std::string res_body;
@@ -275,107 +1107,121 @@ int main() {
                 }
             },
             .close = [](auto *ws, int code, std::string_view message) {
-                SessionManager::GetInstance().RemoveSession(ws->getUserData()->uid);
-                spdlog::info("Connection closed. UID={}", ws->getUserData()->uid);
+                drain.connections.erase(ws->getUserData()->conn_id);
+                SessionManager::GetInstance().RemoveSession(ws->getUserData()->uid , ws);
+                if(ws->getUserData()->uid != 0){
+                    delivery_tracker->OnSessionClosed(ws->getUserData()->uid , ws->getUserData()->conn_id);
+                }
+                ws_log->debug("Connection closed. UID={}", ws->getUserData()->uid);
             }
         })
+        .get("/metrics", [](auto *res, auto *req) {
+            res->writeHeader("Content-Type", "text/plain; version=0.0.4");
+            res->end(metrics::Registry::Instance().Expose());
+        })
         .post("/api/register", [](auto *res, auto *req) {
-        // 1. 处理 CORS (开发环境需要)
-        res->writeHeader("Access-Control-Allow-Origin", "*");
-        // 2. 读取 POST Body (uWebSockets 读取 Body 需要累加 Buffer)
-        std::string buffer;
-        res->onData([res, buffer = std::move(buffer)](std::string_view chunk, bool isLast) mutable {
-            buffer.append(chunk);
-            if (isLast) {
-                // 3. 解析 JSON
-                try {
-                    auto j = json::parse(buffer);
-                    
-                    // 4. 构造 RPC 请求
-                    im::RegisterReq rpc_req;
-                    rpc_req.set_email(j["email"].get<std::string>());
-                    rpc_req.set_nickname(j["nickname"].get<std::string>());
-                    rpc_req.set_password(j["password"].get<std::string>());
-                    
-                    im::RegisterRes rpc_res;
-                    grpc::ClientContext context;
-                    
-                    // 5. 调用 Logic Server (注意：这里是同步调用，高并发下建议放入线程池)
-                    // logic_stub 是全局变量，见原代码
-                    auto status = logic_stub->RegisterUser(&context, rpc_req, &rpc_res);
-                    
-                    // 6. 返回 JSON 给前端
-                    json resp_json;
-                    if (status.ok() && rpc_res.err_code() == 0) {
-                        resp_json["code"] = 200;
-                        resp_json["msg"] = "注册成功";
-                        resp_json["uid"] = rpc_res.uid();
-                    } else {
-                        resp_json["code"] = 500;
-                        resp_json["msg"] = rpc_res.err_msg();
+            static metrics::Histogram* rpc_latency = LogicRpcLatency("RegisterUser");
+            HandleApiCall<im::RegisterReq , im::RegisterRes>(res , rpc_latency ,
+                [](const FlatJson& j , im::RegisterReq& rpc_req){
+                    return j.GetString("email" , *rpc_req.mutable_email()) &&
+                           j.GetString("nickname" , *rpc_req.mutable_nickname()) &&
+                           j.GetString("password" , *rpc_req.mutable_password());
+                },
+                [](grpc::ClientContext* context , const im::RegisterReq* rpc_req , im::RegisterRes* rpc_res , auto done){
+                    logic_stub->async()->RegisterUser(context , rpc_req , rpc_res , std::move(done));
+                },
+                [](const grpc::Status& status , const im::RegisterReq& , const im::RegisterRes& rpc_res){
+                    if(!status.ok() || rpc_res.err_code() != 0){
+                        return ApiError(500 , rpc_res.err_msg());
                     }
-                    res->end(resp_json.dump());
-                    
-                } catch (std::exception& e) {
-                    res->end(json({{"code", 400}, {"msg", "Invalid JSON"}}).dump());
-                }
-            }
-        });
-        res->onAborted([]() {
-            spdlog::warn("HTTP request aborted");
-        });
-    })
-    .post("/api/login", [](auto *res, auto *req) {
-    res->writeHeader("Access-Control-Allow-Origin", "*");
-    
-    std::string buffer;
-    res->onData([res, buffer = std::move(buffer)](std::string_view chunk, bool isLast) mutable {
-        buffer.append(chunk);
-        if (isLast) {
-            try {
-                auto j = json::parse(buffer);
-                
-                im::HttpLoginReq rpc_req;
-                rpc_req.set_email(j["email"].get<std::string>());
-                rpc_req.set_password(j["password"].get<std::string>());
-                
-                im::HttpLoginRes rpc_res;
-                grpc::ClientContext context;
-                
-                auto status = logic_stub->HttpLogin(&context, rpc_req, &rpc_res);
-                
-                json resp_json;
-                if (status.ok() && rpc_res.err_code() == 0) {
-                    resp_json["code"] = 200;
-                    resp_json["msg"] = "登录成功";
-                    resp_json["token"] = rpc_res.token();
-                    resp_json["userInfo"] = {
-                        {"id", rpc_res.uid()},
-                        {"nickname", rpc_res.nickname()},
-                        {"email", j["email"]},
-                        {"avatar", rpc_res.avatar()}
-                    };
-                } else {
-                    resp_json["code"] = 500;
-                    resp_json["msg"] = rpc_res.err_msg();
-                }
-                res->end(resp_json.dump());
-            } catch (std::exception& e) {
-                res->end(json({{"code", 400}, {"msg", "Invalid JSON"}}).dump());
-            }
-        }
-    });
-    res->onAborted([]() { spdlog::warn("HTTP login aborted"); });
+                    return R"({"code":200,"msg":"注册成功","uid":)" + std::to_string(rpc_res.uid()) + "}";
+                });
+        })
+        .post("/api/login", [](auto *res, auto *req) {
+            static metrics::Histogram* rpc_latency = LogicRpcLatency("HttpLogin");
+            HandleApiCall<im::HttpLoginReq , im::HttpLoginRes>(res , rpc_latency ,
+                [](const FlatJson& j , im::HttpLoginReq& rpc_req){
+                    if(!j.GetString("email" , *rpc_req.mutable_email()) || !j.GetString("password" , *rpc_req.mutable_password())){
+                        return false;
+                    }
+                    j.GetString("device_id" , *rpc_req.mutable_device_id());
+                    return true;
+                },
+                [](grpc::ClientContext* context , const im::HttpLoginReq* rpc_req , im::HttpLoginRes* rpc_res , auto done){
+                    logic_stub->async()->HttpLogin(context , rpc_req , rpc_res , std::move(done));
+                },
+                [](const grpc::Status& status , const im::HttpLoginReq& rpc_req , const im::HttpLoginRes& rpc_res){
+                    if(!status.ok() || rpc_res.err_code() != 0){
+                        return ApiError(500 , rpc_res.err_msg());
+                    }
+                    std::string out = R"({"code":200,"msg":"登录成功","token":)";
+                    AppendJsonString(out , rpc_res.token());
+                    out += R"(,"userInfo":{"id":)" + std::to_string(rpc_res.uid()) + R"(,"nickname":)";
+                    AppendJsonString(out , rpc_res.nickname());
+                    out += R"(,"email":)";
+                    AppendJsonString(out , rpc_req.email());
+                    out += R"(,"avatar":)";
+                    AppendJsonString(out , rpc_res.avatar());
+                    out += "}}";
+                    return out;
+                });
         })
-        .listen(8000, [](auto *listen_socket) {
+        .post("/api/logout", [](auto *res, auto *req) {
+            static metrics::Histogram* rpc_latency = LogicRpcLatency("Logout");
+            HandleApiCall<im::LogoutReq , im::LogoutRes>(res , rpc_latency ,
+                [](const FlatJson& j , im::LogoutReq& rpc_req){
+                    int64_t uid = 0;
+                    if(!j.GetInt64("uid" , uid) || !j.GetString("token" , *rpc_req.mutable_token())){
+                        return false;
+                    }
+                    rpc_req.set_uid(uid);
+                    return true;
+                },
+                [](grpc::ClientContext* context , const im::LogoutReq* rpc_req , im::LogoutRes* rpc_res , auto done){
+                    logic_stub->async()->Logout(context , rpc_req , rpc_res , std::move(done));
+                },
+                [](const grpc::Status& status , const im::LogoutReq& , const im::LogoutRes& rpc_res){
+                    if(!status.ok() || rpc_res.err_code() != 0){
+                        return ApiError(500 , rpc_res.err_msg());
+                    }
+                    return std::string(R"({"code":200,"msg":"已退出登录"})");
+                });
+        })
+        .post("/api/upload", [](auto *res, auto *req) {
+            HandleUpload(res , req);
+        })
+        .listen(8000, [&handover_server](auto *listen_socket) {
             if (listen_socket) {
                 spdlog::info("Listening on port 8000 successfully");
             } else {
                 spdlog::error("Failed to listen on port 8000");
                 exit(-1);
             }
+            drain.listen_socket = listen_socket;
+            if(!handover_server) return;
+            // 推送服务也已监听 (SO_REUSEPORT 与旧进程重叠) 后再请求旧进程让出
+            auto started = grpc_started.get_future();
+            if(started.wait_for(std::chrono::seconds(5)) != std::future_status::ready || !started.get()){
+                spdlog::error("Gateway gRpc Server not ready, skip handover");
+                return;
+            }
+            if(RequestTakeover(Config::Instance().GetConfig().gateway.drain.control_socket)){
+                spdlog::warn("Took over from the previous gateway process");
+            }
+            handover_server->Start();
         })
         
         .run();
+
+    // 所有连接已关闭: 停止推送服务与后台线程, 写完路由删除后退出
+    if(drain.ticker.joinable()) drain.ticker.join();
+    if(drain.push_shutdown.joinable()) drain.push_shutdown.join();
+    ShutdownGrpcServer();
+    grpc_thread.join();
+    delivery_tracker->Stop();
+    ack_reporter->Stop();
+    presence_store->Stop();
+    if(handover_server) handover_server->Stop();
+    spdlog::info("Gateway exited");
     return 0;
 }
\ No newline at end of file
@@ -27,6 +27,20 @@ class PacketHelper{
             memcpy(buffer + 6 , &net_cmd , sizeof(net_cmd));
             memcpy(buffer + 8 , &net_seq , sizeof(net_seq));
         }
+        // 组装完整数据包: header + protobuf body
+        static std::string BuildPacket(uint16_t cmd_id , uint32_t seq_id , const std::string& body , uint16_t version = 1){
+            PacketHeader header;
+            header.length = HEADER_LEN + body.size();
+            header.version = version;
+            header.cmd_id = cmd_id;
+            header.seq_id = seq_id;
+
+            std::string packet;
+            packet.resize(HEADER_LEN);
+            EncodeHeader(header , reinterpret_cast<uint8_t*>(&packet[0]));
+            packet.append(body);
+            return packet;
+        }
         static PacketHeader DecodeHeader(const uint8_t* buffer){
             PacketHeader h;
             h.length = ntohl(*reinterpret_cast<const uint32_t*>(buffer));
@@ -0,0 +1,251 @@
+#include "presence_store.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "../../common/auth/session_token.h"
+#include "../../common/presence/gateway_registry.h"
+
+PresenceStore::PresenceStore(const Config::RedisConfig& redis_cfg, const std::string& gateway_id, const std::string& advertise_addr,
+                             int lease_ttl_sec, int revocation_refresh_sec, int token_ttl_sec, size_t remove_batch)
+    : redis_cfg_(redis_cfg),
+      gateway_id_(gateway_id),
+      advertise_addr_(advertise_addr),
+      lease_ttl_sec_(lease_ttl_sec > 0 ? lease_ttl_sec : 15),
+      revocation_refresh_sec_(revocation_refresh_sec > 0 ? revocation_refresh_sec : 1),
+      token_ttl_sec_(token_ttl_sec),
+      remove_batch_(remove_batch > 0 ? remove_batch : 1),
+      revoked_(std::make_shared<const RevokedMap>()) {}
+
+PresenceStore::~PresenceStore() {
+    Stop();
+}
+
+void PresenceStore::Start() {
+    worker_ = std::thread(&PresenceStore::Run, this);
+}
+
+void PresenceStore::Stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void PresenceStore::SetRoute(int64_t uid) {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        pending_routes_.push_back(uid);
+    }
+    cv_.notify_one();
+}
+
+void PresenceStore::RemoveRoutes(const std::vector<int64_t>& uids) {
+    if (uids.empty()) return;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        pending_removals_.insert(pending_removals_.end(), uids.begin(), uids.end());
+    }
+    cv_.notify_one();
+}
+
+void PresenceStore::KeepLeaseOnExit() {
+    std::lock_guard<std::mutex> lk(mu_);
+    keep_lease_ = true;
+}
+
+bool PresenceStore::IsRevoked(int64_t uid, int64_t issued_at) const {
+    auto snapshot = std::atomic_load(&revoked_);
+    auto it = snapshot->find(uid);
+    return it != snapshot->end() && RevokedBy(issued_at, it->second);
+}
+
+redisContext* PresenceStore::Connect() {
+    struct timeval timeout = {1, 0};
+    redisContext* ctx = redisConnectWithTimeout(redis_cfg_.host.c_str(), redis_cfg_.port, timeout);
+    if (!ctx || ctx->err) {
+        spdlog::error("PresenceStore: connect error: {}", ctx ? ctx->errstr : "null");
+        if (ctx) redisFree(ctx);
+        return nullptr;
+    }
+    if (!redis_cfg_.password.empty()) {
+        redisReply* r = (redisReply*)redisCommand(ctx, "AUTH %s", redis_cfg_.password.c_str());
+        if (!r || r->type == REDIS_REPLY_ERROR) {
+            spdlog::error("PresenceStore: AUTH failed: {}", r ? r->str : "null");
+            if (r) freeReplyObject(r);
+            redisFree(ctx);
+            return nullptr;
+        }
+        freeReplyObject(r);
+    }
+    return ctx;
+}
+
+bool PresenceStore::WriteRoute(redisContext* ctx, int64_t uid) {
+    std::string key = UserSessionKey(uid);
+    redisReply* r = (redisReply*)redisCommand(ctx, "SET %s %s", key.c_str(), gateway_id_.c_str());
+    if (!r) return false;
+    bool ok = r->type != REDIS_REPLY_ERROR;
+    freeReplyObject(r);
+    return ok;
+}
+
+// 路由值仍为本网关 id 时才删除; 同一批命令流水线发送, 每批一次往返
+size_t PresenceStore::DeleteRoutes(redisContext* ctx, const std::vector<int64_t>& uids) {
+    static const char* kCompareAndDelete =
+        "if redis.call('GET', KEYS[1]) == ARGV[1] then return redis.call('DEL', KEYS[1]) end return 0";
+    size_t removed = 0;
+    for (size_t begin = 0; begin < uids.size() && !ctx->err; begin += remove_batch_) {
+        size_t end = std::min(uids.size(), begin + remove_batch_);
+        for (size_t i = begin; i < end; ++i) {
+            std::string key = UserSessionKey(uids[i]);
+            redisAppendCommand(ctx, "EVAL %s 1 %s %s", kCompareAndDelete, key.c_str(), gateway_id_.c_str());
+        }
+        for (size_t i = begin; i < end; ++i) {
+            redisReply* r = nullptr;
+            if (redisGetReply(ctx, (void**)&r) != REDIS_OK) break;
+            if (r->type == REDIS_REPLY_INTEGER && r->integer > 0) ++removed;
+            freeReplyObject(r);
+        }
+    }
+    return removed;
+}
+
+bool PresenceStore::RenewLease(redisContext* ctx) {
+    std::string key = GatewayLeaseKey(gateway_id_);
+    redisReply* r = (redisReply*)redisCommand(ctx, "SET %s %s EX %d", key.c_str(), advertise_addr_.c_str(), lease_ttl_sec_);
+    if (!r) return false;
+    bool ok = r->type != REDIS_REPLY_ERROR;
+    freeReplyObject(r);
+    return ok;
+}
+
+// 正常退出时主动删除租约, 不必等 TTL 过期
+void PresenceStore::ReleaseLease(redisContext* ctx) {
+    std::string key = GatewayLeaseKey(gateway_id_);
+    redisReply* r = (redisReply*)redisCommand(ctx, "DEL %s", key.c_str());
+    if (r) freeReplyObject(r);
+}
+
+bool PresenceStore::RefreshRevocations(redisContext* ctx) {
+    redisReply* r = (redisReply*)redisCommand(ctx, "HGETALL %s", kRevokedTokensKey);
+    if (!r) return false;
+    if (r->type != REDIS_REPLY_ARRAY) {
+        bool ok = r->type != REDIS_REPLY_ERROR;
+        freeReplyObject(r);
+        return ok;
+    }
+    // not_before 之前签发的令牌最晚在 not_before + token_ttl_sec 过期, 之后这条记录不再有作用
+    const int64_t expire_before = NowMs() - static_cast<int64_t>(token_ttl_sec_) * 1000;
+    auto fresh = std::make_shared<RevokedMap>();
+    fresh->reserve(r->elements / 2);
+    std::vector<std::pair<std::string, std::string>> expired;
+    for (size_t i = 0; i + 1 < r->elements; i += 2) {
+        int64_t uid = std::strtoll(r->element[i]->str, nullptr, 10);
+        int64_t not_before = NotBeforeMs(std::strtoll(r->element[i + 1]->str, nullptr, 10));
+        if (token_ttl_sec_ > 0 && not_before < expire_before) {
+            expired.emplace_back(r->element[i]->str, r->element[i + 1]->str);
+            continue;
+        }
+        (*fresh)[uid] = not_before;
+    }
+    freeReplyObject(r);
+    std::atomic_store(&revoked_, std::shared_ptr<const RevokedMap>(std::move(fresh)));
+    if (!expired.empty()) PruneRevocations(ctx, expired);
+    return true;
+}
+
+// 值未变时才删除: 刷新与删除之间用户再次注销写入的新记录不受影响; 多个网关同时清理也无妨
+void PresenceStore::PruneRevocations(redisContext* ctx, const std::vector<std::pair<std::string, std::string>>& expired) {
+    static const char* kCompareAndHDel =
+        "if redis.call('HGET', KEYS[1], ARGV[1]) == ARGV[2] then return redis.call('HDEL', KEYS[1], ARGV[1]) end return 0";
+    size_t removed = 0;
+    for (size_t begin = 0; begin < expired.size() && !ctx->err; begin += remove_batch_) {
+        size_t end = std::min(expired.size(), begin + remove_batch_);
+        for (size_t i = begin; i < end; ++i) {
+            redisAppendCommand(ctx, "EVAL %s 1 %s %s %s", kCompareAndHDel, kRevokedTokensKey, expired[i].first.c_str(),
+                               expired[i].second.c_str());
+        }
+        for (size_t i = begin; i < end; ++i) {
+            redisReply* r = nullptr;
+            if (redisGetReply(ctx, (void**)&r) != REDIS_OK) break;
+            if (r->type == REDIS_REPLY_INTEGER && r->integer > 0) ++removed;
+            freeReplyObject(r);
+        }
+    }
+    spdlog::info("PresenceStore: pruned {} expired token revocations", removed);
+}
+
+void PresenceStore::Run() {
+    using namespace std::chrono;
+    redisContext* ctx = nullptr;
+    auto next_refresh = steady_clock::now();
+    auto next_lease = steady_clock::now();
+    // 每个 TTL 周期内续期三次, 容忍偶发的 Redis 抖动
+    const auto lease_interval = milliseconds(lease_ttl_sec_ * 1000 / 3);
+
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_) {
+        cv_.wait_until(lk, std::min(next_refresh, next_lease),
+                       [this] { return stop_ || !pending_routes_.empty() || !pending_removals_.empty(); });
+        if (stop_) break;
+
+        std::deque<int64_t> batch;
+        batch.swap(pending_routes_);
+        std::vector<int64_t> removals;
+        removals.swap(pending_removals_);
+        lk.unlock();
+
+        if (!ctx) ctx = Connect();
+        if (ctx) {
+            if (steady_clock::now() >= next_lease) {
+                if (RenewLease(ctx)) {
+                    next_lease = steady_clock::now() + lease_interval;
+                } else {
+                    spdlog::warn("PresenceStore: renew gateway lease failed id={}", gateway_id_);
+                    next_lease = steady_clock::now() + seconds(1);
+                }
+            }
+            for (int64_t uid : batch) {
+                if (!WriteRoute(ctx, uid)) {
+                    spdlog::error("PresenceStore: write route failed uid={}", uid);
+                }
+            }
+            if (!removals.empty()) {
+                size_t removed = DeleteRoutes(ctx, removals);
+                spdlog::info("PresenceStore: unregistered {} of {} session routes", removed, removals.size());
+            }
+            if (steady_clock::now() >= next_refresh) {
+                if (!RefreshRevocations(ctx)) {
+                    spdlog::warn("PresenceStore: refresh revocations failed");
+                }
+                next_refresh = steady_clock::now() + seconds(revocation_refresh_sec_);
+            }
+            if (ctx->err) {
+                redisFree(ctx);
+                ctx = nullptr;
+            }
+        } else {
+            spdlog::error("PresenceStore: redis unavailable, dropped {} route updates", batch.size() + removals.size());
+            next_refresh = steady_clock::now() + seconds(1);
+            next_lease = next_refresh;
+        }
+
+        lk.lock();
+    }
+    std::vector<int64_t> removals;
+    removals.swap(pending_removals_);
+    bool keep_lease = keep_lease_;
+    lk.unlock();
+    if (!ctx) ctx = Connect();
+    if (ctx) {
+        if (!removals.empty()) {
+            size_t removed = DeleteRoutes(ctx, removals);
+            spdlog::info("PresenceStore: unregistered {} of {} session routes", removed, removals.size());
+        }
+        if (!keep_lease) ReleaseLease(ctx);
+        redisFree(ctx);
+    }
+}
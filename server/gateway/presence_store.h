@@ -0,0 +1,68 @@
+#pragma once
+#include <hiredis/hiredis.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../../common/config/config.h"
+
+// 网关侧的 Redis 访问: 网关租约续期、会话路由写入与令牌吊销表缓存
+// 所有网络操作都在后台线程完成, uWS 事件循环只读内存快照 / 投递任务
+class PresenceStore {
+public:
+    PresenceStore(const Config::RedisConfig& redis_cfg, const std::string& gateway_id, const std::string& advertise_addr,
+                  int lease_ttl_sec, int revocation_refresh_sec, int token_ttl_sec, size_t remove_batch = 500);
+    ~PresenceStore();
+
+    void Start();
+    // 退出前写完已排队的路由删除, 再删除网关租约
+    void Stop();
+
+    // 异步写入 IM:USER:SESS:<uid> -> 本网关 id
+    void SetRoute(int64_t uid);
+
+    // 排空时异步删除会话路由: 每 remove_batch 个一批流水线发送, 路由已指向其它网关 (用户已重连) 的不删
+    void RemoveRoutes(const std::vector<int64_t>& uids);
+
+    // 交接给同 gateway_id 的新进程时调用: 退出时保留租约, 由新进程继续续期
+    void KeepLeaseOnExit();
+
+    // 令牌签发时间 (毫秒) 不晚于吊销时间即视为已吊销
+    bool IsRevoked(int64_t uid, int64_t issued_at) const;
+
+private:
+    using RevokedMap = std::unordered_map<int64_t, int64_t>;
+
+    void Run();
+    redisContext* Connect();
+    bool WriteRoute(redisContext* ctx, int64_t uid);
+    size_t DeleteRoutes(redisContext* ctx, const std::vector<int64_t>& uids);
+    bool RenewLease(redisContext* ctx);
+    void ReleaseLease(redisContext* ctx);
+    bool RefreshRevocations(redisContext* ctx);
+    void PruneRevocations(redisContext* ctx, const std::vector<std::pair<std::string, std::string>>& expired);
+
+    Config::RedisConfig redis_cfg_;
+    std::string gateway_id_;
+    std::string advertise_addr_;
+    int lease_ttl_sec_;
+    int revocation_refresh_sec_;
+    int token_ttl_sec_;
+    size_t remove_batch_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<int64_t> pending_routes_;
+    std::vector<int64_t> pending_removals_;
+    bool keep_lease_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+
+    std::shared_ptr<const RevokedMap> revoked_;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "session_manager.h"
+
+// 下行推送包: 封包后不再修改, 按引用计数在所有接收会话 (以及重传) 之间共享, 不按接收者复制
+using PushBuffer = std::shared_ptr<const std::string>;
+
+inline PushBuffer MakePushBuffer(std::string packet) {
+    return std::make_shared<const std::string>(std::move(packet));
+}
+
+struct PushDispatchStats {
+    uint64_t frames = 0;    // 写入连接的帧数
+    uint64_t flushes = 0;   // cork 次数, 每次对应该连接的一次 write
+    uint64_t drains = 0;    // loop 线程处理的批次数
+    uint64_t backpressured = 0;   // 连接待发送字节超限而丢弃的帧数 (由确认重传 / 同步补齐)
+};
+
+// 把任意线程 (gRPC 推送流, 重传时间轮) 的推送交给 loop 线程写出:
+// Push 只入队, 队列由空变非空时调用 wake (uWS::Loop::defer) 安排一次 Drain;
+// Drain 按 uid 分组, 每个连接在一次 cork 内写完本轮的全部帧, 多条推送合并成一次系统调用
+template <typename Socket>
+class PushDispatcher {
+public:
+    using WakeFn = std::function<void()>;
+
+    PushDispatcher(SessionRegistry<Socket>& sessions, WakeFn wake) : sessions_(sessions), wake_(std::move(wake)) {}
+
+    // 用户不在本网关时返回 false; 返回 true 后如果连接在写出前断开, 推送被丢弃 (由确认重传 / 同步补齐)
+    bool Push(int64_t uid, PushBuffer packet) {
+        if (!sessions_.Contains(uid)) return false;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake = queue_.empty();
+            queue_.emplace_back(uid, std::move(packet));
+        }
+        if (wake) wake_();
+        return true;
+    }
+
+    // 连接待发送字节达到 bytes 时不再向它写推送, 0 表示不限制; 任意线程调用, 下一轮 Drain 生效
+    void SetMaxBackpressure(size_t bytes) { max_backpressure_.store(bytes, std::memory_order_relaxed); }
+
+    // 只在 loop 线程调用
+    void Drain() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch_.swap(queue_);
+        }
+        if (batch_.empty()) return;
+        // 同一 uid 的帧保持入队顺序
+        std::stable_sort(batch_.begin(), batch_.end(), [](const Item& a, const Item& b) { return a.first < b.first; });
+        const size_t max_backpressure = max_backpressure_.load(std::memory_order_relaxed);
+        uint64_t frames = 0;
+        uint64_t flushes = 0;
+        uint64_t backpressured = 0;
+        for (size_t begin = 0; begin < batch_.size();) {
+            size_t end = begin + 1;
+            while (end < batch_.size() && batch_[end].first == batch_[begin].first) ++end;
+            sessions_.With(batch_[begin].first, [&](Socket* ws) {
+                if (max_backpressure > 0 && ws->getBufferedAmount() >= max_backpressure) {
+                    backpressured += end - begin;
+                    return;
+                }
+                // uWS 的 send 默认以 BINARY 发送; cork 内的帧先进 cork 缓冲, 回调结束时一次写出
+                ws->cork([&] {
+                    for (size_t i = begin; i < end; ++i) ws->send(*batch_[i].second);
+                });
+                frames += end - begin;
+                ++flushes;
+            });
+            begin = end;
+        }
+        // 保留容量给下一轮, 释放对推送包的引用
+        batch_.clear();
+        frames_.fetch_add(frames, std::memory_order_relaxed);
+        flushes_.fetch_add(flushes, std::memory_order_relaxed);
+        drains_.fetch_add(1, std::memory_order_relaxed);
+        if (backpressured) backpressured_.fetch_add(backpressured, std::memory_order_relaxed);
+    }
+
+    PushDispatchStats Stats() const {
+        return {frames_.load(std::memory_order_relaxed), flushes_.load(std::memory_order_relaxed),
+                drains_.load(std::memory_order_relaxed), backpressured_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    using Item = std::pair<int64_t, PushBuffer>;
+
+    SessionRegistry<Socket>& sessions_;
+    WakeFn wake_;
+
+    std::mutex mutex_;
+    std::vector<Item> queue_;
+    std::vector<Item> batch_;  // 只在 loop 线程使用
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> drains_{0};
+    std::atomic<uint64_t> backpressured_{0};
+    std::atomic<size_t> max_backpressure_{0};
+};
@@ -0,0 +1,153 @@
+#include "rate_limiter.h"
+#include <algorithm>
+#include <cstring>
+#include <arpa/inet.h>
+
+namespace {
+
+uint64_t Mix(uint64_t x) {
+    // splitmix64 的混合步骤, 相邻的 uid 打散到不同缓存行
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// 同一张表里放 uid 桶和 IP 桶, 用 scope 区分
+uint64_t BucketKey(uint64_t scope, uint64_t id, uint16_t cmd) {
+    uint64_t key = Mix(Mix(id ^ (scope << 62)) ^ cmd);
+    return key != 0 ? key : 1;
+}
+
+constexpr uint64_t kScopeUid = 1;
+constexpr uint64_t kScopeIp = 2;
+
+}  // namespace
+
+TokenBucketTable::TokenBucketTable(size_t capacity) {
+    size_t size = 64;
+    while (size < capacity) size <<= 1;
+    mask_ = size - 1;
+    slots_.reset(new Slot[size]);
+}
+
+bool TokenBucketTable::Acquire(uint64_t key, float rate, float burst, uint64_t now_ms) {
+    if (!has_base_) {
+        base_ms_ = now_ms;
+        has_base_ = true;
+    }
+    const uint32_t now = static_cast<uint32_t>(now_ms - base_ms_);
+    if (burst < 1) burst = 1;
+
+    Slot* found = nullptr;
+    Slot* reusable = nullptr;
+    Slot* oldest = nullptr;
+    uint32_t oldest_idle = 0;
+    for (size_t i = 0; i < kMaxProbe; ++i) {
+        Slot& slot = slots_[(key + i) & mask_];
+        if (slot.key == key) {
+            found = &slot;
+            break;
+        }
+        if (reusable) continue;
+        uint32_t idle = now - slot.stamp_ms;
+        if (slot.key == 0 || idle >= kIdleReuseMs) {
+            reusable = &slot;
+        } else if (!oldest || idle > oldest_idle) {
+            oldest = &slot;
+            oldest_idle = idle;
+        }
+    }
+
+    if (!found) {
+        found = reusable;
+        if (!found) {
+            found = oldest;
+            ++evictions_;
+        }
+        found->key = key;
+        found->tokens = burst - 1;
+        found->stamp_ms = now;
+        return true;
+    }
+
+    uint32_t elapsed = now - found->stamp_ms;
+    found->stamp_ms = now;
+    found->tokens = std::min(burst, found->tokens + static_cast<float>(elapsed) * rate / 1000.0f);
+    if (found->tokens < 1) return false;
+    found->tokens -= 1;
+    return true;
+}
+
+bool TokenBucketTable::Available(uint64_t key, float rate, float burst, uint64_t now_ms) const {
+    if (!has_base_) return true;
+    const uint32_t now = static_cast<uint32_t>(now_ms - base_ms_);
+    if (burst < 1) burst = 1;
+    for (size_t i = 0; i < kMaxProbe; ++i) {
+        const Slot& slot = slots_[(key + i) & mask_];
+        if (slot.key != key) continue;
+        uint32_t elapsed = now - slot.stamp_ms;
+        return std::min(burst, slot.tokens + static_cast<float>(elapsed) * rate / 1000.0f) >= 1;
+    }
+    return true;
+}
+
+RateLimiter::RateLimiter(size_t table_capacity) : table_(table_capacity) {}
+
+void RateLimiter::SetRules(const std::vector<RateLimitRule>& rules) {
+    rules_ = rules;
+    std::sort(rules_.begin(), rules_.end(), [](const RateLimitRule& a, const RateLimitRule& b) { return a.cmd < b.cmd; });
+}
+
+void RateLimiter::SetExemptIps(std::vector<uint64_t> ip_keys) {
+    std::sort(ip_keys.begin(), ip_keys.end());
+    exempt_ = std::move(ip_keys);
+}
+
+const RateLimitRule* RateLimiter::FindRule(uint16_t cmd) const {
+    auto it = std::lower_bound(rules_.begin(), rules_.end(), cmd, [](const RateLimitRule& r, uint16_t c) { return r.cmd < c; });
+    return it != rules_.end() && it->cmd == cmd ? &*it : nullptr;
+}
+
+RateLimiter::Result RateLimiter::Check(uint16_t cmd, int64_t uid, uint64_t ip_key, uint64_t now_ms) {
+    const RateLimitRule* rule = FindRule(cmd);
+    if (!rule) return Result::OK;
+    if (!exempt_.empty() && std::binary_search(exempt_.begin(), exempt_.end(), ip_key)) return Result::OK;
+    // uid 桶先只看不扣, IP 桶放行后再扣; 期间 uid 桶即使被淘汰, 重建时也是满桶, Acquire 必然成功
+    const bool by_uid = uid != 0 && rule->uid_rate > 0;
+    const uint64_t uid_key = by_uid ? BucketKey(kScopeUid, static_cast<uint64_t>(uid), cmd) : 0;
+    if (by_uid && !table_.Available(uid_key, rule->uid_rate, rule->uid_burst, now_ms)) {
+        return Result::UID_LIMITED;
+    }
+    if (rule->ip_rate > 0 && !table_.Acquire(BucketKey(kScopeIp, ip_key, cmd), rule->ip_rate, rule->ip_burst, now_ms)) {
+        return Result::IP_LIMITED;
+    }
+    if (by_uid) table_.Acquire(uid_key, rule->uid_rate, rule->uid_burst, now_ms);
+    return Result::OK;
+}
+
+uint64_t RateLimiter::IpKey(std::string_view address) {
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : address) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool RateLimiter::TextIpKeys(const std::string& text, std::vector<uint64_t>& keys) {
+    unsigned char addr[16];
+    if (inet_pton(AF_INET, text.c_str(), addr) == 1) {
+        keys.push_back(IpKey(std::string_view(reinterpret_cast<const char*>(addr), 4)));
+        unsigned char mapped[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+        std::memcpy(mapped + 12, addr, 4);
+        keys.push_back(IpKey(std::string_view(reinterpret_cast<const char*>(mapped), 16)));
+        return true;
+    }
+    if (inet_pton(AF_INET6, text.c_str(), addr) == 1) {
+        keys.push_back(IpKey(std::string_view(reinterpret_cast<const char*>(addr), 16)));
+        return true;
+    }
+    return false;
+}
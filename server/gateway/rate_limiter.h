@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 令牌桶表: 开放寻址 (线性探测), 每个桶 16 字节, 一条缓存行放 4 个; 不为桶设定时器,
+// 取令牌时按距上次访问的时间补充 (lazy refill). 非线程安全, 网关里只在 loop 线程使用.
+//
+// 探测窗口 kMaxProbe 个槽位内找不到 key 时占用空槽, 或闲置超过 kIdleReuseMs 的槽 (令牌早已补满, 等价于空桶);
+// 都没有时淘汰窗口内最久未访问的桶. 被淘汰的 key 下次出现时按满桶重新开始, 表容量不足时限流会略微放宽.
+class TokenBucketTable {
+public:
+    static constexpr size_t kMaxProbe = 8;
+    static constexpr uint32_t kIdleReuseMs = 60 * 1000;
+
+    // capacity 向上取整到 2 的幂
+    explicit TokenBucketTable(size_t capacity);
+
+    // 取一个令牌, 桶空时返回 false. rate 为每秒补充的令牌数, burst 为桶容量
+    bool Acquire(uint64_t key, float rate, float burst, uint64_t now_ms);
+
+    // 只看桶里 (补充后) 是否还有一个令牌, 不扣减也不占槽; 不在表中的 key 视为满桶
+    bool Available(uint64_t key, float rate, float burst, uint64_t now_ms) const;
+
+    size_t Capacity() const { return mask_ + 1; }
+    uint64_t Evictions() const { return evictions_; }
+
+private:
+    struct Slot {
+        uint64_t key = 0;      // 0 表示空槽
+        float tokens = 0;
+        uint32_t stamp_ms = 0; // 上次访问时间, 相对表创建时刻, 回绕后按无符号差计算
+    };
+    static_assert(sizeof(Slot) == 16, "TokenBucketTable slot should stay 16 bytes");
+
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    uint64_t base_ms_ = 0;
+    bool has_base_ = false;
+    uint64_t evictions_ = 0;
+};
+
+struct RateLimitRule {
+    uint16_t cmd = 0;
+    float uid_rate = 0;    // <= 0 表示不按 uid 限制
+    float uid_burst = 0;
+    float ip_rate = 0;     // <= 0 表示不按 IP 限制
+    float ip_burst = 0;
+};
+
+// 按 cmd_id 配置的 per-uid / per-IP 令牌桶限流. uid 为 0 (未登录) 时只检查 IP.
+// 两个维度都有令牌时才各扣一个, 被任一维度拒绝的请求不消耗另一维度的令牌.
+class RateLimiter {
+public:
+    enum class Result { OK, UID_LIMITED, IP_LIMITED };
+
+    explicit RateLimiter(size_t table_capacity);
+
+    // 替换全部规则, 已有桶保留 (新速率在下次取令牌时生效)
+    void SetRules(const std::vector<RateLimitRule>& rules);
+
+    // 替换豁免的来源地址 (IpKey), 来自这些地址的请求不受任何规则限制
+    void SetExemptIps(std::vector<uint64_t> ip_keys);
+
+    Result Check(uint16_t cmd, int64_t uid, uint64_t ip_key, uint64_t now_ms);
+
+    uint64_t Evictions() const { return table_.Evictions(); }
+
+    // 连接建立时计算一次, 之后每个请求直接使用; address 为 uWS getRemoteAddress 返回的 4 / 16 字节地址
+    static uint64_t IpKey(std::string_view address);
+
+    // 文本地址 ("10.0.0.5" / "::1") 对应的 IpKey; IPv4 同时给出 IPv4-mapped IPv6 形式 (双栈监听时对端地址为 16 字节).
+    // 不是合法地址时返回 false
+    static bool TextIpKeys(const std::string& text, std::vector<uint64_t>& keys);
+
+private:
+    const RateLimitRule* FindRule(uint16_t cmd) const;
+
+    std::vector<RateLimitRule> rules_;   // 按 cmd 排序, 规则只有几条, 二分即可
+    std::vector<uint64_t> exempt_;       // 已排序
+    TokenBucketTable table_;
+};
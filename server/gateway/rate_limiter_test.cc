@@ -0,0 +1,97 @@
+// TokenBucketTable 的补充与淘汰, RateLimiter 的两个维度互不多扣和豁免地址
+#include "rate_limiter.h"
+#include <string>
+#include "../../common/test/check.h"
+
+namespace {
+
+constexpr uint16_t kCmd = 0x1003;
+
+void TestRefill() {
+    TokenBucketTable table(64);
+    uint64_t now = 1000;
+    for (int i = 0; i < 3; ++i) CHECK(table.Acquire(42, 10, 3, now));
+    CHECK(!table.Acquire(42, 10, 3, now));
+    CHECK(!table.Available(42, 10, 3, now));
+    // 10 个/秒: 100ms 补一个
+    CHECK(table.Available(42, 10, 3, now + 100));
+    CHECK(table.Acquire(42, 10, 3, now + 100));
+    CHECK(!table.Acquire(42, 10, 3, now + 150));
+    // 补满后不超过 burst
+    for (int i = 0; i < 3; ++i) CHECK(table.Acquire(42, 10, 3, now + 10000));
+    CHECK(!table.Acquire(42, 10, 3, now + 10000));
+    // 不在表中的 key 视为满桶, Available 不占槽
+    CHECK(table.Available(7, 10, 3, now));
+}
+
+void TestEviction() {
+    TokenBucketTable table(64);
+    // 同一探测窗口内的 key: 低位相同, 差 Capacity() 的倍数
+    const uint64_t base = 5;
+    for (uint64_t i = 0; i < TokenBucketTable::kMaxProbe; ++i) {
+        CHECK(table.Acquire(base + i * table.Capacity(), 1, 1, 1000 + i));
+    }
+    CHECK(table.Evictions() == 0);
+    CHECK(table.Acquire(base + TokenBucketTable::kMaxProbe * table.Capacity(), 1, 1, 2000));
+    CHECK(table.Evictions() == 1);
+    // 最久未访问的 (第一个) 被淘汰, 重新出现时按满桶开始
+    CHECK(table.Acquire(base, 1, 1, 2000));
+}
+
+void TestIpRejectDoesNotChargeUid() {
+    RateLimiter limiter(1024);
+    limiter.SetRules({{kCmd, 1, 2, 1, 1}});
+    const uint64_t ip = RateLimiter::IpKey(std::string("\x0a\x00\x00\x01", 4));
+    const uint64_t other_ip = RateLimiter::IpKey(std::string("\x0a\x00\x00\x02", 4));
+    CHECK(limiter.Check(kCmd, 100, ip, 1000) == RateLimiter::Result::OK);
+    // IP 桶已空, uid 桶还剩一个
+    for (int i = 0; i < 5; ++i) CHECK(limiter.Check(kCmd, 100, ip, 1000) == RateLimiter::Result::IP_LIMITED);
+    // 被 IP 拒绝的请求没有扣 uid 令牌: 换个地址仍能发一次
+    CHECK(limiter.Check(kCmd, 100, other_ip, 1000) == RateLimiter::Result::OK);
+    CHECK(limiter.Check(kCmd, 100, RateLimiter::IpKey("x"), 1000) == RateLimiter::Result::UID_LIMITED);
+    // 被 uid 拒绝的请求也不扣 IP 令牌
+    CHECK(limiter.Check(kCmd, 200, RateLimiter::IpKey("x"), 1000) == RateLimiter::Result::OK);
+}
+
+void TestUnauthenticatedAndUnknownCmd() {
+    RateLimiter limiter(1024);
+    limiter.SetRules({{kCmd, 1, 1, 0, 0}});
+    // 未登录 (uid 0) 时只看 IP, 该规则不限 IP
+    for (int i = 0; i < 10; ++i) CHECK(limiter.Check(kCmd, 0, 1, 1000) == RateLimiter::Result::OK);
+    for (int i = 0; i < 10; ++i) CHECK(limiter.Check(0x1001, 100, 1, 1000) == RateLimiter::Result::OK);
+}
+
+void TestExemptIps() {
+    std::vector<uint64_t> keys;
+    CHECK(RateLimiter::TextIpKeys("127.0.0.1", keys));
+    CHECK(keys.size() == 2);
+    CHECK(RateLimiter::TextIpKeys("::1", keys));
+    CHECK(!RateLimiter::TextIpKeys("localhost", keys));
+    CHECK(keys.size() == 3);
+
+    RateLimiter limiter(1024);
+    limiter.SetRules({{kCmd, 1, 1, 1, 1}});
+    limiter.SetExemptIps(keys);
+    const uint64_t v4 = RateLimiter::IpKey(std::string("\x7f\x00\x00\x01", 4));
+    const uint64_t mapped = RateLimiter::IpKey(std::string("\0\0\0\0\0\0\0\0\0\0\xff\xff\x7f\x00\x00\x01", 16));
+    for (int i = 0; i < 10; ++i) {
+        CHECK(limiter.Check(kCmd, 100, v4, 1000) == RateLimiter::Result::OK);
+        CHECK(limiter.Check(kCmd, 100, mapped, 1000) == RateLimiter::Result::OK);
+    }
+    // 豁免的请求不消耗令牌
+    CHECK(limiter.Check(kCmd, 100, RateLimiter::IpKey("x"), 1000) == RateLimiter::Result::OK);
+
+    limiter.SetExemptIps({});
+    CHECK(limiter.Check(kCmd, 100, v4, 1000) == RateLimiter::Result::UID_LIMITED);
+}
+
+}  // namespace
+
+int main() {
+    TestRefill();
+    TestEviction();
+    TestIpRejectDoesNotChargeUid();
+    TestUnauthenticatedAndUnknownCmd();
+    TestExemptIps();
+    return test::Report();
+}
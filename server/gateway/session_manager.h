@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// uid -> 连接 的在线会话表. 模板参数为连接类型: 网关里是 uWS::WebSocket, 基准测试里换成假连接
+template <typename Socket>
+class SessionRegistry {
+public:
+    void Add(int64_t uid, Socket* ws) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_[uid] = ws;
+    }
+
+    // 只移除 uid 当前对应的 ws: 旧连接晚于新连接登录断开时不影响新会话
+    void Remove(int64_t uid, Socket* ws) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sessions_.find(uid);
+        if (it != sessions_.end() && it->second == ws) sessions_.erase(it);
+    }
+
+    bool Contains(int64_t uid) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sessions_.count(uid) != 0;
+    }
+
+    // 持锁对 uid 的连接执行 fn (连接不会在此期间被移除), 不在线返回 false
+    template <typename Fn>
+    bool With(int64_t uid, Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sessions_.find(uid);
+        if (it == sessions_.end()) return false;
+        fn(it->second);
+        return true;
+    }
+
+    template <typename Fn>
+    void ForEach(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& kv : sessions_) fn(kv.first, kv.second);
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<int64_t, Socket*> sessions_;
+};
@@ -0,0 +1,347 @@
+#include "upload_proxy.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <spdlog/spdlog.h>
+#include "../../common/metrics/metrics.h"
+#include "flat_json.h"
+
+constexpr int SSL = 0;
+
+// 上游响应只是一小段 JSON, 超出即视为异常
+constexpr size_t kMaxUpstreamResponse = 16 * 1024;
+
+struct UploadSession {
+    uWS::HttpResponse<false>* res = nullptr;
+    const UploadProxyOptions* options = nullptr;
+    us_socket_t* upstream = nullptr;
+    uint64_t content_length = 0;
+    uint64_t received = 0;
+    std::string content_type;
+    std::string download_url;
+    // 已收到、上游 socket 暂时写不进去的数据 (首部分是请求头), pending_pos 之前的已写出
+    std::string pending;
+    size_t pending_pos = 0;
+    std::string response;
+    metrics::Stopwatch timer;
+    bool connected = false;
+    bool paused = false;
+    bool timed_out = false;
+    bool aborted = false;
+    bool done = false;   // 已回复客户端 (或客户端已断开), 之后只做清理
+};
+
+namespace {
+
+// 挂在上游 socket 的 ext 上, socket 关闭前保持会话存活
+struct UpstreamExt {
+    std::shared_ptr<UploadSession> session;
+};
+
+struct UploadMetrics {
+    metrics::Counter* ok;
+    metrics::Counter* failed;
+    metrics::Counter* aborted;
+    metrics::Counter* bytes;
+    metrics::Counter* pauses;
+    metrics::Histogram* latency;
+};
+
+UploadMetrics& Metrics() {
+    static UploadMetrics m = [] {
+        auto& registry = metrics::Registry::Instance();
+        const char* help = "Proxied uploads by result";
+        return UploadMetrics{
+            registry.GetCounter("im_gateway_uploads_total", help, {{"result", "ok"}}),
+            registry.GetCounter("im_gateway_uploads_total", help, {{"result", "failed"}}),
+            registry.GetCounter("im_gateway_uploads_total", help, {{"result", "aborted"}}),
+            registry.GetCounter("im_gateway_upload_bytes_total", "Request body bytes received by the upload proxy"),
+            registry.GetCounter("im_gateway_upload_pauses_total", "Times an upload was paused because the storage side lagged"),
+            registry.GetHistogram("im_gateway_upload_seconds", "Proxied upload duration"),
+        };
+    }();
+    return m;
+}
+
+void Reply(UploadSession& s, int code, std::string_view msg) {
+    std::string body = "{\"code\":" + std::to_string(code) + ",\"msg\":";
+    AppendJsonString(body, msg);
+    if (code == 200) {
+        body += ",\"download_url\":";
+        AppendJsonString(body, s.download_url);
+    }
+    body += "}";
+    uWS::HttpResponse<false>* res = s.res;
+    res->cork([res, &body] {
+        res->writeHeader("Access-Control-Allow-Origin", "*");
+        res->end(body);
+    });
+}
+
+// 回复客户端并关闭上游; 可重入 (关闭上游会同步触发 OnClose)
+void Finish(UploadSession& s, int code, std::string_view msg) {
+    if (s.done) return;
+    s.done = true;
+    if (s.upstream) us_socket_close(SSL, s.upstream, 0, nullptr);
+    if (s.aborted) {
+        Metrics().aborted->Inc();
+        return;
+    }
+    // 暂停状态下连接不可写, 先恢复再回复
+    if (s.paused) {
+        s.paused = false;
+        s.res->resume();
+    }
+    Metrics().latency->ObserveUs(s.timer.ElapsedUs());
+    (code == 200 ? Metrics().ok : Metrics().failed)->Inc();
+    if (code != 200) spdlog::warn("upload failed: {} {} ({} of {} bytes received)", code, msg, s.received, s.content_length);
+    Reply(s, code, msg);
+}
+
+// 尽量把积压写给上游; 清空后恢复读取客户端
+void Flush(UploadSession& s) {
+    while (s.pending_pos < s.pending.size()) {
+        size_t left = s.pending.size() - s.pending_pos;
+        int n = us_socket_write(SSL, s.upstream, s.pending.data() + s.pending_pos, static_cast<int>(std::min<size_t>(left, INT_MAX)), 0);
+        if (n <= 0) break;
+        s.pending_pos += static_cast<size_t>(n);
+        if (static_cast<size_t>(n) < left) break;
+    }
+    if (s.pending_pos < s.pending.size()) return;
+    s.pending.clear();
+    s.pending_pos = 0;
+    if (s.paused && !s.done) {
+        s.paused = false;
+        s.res->resume();
+    }
+}
+
+void OnClientData(UploadSession& s, std::string_view chunk, bool is_last) {
+    if (s.done) return;
+    s.received += chunk.size();
+    Metrics().bytes->Inc(chunk.size());
+    if (s.received > s.content_length) {
+        Finish(s, 400, "Body exceeds Content-Length");
+        return;
+    }
+    if (is_last && s.received < s.content_length) {
+        Finish(s, 400, "Body shorter than Content-Length");
+        return;
+    }
+    // 上游空闲时直接写, 写不完的部分才拷贝
+    if (s.connected && s.pending_pos == s.pending.size() && !chunk.empty()) {
+        // 客户端还在发送, 上游的无进展超时从此刻重新计算
+        us_socket_timeout(SSL, s.upstream, s.options->timeout_sec);
+        int n = us_socket_write(SSL, s.upstream, chunk.data(), static_cast<int>(chunk.size()), 0);
+        if (n > 0) chunk.remove_prefix(static_cast<size_t>(n));
+        s.pending.clear();
+        s.pending_pos = 0;
+    }
+    if (chunk.empty()) return;
+    if (s.pending_pos > 0 && s.pending_pos >= s.pending.size() / 2) {
+        s.pending.erase(0, s.pending_pos);
+        s.pending_pos = 0;
+    }
+    s.pending.append(chunk);
+    if (!s.paused && s.pending.size() - s.pending_pos > s.options->max_pending_bytes) {
+        s.paused = true;
+        s.res->pause();
+        Metrics().pauses->Inc();
+    }
+}
+
+// 上游关闭: 按收到的响应回复客户端
+void Complete(UploadSession& s) {
+    if (s.done) return;
+    if (s.timed_out) {
+        Finish(s, 504, "Storage timeout");
+        return;
+    }
+    // 状态行: HTTP/1.1 201 Created
+    int status = 0;
+    if (s.response.size() >= 12 && s.response.compare(0, 5, "HTTP/") == 0) {
+        status = std::atoi(s.response.c_str() + 9);
+    }
+    if (status == 0) {
+        Finish(s, 502, "Storage closed the connection");
+    } else if (status / 100 != 2 || s.received != s.content_length) {
+        spdlog::warn("upload rejected by volume server: {}", s.response.substr(0, s.response.find("\r\n")));
+        Finish(s, 502, "Storage rejected the upload");
+    } else {
+        Finish(s, 200, "上传成功");
+    }
+}
+
+// 响应头收齐且带 Content-Length 时, 读满即可结束, 不必等上游关闭
+bool ResponseComplete(const std::string& response) {
+    size_t header_end = response.find("\r\n\r\n");
+    if (header_end == std::string::npos) return false;
+    std::string head = response.substr(0, header_end);
+    std::transform(head.begin(), head.end(), head.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t pos = head.find("\r\ncontent-length:");
+    if (pos == std::string::npos) return false;
+    size_t length = std::strtoull(head.c_str() + pos + 17, nullptr, 10);
+    return response.size() - header_end - 4 >= length;
+}
+
+UploadSession* SessionOf(us_socket_t* s) {
+    return static_cast<UpstreamExt*>(us_socket_ext(SSL, s))->session.get();
+}
+
+// socket 结束 (关闭或连接失败) 时释放 ext 持有的会话引用
+std::shared_ptr<UploadSession> Detach(us_socket_t* s) {
+    auto* ext = static_cast<UpstreamExt*>(us_socket_ext(SSL, s));
+    std::shared_ptr<UploadSession> session = std::move(ext->session);
+    ext->~UpstreamExt();
+    if (session) session->upstream = nullptr;
+    return session;
+}
+
+us_socket_t* OnOpen(us_socket_t* s, int, char*, int) {
+    UploadSession& session = *SessionOf(s);
+    session.connected = true;
+    Flush(session);
+    return s;
+}
+
+us_socket_t* OnWritable(us_socket_t* s) {
+    UploadSession& session = *SessionOf(s);
+    us_socket_timeout(SSL, s, session.options->timeout_sec);
+    Flush(session);
+    return s;
+}
+
+us_socket_t* OnData(us_socket_t* s, char* data, int length) {
+    UploadSession& session = *SessionOf(s);
+    us_socket_timeout(SSL, s, session.options->timeout_sec);
+    if (session.response.size() + static_cast<size_t>(length) > kMaxUpstreamResponse) {
+        return us_socket_close(SSL, s, 0, nullptr);
+    }
+    session.response.append(data, static_cast<size_t>(length));
+    if (ResponseComplete(session.response)) return us_socket_close(SSL, s, 0, nullptr);
+    return s;
+}
+
+us_socket_t* OnEnd(us_socket_t* s) {
+    return us_socket_close(SSL, s, 0, nullptr);
+}
+
+us_socket_t* OnTimeout(us_socket_t* s) {
+    SessionOf(s)->timed_out = true;
+    return us_socket_close(SSL, s, 0, nullptr);
+}
+
+us_socket_t* OnClose(us_socket_t* s, int, void*) {
+    auto session = Detach(s);
+    if (session) Complete(*session);
+    return s;
+}
+
+us_socket_t* OnConnectError(us_socket_t* s, int code) {
+    auto session = Detach(s);
+    if (session) {
+        spdlog::warn("upload proxy: connect to volume server failed, code={}", code);
+        Finish(*session, 502, "Storage unreachable");
+    }
+    return s;
+}
+
+}  // namespace
+
+bool ResolveUploadTarget(const std::string& upload_url, const std::string& download_url, UploadTarget& out) {
+    constexpr std::string_view kScheme = "http://";
+    if (upload_url.compare(0, kScheme.size(), kScheme) != 0) return false;
+    size_t host_begin = kScheme.size();
+    size_t path_begin = upload_url.find('/', host_begin);
+    if (path_begin == std::string::npos) return false;
+    out.host = upload_url.substr(host_begin, path_begin - host_begin);
+    out.path = upload_url.substr(path_begin);
+    out.download_url = download_url;
+
+    std::string hostname = out.host;
+    out.port = 80;
+    size_t colon = hostname.rfind(':');
+    if (colon != std::string::npos && hostname.find(']') == std::string::npos) {
+        out.port = std::atoi(hostname.c_str() + colon + 1);
+        hostname.resize(colon);
+    }
+    if (hostname.empty() || out.port <= 0 || out.port > 65535) return false;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    int rc = getaddrinfo(hostname.c_str(), nullptr, &hints, &res);
+    if (rc != 0 || res == nullptr) {
+        spdlog::warn("upload proxy: resolve {} failed: {}", hostname, gai_strerror(rc));
+        return false;
+    }
+    char ip[INET6_ADDRSTRLEN] = {0};
+    const void* addr = res->ai_family == AF_INET6
+        ? static_cast<const void*>(&reinterpret_cast<sockaddr_in6*>(res->ai_addr)->sin6_addr)
+        : static_cast<const void*>(&reinterpret_cast<sockaddr_in*>(res->ai_addr)->sin_addr);
+    bool ok = inet_ntop(res->ai_family, addr, ip, sizeof(ip)) != nullptr;
+    freeaddrinfo(res);
+    out.ip = ip;
+    return ok;
+}
+
+UploadProxy::UploadProxy(uWS::Loop* loop, const UploadProxyOptions& options) : options_(options) {
+    context_ = us_create_socket_context(SSL, reinterpret_cast<us_loop_t*>(loop), 0, us_socket_context_options_t{});
+    us_socket_context_on_open(SSL, context_, OnOpen);
+    us_socket_context_on_writable(SSL, context_, OnWritable);
+    us_socket_context_on_data(SSL, context_, OnData);
+    us_socket_context_on_end(SSL, context_, OnEnd);
+    us_socket_context_on_timeout(SSL, context_, OnTimeout);
+    us_socket_context_on_close(SSL, context_, OnClose);
+    us_socket_context_on_connect_error(SSL, context_, OnConnectError);
+    Metrics();
+}
+
+UploadProxy::~UploadProxy() {
+    us_socket_context_free(SSL, context_);
+}
+
+std::shared_ptr<UploadSession> UploadProxy::Begin(uWS::HttpResponse<false>* res, uint64_t content_length,
+                                                  std::string_view content_type) {
+    auto session = std::make_shared<UploadSession>();
+    session->res = res;
+    session->options = &options_;
+    session->content_length = content_length;
+    session->content_type = content_type.empty() ? "application/octet-stream" : std::string(content_type);
+    // 拿到上传目标前不再读取; 已经读进来的数据照常经 onData 暂存
+    res->pause();
+    session->paused = true;
+    res->onAborted([session] {
+        session->aborted = true;
+        Finish(*session, 0, "");
+    });
+    res->onData([session](std::string_view chunk, bool is_last) { OnClientData(*session, chunk, is_last); });
+    return session;
+}
+
+void UploadProxy::Connect(const std::shared_ptr<UploadSession>& session, const UploadTarget& target) {
+    if (session->done) return;
+    session->download_url = target.download_url;
+    us_socket_t* s = us_socket_context_connect(SSL, context_, target.ip.c_str(), target.port, nullptr, 0, sizeof(UpstreamExt));
+    if (s == nullptr) {
+        Finish(*session, 502, "Storage unreachable");
+        return;
+    }
+    new (us_socket_ext(SSL, s)) UpstreamExt{session};
+    session->upstream = s;
+    us_socket_timeout(SSL, s, options_.timeout_sec);
+
+    // 非 form-data 的 Content-Type 让 volume 按原始请求体保存; 客户端发 multipart 时原样透传
+    std::string head = "POST " + target.path + " HTTP/1.1\r\nHost: " + target.host + "\r\nContent-Type: " + session->content_type +
+                       "\r\nContent-Length: " + std::to_string(session->content_length) + "\r\nConnection: close\r\n\r\n";
+    session->pending.insert(0, head);
+}
+
+void UploadProxy::Fail(const std::shared_ptr<UploadSession>& session, int code, std::string_view msg) {
+    Finish(*session, code, msg);
+}
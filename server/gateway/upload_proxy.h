@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <uwebsockets/App.h>
+
+struct UploadProxyOptions {
+    uint64_t max_upload_bytes = 64ull << 20;
+    size_t max_pending_bytes = 256 * 1024;   // 上游写不进去的积压超过此值时暂停读取客户端
+    unsigned int timeout_sec = 30;           // 上游连接建立 / 无读写进展的超时
+};
+
+// GetUploadUrl 分配的上传目标; 在 gRPC 完成回调线程上解析, loop 线程上直接按数值地址连接
+struct UploadTarget {
+    std::string ip;
+    int port = 80;
+    std::string host;   // Host 头, host:port
+    std::string path;   // 含查询串
+    std::string download_url;
+};
+
+// upload_url 只支持 http://host[:port]/path; 主机名解析 (getaddrinfo) 会阻塞, 不能在 loop 线程调用
+bool ResolveUploadTarget(const std::string& upload_url, const std::string& download_url, UploadTarget& out);
+
+struct UploadSession;
+
+// /api/upload 的流式代理: 请求体按 onData 收到的块直接写给 SeaweedFS volume, 不在网关内攒完整文件.
+//
+// 上游连接是 loop 上的 uSockets 客户端 socket, 与 uWS::App 同线程, 无需加锁.
+// 上游 socket 写不进去的数据暂存在会话里, 超过 max_pending_bytes 时 pause 客户端连接, 上游可写并清空积压后 resume;
+// 在拿到上传目标前客户端同样处于暂停状态. 每个上传占用的内存约为 max_pending_bytes + 一次 recv 的数据.
+// 以下接口都只能在 loop 线程调用.
+class UploadProxy {
+public:
+    UploadProxy(uWS::Loop* loop, const UploadProxyOptions& options);
+    ~UploadProxy();
+
+    UploadProxy(const UploadProxy&) = delete;
+    UploadProxy& operator=(const UploadProxy&) = delete;
+
+    const UploadProxyOptions& Options() const { return options_; }
+
+    // 路由处理函数内调用: 暂停读取请求体并接管 res, 之后由 Connect 或 Fail 继续
+    std::shared_ptr<UploadSession> Begin(uWS::HttpResponse<false>* res, uint64_t content_length, std::string_view content_type);
+    // 连接上传目标并开始转发; 客户端已断开时什么也不做
+    void Connect(const std::shared_ptr<UploadSession>& session, const UploadTarget& target);
+    void Fail(const std::shared_ptr<UploadSession>& session, int code, std::string_view msg);
+
+private:
+    struct us_socket_context_t* context_;
+    UploadProxyOptions options_;
+};
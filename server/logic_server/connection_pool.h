@@ -0,0 +1,365 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "pool_stats.h"
+
+// 通用连接池, DbPool / RedisPool 都基于它实现
+//
+// Traits 需要提供:
+//   using Handle = T*;
+//   static constexpr const char* kName;
+//   Handle Create();            失败返回 nullptr
+//   void Destroy(Handle);
+//   bool IsHealthy(Handle);     只检查本地状态, 不产生网络请求
+//   bool Ping(Handle);          保活探测
+//
+// 空闲连接放在 max_pool 个原子槽位里, Acquire/Release 的快路径只做 CAS, 不加锁;
+// 每个线程从自己上次归还的槽位开始扫描, 尽量拿回刚用过的热连接.
+// 只有池里没有空闲连接时才进入 mutex + condition_variable 的慢路径 (建连或等待).
+// min/max、获取超时、闲置回收和保活周期可以经 Reconfigure 在运行时调整; 槽位数在构造时按 max_pool_limit 固定.
+template <typename Traits>
+class ConnectionPool {
+public:
+    using Handle = typename Traits::Handle;
+
+private:
+    struct Entry {
+        Handle handle;
+        uint64_t idle_epoch;  // 归还时的巡检轮次, 用于回收/保活 (避免在快路径上读时钟)
+    };
+
+public:
+    class ConnGuard {
+    public:
+        ConnGuard() = default;
+        ConnGuard(ConnectionPool* pool, Entry* entry) : pool_(pool), entry_(entry) {}
+        ConnGuard(ConnGuard&& other) noexcept : pool_(other.pool_), entry_(other.entry_) {
+            other.entry_ = nullptr;
+        }
+        ConnGuard& operator=(ConnGuard&& other) noexcept {
+            if (this != &other) {
+                reset();
+                pool_ = other.pool_;
+                entry_ = other.entry_;
+                other.entry_ = nullptr;
+            }
+            return *this;
+        }
+        ConnGuard(const ConnGuard&) = delete;
+        ConnGuard& operator=(const ConnGuard&) = delete;
+        ~ConnGuard() { reset(); }
+
+        Handle get() const { return entry_ ? entry_->handle : nullptr; }
+        explicit operator bool() const { return entry_ != nullptr; }
+
+        void reset() {
+            if (entry_) {
+                pool_->Release(entry_);
+                entry_ = nullptr;
+            }
+        }
+
+    private:
+        ConnectionPool* pool_ = nullptr;
+        Entry* entry_ = nullptr;
+    };
+
+    ConnectionPool(Traits traits, const PoolOptions& options)
+        : traits_(std::move(traits)),
+          slot_count_(std::max<size_t>({options.max_pool, options.max_pool_limit, 1})),
+          slots_(new std::atomic<Entry*>[slot_count_]) {
+        for (size_t i = 0; i < slot_count_; ++i) slots_[i].store(nullptr);
+        Apply(options);
+        TopUp();
+        maintainer_ = std::thread(&ConnectionPool::MaintainLoop, this);
+    }
+
+    ~ConnectionPool() {
+        {
+            std::lock_guard<std::mutex> lk(maintain_mu_);
+            stop_ = true;
+        }
+        maintain_cv_.notify_all();
+        if (maintainer_.joinable()) maintainer_.join();
+        for (size_t i = 0; i < slot_count_; ++i) {
+            if (Entry* e = slots_[i].exchange(nullptr)) {
+                traits_.Destroy(e->handle);
+                delete e;
+            }
+        }
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // 返回空 guard 表示超时或失败; timeout_ms < 0 时使用 options.acquire_timeout_ms
+    ConnGuard Acquire(int timeout_ms = -1) {
+        if (Entry* e = TryTakeIdle()) {
+            stats_.RecordFastAcquire();
+            return ConnGuard(this, e);
+        }
+        return AcquireSlow(std::chrono::steady_clock::now(),
+                           timeout_ms < 0 ? acquire_timeout_ms_.load(std::memory_order_relaxed) : timeout_ms);
+    }
+
+    PoolStatsSnapshot Stats() const {
+        size_t idle = 0;
+        for (size_t i = 0; i < slot_count_; ++i) {
+            if (slots_[i].load(std::memory_order_relaxed)) ++idle;
+        }
+        size_t total = total_.load(std::memory_order_relaxed);
+        return stats_.Snapshot(total > idle ? total - idle : 0, idle);
+    }
+
+    PoolOptions Options() const {
+        PoolOptions options;
+        options.min_pool = min_pool_.load(std::memory_order_relaxed);
+        options.max_pool = max_pool_.load(std::memory_order_relaxed);
+        options.max_pool_limit = slot_count_;
+        options.acquire_timeout_ms = acquire_timeout_ms_.load(std::memory_order_relaxed);
+        options.idle_timeout_sec = idle_timeout_sec_.load(std::memory_order_relaxed);
+        options.keepalive_interval_sec = keepalive_interval_sec_.load(std::memory_order_relaxed);
+        return options;
+    }
+
+    // 运行时调整池参数 (配置热更新). max_pool 超过槽位数时截断;
+    // 调小 max_pool 后多出的连接在归还时关闭, 调大 min_pool 由巡检线程立即补足
+    void Reconfigure(const PoolOptions& options) {
+        if (options.max_pool > slot_count_) {
+            spdlog::warn("{}: max_pool {} exceeds slot limit {}, restart with a larger max_limit to grow further", Traits::kName,
+                         options.max_pool, slot_count_);
+        }
+        Apply(options);
+        {
+            std::lock_guard<std::mutex> lk(maintain_mu_);
+            reconfigured_ = true;
+        }
+        maintain_cv_.notify_all();
+        // 调大 max_pool 后等待者可以直接建连
+        std::lock_guard<std::mutex> lk(mu_);
+        cv_.notify_all();
+    }
+
+private:
+    static uint64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 线程亲和的起始槽位: 首次使用按线程 id 打散, 之后记住上次归还的位置
+    static size_t& Hint() {
+        thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return hint;
+    }
+
+    Entry* TryTakeIdle() {
+        size_t start = Hint() % slot_count_;
+        for (size_t n = 0; n < slot_count_; ++n) {
+            size_t i = start + n < slot_count_ ? start + n : start + n - slot_count_;
+            Entry* e = slots_[i].load();
+            if (e && slots_[i].compare_exchange_strong(e, nullptr)) {
+                if (!traits_.IsHealthy(e->handle)) {
+                    DestroyEntry(e);
+                    stats_.RecordHealthFailure();
+                    continue;
+                }
+                Hint() = i;
+                return e;
+            }
+        }
+        return nullptr;
+    }
+
+    void PutIdle(Entry* e) {
+        // 存活连接数不超过 max_pool <= 槽位数, 一定能找到空槽
+        size_t start = Hint() % slot_count_;
+        while (true) {
+            for (size_t n = 0; n < slot_count_; ++n) {
+                size_t i = start + n < slot_count_ ? start + n : start + n - slot_count_;
+                Entry* expected = nullptr;
+                if (slots_[i].compare_exchange_strong(expected, e)) {
+                    Hint() = i;
+                    return;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void Release(Entry* e) {
+        if (!traits_.IsHealthy(e->handle)) {
+            DestroyEntry(e);
+            stats_.RecordHealthFailure();
+        } else if (total_.load(std::memory_order_relaxed) > max_pool_.load(std::memory_order_relaxed)) {
+            DestroyEntry(e);  // max_pool 被调小
+        } else {
+            e->idle_epoch = epoch_.load(std::memory_order_relaxed);
+            PutIdle(e);
+        }
+        NotifyWaiter();
+    }
+
+    // 槽位写入与 waiters_ 读取都是 seq_cst: 要么归还方看到等待者, 要么等待者扫描时看到连接
+    void NotifyWaiter() {
+        if (waiters_.load() > 0) {
+            std::lock_guard<std::mutex> lk(mu_);
+            cv_.notify_one();
+        }
+    }
+
+    bool Reserve() {
+        size_t total = total_.load();
+        while (total < max_pool_.load(std::memory_order_relaxed)) {
+            if (total_.compare_exchange_weak(total, total + 1)) return true;
+        }
+        return false;
+    }
+
+    Entry* CreateEntry() {
+        Handle h = traits_.Create();
+        if (!h) {
+            total_.fetch_sub(1);
+            return nullptr;
+        }
+        stats_.RecordCreated();
+        return new Entry{h, epoch_.load(std::memory_order_relaxed)};
+    }
+
+    void DestroyEntry(Entry* e) {
+        traits_.Destroy(e->handle);
+        delete e;
+        total_.fetch_sub(1);
+        stats_.RecordDestroyed();
+    }
+
+    ConnGuard AcquireSlow(std::chrono::steady_clock::time_point start, int timeout_ms) {
+        auto deadline = start + std::chrono::milliseconds(timeout_ms);
+        std::unique_lock<std::mutex> lk(mu_);
+        waiters_.fetch_add(1);
+        while (true) {
+            if (Entry* e = TryTakeIdle()) {
+                waiters_.fetch_sub(1);
+                stats_.RecordAcquire(ElapsedUs(start), true);
+                return ConnGuard(this, e);
+            }
+            if (Reserve()) {
+                lk.unlock();
+                Entry* e = CreateEntry();
+                if (e) {
+                    waiters_.fetch_sub(1);
+                    stats_.RecordAcquire(ElapsedUs(start), true);
+                    return ConnGuard(this, e);
+                }
+                lk.lock();
+            }
+            if (cv_.wait_until(lk, deadline) == std::cv_status::timeout) {
+                if (Entry* e = TryTakeIdle()) {
+                    waiters_.fetch_sub(1);
+                    stats_.RecordAcquire(ElapsedUs(start), true);
+                    return ConnGuard(this, e);
+                }
+                waiters_.fetch_sub(1);
+                lk.unlock();
+                stats_.RecordAcquire(ElapsedUs(start), false);
+                spdlog::warn("{}: acquire timeout after {}ms, {}", Traits::kName, timeout_ms, PoolStats::Describe(Stats()));
+                return ConnGuard();
+            }
+        }
+    }
+
+    void TopUp() {
+        bool added = false;
+        while (total_.load() < min_pool_.load(std::memory_order_relaxed) && Reserve()) {
+            Entry* e = CreateEntry();
+            if (!e) break;
+            PutIdle(e);
+            added = true;
+        }
+        if (added) NotifyWaiter();
+    }
+
+    void Apply(const PoolOptions& options) {
+        size_t max_pool = std::min<size_t>(std::max<size_t>(options.max_pool, 1), slot_count_);
+        max_pool_.store(max_pool, std::memory_order_relaxed);
+        min_pool_.store(std::min(options.min_pool, max_pool), std::memory_order_relaxed);
+        acquire_timeout_ms_.store(options.acquire_timeout_ms, std::memory_order_relaxed);
+        idle_timeout_sec_.store(options.idle_timeout_sec, std::memory_order_relaxed);
+        keepalive_interval_sec_.store(options.keepalive_interval_sec, std::memory_order_relaxed);
+    }
+
+    void MaintainLoop() {
+        using namespace std::chrono;
+        std::unique_lock<std::mutex> lk(maintain_mu_);
+        while (true) {
+            int keepalive = keepalive_interval_sec_.load(std::memory_order_relaxed);
+            const int interval_sec = keepalive > 0 ? keepalive : 30;
+            bool woken = maintain_cv_.wait_for(lk, seconds(interval_sec), [this] { return stop_ || reconfigured_; });
+            if (stop_) break;
+            if (woken) {
+                // Reconfigure: 只按新的 min_pool 补足, 不推进巡检轮次
+                reconfigured_ = false;
+                TopUp();
+                continue;
+            }
+            // 闲置时长按巡检轮次计, 精度为一个巡检周期
+            int idle_timeout_sec = idle_timeout_sec_.load(std::memory_order_relaxed);
+            const uint64_t idle_timeout_epochs = idle_timeout_sec > 0 ? (idle_timeout_sec + interval_sec - 1) / interval_sec : 0;
+            uint64_t now = epoch_.fetch_add(1) + 1;
+            for (size_t i = 0; i < slot_count_; ++i) {
+                // 先用 CAS 取得所有权再读 idle_epoch: 仍在槽里的 Entry 随时可能被其它线程取走、销毁或复用
+                Entry* e = slots_[i].load();
+                if (!e || !slots_[i].compare_exchange_strong(e, nullptr)) continue;
+                if (e->idle_epoch >= now) {
+                    // 本轮开始后才归还的, 原样放回
+                    Entry* expected = nullptr;
+                    if (!slots_[i].compare_exchange_strong(expected, e)) PutIdle(e);
+                    continue;
+                }
+
+                // 回收超出 min_pool 且闲置超时的连接, 其余闲置连接做保活探测
+                if (idle_timeout_epochs > 0 && now - e->idle_epoch >= idle_timeout_epochs &&
+                    total_.load() > min_pool_.load(std::memory_order_relaxed)) {
+                    DestroyEntry(e);
+                    stats_.RecordReaped();
+                } else if (traits_.Ping(e->handle)) {
+                    PutIdle(e);  // 保留原归还时间, 闲置时长不因保活而重置
+                } else {
+                    DestroyEntry(e);
+                    stats_.RecordHealthFailure();
+                    NotifyWaiter();
+                }
+            }
+            TopUp();
+        }
+    }
+
+    Traits traits_;
+    const size_t slot_count_;
+    std::unique_ptr<std::atomic<Entry*>[]> slots_;
+    std::atomic<size_t> total_{0};      // 已创建 (含正在建连的占位) 的连接数
+    std::atomic<size_t> waiters_{0};
+    std::atomic<uint64_t> epoch_{0};
+
+    // 可热更新的参数, 热路径上 relaxed 读取
+    std::atomic<size_t> min_pool_{0};
+    std::atomic<size_t> max_pool_{1};
+    std::atomic<int> acquire_timeout_ms_{0};
+    std::atomic<int> idle_timeout_sec_{0};
+    std::atomic<int> keepalive_interval_sec_{0};
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+
+    bool stop_ = false;
+    bool reconfigured_ = false;
+    std::mutex maintain_mu_;
+    std::condition_variable maintain_cv_;
+    std::thread maintainer_;
+    PoolStats stats_;
+};
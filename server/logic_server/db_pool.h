@@ -1,35 +1,22 @@
 #pragma once
 #include <libpq-fe.h>
-#include <mutex>
-#include <condition_variable>
-#include <deque>
-#include <memory>
 #include <string>
+#include "connection_pool.h"
 
-class DbPool {
-public:
-    DbPool(const std::string& conninfo, size_t min_pool = 2, size_t max_pool = 20);
-    ~DbPool();
-
-    struct ConnGuard {
-        PGconn* conn = nullptr;
-        DbPool* pool = nullptr;
-        ~ConnGuard();
-    };
+struct PgConnTraits {
+    using Handle = PGconn*;
+    static constexpr const char* kName = "DbPool";
 
-    // 返回 nullptr 表示超时或失败
-    std::unique_ptr<ConnGuard> Acquire(int timeout_ms = 5000);
+    std::string conninfo;
 
-private:
-    PGconn* CreateConn();
-    void Release(PGconn* conn);
+    PGconn* Create();
+    void Destroy(PGconn* conn);
     bool IsHealthy(PGconn* conn);
+    bool Ping(PGconn* conn);
+};
 
-    std::string conninfo_;
-    size_t min_pool_;
-    size_t max_pool_;
-    std::deque<PGconn*> idle_;
-    size_t total_created_ = 0;
-    std::mutex mu_;
-    std::condition_variable cv_;
-};
\ No newline at end of file
+class DbPool : public ConnectionPool<PgConnTraits> {
+public:
+    explicit DbPool(const std::string& conninfo, const PoolOptions& options = PoolOptions())
+        : ConnectionPool(PgConnTraits{conninfo}, options) {}
+};
@@ -0,0 +1,80 @@
+#include "delivery_cursor.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_set>
+#include <spdlog/spdlog.h>
+#include "../../common/trace/trace.h"
+
+namespace {
+// 旧版本的 IM:USER:CURSOR:<uid> 存的是 msg_id, 与 seq 不可比, 换用新 key
+std::string CursorKey(int64_t uid) { return "IM:USER:SEQ_CURSOR:" + std::to_string(uid); }
+std::string AckedKey(int64_t uid) { return "IM:USER:ACKED:" + std::to_string(uid); }
+}  // namespace
+
+std::string DeliveryCursor::Member(int64_t msg_id) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "%019lld", static_cast<long long>(msg_id));
+    return buf;
+}
+
+int64_t DeliveryCursor::LoadCursor(int64_t uid) {
+    auto value = redis_->Get(CursorKey(uid));
+    return value.has_value() ? std::strtoll(value->c_str(), nullptr, 10) : 0;
+}
+
+void DeliveryCursor::OnAcked(int64_t uid, const std::vector<int64_t>& msg_ids) {
+    std::vector<std::string> members;
+    members.reserve(msg_ids.size());
+    for (int64_t id : msg_ids) {
+        if (id > 0) members.push_back(Member(id));
+    }
+    if (!redis_->ZAddLex(AckedKey(uid), members, kAckedTtlSec)) {
+        spdlog::warn("record acks failed uid={} count={}", uid, members.size());
+    }
+}
+
+std::vector<im::ChatMsg> DeliveryCursor::Unacked(int64_t uid, int64_t client_last_seq) {
+    trace::Span span("cursor.Unacked");
+    const int64_t stored = LoadCursor(uid);
+    int64_t cursor = std::max(stored, client_last_seq);
+    int64_t scan_from = cursor;
+    bool contiguous = true;
+    std::vector<im::ChatMsg> out;
+    std::vector<std::string> absorbed;  // 被游标吸收的零散确认
+
+    for (int page = 0; page < kMaxScanPages && out.size() < kPageSize; ++page) {
+        auto msgs = db_->GetofflineMsgs(uid, scan_from);
+        if (msgs.empty()) break;
+        // msg_id 与 seq 的顺序不一致, 按本页 msg_id 的上下界取确认集合
+        auto bounds = std::minmax_element(msgs.begin(), msgs.end(),
+                                          [](const im::ChatMsg& a, const im::ChatMsg& b) { return a.msg_id() < b.msg_id(); });
+        auto acked_list = redis_->ZRangeByLex(AckedKey(uid), "[" + Member(bounds.first->msg_id()), "[" + Member(bounds.second->msg_id()));
+        std::unordered_set<std::string> acked(acked_list.begin(), acked_list.end());
+        scan_from = msgs.back().seq();  // 下面会移走消息, 先记下翻页位置
+
+        for (auto& msg : msgs) {
+            std::string member = Member(msg.msg_id());
+            if (!acked.count(member)) {
+                contiguous = false;
+                if (out.size() < kPageSize) out.push_back(std::move(msg));
+            } else if (contiguous && msg.seq() == cursor + 1) {
+                cursor = msg.seq();
+                absorbed.push_back(std::move(member));
+            } else {
+                contiguous = false;
+            }
+        }
+        if (msgs.size() < kPageSize) break;
+    }
+
+    if (cursor > stored) {
+        // 游标没写成功时保留零散确认, 下次同步还要靠它们推进
+        if (redis_->SetIfGreater(CursorKey(uid), cursor)) {
+            redis_->ZRem(AckedKey(uid), absorbed);
+        } else {
+            spdlog::warn("advance delivery cursor failed uid={} cursor={}", uid, cursor);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "im.pb.h"
+#include "storage.h"
+
+// 每个用户的已送达游标
+//
+//   IM:USER:SEQ_CURSOR:<uid>  seq 不大于游标的单聊消息全部已确认
+//   IM:USER:ACKED:<uid>       游标之后零散确认的 msg_id (ZSET, 成员为定长十进制串, 按字典序即数值序)
+//
+// 客户端确认可能乱序或丢失, 游标只在同步时沿 "已确认的连续前缀" 推进. seq 由存储按提交顺序连续分配,
+// 只有 seq 恰好为游标 + 1 的消息才能推进游标, 尚未提交的消息不会被越过.
+// 同步只返回游标之后仍未确认的消息.
+class DeliveryCursor {
+public:
+    DeliveryCursor(KvClient* redis, DbClient* db) : redis_(redis), db_(db) {}
+
+    void OnAcked(int64_t uid, const std::vector<int64_t>& msg_ids);
+
+    // client_last_seq 为客户端已连续收到的最大 seq, 与服务端游标取较大者作为起点
+    std::vector<im::ChatMsg> Unacked(int64_t uid, int64_t client_last_seq);
+
+private:
+    static constexpr size_t kPageSize = 100;
+    static constexpr int kMaxScanPages = 5;     // 单次同步最多扫描的页数, 避免长时间占用连接
+    static constexpr int kAckedTtlSec = 7 * 24 * 3600;
+
+    static std::string Member(int64_t msg_id);
+    int64_t LoadCursor(int64_t uid);
+
+    KvClient* redis_;
+    DbClient* db_;
+};
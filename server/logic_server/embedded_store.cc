@@ -0,0 +1,521 @@
+#include "embedded_store.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include "../../common/trace/trace.h"
+
+namespace {
+
+// 日志负载编码: 整数为 varint, 字符串为 varint 长度 + 字节
+void PutVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void PutInt(std::string& out, int64_t v) {
+    PutVarint(out, static_cast<uint64_t>(v));
+}
+
+void PutBytes(std::string& out, std::string_view s) {
+    PutVarint(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    bool Int(int64_t& v) {
+        uint64_t result = 0;
+        for (int shift = 0; shift < 64 && pos_ < data_.size(); shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(data_[pos_++]);
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                v = static_cast<int64_t>(result);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Bytes(std::string& s) {
+        int64_t len;
+        if (!Int(len) || len < 0 || static_cast<uint64_t>(len) > data_.size() - pos_) return false;
+        s.assign(data_.data() + pos_, static_cast<size_t>(len));
+        pos_ += static_cast<size_t>(len);
+        return true;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+// ZRANGEBYLEX 区间端点: "-" / "+" 为无穷, "(" 开区间, "[" 闭区间
+struct LexBound {
+    enum Kind { kMinusInf, kPlusInf, kOpen, kClosed } kind;
+    std::string value;
+};
+
+bool ParseLexBound(const std::string& s, LexBound& b) {
+    if (s == "-") b.kind = LexBound::kMinusInf;
+    else if (s == "+") b.kind = LexBound::kPlusInf;
+    else if (!s.empty() && s[0] == '(') b.kind = LexBound::kOpen;
+    else if (!s.empty() && s[0] == '[') b.kind = LexBound::kClosed;
+    else return false;
+    if (b.kind == LexBound::kOpen || b.kind == LexBound::kClosed) b.value = s.substr(1);
+    return true;
+}
+
+// 返回 [first, last) 迭代器区间; 区间为空时 first == last
+template <typename Set>
+std::pair<typename Set::const_iterator, typename Set::const_iterator> LexRange(const Set& set, const LexBound& min, const LexBound& max) {
+    auto first = set.begin();
+    if (min.kind == LexBound::kPlusInf) first = set.end();
+    else if (min.kind == LexBound::kClosed) first = set.lower_bound(min.value);
+    else if (min.kind == LexBound::kOpen) first = set.upper_bound(min.value);
+
+    auto last = set.end();
+    if (max.kind == LexBound::kMinusInf) last = set.begin();
+    else if (max.kind == LexBound::kClosed) last = set.upper_bound(max.value);
+    else if (max.kind == LexBound::kOpen) last = set.lower_bound(max.value);
+
+    if (first == set.end() || last == set.begin() || *first > *std::prev(last)) return {set.end(), set.end()};
+    return {first, last};
+}
+
+}  // namespace
+
+EmbeddedStore::EmbeddedStore(const SegmentedLogOptions& options) : log_(options) {}
+
+// 回放时单线程, 不加锁
+bool EmbeddedStore::Open() {
+    bool ok = log_.Open([this](uint8_t type, std::string_view payload, const SegmentedLog::Location& loc) {
+        if ((type >= kUser && type <= kFriendReject) || type == kUserPassword || type == kObjectFid) {
+            ApplyDb(type, payload, loc);
+        } else if (type == kKvHSet || type == kKvCounter) {
+            ApplyKv(type, payload);
+        } else {
+            spdlog::warn("embedded store: unknown record type {} skipped", type);
+        }
+    });
+    if (ok) {
+        spdlog::info("embedded store replayed: users={} messages={} friend_requests={}", users_.size(), message_count_, requests_.size());
+    }
+    return ok;
+}
+
+EmbeddedStoreStats EmbeddedStore::Stats() const {
+    EmbeddedStoreStats stats;
+    {
+        std::shared_lock<std::shared_mutex> lk(db_mu_);
+        stats.users = users_.size();
+        stats.messages = message_count_;
+    }
+    stats.segments = log_.SegmentCount();
+    stats.log_bytes = log_.TotalBytes();
+    return stats;
+}
+
+void EmbeddedStore::ApplyDb(uint8_t type, std::string_view payload, const SegmentedLog::Location& loc) {
+    Reader r(payload);
+    switch (type) {
+    case kUser: {
+        int64_t uid;
+        User user;
+        if (!r.Int(uid) || !r.Bytes(user.username) || !r.Bytes(user.password) || !r.Bytes(user.email)) break;
+        uid_by_email_[user.email] = uid;
+        users_[uid] = std::move(user);
+        next_uid_ = std::max(next_uid_, uid + 1);
+        return;
+    }
+    case kUserPassword: {
+        int64_t uid;
+        std::string password;
+        if (!r.Int(uid) || !r.Bytes(password)) break;
+        auto it = users_.find(uid);
+        if (it != users_.end()) it->second.password = std::move(password);
+        return;
+    }
+    case kObjectFid: {
+        std::string object_key, fid;
+        if (!r.Bytes(object_key) || !r.Bytes(fid)) break;
+        object_fids_[std::move(object_key)] = std::move(fid);
+        return;
+    }
+    case kMessage:
+    case kGroupMessage: {
+        int64_t msg_id, key;
+        if (!r.Int(msg_id) || !r.Int(key)) break;
+        auto& index = type == kMessage ? inbox_[key] : groups_[key];
+        index.emplace_hint(index.end(), index.empty() ? 1 : index.rbegin()->first + 1, loc);
+        ++message_count_;
+        return;
+    }
+    case kFriendRequest: {
+        int64_t req_id, from_uid, to_uid, create_time;
+        std::string reason;
+        if (!r.Int(req_id) || !r.Int(from_uid) || !r.Int(to_uid) || !r.Int(create_time) || !r.Bytes(reason)) break;
+        im::FriendRequest& fr = requests_[req_id];
+        fr.set_req_id(req_id);
+        fr.set_from_uid(from_uid);
+        fr.set_to_uid(to_uid);
+        fr.set_reason(reason);
+        fr.set_create_time(create_time);
+        fr.set_status(0);
+        pending_requests_[to_uid].insert(req_id);
+        next_req_id_ = std::max(next_req_id_, req_id + 1);
+        return;
+    }
+    case kFriendAccept:
+    case kFriendReject: {
+        int64_t req_id;
+        if (!r.Int(req_id)) break;
+        auto it = requests_.find(req_id);
+        if (it == requests_.end()) return;
+        im::FriendRequest& fr = it->second;
+        fr.set_status(type == kFriendAccept ? 1 : 2);
+        pending_requests_[fr.to_uid()].erase(req_id);
+        if (type == kFriendAccept) {
+            friends_[fr.from_uid()].insert(fr.to_uid());
+            friends_[fr.to_uid()].insert(fr.from_uid());
+        }
+        return;
+    }
+    }
+    spdlog::error("embedded store: malformed record type {} at segment {} offset {}", type, loc.segment, loc.offset);
+}
+
+void EmbeddedStore::ApplyKv(uint8_t type, std::string_view payload) {
+    Reader r(payload);
+    std::string key;
+    if (type == kKvHSet) {
+        std::string field, value;
+        if (r.Bytes(key) && r.Bytes(field) && r.Bytes(value)) {
+            hashes_[key][field] = std::move(value);
+            return;
+        }
+    } else if (type == kKvCounter) {
+        int64_t value;
+        if (r.Bytes(key) && r.Int(value)) {
+            auto& cur = strings_[key];
+            if (cur.empty() || value > std::strtoll(cur.c_str(), nullptr, 10)) cur = std::to_string(value);
+            return;
+        }
+    }
+    spdlog::error("embedded store: malformed kv record type {}", type);
+}
+
+std::string EmbeddedStore::GetUserPassword(int64_t uid) {
+    trace::Span span("db.GetUserPassword");
+    std::shared_lock<std::shared_mutex> lk(db_mu_);
+    auto it = users_.find(uid);
+    return it != users_.end() ? it->second.password : "";
+}
+
+// 正文不进内存: 先写日志拿到位置, 再加锁更新索引; 返回分配的 seq, 失败返回 0
+int64_t EmbeddedStore::AppendMessage(RecordType type, const std::string& msg_id, int64_t key, int64_t from_uid, const std::string& content) {
+    int64_t id = std::strtoll(msg_id.c_str(), nullptr, 10);
+    if (id <= 0) return 0;
+    std::string payload;
+    PutInt(payload, id);
+    PutInt(payload, key);
+    PutInt(payload, from_uid);
+    PutInt(payload, time(nullptr));
+    PutBytes(payload, content);
+    SegmentedLog::Location loc;
+    std::lock_guard<std::mutex> order(msg_mu_);
+    if (!log_.Append(type, payload, &loc)) return 0;
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    ApplyDb(type, payload, loc);
+    const auto& index = type == kMessage ? inbox_[key] : groups_[key];
+    return index.rbegin()->first;
+}
+
+std::vector<im::ChatMsg> EmbeddedStore::ReadMsgs(const std::unordered_map<int64_t, MsgIndex>& index, int64_t key, int64_t after_seq) {
+    std::vector<std::pair<int64_t, SegmentedLog::Location>> locs;
+    {
+        std::shared_lock<std::shared_mutex> lk(db_mu_);
+        auto it = index.find(key);
+        if (it == index.end()) return {};
+        for (auto m = it->second.upper_bound(after_seq); m != it->second.end() && locs.size() < kMsgPageSize; ++m) {
+            locs.emplace_back(m->first, m->second);
+        }
+    }
+    std::vector<im::ChatMsg> msgs;
+    msgs.reserve(locs.size());
+    std::string payload;
+    for (const auto& [seq, loc] : locs) {
+        int64_t msg_id, msg_key, from_uid, create_time;
+        std::string content;
+        if (!log_.Read(loc, payload)) {
+            spdlog::error("embedded store: read message at segment {} offset {} failed", loc.segment, loc.offset);
+            continue;
+        }
+        Reader r(payload);
+        if (!r.Int(msg_id) || !r.Int(msg_key) || !r.Int(from_uid) || !r.Int(create_time) || !r.Bytes(content)) {
+            spdlog::error("embedded store: malformed message at segment {} offset {}", loc.segment, loc.offset);
+            continue;
+        }
+        im::ChatMsg msg;
+        msg.set_msg_id(msg_id);
+        msg.set_from_uid(from_uid);
+        msg.set_to_uid(msg_key);  // 群聊时为群ID
+        msg.set_content(std::move(content));
+        msg.set_create_time(create_time);
+        msg.set_seq(seq);
+        msgs.push_back(std::move(msg));
+    }
+    return msgs;
+}
+
+int64_t EmbeddedStore::SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content) {
+    trace::Span span("db.SaveMessage");
+    return AppendMessage(kMessage, msg_id, to_uid, from_uid, content);
+}
+
+std::vector<im::ChatMsg> EmbeddedStore::GetofflineMsgs(int64_t uid, int64_t after_seq) {
+    trace::Span span("db.GetOfflineMsgs");
+    return ReadMsgs(inbox_, uid, after_seq);
+}
+
+int64_t EmbeddedStore::SaveGroupMessage(const std::string& msg_id, int64_t group_id, int64_t from_uid, const std::string& content) {
+    return AppendMessage(kGroupMessage, msg_id, group_id, from_uid, content);
+}
+
+std::vector<im::ChatMsg> EmbeddedStore::GetGroupMsgs(int64_t group_id, int64_t after_seq) {
+    return ReadMsgs(groups_, group_id, after_seq);
+}
+
+bool EmbeddedStore::SaveObjectFid(const std::string& object_key, const std::string& fid) {
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    std::string payload;
+    PutBytes(payload, object_key);
+    PutBytes(payload, fid);
+    if (!log_.Append(kObjectFid, payload)) return false;
+    ApplyDb(kObjectFid, payload, {});
+    return true;
+}
+
+std::string EmbeddedStore::GetObjectFid(const std::string& object_key) {
+    std::shared_lock<std::shared_mutex> lk(db_mu_);
+    auto it = object_fids_.find(object_key);
+    return it == object_fids_.end() ? "" : it->second;
+}
+
+// 分配 id 和写日志都在写锁内, 保证日志顺序与 id 顺序一致
+int64_t EmbeddedStore::CreateUser(const std::string& username, const std::string& password, const std::string& email) {
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    if (uid_by_email_.count(email)) return -1;
+    int64_t uid = next_uid_;
+    std::string payload;
+    PutInt(payload, uid);
+    PutBytes(payload, username);
+    PutBytes(payload, password);
+    PutBytes(payload, email);
+    if (!log_.Append(kUser, payload)) return -1;
+    ApplyDb(kUser, payload, {});
+    return uid;
+}
+
+bool EmbeddedStore::GetUserByEmail(const std::string& email, UserCredential& credential) {
+    std::shared_lock<std::shared_mutex> lk(db_mu_);
+    auto it = uid_by_email_.find(email);
+    if (it == uid_by_email_.end()) return false;
+    const User& user = users_.at(it->second);
+    credential.uid = it->second;
+    credential.nickname = user.username;
+    credential.password = user.password;
+    return true;
+}
+
+bool EmbeddedStore::UpdatePassword(int64_t uid, const std::string& password) {
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    if (!users_.count(uid)) return false;
+    std::string payload;
+    PutInt(payload, uid);
+    PutBytes(payload, password);
+    if (!log_.Append(kUserPassword, payload)) return false;
+    ApplyDb(kUserPassword, payload, {});
+    return true;
+}
+
+bool EmbeddedStore::CreateFriendRequest(int64_t from_uid, int64_t to_uid, const std::string& reason, int64_t& out_req_id) {
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    int64_t req_id = next_req_id_;
+    std::string payload;
+    PutInt(payload, req_id);
+    PutInt(payload, from_uid);
+    PutInt(payload, to_uid);
+    PutInt(payload, time(nullptr));
+    PutBytes(payload, reason);
+    if (!log_.Append(kFriendRequest, payload)) return false;
+    ApplyDb(kFriendRequest, payload, {});
+    out_req_id = req_id;
+    return true;
+}
+
+std::vector<im::FriendRequest> EmbeddedStore::GetFriendRequestsForUser(int64_t uid) {
+    std::vector<im::FriendRequest> list;
+    std::shared_lock<std::shared_mutex> lk(db_mu_);
+    auto it = pending_requests_.find(uid);
+    if (it == pending_requests_.end()) return list;
+    for (int64_t req_id : it->second) list.push_back(requests_.at(req_id));
+    return list;
+}
+
+void EmbeddedStore::DecideFriendRequest(int64_t req_id, int32_t status) {
+    std::string payload;
+    PutInt(payload, req_id);
+    RecordType type = status == 1 ? kFriendAccept : kFriendReject;
+    if (log_.Append(type, payload)) ApplyDb(type, payload, {});
+}
+
+bool EmbeddedStore::AcceptFriendRequest(int64_t req_id) {
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    auto it = requests_.find(req_id);
+    if (it == requests_.end() || it->second.status() != 0) return false;
+    DecideFriendRequest(req_id, 1);
+    return it->second.status() == 1;
+}
+
+bool EmbeddedStore::RejectFriendRequest(int64_t req_id) {
+    std::unique_lock<std::shared_mutex> lk(db_mu_);
+    auto it = requests_.find(req_id);
+    if (it == requests_.end()) return false;
+    if (it->second.status() == 0) DecideFriendRequest(req_id, 2);
+    return true;
+}
+
+bool EmbeddedStore::AreFriends(int64_t uid1, int64_t uid2) {
+    trace::Span span("db.AreFriends");
+    std::shared_lock<std::shared_mutex> lk(db_mu_);
+    auto it = friends_.find(uid1);
+    return it != friends_.end() && it->second.count(uid2) > 0;
+}
+
+std::vector<int64_t> EmbeddedStore::ListFriends(int64_t uid) {
+    std::shared_lock<std::shared_mutex> lk(db_mu_);
+    auto it = friends_.find(uid);
+    if (it == friends_.end()) return {};
+    return std::vector<int64_t>(it->second.begin(), it->second.end());
+}
+
+bool EmbeddedStore::Set(const std::string& key, const std::string& value) {
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    strings_[key] = value;
+    return true;
+}
+
+std::optional<std::string> EmbeddedStore::Get(const std::string& key) {
+    std::shared_lock<std::shared_mutex> lk(kv_mu_);
+    auto it = strings_.find(key);
+    if (it == strings_.end()) return std::nullopt;
+    return it->second;
+}
+
+bool EmbeddedStore::HSet(const std::string& key, const std::string& field, const std::string& value) {
+    std::string payload;
+    PutBytes(payload, key);
+    PutBytes(payload, field);
+    PutBytes(payload, value);
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    if (!log_.Append(kKvHSet, payload)) return false;
+    ApplyKv(kKvHSet, payload);
+    return true;
+}
+
+std::optional<std::string> EmbeddedStore::HGet(const std::string& key, const std::string& field) {
+    std::shared_lock<std::shared_mutex> lk(kv_mu_);
+    auto it = hashes_.find(key);
+    if (it == hashes_.end()) return std::nullopt;
+    auto f = it->second.find(field);
+    if (f == it->second.end()) return std::nullopt;
+    return f->second;
+}
+
+bool EmbeddedStore::SetIfGreater(const std::string& key, int64_t value) {
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    auto it = strings_.find(key);
+    if (it != strings_.end() && value <= std::strtoll(it->second.c_str(), nullptr, 10)) return true;
+    std::string payload;
+    PutBytes(payload, key);
+    PutInt(payload, value);
+    if (!log_.Append(kKvCounter, payload)) return false;
+    ApplyKv(kKvCounter, payload);
+    return true;
+}
+
+bool EmbeddedStore::SetNXOrGet(const std::string& key, const std::string& value, int, std::optional<std::string>& existing) {
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    auto [it, inserted] = strings_.emplace(key, value);
+    if (inserted) existing.reset();
+    else existing = it->second;
+    return true;
+}
+
+// 同 SetNXOrGet, 单机部署不落盘也不过期
+bool EmbeddedStore::SetEx(const std::string& key, const std::string& value, int) {
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    strings_[key] = value;
+    return true;
+}
+
+bool EmbeddedStore::Del(const std::string& key) {
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    strings_.erase(key);
+    return true;
+}
+
+const EmbeddedStore::SortedSet* EmbeddedStore::FindSortedSet(const std::string& key) const {
+    auto it = sorted_sets_.find(key);
+    if (it == sorted_sets_.end() || it->second.expires <= std::chrono::steady_clock::now()) return nullptr;
+    return &it->second;
+}
+
+bool EmbeddedStore::ZAddLex(const std::string& key, const std::vector<std::string>& members, int ttl_sec) {
+    if (members.empty()) return true;
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    auto& set = sorted_sets_[key];
+    auto now = std::chrono::steady_clock::now();
+    if (set.expires <= now) set.members.clear();
+    set.members.insert(members.begin(), members.end());
+    set.expires = ttl_sec > 0 ? now + std::chrono::seconds(ttl_sec) : std::chrono::steady_clock::time_point::max();
+    return true;
+}
+
+std::vector<std::string> EmbeddedStore::ZRangeByLex(const std::string& key, const std::string& min, const std::string& max) {
+    LexBound lo, hi;
+    if (!ParseLexBound(min, lo) || !ParseLexBound(max, hi)) return {};
+    std::shared_lock<std::shared_mutex> lk(kv_mu_);
+    const SortedSet* set = FindSortedSet(key);
+    if (!set) return {};
+    auto range = LexRange(set->members, lo, hi);
+    return std::vector<std::string>(range.first, range.second);
+}
+
+bool EmbeddedStore::ZRemRangeByLex(const std::string& key, const std::string& min, const std::string& max) {
+    LexBound lo, hi;
+    if (!ParseLexBound(min, lo) || !ParseLexBound(max, hi)) return false;
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    auto it = sorted_sets_.find(key);
+    if (it == sorted_sets_.end()) return true;
+    auto range = LexRange(it->second.members, lo, hi);
+    it->second.members.erase(range.first, range.second);
+    if (it->second.members.empty()) sorted_sets_.erase(it);
+    return true;
+}
+
+bool EmbeddedStore::ZRem(const std::string& key, const std::vector<std::string>& members) {
+    std::unique_lock<std::shared_mutex> lk(kv_mu_);
+    auto it = sorted_sets_.find(key);
+    if (it == sorted_sets_.end()) return true;
+    for (const auto& m : members) it->second.members.erase(m);
+    if (it->second.members.empty()) sorted_sets_.erase(it);
+    return true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "segmented_log.h"
+#include "storage.h"
+
+struct EmbeddedStoreStats {
+    size_t users = 0;
+    size_t messages = 0;
+    size_t segments = 0;
+    uint64_t log_bytes = 0;
+};
+
+// 嵌入式存储, 单机部署和压测用, 不依赖 Postgres / Redis
+//
+// 用户、好友、好友申请、消息及 KV 中的吊销表 / 已送达游标都写入 SegmentedLog, 启动时回放日志重建内存索引:
+//   用户 / 好友 / 申请 / 对象 fid   全部在内存 (哈希表)
+//   单聊 / 群聊消息                 每个 uid / 群 一棵按 seq 排序的有序表, 只存日志位置, 正文按需从日志读回;
+//                                   seq 按日志顺序逐条分配 (回放时重新推出, 不写入日志)
+// 会话路由、网关租约、零散确认集合只在内存: 重启后路由由用户重新登录补齐, 零散确认丢失只会多同步几条消息 (客户端按 msg_id 去重)
+class EmbeddedStore : public DbClient, public KvClient {
+public:
+    explicit EmbeddedStore(const SegmentedLogOptions& options);
+
+    // 回放日志, 失败返回 false
+    bool Open();
+
+    EmbeddedStoreStats Stats() const;
+
+    // DbClient
+    std::string GetUserPassword(int64_t uid) override;
+    int64_t SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content) override;
+    std::vector<im::ChatMsg> GetofflineMsgs(int64_t uid, int64_t after_seq) override;
+    int64_t CreateUser(const std::string& username, const std::string& password, const std::string& email) override;
+    bool GetUserByEmail(const std::string& email, UserCredential& credential) override;
+    bool UpdatePassword(int64_t uid, const std::string& password) override;
+    bool CreateFriendRequest(int64_t from_uid, int64_t to_uid, const std::string& reason, int64_t& out_req_id) override;
+    std::vector<im::FriendRequest> GetFriendRequestsForUser(int64_t uid) override;
+    bool AcceptFriendRequest(int64_t req_id) override;
+    bool RejectFriendRequest(int64_t req_id) override;
+    bool AreFriends(int64_t uid1, int64_t uid2) override;
+    std::vector<int64_t> ListFriends(int64_t uid) override;
+    int64_t SaveGroupMessage(const std::string& msg_id, int64_t group_id, int64_t from_uid, const std::string& content) override;
+    std::vector<im::ChatMsg> GetGroupMsgs(int64_t group_id, int64_t after_seq) override;
+    bool SaveObjectFid(const std::string& object_key, const std::string& fid) override;
+    std::string GetObjectFid(const std::string& object_key) override;
+
+    // KvClient
+    bool Set(const std::string& key, const std::string& value) override;
+    std::optional<std::string> Get(const std::string& key) override;
+    bool HSet(const std::string& key, const std::string& field, const std::string& value) override;
+    std::optional<std::string> HGet(const std::string& key, const std::string& field) override;
+    bool SetIfGreater(const std::string& key, int64_t value) override;
+    // 只在内存, 不支持 TTL; 单机部署的发送去重只用进程内窗口, 不经过这里
+    bool SetNXOrGet(const std::string& key, const std::string& value, int ttl_sec, std::optional<std::string>& existing) override;
+    bool SetEx(const std::string& key, const std::string& value, int ttl_sec) override;
+    bool Del(const std::string& key) override;
+    bool ZAddLex(const std::string& key, const std::vector<std::string>& members, int ttl_sec) override;
+    std::vector<std::string> ZRangeByLex(const std::string& key, const std::string& min, const std::string& max) override;
+    bool ZRemRangeByLex(const std::string& key, const std::string& min, const std::string& max) override;
+    bool ZRem(const std::string& key, const std::vector<std::string>& members) override;
+
+private:
+    static constexpr size_t kMsgPageSize = 100;
+
+    // 日志记录类型, 只能追加新值
+    enum RecordType : uint8_t {
+        kUser = 1,
+        kMessage = 2,
+        kGroupMessage = 3,
+        kFriendRequest = 4,
+        kFriendAccept = 5,
+        kFriendReject = 6,
+        kKvHSet = 7,
+        kKvCounter = 8,
+        kUserPassword = 9,
+        kObjectFid = 10,
+    };
+
+    struct User {
+        std::string username;
+        std::string password;
+        std::string email;
+    };
+
+    struct SortedSet {
+        std::set<std::string> members;
+        std::chrono::steady_clock::time_point expires = std::chrono::steady_clock::time_point::max();
+    };
+
+    using MsgIndex = std::map<int64_t, SegmentedLog::Location>;  // seq -> 日志位置
+
+    // 回放和写入共用: 把一条记录应用到内存索引, 调用方持有对应的写锁
+    void ApplyDb(uint8_t type, std::string_view payload, const SegmentedLog::Location& loc);
+    void ApplyKv(uint8_t type, std::string_view payload);
+
+    int64_t AppendMessage(RecordType type, const std::string& msg_id, int64_t key, int64_t from_uid, const std::string& content);
+    std::vector<im::ChatMsg> ReadMsgs(const std::unordered_map<int64_t, MsgIndex>& index, int64_t key, int64_t after_seq);
+    void DecideFriendRequest(int64_t req_id, int32_t status);
+    // 过期的有序集合按不存在处理 (下次 ZAddLex 时清空), 调用方持有 kv_mu_
+    const SortedSet* FindSortedSet(const std::string& key) const;
+
+    SegmentedLog log_;
+
+    // 消息的写日志和更新索引在同一把锁内, 日志顺序即 seq 顺序, 回放得到相同的 seq
+    std::mutex msg_mu_;
+
+    mutable std::shared_mutex db_mu_;
+    std::unordered_map<int64_t, User> users_;
+    std::unordered_map<std::string, int64_t> uid_by_email_;
+    int64_t next_uid_ = 1;
+    std::unordered_map<int64_t, std::unordered_set<int64_t>> friends_;
+    std::unordered_map<int64_t, im::FriendRequest> requests_;
+    std::unordered_map<int64_t, std::set<int64_t>> pending_requests_;  // to_uid -> 待处理的 req_id
+    int64_t next_req_id_ = 1;
+    std::unordered_map<int64_t, MsgIndex> inbox_;   // to_uid -> 单聊消息
+    std::unordered_map<int64_t, MsgIndex> groups_;  // group_id -> 群聊消息
+    size_t message_count_ = 0;
+    std::unordered_map<std::string, std::string> object_fids_;  // 上传对象 key -> fid
+
+    mutable std::shared_mutex kv_mu_;
+    std::unordered_map<std::string, std::string> strings_;
+    std::unordered_map<std::string, std::unordered_map<std::string, std::string>> hashes_;
+    std::unordered_map<std::string, SortedSet> sorted_sets_;
+};
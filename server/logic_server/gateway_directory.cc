@@ -0,0 +1,75 @@
+#include "gateway_directory.h"
+#include <spdlog/spdlog.h>
+#include "../../common/presence/gateway_registry.h"
+#include "../../common/trace/trace.h"
+
+bool GatewayDirectory::Resolve(int64_t uid, Target& target) {
+    trace::Span span("redis.ResolveGateway");
+    if (!static_address_.empty()) {
+        target.gateway_id = static_address_;
+        target.address = static_address_;
+        target.stream = StreamFor(target.address);
+        return true;
+    }
+    auto gateway_id = redis_->Get(UserSessionKey(uid));
+    if (!gateway_id.has_value()) return false;
+    target.gateway_id = gateway_id.value();
+    if (!ResolveGateway(target.gateway_id, target.address)) {
+        spdlog::warn("gateway {} of uid {} has no live lease", target.gateway_id, uid);
+        return false;
+    }
+    target.stream = StreamFor(target.address);
+    return true;
+}
+
+// 租约地址在本地缓存 address_cache_ms, 避免每次推送都多一次 Redis 往返
+bool GatewayDirectory::ResolveGateway(const std::string& gateway_id, std::string& address) {
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = addresses_.find(gateway_id);
+        if (it != addresses_.end() && it->second.expires > now) {
+            address = it->second.address;
+            return true;
+        }
+    }
+    auto lease = redis_->Get(GatewayLeaseKey(gateway_id));
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!lease.has_value()) {
+        addresses_.erase(gateway_id);
+        return false;
+    }
+    address = lease.value();
+    addresses_[gateway_id] = {address, now + std::chrono::milliseconds(address_cache_ms_)};
+    return true;
+}
+
+GatewayPushStream* GatewayDirectory::StreamFor(const std::string& address) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& stream = streams_[address];
+    if (!stream) {
+        stream = std::make_unique<GatewayPushStream>(address, stream_options_, [this, address] { ForgetAddress(address); });
+        spdlog::info("gateway push stream created: {}", address);
+    }
+    return stream.get();
+}
+
+// 推送流回执超时: 丢掉指向该地址的租约缓存, 之后的推送重新读租约, 网关已下线时不再路由到它
+void GatewayDirectory::ForgetAddress(const std::string& address) {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto it = addresses_.begin(); it != addresses_.end();) {
+        if (it->second.address == address) {
+            spdlog::warn("gateway {} at {} stalled, dropping cached route", it->first, address);
+            it = addresses_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, PushStreamStats>> GatewayDirectory::StreamStats() {
+    std::vector<std::pair<std::string, PushStreamStats>> out;
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const auto& kv : streams_) out.emplace_back(kv.first, kv.second->Stats());
+    return out;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "storage.h"
+#include "push_stream.h"
+
+// 推送路由: uid -> 会话所在网关 id -> 网关租约中的推送地址 -> 到该网关的长连接推送流
+class GatewayDirectory {
+public:
+    explicit GatewayDirectory(KvClient* redis, const PushStreamOptions& stream_options = PushStreamOptions(),
+                              int address_cache_ms = 1000)
+        : redis_(redis), stream_options_(stream_options), address_cache_ms_(address_cache_ms) {}
+
+    struct Target {
+        std::string gateway_id;
+        std::string address;
+        GatewayPushStream* stream = nullptr;  // 归 GatewayDirectory 所有, 生命周期同 directory
+    };
+
+    // 用户不在线或所在网关租约已过期时返回 false
+    bool Resolve(int64_t uid, Target& target);
+
+    // 单机部署 (embedded 存储): 网关的会话路由和租约不在本进程, 所有用户都推给这一个网关,
+    // 不在线的用户由网关回执 not_found. 启动时设置一次
+    void SetStaticGateway(const std::string& address) { static_address_ = address; }
+
+    std::vector<std::pair<std::string, PushStreamStats>> StreamStats();
+
+private:
+    struct CachedAddress {
+        std::string address;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    bool ResolveGateway(const std::string& gateway_id, std::string& address);
+    GatewayPushStream* StreamFor(const std::string& address);
+    void ForgetAddress(const std::string& address);
+
+    KvClient* redis_;
+    PushStreamOptions stream_options_;
+    int address_cache_ms_;
+    std::string static_address_;
+
+    std::mutex mu_;
+    // 网关数量很少, 地址缓存与推送流都不做淘汰; 下线网关的推送流空闲时不会重连
+    std::unordered_map<std::string, CachedAddress> addresses_;
+    std::unordered_map<std::string, std::unique_ptr<GatewayPushStream>> streams_;
+};
@@ -0,0 +1,383 @@
+#include "http_client.h"
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kMaxHeaderBytes = 64 * 1024;
+constexpr ssize_t kReadTimeout = -2;
+
+int RemainingMs(Clock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+// 等待 fd 就绪, 超时返回 false; POLLERR / POLLHUP 交给随后的读写报告
+bool WaitFor(int fd, short events, Clock::time_point deadline) {
+    while (true) {
+        int ms = RemainingMs(deadline);
+        if (ms <= 0) return false;
+        pollfd p{fd, events, 0};
+        int n = ::poll(&p, 1, ms);
+        if (n < 0 && errno == EINTR) continue;
+        return n > 0;
+    }
+}
+
+bool SendAll(int fd, const std::string& data, Clock::time_point deadline) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!WaitFor(fd, POLLOUT, deadline)) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 追加读到的数据到 buf: 返回字节数, 0 表示对端关闭, -1 出错, kReadTimeout 超时
+ssize_t ReadSome(int fd, std::string& buf, Clock::time_point deadline) {
+    char tmp[16384];
+    while (true) {
+        ssize_t n = ::recv(fd, tmp, sizeof(tmp), 0);
+        if (n > 0) {
+            buf.append(tmp, static_cast<size_t>(n));
+            return n;
+        }
+        if (n == 0) return 0;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        if (!WaitFor(fd, POLLIN, deadline)) return kReadTimeout;
+    }
+}
+
+std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool IEquals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+bool IContains(std::string_view s, std::string_view token) {
+    if (token.size() > s.size()) return false;
+    for (size_t i = 0; i + token.size() <= s.size(); ++i) {
+        if (IEquals(s.substr(i, token.size()), token)) return true;
+    }
+    return false;
+}
+
+bool ParseChunkSize(std::string_view line, size_t& size) {
+    line = Trim(line.substr(0, line.find(';')));
+    if (line.empty() || line.size() > 15) return false;
+    size = 0;
+    for (char c : line) {
+        int v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else return false;
+        size = size * 16 + static_cast<size_t>(v);
+    }
+    return true;
+}
+
+}  // namespace
+
+HttpClient::HttpClient(const std::string& name, const HttpClientOptions& options) : name_(name), options_(options) {
+    auto& registry = metrics::Registry::Instance();
+    connects_ = registry.GetCounter("im_http_client_connects_total", "New TCP connections opened by the HTTP client", {{"client", name_}});
+    reuses_ = registry.GetCounter("im_http_client_reuses_total", "Requests sent on a pooled keep-alive connection", {{"client", name_}});
+    failures_ = registry.GetCounter("im_http_client_failures_total", "HTTP requests failed by connect error, timeout or bad response",
+                                    {{"client", name_}});
+}
+
+HttpClient::~HttpClient() {
+    for (auto& kv : idle_) {
+        for (const auto& conn : kv.second) ::close(conn.fd);
+    }
+}
+
+bool HttpClient::Get(const std::string& host, int port, const std::string& path, HttpResult& result) {
+    std::string endpoint = host + ":" + std::to_string(port);
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + endpoint + "\r\n\r\n";
+    auto deadline = Clock::now() + std::chrono::milliseconds(options_.request_timeout_ms);
+
+    // 第二次只用新连接
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int fd = attempt == 0 ? TakeIdle(endpoint) : -1;
+        bool reused = fd >= 0;
+        if (reused) {
+            reuses_->Inc();
+        } else {
+            auto connect_deadline = std::min(deadline, Clock::now() + std::chrono::milliseconds(options_.connect_timeout_ms));
+            fd = Connect(host, port, connect_deadline);
+            if (fd < 0) break;
+            connects_->Inc();
+        }
+
+        bool keep_alive = false;
+        result = HttpResult();
+        Outcome outcome = RoundTrip(fd, request, deadline, result, keep_alive);
+        if (outcome == Outcome::kOk) {
+            if (keep_alive) {
+                PutIdle(endpoint, fd);
+            } else {
+                ::close(fd);
+            }
+            return true;
+        }
+        ::close(fd);
+        if (outcome != Outcome::kRetryable || !reused) break;
+    }
+    failures_->Inc();
+    spdlog::warn("http client {}: GET {}{} failed", name_, endpoint, path);
+    return false;
+}
+
+bool HttpClient::Resolve(const std::string& host, int port, std::vector<Address>& addrs) {
+    std::string key = host + ":" + std::to_string(port);
+    auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = resolved_.find(key);
+        if (it != resolved_.end() && it->second.expires > now) {
+            addrs = it->second.addrs;
+            return true;
+        }
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    int rc = ::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res);
+    if (rc != 0) {
+        spdlog::warn("http client {}: resolve {} failed: {}", name_, host, gai_strerror(rc));
+        return false;
+    }
+    addrs.clear();
+    for (addrinfo* p = res; p != nullptr; p = p->ai_next) {
+        Address a;
+        std::memcpy(&a.addr, p->ai_addr, p->ai_addrlen);
+        a.len = p->ai_addrlen;
+        addrs.push_back(a);
+    }
+    ::freeaddrinfo(res);
+    if (addrs.empty()) return false;
+    std::lock_guard<std::mutex> lk(mu_);
+    resolved_[key] = {addrs, now + std::chrono::seconds(options_.dns_ttl_sec)};
+    return true;
+}
+
+int HttpClient::Connect(const std::string& host, int port, Clock::time_point deadline) {
+    std::vector<Address> addrs;
+    if (!Resolve(host, port, addrs)) return -1;
+    for (const auto& a : addrs) {
+        int fd = ::socket(a.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) continue;
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&a.addr), a.len) == 0) return fd;
+        if (errno == EINPROGRESS && WaitFor(fd, POLLOUT, deadline)) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) return fd;
+        }
+        ::close(fd);
+    }
+    // 地址可能已变化, 下次重新解析
+    std::lock_guard<std::mutex> lk(mu_);
+    resolved_.erase(host + ":" + std::to_string(port));
+    spdlog::warn("http client {}: connect {}:{} failed", name_, host, port);
+    return -1;
+}
+
+int HttpClient::TakeIdle(const std::string& endpoint) {
+    auto cutoff = Clock::now() - std::chrono::seconds(options_.idle_timeout_sec);
+    while (true) {
+        int fd = -1;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            auto it = idle_.find(endpoint);
+            if (it == idle_.end() || it->second.empty()) return -1;
+            // 尾部最新; 最新的都已超时说明整组都超时
+            IdleConn conn = it->second.back();
+            it->second.pop_back();
+            if (conn.since < cutoff) {
+                for (const auto& c : it->second) ::close(c.fd);
+                it->second.clear();
+                ::close(conn.fd);
+                return -1;
+            }
+            fd = conn.fd;
+        }
+        // 空闲连接上不应有数据: 可读说明对端已关闭 (EOF) 或状态异常
+        pollfd p{fd, POLLIN, 0};
+        if (::poll(&p, 1, 0) == 0) return fd;
+        ::close(fd);
+    }
+}
+
+void HttpClient::PutIdle(const std::string& endpoint, int fd) {
+    int evicted = -1;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto& conns = idle_[endpoint];
+        if (options_.max_idle_per_endpoint == 0) {
+            evicted = fd;
+        } else if (conns.size() >= options_.max_idle_per_endpoint) {
+            evicted = conns.front().fd;
+            conns.erase(conns.begin());
+        }
+        if (evicted != fd) conns.push_back({fd, Clock::now()});
+    }
+    if (evicted >= 0) ::close(evicted);
+}
+
+HttpClient::Outcome HttpClient::RoundTrip(int fd, const std::string& request, Clock::time_point deadline, HttpResult& result,
+                                          bool& keep_alive) {
+    // 复用的连接被对端关闭时, 发送可能仍成功 (写进内核缓冲), 失败体现在读不到任何响应字节
+    if (!SendAll(fd, request, deadline)) return Outcome::kRetryable;
+
+    std::string buf;
+    ssize_t last_read = 0;
+    auto read_more = [&] {
+        last_read = ReadSome(fd, buf, deadline);
+        return last_read > 0 && buf.size() <= options_.max_response_bytes + kMaxHeaderBytes;
+    };
+
+    size_t header_end;
+    size_t scan = 0;
+    while ((header_end = buf.find("\r\n\r\n", scan)) == std::string::npos) {
+        if (buf.size() > kMaxHeaderBytes) return Outcome::kFailed;
+        scan = buf.size() >= 3 ? buf.size() - 3 : 0;
+        if (!read_more()) {
+            bool nothing_received = buf.empty() && (last_read == 0 || last_read == -1);
+            return nothing_received ? Outcome::kRetryable : Outcome::kFailed;
+        }
+    }
+
+    // 状态行: HTTP/1.1 200 OK
+    std::string_view head(buf.data(), header_end);
+    size_t line_end = head.find("\r\n");
+    std::string_view status_line = head.substr(0, line_end);
+    if (status_line.size() < 12 || status_line.compare(0, 5, "HTTP/") != 0) return Outcome::kFailed;
+    bool close = status_line.compare(5, 3, "1.1") != 0;
+    result.status = 0;
+    for (size_t i = 9; i < 12; ++i) {
+        if (status_line[i] < '0' || status_line[i] > '9') return Outcome::kFailed;
+        result.status = result.status * 10 + (status_line[i] - '0');
+    }
+
+    int64_t content_length = -1;
+    bool chunked = false;
+    while (line_end != std::string_view::npos) {
+        size_t begin = line_end + 2;
+        line_end = head.find("\r\n", begin);
+        std::string_view line = head.substr(begin, line_end == std::string_view::npos ? std::string_view::npos : line_end - begin);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = Trim(line.substr(0, colon));
+        std::string_view value = Trim(line.substr(colon + 1));
+        if (IEquals(name, "Content-Length")) {
+            content_length = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9' || content_length > static_cast<int64_t>(options_.max_response_bytes)) return Outcome::kFailed;
+                content_length = content_length * 10 + (c - '0');
+            }
+        } else if (IEquals(name, "Transfer-Encoding")) {
+            chunked = IContains(value, "chunked");
+        } else if (IEquals(name, "Connection")) {
+            if (IContains(value, "close")) {
+                close = true;
+            } else if (IContains(value, "keep-alive")) {
+                close = false;
+            }
+        }
+    }
+
+    size_t pos = header_end + 4;
+    if (result.status / 100 == 1 || result.status == 204 || result.status == 304) {
+        keep_alive = !close && pos == buf.size();
+        return Outcome::kOk;
+    }
+
+    if (chunked) {
+        while (true) {
+            size_t eol;
+            while ((eol = buf.find("\r\n", pos)) == std::string::npos) {
+                if (!read_more()) return Outcome::kFailed;
+            }
+            size_t size;
+            if (!ParseChunkSize(std::string_view(buf).substr(pos, eol - pos), size)) return Outcome::kFailed;
+            pos = eol + 2;
+            if (size == 0) {
+                // 可选的 trailer, 以空行结束
+                while (true) {
+                    while ((eol = buf.find("\r\n", pos)) == std::string::npos) {
+                        if (!read_more()) return Outcome::kFailed;
+                    }
+                    bool empty = eol == pos;
+                    pos = eol + 2;
+                    if (empty) break;
+                }
+                break;
+            }
+            if (result.body.size() + size > options_.max_response_bytes) return Outcome::kFailed;
+            while (buf.size() < pos + size + 2) {
+                if (!read_more()) return Outcome::kFailed;
+            }
+            result.body.append(buf, pos, size);
+            if (buf.compare(pos + size, 2, "\r\n") != 0) return Outcome::kFailed;
+            pos += size + 2;
+            // 丢掉已解码的部分, buf 不随响应体增长
+            if (pos >= 64 * 1024) {
+                buf.erase(0, pos);
+                pos = 0;
+            }
+        }
+        if (pos != buf.size()) close = true;
+    } else if (content_length >= 0) {
+        size_t length = static_cast<size_t>(content_length);
+        buf.reserve(pos + length);
+        while (buf.size() - pos < length) {
+            if (!read_more()) return Outcome::kFailed;
+        }
+        if (buf.size() - pos > length) close = true;
+        buf.erase(0, pos);
+        buf.resize(length);
+        result.body = std::move(buf);
+    } else {
+        // 既无长度也非 chunked: 读到连接关闭
+        while (read_more()) {}
+        if (last_read != 0) return Outcome::kFailed;
+        result.body = buf.substr(pos);
+        close = true;
+    }
+    keep_alive = !close;
+    return Outcome::kOk;
+}
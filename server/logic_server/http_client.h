@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+#include "../../common/metrics/metrics.h"
+
+struct HttpClientOptions {
+    int connect_timeout_ms = 1000;
+    int request_timeout_ms = 3000;       // 从发出请求到读完响应
+    size_t max_idle_per_endpoint = 8;    // 每个 host:port 保留的空闲连接上限
+    int idle_timeout_sec = 30;           // 空闲超过此时间的连接不再复用 (SeaweedFS 默认 keep-alive 更长)
+    int dns_ttl_sec = 60;
+    size_t max_response_bytes = 4 << 20;
+};
+
+struct HttpResult {
+    int status = 0;
+    std::string body;
+};
+
+// 最小 HTTP/1.1 客户端 (只有 GET), 供 S3Client 访问 SeaweedFS master / volume.
+//
+// 每个 host:port 维护一组 keep-alive 连接, 响应按 Content-Length 或 chunked 读完后连接放回空闲池;
+// 地址用 getaddrinfo 解析并按 dns_ttl_sec 缓存. socket 为非阻塞, 连接与读写都用 poll 控制超时.
+// 复用的空闲连接可能已被服务端关闭: 请求在收到任何响应字节前失败时, 换新连接重试一次 (GET 幂等).
+// 线程安全, 多个线程可并发调用 Get.
+class HttpClient {
+public:
+    // name 用作指标的 client 标签
+    explicit HttpClient(const std::string& name, const HttpClientOptions& options = HttpClientOptions());
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // 连接失败、超时、响应格式错误返回 false; 非 2xx 状态码仍返回 true, 由调用方判断
+    bool Get(const std::string& host, int port, const std::string& path, HttpResult& result);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct IdleConn {
+        int fd;
+        Clock::time_point since;
+    };
+
+    struct Address {
+        sockaddr_storage addr;
+        socklen_t len;
+    };
+
+    struct ResolveEntry {
+        std::vector<Address> addrs;
+        Clock::time_point expires;
+    };
+
+    enum class Outcome { kOk, kRetryable, kFailed };
+
+    bool Resolve(const std::string& host, int port, std::vector<Address>& addrs);
+    int Connect(const std::string& host, int port, Clock::time_point deadline);
+    int TakeIdle(const std::string& endpoint);
+    void PutIdle(const std::string& endpoint, int fd);
+    Outcome RoundTrip(int fd, const std::string& request, Clock::time_point deadline, HttpResult& result, bool& keep_alive);
+
+    const std::string name_;
+    HttpClientOptions options_;
+
+    std::mutex mu_;
+    std::unordered_map<std::string, std::vector<IdleConn>> idle_;   // "host:port" -> 空闲连接, 尾部最新
+    std::unordered_map<std::string, ResolveEntry> resolved_;
+
+    metrics::Counter* connects_;
+    metrics::Counter* reuses_;
+    metrics::Counter* failures_;
+};
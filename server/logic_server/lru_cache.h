@@ -0,0 +1,78 @@
+#pragma once
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+// 容量固定的 LRU 缓存, 按 key 哈希分成若干分片, 每片一把锁, 降低并发 Get/Put 的锁竞争.
+//
+// 每片是 list (按最近使用排序, 头部最新) + unordered_map (key -> list 节点); map 的 key 是指向
+// list 节点内字符串的 string_view, key 只存一份. 总容量按分片均分, 超出时淘汰该分片最久未用的项.
+template <typename V>
+class ShardedLruCache {
+public:
+    explicit ShardedLruCache(size_t capacity, size_t shard_count = 16)
+        : shard_count_(shard_count > 0 ? shard_count : 1), shards_(new Shard[shard_count_]) {
+        size_t per_shard = (capacity + shard_count_ - 1) / shard_count_;
+        for (size_t i = 0; i < shard_count_; ++i) shards_[i].capacity = per_shard > 0 ? per_shard : 1;
+    }
+
+    ShardedLruCache(const ShardedLruCache&) = delete;
+    ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+
+    // 命中时复制到 out 并把该项移到最新
+    bool Get(const std::string& key, V& out) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lk(shard.mu);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) return false;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        out = it->second->second;
+        return true;
+    }
+
+    void Put(const std::string& key, V value) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lk(shard.mu);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            it->second->second = std::move(value);
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            return;
+        }
+        if (shard.index.size() >= shard.capacity) {
+            shard.index.erase(shard.entries.back().first);
+            shard.entries.pop_back();
+        }
+        shard.entries.emplace_front(key, std::move(value));
+        shard.index.emplace(shard.entries.front().first, shard.entries.begin());
+    }
+
+    size_t Size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::lock_guard<std::mutex> lk(shards_[i].mu);
+            total += shards_[i].index.size();
+        }
+        return total;
+    }
+
+private:
+    using Entry = std::pair<std::string, V>;
+
+    struct Shard {
+        mutable std::mutex mu;
+        size_t capacity = 1;
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, typename std::list<Entry>::iterator> index;
+    };
+
+    Shard& ShardFor(const std::string& key) { return shards_[std::hash<std::string>()(key) % shard_count_]; }
+
+    const size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+};
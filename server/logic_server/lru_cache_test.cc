@@ -0,0 +1,79 @@
+// ShardedLruCache 的命中、按最近使用淘汰、覆盖写和并发访问
+#include "lru_cache.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../common/test/check.h"
+
+namespace {
+
+void TestEvictsLeastRecentlyUsed() {
+    ShardedLruCache<int> cache(3, 1);
+    cache.Put("a", 1);
+    cache.Put("b", 2);
+    cache.Put("c", 3);
+    int v = 0;
+    // 访问 a 后 b 成为最久未用
+    CHECK(cache.Get("a", v) && v == 1);
+    cache.Put("d", 4);
+    CHECK(cache.Size() == 3);
+    CHECK(!cache.Get("b", v));
+    CHECK(cache.Get("a", v) && v == 1);
+    CHECK(cache.Get("c", v) && v == 3);
+    CHECK(cache.Get("d", v) && v == 4);
+}
+
+void TestOverwrite() {
+    ShardedLruCache<std::string> cache(2, 1);
+    cache.Put("a", "x");
+    cache.Put("b", "y");
+    // 覆盖不增加条目, 并把 a 移到最新
+    cache.Put("a", "z");
+    CHECK(cache.Size() == 2);
+    cache.Put("c", "w");
+    std::string v;
+    CHECK(cache.Get("a", v) && v == "z");
+    CHECK(!cache.Get("b", v));
+    CHECK(cache.Get("c", v) && v == "w");
+}
+
+void TestCapacitySplitAcrossShards() {
+    ShardedLruCache<int> cache(64, 16);
+    for (int i = 0; i < 10000; ++i) cache.Put("key" + std::to_string(i), i);
+    // 每片 4 条, 总数不超过 16 * 4
+    CHECK(cache.Size() <= 64);
+    CHECK(cache.Size() > 0);
+    int v = -1;
+    CHECK(cache.Get("key9999", v) && v == 9999);
+
+    // 容量小于分片数时每片至少 1 条
+    ShardedLruCache<int> tiny(1, 4);
+    tiny.Put("only", 7);
+    CHECK(tiny.Get("only", v) && v == 7);
+}
+
+void TestConcurrentAccess() {
+    ShardedLruCache<int> cache(1000, 8);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 20000; ++i) {
+                std::string key = "k" + std::to_string((i * 7 + t) % 2000);
+                int v = 0;
+                if (!cache.Get(key, v)) cache.Put(key, i);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    CHECK(cache.Size() <= 1000);
+}
+
+}  // namespace
+
+int main() {
+    TestEvictsLeastRecentlyUsed();
+    TestOverwrite();
+    TestCapacitySplitAcrossShards();
+    TestConcurrentAccess();
+    return test::Report();
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 #include <grpcpp/grpcpp.h>
 #include <spdlog/spdlog.h>
@@ -13,10 +14,28 @@
 #include "redis_pool.h"
 #include "pool_db_client.h"
 #include "pool_redis_client.h"
+#include "replica_router.h"
+#include "shard_router.h"
+#include "gateway_directory.h"
+#include "delivery_cursor.h"
+#include "send_dedup.h"
+#include "metrics_server.h"
+#include "push_packet.h"
+#include "storage.h"
+#include "embedded_store.h"
+#include "password_hasher.h"
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <unordered_map>
 #include "s3_client.h"
 #include "../../common/config/config.h"
+#include "../../common/config/config_watcher.h"
+#include "../../common/auth/session_token.h"
+#include "../../common/presence/gateway_registry.h"
+#include "../../common/metrics/metrics.h"
+#include "../../common/trace/trace.h"
+#include "../../common/log/logging.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -28,154 +47,252 @@ using im::LoginRes;
 using im::MsgSendReq; 
 using im::MsgSendRes;
 
-std::string PackPushMsg(const im::ChatMsg& chat_msg) {
+// 每个 RPC 方法一个延迟直方图, 处理函数内用 static 缓存指针, 热路径不经过注册表
+metrics::Histogram* RpcLatency(const char* method){
+    return metrics::Registry::Instance().GetHistogram("im_logic_rpc_seconds" , "Logic server gRPC handler latency" , {{"method" , method}});
+}
 
-    im::MsgPush push_pkg;
-    *push_pkg.mutable_msg() = chat_msg;
-    
-    std::string body_bytes;
-    push_pkg.SerializeToString(&body_bytes);
-
-    uint32_t total_len = 12 + body_bytes.size();
-    uint16_t version = 1;
-    uint16_t cmd_id = 0x1005;
-    uint32_t seq_id = 0;      
-
-    uint32_t net_len = htonl(total_len);
-    uint16_t net_ver = htons(version);
-    uint16_t net_cmd = htons(cmd_id);
-    uint32_t net_seq = htonl(seq_id);
-
-    std::string packet;
-    packet.append((char*)&net_len, 4);
-    packet.append((char*)&net_ver, 2);
-    packet.append((char*)&net_cmd, 2);
-    packet.append((char*)&net_seq, 4);
-    packet.append(body_bytes);
-
-    return packet;
+// 模块 logger, RunServer 中初始化异步日志后赋值
+std::shared_ptr<spdlog::logger> rpc_log;
+std::shared_ptr<spdlog::logger> push_log;
+
+// 网关只给采样中的请求带 trace id
+uint64_t TraceIdFromMetadata(const grpc::ServerContextBase* context){
+    const auto& metadata = context->client_metadata();
+    auto it = metadata.find(trace::kTraceIdMetadataKey);
+    if(it == metadata.end()) return 0;
+    return trace::ParseTraceId(std::string_view(it->second.data() , it->second.size()));
 }
 
-class LogicServiceImpl final : public LogicService::Service{
+// RPC 处理函数的公共入口: 记录处理延迟, 恢复网关传来的追踪上下文并把整个处理过程记为一个 span
+class RpcScope{
 public:
-    LogicServiceImpl(PooledRedisClient* redis_pool , PooledDbClient* db_pool , S3Client* s3) : redis_pool_(redis_pool),db_pool_(db_pool),s3_(s3){}
+    RpcScope(const grpc::ServerContextBase* context , const char* span_name , metrics::Histogram* latency)
+        : timer_(latency) , trace_(TraceIdFromMetadata(context)) , span_(span_name){}
+private:
+    metrics::ScopedTimer timer_;
+    trace::ScopedTrace trace_;
+    trace::Span span_;
+};
 
-    Status Login(ServerContext* context , const LoginReq* request , LoginRes* reply) override {
-        spdlog::info("PRC Login Request: Uid= {} , token = {} , device = {}" , request->uid() , request->token() , request->device_id());
-        std::string db_password = db_pool_->GetUserPassword(request->uid());
-        if(!db_password.empty() && db_password == request->token()){
-            reply->set_err_code(im::ERR_SUCCESS);
-            reply->set_session_id("sess_"+ std::to_string(request->uid()));
+// 需要计算口令哈希的三个方法用回调接口, 在 PasswordHasher 的线程池上完成 (Login 的签名令牌分支也是), 其余方法仍是同步处理
+using LogicServiceBase = LogicService::WithCallbackMethod_Login<
+    LogicService::WithCallbackMethod_RegisterUser<LogicService::WithCallbackMethod_HttpLogin<LogicService::Service>>>;
 
-            std::string redis_key = "IM:USER:SESS" + std::to_string(request->uid());
-            std::string gateway_addr = "0.0.0.0:50052";
+class LogicServiceImpl final : public LogicServiceBase{
+public:
+    LogicServiceImpl(KvClient* redis_pool , DbClient* db_pool , S3Client* s3 , const SessionTokenCodec* token_codec ,
+                     GatewayDirectory* gateways , DeliveryCursor* cursor , PasswordHasher* hasher , SendDedup* send_dedup)
+        : redis_pool_(redis_pool),db_pool_(db_pool),s3_(s3),token_codec_(token_codec),gateways_(gateways),cursor_(cursor),hasher_(hasher),
+          send_dedup_(send_dedup){}
+
+    // 网关会在本地校验签名令牌, 只有旧客户端(密码当 token)或网关无法判定时才会走到这里
+    grpc::ServerUnaryReactor* Login(grpc::CallbackServerContext* context , const LoginReq* request , LoginRes* reply) override {
+        static metrics::Histogram* latency = RpcLatency("Login");
+        rpc_log->debug("PRC Login Request: Uid= {} , device = {}" , request->uid() , request->device_id());
+        // 签名令牌不用算哈希, 但吊销检查和路由登记要访问 Redis, 同样不能阻塞回调线程
+        if(SessionTokenCodec::LooksSigned(request->token())){
+            return RunOnHasher(context , reply , "logic.Login" , latency , [this , context , request , reply]{
+                FinishLogin(context , request , reply , VerifySessionToken(request->uid() , request->device_id() , request->token()));
+            });
+        }
+        return RunOnHasher(context , reply , "logic.Login" , latency , [this , context , request , reply]{
+            std::string stored = db_pool_->GetUserPassword(request->uid());
+            bool needs_rehash = false;
+            bool authed = !stored.empty() && hasher_->Verify(request->token() , stored , &needs_rehash);
+            if(authed && needs_rehash){
+                UpgradePassword(request->uid() , request->token());
+            }
+            FinishLogin(context , request , reply , authed);
+        });
+    }
 
-            if(redis_pool_->Set(redis_key , gateway_addr)){
-                spdlog::info("->Login Success : Uid = {}", request->uid());
+    void FinishLogin(const grpc::ServerContextBase* context , const LoginReq* request , LoginRes* reply , bool authed){
+        if(authed){
+            reply->set_err_code(im::ERR_SUCCESS);
+            reply->set_session_id("sess_"+ std::to_string(request->uid()));
+            reply->set_server_time(time(nullptr));
+
+            // 会话路由登记到发起调用的网关, 推送时再经网关租约解析地址
+            const auto& metadata = context->client_metadata();
+            auto gateway_it = metadata.find(kGatewayIdMetadataKey);
+            if(gateway_it == metadata.end()){
+                static logging::RateLimit limit(10);
+                logging::Limited(limit , rpc_log , spdlog::level::warn , "->Login Success : Uid = {} , but caller sent no gateway id, route not recorded", request->uid());
+            }
+            else{
+                std::string gateway_id(gateway_it->second.data() , gateway_it->second.size());
+                if(redis_pool_->Set(UserSessionKey(request->uid()) , gateway_id)){
+                    rpc_log->debug("->Login Success : Uid = {} , gateway = {}", request->uid(), gateway_id);
+                }
             }
         }
         else{
             reply->set_err_code(im::ErrorCode::ERR_AUTH_FAIL);
             reply->set_err_msg("Invalid token");
-            spdlog::info("->Login Failed: uid = {}" , request->uid());
+            rpc_log->debug("->Login Failed: uid = {}" , request->uid());
         }
-        return Status::OK;
     }
     Status SendMsg(ServerContext* context , const MsgSendReq* request , MsgSendRes* reply) override {
+        static metrics::Histogram* latency = RpcLatency("SendMsg");
+        RpcScope scope(context , "logic.SendMsg" , latency);
         const auto& msg = request->msg();
+        // 超时重发: 返回首次的结果, 不再入库和推送. seq_id 为 0 (旧网关) 时不去重
+        const bool dedup = request->seq_id() != 0;
+        const uint64_t fingerprint = dedup ? SendDedup::Fingerprint(msg.to_uid() , msg.content()) : 0;
+        SendResult sent;
+        if(dedup){
+            SendDedup::Source source = send_dedup_->Lookup(msg.from_uid() , request->device_id() , request->seq_id() , fingerprint , sent);
+            if(source != SendDedup::Source::NEW){
+                return ReplyDuplicate(reply , sent , source);
+            }
+        }
         if(!db_pool_->AreFriends(msg.from_uid() , msg.to_uid())){
             reply->set_err_code(im::ErrorCode::ERR_NOT_FRIEND);
             reply->set_err_msg("You must be friend to send message");
-            spdlog::info("->SendMsg blocked : {} -> {} not friends" , msg.from_uid() , msg.to_uid());
+            rpc_log->debug("->SendMsg blocked : {} -> {} not friends" , msg.from_uid() , msg.to_uid());
             return Status::OK;
         }
-        spdlog::info("RPC sendMsg: from={} to={} content={}" , msg.from_uid() , msg.to_uid() , msg.content());
+        // 正文只在 debug 级别格式化
+        rpc_log->debug("RPC sendMsg: from={} to={} content={}" , msg.from_uid() , msg.to_uid() , msg.content());
         
         int64_t msg_id = std::chrono::system_clock::now().time_since_epoch().count();
-       
-        bool saved = db_pool_->SaveMessage(std::to_string(msg_id) , msg.from_uid() , msg.to_uid() , msg.content());
-        if(!saved){
-            spdlog::error("failed to save messahe to DB");
+        sent.msg_id = msg_id;
+        sent.create_time = time(nullptr);
+        if(dedup){
+            SendDedup::Source source = send_dedup_->Claim(msg.from_uid() , request->device_id() , request->seq_id() , fingerprint , sent);
+            if(source != SendDedup::Source::NEW){
+                return ReplyDuplicate(reply , sent , source);
+            }
         }
 
-        std::string redis_key = "IM:USER:SESS:" + std::to_string(msg.to_uid());
-        auto gateway_addr_opt = redis_pool_->Get(redis_key);
-
-        if(gateway_addr_opt.has_value()){
-            std::string gateway_addr = gateway_addr_opt.value();
-            spdlog::info("->Found target user {} at gateway[{}]" , msg.to_uid() , gateway_addr_opt.value());
-            auto channel = grpc::CreateChannel(gateway_addr , grpc::InsecureChannelCredentials());
-            auto stub = im::GatewayService::NewStub(channel);
-
-            im::PushMsgReq push_req;
-            push_req.set_to_uid(msg.to_uid());
-
-            std::string raw_packet = PackPushMsg(msg);
-            push_req.set_content(raw_packet);
-
-            im::PushMsgRes push_res;
-            grpc::ClientContext client_context;
-            client_context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(2));
-
-            grpc::Status status = stub->PushMsg(&client_context , push_req , &push_res);
-            
-            if (status.ok() && push_res.err_code() == 0) {
-                spdlog::info("--> Push to Gateway Success!");
-            } else {
-                spdlog::warn("--> Push to Gateway Failed: {} ({})", status.error_message(), push_res.err_msg());
+        int64_t seq = db_pool_->SaveMessage(std::to_string(msg_id) , msg.from_uid() , msg.to_uid() , msg.content());
+        if(seq <= 0){
+            static logging::RateLimit limit(10);
+            logging::Limited(limit , rpc_log , spdlog::level::err , "failed to save message to DB: to_uid = {}" , msg.to_uid());
+            // 撤销登记, 客户端重发时按新消息重新入库
+            if(dedup) send_dedup_->Release(msg.from_uid() , request->device_id() , request->seq_id() , fingerprint);
+            reply->set_err_code(im::ErrorCode::ERR_SYS_ERROR);
+            reply->set_err_msg("failed to save message");
+            return Status::OK;
+        }
+        if(dedup) send_dedup_->Commit(msg.from_uid() , request->device_id() , request->seq_id() , fingerprint , sent);
+
+        GatewayDirectory::Target target;
+        if(gateways_->Resolve(msg.to_uid() , target)){
+            push_log->debug("->Found target user {} at gateway {}[{}]" , msg.to_uid() , target.gateway_id , target.address);
+
+            // 只入队, 由到该网关的推送流批量发送; 投递失败的消息由客户端离线同步补齐
+            // 推送包带上 msg_id, 客户端据此确认与去重
+            im::ChatMsg push_msg = msg;
+            push_msg.set_msg_id(msg_id);
+            push_msg.set_create_time(sent.create_time);
+            push_msg.set_seq(seq);
+            if(target.stream->Push(msg.to_uid() , msg_id , PackPushMsg(push_msg))){
+                push_log->debug("--> Push queued to gateway stream");
+            }
+            else{
+                static logging::RateLimit limit(10);
+                logging::Limited(limit , push_log , spdlog::level::warn , "--> Push to Gateway {} rejected (stream unavailable or full)", target.address);
             }
         }
         else{
-            spdlog::warn("->Target user {} is offline(reids key not found)" , msg.to_uid());
+            push_log->debug("->Target user {} is offline(no session route or gateway lease)" , msg.to_uid());
 
         }
         reply->set_err_code(im::ErrorCode::ERR_SUCCESS);
         reply->set_msg_id(msg_id);
-        reply->set_create_time(time(nullptr));
+        reply->set_create_time(sent.create_time);
 
         return Status::OK;
     }
     Status SyncMsg(ServerContext* context , const im::SyncMsgReq* request , im::SyncMsgRes* reply) override{
-        spdlog::info("RPC SyncMsg: Uid={} lastMsgID={}",request->uid() , request->last_msg_id());
+        static metrics::Histogram* latency = RpcLatency("SyncMsg");
+        RpcScope scope(context , "logic.SyncMsg" , latency);
+        rpc_log->debug("RPC SyncMsg: Uid={} lastSeq={}",request->uid() , request->last_seq());
 
-        std::vector<im::ChatMsg> history_msgs = db_pool_->GetofflineMsgs(request->uid() , request->last_msg_id());
+        // 只返回已送达游标之后仍未确认的消息
+        std::vector<im::ChatMsg> history_msgs = cursor_->Unacked(request->uid() , request->last_seq());
 
         reply->set_err_code(im::ERR_SUCCESS);
         for(const auto& msg : history_msgs){
             *reply->add_msgs() = msg;
         }
-        spdlog::info("->Synced {} message to UID={}" , history_msgs.size() , request->uid());
+        rpc_log->debug("->Synced {} message to UID={}" , history_msgs.size() , request->uid());
         return Status::OK;
     }
-    Status RegisterUser(ServerContext* context , const im::RegisterReq* request , im::RegisterRes* reply) override{
-        spdlog::info("RPC Register : emial={} nick={}",request->email() , request->nickname());
-
-        int64_t uid = db_pool_->CreateUser(request->nickname() , request->password() , request->email());
-        if(uid > 0){
-            reply->set_err_code(0);
-            reply->set_uid(uid);
-            spdlog::info("User created: uid={}" , uid);
-        }else{
-            reply->set_err_code(1);
-            reply->set_err_msg("create user failed");
+    Status ReportAcks(ServerContext* context , const im::MsgAckReport* request , im::MsgAckReportRes* reply) override{
+        static metrics::Histogram* latency = RpcLatency("ReportAcks");
+        RpcScope scope(context , "logic.ReportAcks" , latency);
+        for(const auto& acks : request->acks()){
+            cursor_->OnAcked(acks.uid() , std::vector<int64_t>(acks.msg_ids().begin() , acks.msg_ids().end()));
         }
+        reply->set_err_code(im::ERR_SUCCESS);
         return Status::OK;
     }
-    Status HttpLogin(ServerContext* context , const im::HttpLoginReq* request , im::HttpLoginRes* reply) override {
-        spdlog::info("RPC Httplogin: emial={}",request->email());
-        if(db_pool_->CheckUserByEmail(request->email() , request->password() , *reply)){
-            reply->set_err_code(0);
-            spdlog::info("User login sucess : uid={}",reply->uid());
-            redis_pool_->Set("IM:USER:TOKEN"+std::to_string(reply->uid()) , request->password());
-        }else{
-            reply->set_err_code(1);
-            reply->set_err_msg("Invaild email or passwrod");
-            spdlog::warn("User login failed : email={}",request->email());
+    grpc::ServerUnaryReactor* RegisterUser(grpc::CallbackServerContext* context , const im::RegisterReq* request , im::RegisterRes* reply) override{
+        static metrics::Histogram* latency = RpcLatency("RegisterUser");
+        rpc_log->info("RPC Register : emial={} nick={}",request->email() , request->nickname());
+        return RunOnHasher(context , reply , "logic.RegisterUser" , latency , [this , request , reply]{
+            std::string hashed = hasher_->Hash(request->password());
+            int64_t uid = hashed.empty() ? -1 : db_pool_->CreateUser(request->nickname() , hashed , request->email());
+            if(uid > 0){
+                reply->set_err_code(0);
+                reply->set_uid(uid);
+                rpc_log->info("User created: uid={}" , uid);
+            }else{
+                reply->set_err_code(1);
+                reply->set_err_msg("create user failed");
+            }
+        });
+    }
+    grpc::ServerUnaryReactor* HttpLogin(grpc::CallbackServerContext* context , const im::HttpLoginReq* request , im::HttpLoginRes* reply) override {
+        static metrics::Histogram* latency = RpcLatency("HttpLogin");
+        rpc_log->info("RPC Httplogin: emial={}",request->email());
+        return RunOnHasher(context , reply , "logic.HttpLogin" , latency , [this , request , reply]{
+            UserCredential credential;
+            bool needs_rehash = false;
+            if(db_pool_->GetUserByEmail(request->email() , credential) &&
+               hasher_->Verify(request->password() , credential.password , &needs_rehash)){
+                if(needs_rehash){
+                    UpgradePassword(credential.uid , request->password());
+                }
+                reply->set_err_code(0);
+                reply->set_uid(credential.uid);
+                reply->set_nickname(credential.nickname);
+                reply->set_token(token_codec_->Issue(credential.uid , request->device_id()));
+                rpc_log->info("User login sucess : uid={}",credential.uid);
+            }else{
+                reply->set_err_code(1);
+                reply->set_err_msg("Invaild email or passwrod");
+                static logging::RateLimit limit(10);
+                logging::Limited(limit , rpc_log , spdlog::level::warn , "User login failed : email={}",request->email());
+            }
+        });
+    }
+    Status Logout(ServerContext* context , const im::LogoutReq* request , im::LogoutRes* reply) override {
+        static metrics::Histogram* latency = RpcLatency("Logout");
+        RpcScope scope(context , "logic.Logout" , latency);
+        SessionToken token;
+        if(token_codec_->Verify(request->token() , token) != SessionTokenCodec::VerifyResult::OK || token.uid != request->uid()){
+            reply->set_err_code(im::ERR_AUTH_FAIL);
+            reply->set_err_msg("Invalid token");
+            return Status::OK;
         }
+        // 吊销该用户此刻之前签发的全部令牌, 网关按 revocation_refresh_sec 周期拉取
+        if(!redis_pool_->HSet(kRevokedTokensKey , std::to_string(request->uid()) , std::to_string(NowMs()))){
+            reply->set_err_code(im::ERR_SYS_ERROR);
+            reply->set_err_msg("Revoke failed");
+            return Status::OK;
+        }
+        reply->set_err_code(im::ERR_SUCCESS);
+        rpc_log->info("User logout : uid={}" , request->uid());
         return Status::OK;
     }
     Status GetUploadUrl(ServerContext* context , const im::GetUploadUrlReq* request, im::GetUploadUrlRes* reply){
-        spdlog::info("RPC GetUploadUrl UID={} File={}" , request->uid() , request->file_name());
+        static metrics::Histogram* latency = RpcLatency("GetUploadUrl");
+        RpcScope scope(context , "logic.GetUploadUrl" , latency);
+        rpc_log->info("RPC GetUploadUrl UID={} File={}" , request->uid() , request->file_name());
         int64_t now = std::chrono::system_clock::now().time_since_epoch().count();
         std::string object_key = std::to_string(request->uid()) + "/" + std::to_string(now) + "_" + request->file_name();
         std::string upload_url = s3_->GetPresignedPutUrl(object_key);
@@ -184,7 +301,7 @@ public:
         if (upload_url.empty() || download_url.empty()) {
             reply->set_err_code(im::ERR_SYS_ERROR);
             reply->set_err_msg("SeaweedFS unavailable");
-            spdlog::error("-> Failed to generate upload/download URL for {}", object_key);
+            rpc_log->error("-> Failed to generate upload/download URL for {}", object_key);
             return Status::OK;
         }
 
@@ -192,42 +309,47 @@ public:
         reply->set_upload_url(upload_url);
         reply->set_download_url(download_url);
 
-        spdlog::info("-> Generated Upload URL for {}", object_key);
+        rpc_log->info("-> Generated Upload URL for {}", object_key);
         return Status::OK;
     }
     Status SendFriendRequest(ServerContext* context , const im::SendFriendReq* req , im::SendFriendRes* reply) override {
-        spdlog::info("PRC SendFriendRequest : from={} to={} reason={}",req->from_uid() , req->to_uid() , req->reason());
+        static metrics::Histogram* latency = RpcLatency("SendFriendRequest");
+        RpcScope scope(context , "logic.SendFriendRequest" , latency);
+        rpc_log->info("PRC SendFriendRequest : from={} to={} reason={}",req->from_uid() , req->to_uid() , req->reason());
         int64_t req_id = 0;
         if(db_pool_->CreateFriendRequest(req->from_uid() , req->to_uid() , req->reason() , req_id)){
             reply->set_err_code(im::ErrorCode::ERR_SUCCESS);
             reply->set_req_id(req_id);
-            spdlog::info("->Friend request created: id={}" , req_id);
+            rpc_log->info("->Friend request created: id={}" , req_id);
         }else{
             reply->set_err_code(im::ErrorCode::ERR_SYS_ERROR);
             reply->set_err_msg("Failed to create friend request");
-            spdlog::error("->Failed to create friend request from {} to {}" , req->from_uid() , req->to_uid());
+            rpc_log->error("->Failed to create friend request from {} to {}" , req->from_uid() , req->to_uid());
         }
         return Status::OK;
     }
     Status RespondFriendRequest(ServerContext* context , const im::RespondFriendReq* req , im::RespondFriendRes* reply) override{
-        spdlog::info("RPC RespondFriendRequest: req_id={} accept={} " , req->req_id() , req->accept());
+        static metrics::Histogram* latency = RpcLatency("RespondFriendRequest");
+        RpcScope scope(context , "logic.RespondFriendRequest" , latency);
+        rpc_log->info("RPC RespondFriendRequest: req_id={} accept={} " , req->req_id() , req->accept());
         if(req->accept()){
             if(db_pool_->AcceptFriendRequest(req->req_id())){
                 reply->set_err_code(im::ErrorCode::ERR_SUCCESS);
-                spdlog::info("Friend request accepted : req_id = {}" , req->req_id());
+                rpc_log->info("Friend request accepted : req_id = {}" , req->req_id());
             }else{
                 reply->set_err_code(im::ErrorCode::ERR_SYS_ERROR);
                 reply->set_err_msg("Failed to accept friend request");
             }
         }else{
-            std::string sql = "UPDATE t_friend_request SET status=2 WHERE id=" + std::to_string(req->req_id());
-            db_pool_->Execute(sql);
+            db_pool_->RejectFriendRequest(req->req_id());
             reply->set_err_code(im::ERR_SUCCESS);
         }
         return Status::OK;
     }
 
     Status ListFriends(ServerContext* context, const im::FriendListReq* request, im::FriendListRes* reply) override {
+        static metrics::Histogram* latency = RpcLatency("ListFriends");
+        RpcScope scope(context , "logic.ListFriends" , latency);
     auto list = db_pool_->ListFriends(request->uid());
     reply->set_err_code(im::ERR_SUCCESS);
     for(auto f : list) reply->add_friend_uids(f);
@@ -235,6 +357,8 @@ public:
     }
 
     Status GetFriendRequests(ServerContext* context, const im::GetFriendReqsReq* request, im::GetFriendReqsRes* reply) override {
+        static metrics::Histogram* latency = RpcLatency("GetFriendRequests");
+        RpcScope scope(context , "logic.GetFriendRequests" , latency);
     auto reqs = db_pool_->GetFriendRequestsForUser(request->uid());
     reply->set_err_code(im::ERR_SUCCESS);
     for(const auto& r : reqs){
@@ -243,9 +367,202 @@ public:
     return Status::OK;
 }
     private:
-        PooledRedisClient* redis_pool_;
-        PooledDbClient* db_pool_;
+        bool VerifySessionToken(int64_t uid , const std::string& device_id , const std::string& raw_token){
+            SessionToken token;
+            if(token_codec_->Verify(raw_token , token) != SessionTokenCodec::VerifyResult::OK ||
+               !SessionTokenCodec::Matches(token , uid , device_id)){
+                return false;
+            }
+            auto not_before = redis_pool_->HGet(kRevokedTokensKey , std::to_string(uid));
+            return !not_before.has_value() ||
+                   !RevokedBy(token.issued_at , NotBeforeMs(std::strtoll(not_before->c_str() , nullptr , 10)));
+        }
+
+        // 把口令相关的处理放到哈希线程池上执行, 完成后回复; 排队已满时不入队, 直接回复繁忙
+        template <typename Reply , typename Fn>
+        grpc::ServerUnaryReactor* RunOnHasher(grpc::CallbackServerContext* context , Reply* reply , const char* span_name ,
+                                              metrics::Histogram* latency , Fn fn){
+            auto* reactor = context->DefaultReactor();
+            uint64_t trace_id = TraceIdFromMetadata(context);
+            metrics::Stopwatch timer;
+            bool queued = hasher_->Submit([reactor , trace_id , timer , span_name , latency , fn]{
+                {
+                    trace::ScopedTrace trace_ctx(trace_id);
+                    trace::Span span(span_name);
+                    fn();
+                }
+                latency->ObserveUs(timer.ElapsedUs());
+                reactor->Finish(Status::OK);
+            });
+            if(!queued){
+                reply->set_err_code(im::ERR_SYS_ERROR);
+                reply->set_err_msg("Server busy, retry later");
+                static logging::RateLimit limit(10);
+                logging::Limited(limit , rpc_log , spdlog::level::warn , "{} rejected: password hash queue full" , span_name);
+                latency->ObserveUs(timer.ElapsedUs());
+                reactor->Finish(Status::OK);
+            }
+            return reactor;
+        }
+
+        // 明文或低参数的口令在校验通过后按当前参数重算, 失败不影响本次登录
+        void UpgradePassword(int64_t uid , const std::string& password){
+            std::string hashed = hasher_->Hash(password);
+            if(!hashed.empty() && db_pool_->UpdatePassword(uid , hashed)){
+                rpc_log->info("Password rehashed: uid={}" , uid);
+            }
+        }
+
+        // 重发按首次的结果回复; 首次发送还在入库时回复失败, 客户端稍后再重发
+        Status ReplyDuplicate(MsgSendRes* reply , const SendResult& sent , SendDedup::Source source){
+            static metrics::Counter* local = metrics::Registry::Instance().GetCounter(
+                "im_logic_send_duplicates_total" , "Retried MsgSendReq answered with the original result" , {{"source" , "local"}});
+            static metrics::Counter* shared = metrics::Registry::Instance().GetCounter(
+                "im_logic_send_duplicates_total" , "Retried MsgSendReq answered with the original result" , {{"source" , "shared"}});
+            static metrics::Counter* pending = metrics::Registry::Instance().GetCounter(
+                "im_logic_send_duplicates_total" , "Retried MsgSendReq answered with the original result" , {{"source" , "pending"}});
+            if(source == SendDedup::Source::PENDING){
+                pending->Inc();
+                rpc_log->debug("->SendMsg duplicate while the first attempt is still saving");
+                reply->set_err_code(im::ErrorCode::ERR_SYS_ERROR);
+                reply->set_err_msg("previous attempt in progress, retry later");
+                return Status::OK;
+            }
+            (source == SendDedup::Source::LOCAL ? local : shared)->Inc();
+            rpc_log->debug("->SendMsg duplicate : msg_id = {}" , sent.msg_id);
+            reply->set_err_code(im::ErrorCode::ERR_SUCCESS);
+            reply->set_msg_id(sent.msg_id);
+            reply->set_create_time(sent.create_time);
+            return Status::OK;
+        }
+
+        KvClient* redis_pool_;
+        DbClient* db_pool_;
         S3Client* s3_;
+        const SessionTokenCodec* token_codec_;
+        GatewayDirectory* gateways_;
+        DeliveryCursor* cursor_;
+        PasswordHasher* hasher_;
+        SendDedup* send_dedup_;
+};
+
+// 连接池快照按 Prometheus 格式输出, 等待时间沿用 PoolStats 自带的桶
+void AppendPoolMetrics(std::string& out, const std::vector<std::pair<std::string, PoolStatsSnapshot>>& pools){
+    static const std::vector<uint64_t> bounds(kPoolWaitBucketsUs.begin(), kPoolWaitBucketsUs.end());
+    out += "# HELP im_pool_wait_seconds Time spent waiting for a pooled connection\n# TYPE im_pool_wait_seconds histogram\n";
+    for (const auto& kv : pools) {
+        std::vector<uint64_t> buckets(kv.second.wait_buckets.begin(), kv.second.wait_buckets.end());
+        metrics::AppendHistogram(out, "im_pool_wait_seconds", {{"pool", kv.first}}, bounds, buckets, kv.second.wait_sum_us);
+    }
+    out += "# HELP im_pool_connections Pooled connections by state\n# TYPE im_pool_connections gauge\n";
+    for (const auto& kv : pools) {
+        out += "im_pool_connections{pool=\"" + kv.first + "\",state=\"in_use\"} " + std::to_string(kv.second.in_use) + "\n";
+        out += "im_pool_connections{pool=\"" + kv.first + "\",state=\"idle\"} " + std::to_string(kv.second.idle) + "\n";
+    }
+    out += "# HELP im_pool_acquire_timeouts_total Connection acquisitions that timed out\n# TYPE im_pool_acquire_timeouts_total counter\n";
+    for (const auto& kv : pools) {
+        out += "im_pool_acquire_timeouts_total{pool=\"" + kv.first + "\"} " + std::to_string(kv.second.timeouts) + "\n";
+    }
+}
+
+PoolOptions ToPoolOptions(const Config::PoolConfig& cfg) {
+    PoolOptions options;
+    options.min_pool = cfg.min_pool;
+    options.max_pool = cfg.max_pool;
+    options.max_pool_limit = static_cast<size_t>(std::max(cfg.max_pool_limit , cfg.max_pool));
+    options.acquire_timeout_ms = cfg.acquire_timeout_ms;
+    options.idle_timeout_sec = cfg.idle_timeout_sec;
+    options.keepalive_interval_sec = cfg.keepalive_interval_sec;
+    return options;
+}
+
+// Postgres + Redis 后端: 主库 / 只读副本 / 消息分片的连接池与路由
+struct PooledBackend {
+    explicit PooledBackend(const Config& config) {
+        const auto& redis_cfg = config.GetRedisConfig();
+        const auto& db_cfg = config.GetPostgresConfig();
+        const auto& pools_cfg = config.GetPoolsConfig();
+
+        auto make_db_conn_str = [&db_cfg](const std::string& host, int port) {
+            return "dbname=" + db_cfg.dbname + 
+                   " user=" + db_cfg.user + 
+                   " password=" + db_cfg.password + 
+                   " hostaddr=" + host + 
+                   " port=" + std::to_string(port) +
+                   " connect_timeout=3";
+        };
+
+        redis_pool = std::make_unique<RedisPool>(redis_cfg.host, redis_cfg.port, redis_cfg.password, ToPoolOptions(pools_cfg.redis));
+        redis = std::make_unique<PooledRedisClient>(redis_pool.get());
+
+        db_pool = std::make_unique<DbPool>(make_db_conn_str(db_cfg.host, db_cfg.port), ToPoolOptions(pools_cfg.postgres));
+
+        std::vector<DbPool*> replicas;
+        for (const auto& replica : db_cfg.replicas) {
+            replica_pools.push_back(std::make_unique<DbPool>(make_db_conn_str(replica.host, replica.port), ToPoolOptions(pools_cfg.postgres)));
+            replicas.push_back(replica_pools.back().get());
+            spdlog::info("Postgres read replica: {}:{}", replica.host, replica.port);
+        }
+        ReplicaOptions replica_options;
+        replica_options.max_lag_ms = db_cfg.replica_max_lag_ms;
+        replica_options.read_your_writes_ms = db_cfg.read_your_writes_ms;
+        replica_options.check_interval_ms = db_cfg.replica_check_interval_ms;
+        replica_router = std::make_unique<ReplicaRouter>(db_pool.get(), replicas, replica_options);
+
+        // 消息分片: 未配置时消息表在主库
+        std::vector<MessageShard> shards;
+        for (const auto& shard : db_cfg.message_shards) {
+            shard_pools.push_back(std::make_unique<DbPool>(make_db_conn_str(shard.host, shard.port), ToPoolOptions(pools_cfg.postgres)));
+            shards.push_back({shard.name, shard_pools.back().get(), shard.migrating});
+            spdlog::info("Message shard {}: {}:{}{}", shard.name, shard.host, shard.port, shard.migrating ? " (migrating)" : "");
+        }
+        if (shards.empty()) shards.push_back({"primary", db_pool.get(), false});
+        shard_router = std::make_unique<ShardRouter>(shards);
+
+        db = std::make_unique<PooledDbClient>(db_pool.get(), replica_router.get(), shard_router.get());
+    }
+
+    std::vector<std::pair<std::string, PoolStatsSnapshot>> PoolSnapshots() {
+        std::vector<std::pair<std::string, PoolStatsSnapshot>> pools;
+        pools.emplace_back("db", db_pool->Stats());
+        pools.emplace_back("redis", redis_pool->Stats());
+        for (size_t i = 0; i < replica_pools.size(); ++i) {
+            pools.emplace_back("replica" + std::to_string(i), replica_pools[i]->Stats());
+        }
+        for (const auto& shard : shard_router->Shards()) {
+            if (shard.pool != db_pool.get()) pools.emplace_back("shard_" + shard.name, shard.pool->Stats());
+        }
+        return pools;
+    }
+
+    // 配置热更新: 副本和消息分片与主库使用同一组 postgres 池参数
+    void ApplyPoolConfig(const Config::PoolsConfig& cfg) {
+        redis_pool->Reconfigure(ToPoolOptions(cfg.redis));
+        db_pool->Reconfigure(ToPoolOptions(cfg.postgres));
+        for (auto& pool : replica_pools) pool->Reconfigure(ToPoolOptions(cfg.postgres));
+        for (auto& pool : shard_pools) pool->Reconfigure(ToPoolOptions(cfg.postgres));
+        spdlog::info("Pool config applied: postgres min={} max={} acquire_timeout_ms={}, redis min={} max={} acquire_timeout_ms={}",
+                     cfg.postgres.min_pool, cfg.postgres.max_pool, cfg.postgres.acquire_timeout_ms,
+                     cfg.redis.min_pool, cfg.redis.max_pool, cfg.redis.acquire_timeout_ms);
+    }
+
+    void LogStats() {
+        spdlog::info("DbPool stats: {}", PoolStats::Describe(db_pool->Stats()));
+        spdlog::info("RedisPool stats: {}", PoolStats::Describe(redis_pool->Stats()));
+        for (const auto& shard : shard_router->Shards()) {
+            if (shard.pool != db_pool.get()) spdlog::info("Shard {} pool stats: {}", shard.name, PoolStats::Describe(shard.pool->Stats()));
+        }
+    }
+
+    // 析构顺序与构造相反: 客户端 -> 路由 -> 连接池
+    std::unique_ptr<RedisPool> redis_pool;
+    std::unique_ptr<PooledRedisClient> redis;
+    std::unique_ptr<DbPool> db_pool;
+    std::vector<std::unique_ptr<DbPool>> replica_pools;
+    std::unique_ptr<ReplicaRouter> replica_router;
+    std::vector<std::unique_ptr<DbPool>> shard_pools;
+    std::unique_ptr<ShardRouter> shard_router;
+    std::unique_ptr<PooledDbClient> db;
 };
 
 std::string GetEnvOrDefault(const char* key, const std::string& default_value) {
@@ -266,11 +583,16 @@ int RunServer(){
         return 1;
     }
 
+    const auto& log_cfg = config.GetLogConfig();
+    logging::Init("[%H:%M:%S%z][%^%L%$][Logic][%n] %v" , {log_cfg.queue_size , log_cfg.flush_interval_sec , log_cfg.level , log_cfg.modules});
+    rpc_log = logging::Get("rpc");
+    push_log = logging::Get("push");
+
     // Get config values
-    const auto& redis_cfg = config.GetRedisConfig();
-    const auto& db_cfg = config.GetPostgresConfig();
     const auto& grpc_cfg = config.GetGrpcConfig();
     const auto& seaweedfs_cfg = config.GetSeaweedFSConfig();
+    const auto& storage_cfg = config.GetStorageConfig();
+    const bool embedded_mode = storage_cfg.backend == "embedded";
 
     std::string server_address = grpc_cfg.logic_server_listen_addr;
 
@@ -280,45 +602,191 @@ int RunServer(){
     const std::string seaweed_access_key = GetEnvOrDefault("SEAWEED_ACCESS_KEY", "");
     const std::string seaweed_secret_key = GetEnvOrDefault("SEAWEED_SECRET_KEY", "");
 
+    // 存储后端: embedded 时 EmbeddedStore 同时充当 DbClient 和 KvClient
+    std::unique_ptr<PooledBackend> pooled;
+    std::unique_ptr<EmbeddedStore> embedded;
+    DbClient* db_client = nullptr;
+    KvClient* kv_client = nullptr;
+    if (embedded_mode) {
+        SegmentedLogOptions log_options;
+        log_options.dir = storage_cfg.data_dir;
+        log_options.segment_bytes = storage_cfg.segment_bytes;
+        log_options.sync_interval_ms = storage_cfg.sync_interval_ms;
+        embedded = std::make_unique<EmbeddedStore>(log_options);
+        if (!embedded->Open()) {
+            spdlog::error("Failed to open embedded store at {}", storage_cfg.data_dir);
+            return 1;
+        }
+        db_client = embedded.get();
+        kv_client = embedded.get();
+        spdlog::info("Storage backend: embedded ({})", storage_cfg.data_dir);
+    }
+    else if (storage_cfg.backend == "postgres") {
+        pooled = std::make_unique<PooledBackend>(config);
+        db_client = pooled->db.get();
+        kv_client = pooled->redis.get();
+    }
+    else {
+        spdlog::error("Unknown storage backend: {}", storage_cfg.backend);
+        return 1;
+    }
+
+    S3ClientOptions s3_options;
+    s3_options.http.connect_timeout_ms = seaweedfs_cfg.connect_timeout_ms;
+    s3_options.http.request_timeout_ms = seaweedfs_cfg.request_timeout_ms;
+    s3_options.http.max_idle_per_endpoint = static_cast<size_t>(std::max(seaweedfs_cfg.max_idle_conns, 0));
+    s3_options.assign_batch = seaweedfs_cfg.assign_batch;
+    s3_options.assign_low_water = seaweedfs_cfg.assign_low_water;
+    s3_options.fid_ttl_sec = seaweedfs_cfg.fid_ttl_sec;
+    s3_options.fid_cache_capacity = static_cast<size_t>(std::max(seaweedfs_cfg.fid_cache_capacity, 1));
     S3Client s3(seaweed_master_endpoint,
                 seaweed_public_endpoint,
                 seaweed_bucket,
                 seaweed_access_key,
-                seaweed_secret_key);
+                seaweed_secret_key,
+                db_client,
+                s3_options);
 
+    // 单机模式下文件存储是可选的, 不可达时只有 GetUploadUrl 返回错误
     if (!s3.CheckConnectivity()) {
-        spdlog::error("SeaweedFS unavailable, logic server exit with code {}", kStorageConnectErrorCode);
-        return kStorageConnectErrorCode;
+        if (!embedded_mode) {
+            spdlog::error("SeaweedFS unavailable, logic server exit with code {}", kStorageConnectErrorCode);
+            return kStorageConnectErrorCode;
+        }
+        spdlog::warn("SeaweedFS unavailable, uploads will fail until it comes up");
     }
 
-    std::string db_conn_str = "dbname=" + db_cfg.dbname + 
-                              " user=" + db_cfg.user + 
-                              " password=" + db_cfg.password + 
-                              " hostaddr=" + db_cfg.host + 
-                              " port=" + std::to_string(db_cfg.port);
-
-    // Initialize connection pools and pooled clients
-    RedisPool redis_pool(redis_cfg.host, redis_cfg.port, redis_cfg.password, 2, 50);
-    PooledRedisClient pooled_redis(&redis_pool);
-
-    DbPool db_pool(db_conn_str, 2, 20);
-    PooledDbClient pooled_db(&db_pool);
-
-    LogicServiceImpl service(&pooled_redis, &pooled_db, &s3);
+    GatewayDirectory gateways(kv_client);
+    if (embedded_mode) gateways.SetStaticGateway(grpc_cfg.gateway_server_addr);
+
+    // 周期输出连接池统计, 按实测的等待时间/占用情况调整池大小; 周期可热更新, <= 0 时不输出
+    std::mutex reporter_mu;
+    std::condition_variable reporter_cv;
+    bool reporter_stop = false;
+    std::thread pool_reporter([&] {
+        std::unique_lock<std::mutex> lk(reporter_mu);
+        while (true) {
+            int interval_sec = Config::Instance().Current()->pools.stats_log_interval_sec;
+            if (reporter_cv.wait_for(lk, std::chrono::seconds(interval_sec > 0 ? interval_sec : 60), [&] { return reporter_stop; })) break;
+            if (interval_sec <= 0) continue;
+            if (pooled) pooled->LogStats();
+            if (embedded) {
+                auto st = embedded->Stats();
+                spdlog::info("Embedded store stats: users={} messages={} segments={} log_bytes={}", st.users, st.messages, st.segments, st.log_bytes);
+            }
+            for (const auto& kv : gateways.StreamStats()) {
+                const auto& st = kv.second;
+                spdlog::info("Push stream {} stats: pushed={} delivered={} not_found={} dropped={} batches={} reconnects={}",
+                             kv.first, st.pushed, st.delivered, st.not_found, st.dropped, st.batches, st.reconnects);
+            }
+        }
+    });
+
+    // 抓取时读取池和推送流的快照, 不在热路径上额外计数
+    metrics::Registry::Instance().AddCollector([&](std::string& out) {
+        if (pooled) AppendPoolMetrics(out, pooled->PoolSnapshots());
+        if (embedded) {
+            auto st = embedded->Stats();
+            out += "# HELP im_embedded_store_log_bytes Bytes in the embedded store log\n# TYPE im_embedded_store_log_bytes gauge\n";
+            out += "im_embedded_store_log_bytes " + std::to_string(st.log_bytes) + "\n";
+            out += "# HELP im_embedded_store_segments Log segments of the embedded store\n# TYPE im_embedded_store_segments gauge\n";
+            out += "im_embedded_store_segments " + std::to_string(st.segments) + "\n";
+            out += "# HELP im_embedded_store_messages Messages indexed by the embedded store\n# TYPE im_embedded_store_messages gauge\n";
+            out += "im_embedded_store_messages " + std::to_string(st.messages) + "\n";
+        }
 
+        auto streams = gateways.StreamStats();
+        out += "# HELP im_push_stream_frames_total Push frames per gateway stream by outcome\n# TYPE im_push_stream_frames_total counter\n";
+        for (const auto& kv : streams) {
+            const auto& st = kv.second;
+            for (const auto& result : {std::make_pair("pushed", st.pushed), std::make_pair("delivered", st.delivered),
+                                       std::make_pair("not_found", st.not_found), std::make_pair("dropped", st.dropped)}) {
+                out += "im_push_stream_frames_total{gateway=\"" + kv.first + "\",result=\"" + result.first + "\"} " +
+                       std::to_string(result.second) + "\n";
+            }
+        }
+        out += "# HELP im_push_stream_reconnects_total Push stream reconnects per gateway\n# TYPE im_push_stream_reconnects_total counter\n";
+        for (const auto& kv : streams) {
+            out += "im_push_stream_reconnects_total{gateway=\"" + kv.first + "\"} " + std::to_string(kv.second.reconnects) + "\n";
+        }
+        out += "# HELP im_push_stream_ack_timeouts_total Push streams torn down for unacked frames per gateway\n# TYPE im_push_stream_ack_timeouts_total counter\n";
+        for (const auto& kv : streams) {
+            out += "im_push_stream_ack_timeouts_total{gateway=\"" + kv.first + "\"} " + std::to_string(kv.second.ack_timeouts) + "\n";
+        }
+    });
+    // logic server 不自己采样, 只记录网关带来的 trace
+    trace::Tracer::Instance().Configure("logic_server" , config.GetTraceConfig().ring_capacity , 0);
+    MetricsServer metrics_server(config.GetMetricsConfig().logic_listen_addr , false);
+    if (!config.GetMetricsConfig().logic_listen_addr.empty()) metrics_server.Start();
+    // 诊断接口单独监听, 默认只对本机开放
+    MetricsServer admin_server(config.GetMetricsConfig().logic_admin_addr , true);
+    if (!config.GetMetricsConfig().logic_admin_addr.empty()) admin_server.Start();
+
+    SessionTokenCodec token_codec(config.GetAuthConfig());
+
+    DeliveryCursor delivery_cursor(kv_client, db_client);
+
+    // 先于 service 构造: 服务关闭时所有回调 RPC 已完成, 哈希队列为空
+    const auto& hash_cfg = config.GetAuthConfig().password_hash;
+    PasswordHasherOptions hasher_options;
+    hasher_options.threads = hash_cfg.threads;
+    hasher_options.max_queue = static_cast<size_t>(std::max(hash_cfg.max_queue, 1));
+    hasher_options.scrypt_log_n = hash_cfg.scrypt_log_n;
+    hasher_options.scrypt_r = hash_cfg.scrypt_r;
+    hasher_options.scrypt_p = hash_cfg.scrypt_p;
+    PasswordHasher hasher(hasher_options);
+
+    // 配置热更新: 日志级别与连接池参数; 监听端口、存储后端等其余配置仍需重启
+    config.OnReload([&pooled](const Config::ServerConfig& cfg) {
+        logging::ApplyLevels(cfg.log.level , cfg.log.modules);
+        if (pooled) pooled->ApplyPoolConfig(cfg.pools);
+    });
+    ConfigWatcher config_watcher("../config.yaml");
+    config_watcher.Start();
+    metrics::Registry::Instance().AddCollector([&hasher](std::string& out) {
+        out += "# HELP im_logic_password_hash_queue_depth Credential requests waiting for a hash thread\n# TYPE im_logic_password_hash_queue_depth gauge\n";
+        out += "im_logic_password_hash_queue_depth " + std::to_string(hasher.QueueDepth()) + "\n";
+    });
+
+    // 单机部署只有一个 logic server, 进程内窗口即可判重
+    const auto& dedup_cfg = config.GetMessageConfig().send_dedup;
+    SendDedupOptions dedup_options;
+    dedup_options.window_sec = dedup_cfg.window_sec;
+    dedup_options.max_entries = static_cast<size_t>(std::max(dedup_cfg.max_entries, 1));
+    SendDedup send_dedup(embedded_mode ? nullptr : kv_client, dedup_options);
+    metrics::Registry::Instance().AddCollector([&send_dedup](std::string& out) {
+        out += "# HELP im_logic_send_dedup_entries Sends remembered by the in-process dedup window\n# TYPE im_logic_send_dedup_entries gauge\n";
+        out += "im_logic_send_dedup_entries " + std::to_string(send_dedup.Size()) + "\n";
+    });
+
+    LogicServiceImpl service(kv_client, db_client, &s3, &token_codec, &gateways, &delivery_cursor, &hasher, &send_dedup);
+
+    // 网关侧 round_robin 通过健康检查判断本节点是否可用
+    grpc::EnableDefaultHealthCheckService(true);
     ServerBuilder builder;
     builder.AddListeningPort(server_address , grpc::InsecureServerCredentials());
     builder.RegisterService(&service);
 
     std::unique_ptr<Server> server(builder.BuildAndStart());
+    server->GetHealthCheckService()->SetServingStatus(kLogicHealthServiceName, true);
     spdlog::info("logic Server is listening on {}", server_address);
 
     server->Wait();
+
+    {
+        std::lock_guard<std::mutex> lk(reporter_mu);
+        reporter_stop = true;
+    }
+    reporter_cv.notify_all();
+    pool_reporter.join();
+    config_watcher.Stop();
+    metrics_server.Stop();
+    admin_server.Stop();
     return 0;
 }
 
 int main(){
-    spdlog::set_pattern("[%H:%H:%S%z][%^%L%$][Logic]%v");
+    spdlog::set_pattern("[%H:%M:%S%z][%^%L%$][Logic][%n] %v");
 
     return RunServer();
 }
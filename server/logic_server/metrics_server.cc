@@ -0,0 +1,138 @@
+#include "metrics_server.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include "../../common/config/config_watcher.h"
+#include "../../common/metrics/metrics.h"
+#include "../../common/trace/trace.h"
+#include "../../common/log/logging.h"
+
+// query 形如 a=1&b=2, 不做 URL 解码 (参数都是模块名/级别/十六进制 id)
+static std::string QueryParam(const std::string& query, const std::string& key) {
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        if (query.compare(pos, key.size() + 1, key + "=") == 0) return query.substr(pos + key.size() + 1, end - pos - key.size() - 1);
+        pos = end + 1;
+    }
+    return "";
+}
+
+MetricsServer::MetricsServer(const std::string& listen_addr, bool admin) : listen_addr_(listen_addr), admin_(admin) {}
+
+MetricsServer::~MetricsServer() {
+    Stop();
+}
+
+bool MetricsServer::Start() {
+    size_t colon = listen_addr_.rfind(':');
+    if (colon == std::string::npos) {
+        spdlog::error("Metrics listen addr invalid: {}", listen_addr_);
+        return false;
+    }
+    std::string host = listen_addr_.substr(0, colon);
+    int port = std::atoi(listen_addr_.c_str() + colon + 1);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        spdlog::error("Metrics listen addr invalid: {}", listen_addr_);
+        return false;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return false;
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 16) < 0) {
+        spdlog::error("Metrics listen on {} failed: {}", listen_addr_, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    worker_ = std::thread(&MetricsServer::Serve, this);
+    spdlog::info("{} listening on {}", admin_ ? "Admin" : "Metrics", listen_addr_);
+    return true;
+}
+
+void MetricsServer::Stop() {
+    if (stop_.exchange(true)) return;
+    if (listen_fd_ >= 0) shutdown(listen_fd_, SHUT_RDWR);  // 唤醒阻塞中的 accept
+    if (worker_.joinable()) worker_.join();
+    if (listen_fd_ >= 0) close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+void MetricsServer::Serve() {
+    while (!stop_) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (stop_) break;
+            if (errno == EINTR) continue;
+            spdlog::warn("Metrics accept failed: {}", strerror(errno));
+            continue;
+        }
+        HandleConnection(fd);
+        close(fd);
+    }
+}
+
+void MetricsServer::HandleConnection(int fd) {
+    // 抓取端异常时不能卡住唯一的服务线程
+    timeval tv{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return;
+        request.append(buf, n);
+    }
+
+    // 请求行: GET <path>[?<query>] HTTP/1.1
+    std::string target;
+    if (request.compare(0, 4, "GET ") == 0) {
+        size_t end = request.find(' ', 4);
+        if (end != std::string::npos) target = request.substr(4, end - 4);
+    }
+    std::string path = target.substr(0, target.find('?'));
+    std::string query = path.size() < target.size() ? target.substr(path.size() + 1) : "";
+
+    std::string status = "200 OK";
+    std::string content_type = "text/plain; version=0.0.4";
+    std::string body;
+    if (path == "/metrics") {
+        body = metrics::Registry::Instance().Expose();
+    } else if (admin_ && path == "/debug/loglevel") {
+        body = logging::HandleLevelRequest(QueryParam(query, "module"), QueryParam(query, "level"));
+    } else if (admin_ && path == "/debug/config/reload") {
+        body = HandleConfigReload();
+    } else if (admin_ && path == "/debug/traces") {
+        content_type = "application/json";
+        body = trace::Tracer::Instance().DumpChromeTrace(trace::ParseTraceId(QueryParam(query, "trace_id")));
+    } else {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: " + content_type + "\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += n;
+    }
+}
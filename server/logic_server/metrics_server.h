@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+
+// logic server 的指标/诊断监听: 单线程阻塞式 HTTP (抓取频率很低, 不需要并发)
+//   GET /metrics                       Prometheus 指标
+// 以下诊断接口只在 admin 实例 (管理端口, 默认只监听本机) 上提供:
+//   GET /debug/traces[?trace_id=<hex>]  采样追踪, Chrome trace 格式
+//   GET /debug/loglevel[?module=rpc&level=debug]  查看 / 修改日志级别
+//   GET /debug/config/reload           立即重新加载配置文件 (平时由文件监视自动触发)
+class MetricsServer {
+public:
+    MetricsServer(const std::string& listen_addr, bool admin);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool Start();
+    void Stop();
+
+private:
+    void Serve();
+    void HandleConnection(int fd);
+
+    std::string listen_addr_;
+    const bool admin_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread worker_;
+};
@@ -0,0 +1,171 @@
+#include "password_hasher.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <cstdio>
+#include <spdlog/spdlog.h>
+#include "../../common/metrics/metrics.h"
+
+namespace {
+
+constexpr size_t kSaltLen = 16;
+constexpr size_t kHashLen = 32;
+constexpr char kPrefix[] = "$scrypt$";
+
+metrics::Histogram* HashLatency(const char* op) {
+    return metrics::Registry::Instance().GetHistogram("im_logic_password_hash_seconds", "scrypt hash / verify CPU time",
+                                                      {{"op", op}});
+}
+
+std::string ToHex(const unsigned char* data, size_t len) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string out(len * 2, '\0');
+    for (size_t i = 0; i < len; ++i) {
+        out[i * 2] = kHex[data[i] >> 4];
+        out[i * 2 + 1] = kHex[data[i] & 0xF];
+    }
+    return out;
+}
+
+bool FromHex(const std::string& hex, std::vector<unsigned char>& out) {
+    if (hex.size() % 2 != 0) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    out.resize(hex.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i) {
+        int hi = nibble(hex[i * 2]);
+        int lo = nibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<unsigned char>(hi << 4 | lo);
+    }
+    return true;
+}
+
+bool Scrypt(const std::string& password, const unsigned char* salt, size_t salt_len, int log_n, int r, int p,
+            unsigned char* out, size_t out_len) {
+    uint64_t n = uint64_t{1} << log_n;
+    // scrypt 需要约 128 * r * (N + p) 字节, 留出余量
+    uint64_t maxmem = 128 * static_cast<uint64_t>(r) * (n + static_cast<uint64_t>(p) + 2) + (1 << 20);
+    return EVP_PBE_scrypt(password.data(), password.size(), salt, salt_len, n, static_cast<uint64_t>(r),
+                          static_cast<uint64_t>(p), maxmem, out, out_len) == 1;
+}
+
+}  // namespace
+
+PasswordHasher::PasswordHasher(const PasswordHasherOptions& options) : options_(options) {
+    if (options_.threads <= 0) options_.threads = 1;
+    if (options_.scrypt_log_n < 10 || options_.scrypt_log_n > 22) {
+        spdlog::warn("scrypt_log_n {} out of range [10, 22], using 14", options_.scrypt_log_n);
+        options_.scrypt_log_n = 14;
+    }
+    if (options_.scrypt_r <= 0) options_.scrypt_r = 8;
+    if (options_.scrypt_p <= 0) options_.scrypt_p = 1;
+    for (int i = 0; i < options_.threads; ++i) workers_.emplace_back(&PasswordHasher::WorkerLoop, this);
+    spdlog::info("password hasher: threads={} max_queue={} scrypt ln={} r={} p={}", options_.threads, options_.max_queue,
+                 options_.scrypt_log_n, options_.scrypt_r, options_.scrypt_p);
+}
+
+PasswordHasher::~PasswordHasher() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+bool PasswordHasher::Submit(std::function<void()> job) {
+    static metrics::Counter* rejected = metrics::Registry::Instance().GetCounter(
+        "im_logic_password_hash_rejected_total", "Credential requests rejected because the hash queue was full");
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stop_ || queue_.size() >= options_.max_queue) {
+            rejected->Inc();
+            return false;
+        }
+        queue_.push_back({std::move(job), std::chrono::steady_clock::now()});
+    }
+    cv_.notify_one();
+    return true;
+}
+
+size_t PasswordHasher::QueueDepth() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return queue_.size();
+}
+
+void PasswordHasher::WorkerLoop() {
+    static metrics::Histogram* wait = metrics::Registry::Instance().GetHistogram(
+        "im_logic_password_hash_queue_seconds", "Time credential requests wait for a hash thread");
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+            // 退出前执行完已排队的任务, 每个任务都负责回复各自的 RPC
+            if (queue_.empty()) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        wait->ObserveUs(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - job.enqueued).count());
+        job.fn();
+    }
+}
+
+std::string PasswordHasher::Hash(const std::string& password) const {
+    static metrics::Histogram* latency = HashLatency("hash");
+    metrics::ScopedTimer timer(latency);
+    unsigned char salt[kSaltLen];
+    unsigned char hash[kHashLen];
+    if (RAND_bytes(salt, sizeof(salt)) != 1 ||
+        !Scrypt(password, salt, sizeof(salt), options_.scrypt_log_n, options_.scrypt_r, options_.scrypt_p, hash, sizeof(hash))) {
+        spdlog::error("scrypt hash failed");
+        return "";
+    }
+    char params[48];
+    std::snprintf(params, sizeof(params), "ln=%d,r=%d,p=%d$", options_.scrypt_log_n, options_.scrypt_r, options_.scrypt_p);
+    return std::string(kPrefix) + params + ToHex(salt, sizeof(salt)) + "$" + ToHex(hash, sizeof(hash));
+}
+
+bool PasswordHasher::Verify(const std::string& password, const std::string& stored, bool* needs_rehash) const {
+    static metrics::Histogram* latency = HashLatency("verify");
+    if (needs_rehash) *needs_rehash = false;
+    if (stored.compare(0, sizeof(kPrefix) - 1, kPrefix) != 0) {
+        // 迁移前的明文口令
+        if (stored.empty() || stored.size() != password.size() || CRYPTO_memcmp(stored.data(), password.data(), stored.size()) != 0) {
+            return false;
+        }
+        if (needs_rehash) *needs_rehash = true;
+        return true;
+    }
+
+    int log_n = 0, r = 0, p = 0, consumed = 0;
+    if (std::sscanf(stored.c_str() + sizeof(kPrefix) - 1, "ln=%d,r=%d,p=%d$%n", &log_n, &r, &p, &consumed) != 3 || consumed == 0 ||
+        log_n < 1 || log_n > 22 || r <= 0 || p <= 0) {
+        spdlog::warn("malformed password hash");
+        return false;
+    }
+    std::string rest = stored.substr(sizeof(kPrefix) - 1 + consumed);
+    size_t sep = rest.find('$');
+    std::vector<unsigned char> salt, expected;
+    if (sep == std::string::npos || !FromHex(rest.substr(0, sep), salt) || !FromHex(rest.substr(sep + 1), expected) ||
+        expected.empty()) {
+        spdlog::warn("malformed password hash");
+        return false;
+    }
+
+    metrics::ScopedTimer timer(latency);
+    std::vector<unsigned char> actual(expected.size());
+    if (!Scrypt(password, salt.data(), salt.size(), log_n, r, p, actual.data(), actual.size())) {
+        spdlog::error("scrypt verify failed: ln={} r={} p={}", log_n, r, p);
+        return false;
+    }
+    if (CRYPTO_memcmp(actual.data(), expected.data(), expected.size()) != 0) return false;
+    if (needs_rehash) {
+        *needs_rehash = log_n < options_.scrypt_log_n || r != options_.scrypt_r || p != options_.scrypt_p;
+    }
+    return true;
+}
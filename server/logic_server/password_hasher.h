@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PasswordHasherOptions {
+    int threads = 2;
+    size_t max_queue = 64;   // 排队 (不含执行中) 的上限, 超出时 Submit 返回 false
+    int scrypt_log_n = 14;
+    int scrypt_r = 8;
+    int scrypt_p = 1;
+};
+
+// 口令哈希与校验, 在独立的有界线程池上执行, 不占用 gRPC 处理线程.
+//
+// 存储格式: $scrypt$ln=<log2 N>,r=<r>,p=<p>$<salt hex>$<hash hex>
+// 不以 "$scrypt$" 开头的存储值视为迁移前的明文口令, 校验通过后应按当前参数重算 (needs_rehash)
+class PasswordHasher {
+public:
+    explicit PasswordHasher(const PasswordHasherOptions& options);
+    ~PasswordHasher();
+
+    PasswordHasher(const PasswordHasher&) = delete;
+    PasswordHasher& operator=(const PasswordHasher&) = delete;
+
+    // 在哈希线程上执行 job; 队列已满返回 false, 调用方应直接回复繁忙
+    bool Submit(std::function<void()> job);
+
+    // 以下两个是 CPU 密集的同步计算, 只应在 Submit 的 job 内调用; 失败返回空串 / false
+    std::string Hash(const std::string& password) const;
+    // 存储值的参数低于当前配置 (或为明文) 时 needs_rehash 置 true
+    bool Verify(const std::string& password, const std::string& stored, bool* needs_rehash = nullptr) const;
+
+    size_t QueueDepth() const;
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    void WorkerLoop();
+
+    PasswordHasherOptions options_;
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,112 @@
+// PasswordHasher 的编码格式、校验、明文迁移与参数升级后的 needs_rehash, 以及线程池的有界队列
+#include "password_hasher.h"
+#include <atomic>
+#include <future>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "../../common/test/check.h"
+
+namespace {
+
+// 最小参数, 只为测试跑得快
+PasswordHasherOptions FastOptions(int log_n = 10) {
+    PasswordHasherOptions options;
+    options.threads = 1;
+    options.max_queue = 2;
+    options.scrypt_log_n = log_n;
+    options.scrypt_r = 8;
+    options.scrypt_p = 1;
+    return options;
+}
+
+void TestHashAndVerify() {
+    PasswordHasher hasher(FastOptions());
+    std::string stored = hasher.Hash("s3cret");
+    CHECK(stored.rfind("$scrypt$ln=10,r=8,p=1$", 0) == 0);
+    // 16 字节盐 + 32 字节哈希, 十六进制
+    size_t sep = stored.rfind('$');
+    CHECK(sep != std::string::npos && stored.size() - sep - 1 == 64);
+    CHECK(sep - stored.rfind('$', sep - 1) - 1 == 32);
+
+    bool rehash = true;
+    CHECK(hasher.Verify("s3cret", stored, &rehash));
+    CHECK(!rehash);
+    CHECK(!hasher.Verify("s3creT", stored));
+    CHECK(!hasher.Verify("", stored));
+    // 随机盐: 同一口令两次结果不同, 都能校验
+    std::string again = hasher.Hash("s3cret");
+    CHECK(again != stored);
+    CHECK(hasher.Verify("s3cret", again));
+}
+
+void TestMalformed() {
+    PasswordHasher hasher(FastOptions());
+    std::string stored = hasher.Hash("pw");
+    CHECK(!hasher.Verify("pw", "$scrypt$"));
+    CHECK(!hasher.Verify("pw", "$scrypt$ln=10,r=8,p=1$"));
+    CHECK(!hasher.Verify("pw", "$scrypt$ln=99,r=8,p=1$00$00"));
+    CHECK(!hasher.Verify("pw", stored.substr(0, stored.size() - 1)));
+    std::string flipped = stored;
+    flipped.back() = flipped.back() == '0' ? '1' : '0';
+    CHECK(!hasher.Verify("pw", flipped));
+    std::string upper = stored;
+    upper.back() = 'G';
+    CHECK(!hasher.Verify("pw", upper));
+}
+
+void TestPlaintextMigration() {
+    PasswordHasher hasher(FastOptions());
+    bool rehash = false;
+    CHECK(hasher.Verify("legacy", "legacy", &rehash));
+    CHECK(rehash);
+    CHECK(!hasher.Verify("legacy", "Legacy"));
+    CHECK(!hasher.Verify("", ""));
+}
+
+void TestRehashOnStrongerParams() {
+    PasswordHasher weak(FastOptions(10));
+    PasswordHasher strong(FastOptions(11));
+    std::string old_hash = weak.Hash("pw");
+    bool rehash = false;
+    CHECK(strong.Verify("pw", old_hash, &rehash));
+    CHECK(rehash);
+    std::string new_hash = strong.Hash("pw");
+    CHECK(weak.Verify("pw", new_hash, &rehash));
+    CHECK(!rehash);
+}
+
+void TestBoundedQueue() {
+    PasswordHasher hasher(FastOptions());
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::promise<void> started;
+    std::atomic<int> ran{0};
+    // 第一个任务占住唯一的线程, 之后只能再排 max_queue 个
+    CHECK(hasher.Submit([&] {
+        started.set_value();
+        gate.wait();
+        ++ran;
+    }));
+    started.get_future().wait();
+    CHECK(hasher.Submit([&] { ++ran; }));
+    CHECK(hasher.Submit([&] { ++ran; }));
+    CHECK(hasher.QueueDepth() == 2);
+    CHECK(!hasher.Submit([&] { ++ran; }));
+    release.set_value();
+    std::promise<void> done;
+    while (!hasher.Submit([&] { done.set_value(); })) std::this_thread::yield();
+    done.get_future().wait();
+    CHECK(ran.load() == 3);
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::err);
+    TestHashAndVerify();
+    TestMalformed();
+    TestPlaintextMigration();
+    TestRehashOnStrongerParams();
+    TestBoundedQueue();
+    return test::Report();
+}
@@ -1,13 +1,127 @@
 #include "pool_db_client.h"
 #include <libpq-fe.h>
-#include <sstream>
+#include <algorithm>
+#include "../../common/trace/trace.h"
+
+ReplicaRouter::ReadLease PooledDbClient::AcquireRead(int64_t uid) {
+    if (router_) return router_->AcquireRead(uid);
+    return ReplicaRouter::ReadLease(pool_->Acquire(), nullptr);
+}
+
+void PooledDbClient::MarkWrite(int64_t uid) {
+    if (router_) router_->MarkWrite(uid);
+}
+
+ShardRouter::Route PooledDbClient::LocateShard(int64_t key) {
+    if (!shards_) return ShardRouter::Route{pool_, nullptr};
+    return shards_->Locate(key);
+}
+
+// 消息列按 msg_id, from_uid, to_uid/group_id, content, create_time, seq 的顺序返回
+std::vector<im::ChatMsg> PooledDbClient::QueryMsgs(DbPool* shard, int64_t uid, const std::string& sql, bool group) {
+    std::vector<im::ChatMsg> msgs;
+    // 落在主库的分片沿用读写分离路由, 独立分片直接走分片主库
+    auto g = shard == pool_ ? AcquireRead(uid) : ReplicaRouter::ReadLease(shard->Acquire(), nullptr);
+    if (!g) return msgs;
+    PGresult* res = PQexec(g.get(), sql.c_str());
+    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
+        int rows = PQntuples(res);
+        for (int i = 0; i < rows; ++i) {
+            im::ChatMsg msg;
+            msg.set_msg_id(std::stoll(PQgetvalue(res, i, 0)));
+            msg.set_from_uid(std::stoll(PQgetvalue(res, i, 1)));
+            msg.set_to_uid(std::stoll(PQgetvalue(res, i, 2)));  // 群聊时为群ID
+            msg.set_content(PQgetvalue(res, i, 3));
+            msg.set_create_time(std::stoll(PQgetvalue(res, i, 4)));
+            msg.set_seq(std::stoll(PQgetvalue(res, i, 5)));
+            msgs.push_back(msg);
+        }
+    } else {
+        spdlog::error("{} query failed: {} | Error: {}", group ? "Group msg" : "Msg", sql, PQerrorMessage(g.get()));
+    }
+    if (res) PQclear(res);
+    return msgs;
+}
+
+// 迁移期间同一个 key 的消息可能分布在新旧两个分片, 按 seq 合并; 搬运途中两边都有的行按 msg_id 去重
+std::vector<im::ChatMsg> PooledDbClient::QueryShardedMsgs(int64_t key, int64_t uid, const std::string& sql, bool group) {
+    auto route = LocateShard(key);
+    if (!route.pool) return {};
+    auto msgs = QueryMsgs(route.pool, uid, sql, group);
+    if (!route.previous) return msgs;
+
+    auto old_msgs = QueryMsgs(route.previous, uid, sql, group);
+    msgs.insert(msgs.end(), old_msgs.begin(), old_msgs.end());
+    std::sort(msgs.begin(), msgs.end(), [](const im::ChatMsg& a, const im::ChatMsg& b) {
+        return a.seq() != b.seq() ? a.seq() < b.seq() : a.msg_id() < b.msg_id();
+    });
+    msgs.erase(std::unique(msgs.begin(), msgs.end(),
+                           [](const im::ChatMsg& a, const im::ChatMsg& b) { return a.msg_id() == b.msg_id(); }),
+               msgs.end());
+    if (msgs.size() > kMsgPageSize) msgs.resize(kMsgPageSize);
+    return msgs;
+}
+
+// 迁移期间新分片上的计数器从旧分片的计数器续接, 保证同一个 key 的 seq 跨分片不重复; 查询失败返回 -1
+int64_t PooledDbClient::SeqFloor(DbPool* previous, SeqScope scope, int64_t key) {
+    auto g = previous->Acquire();
+    if (!g) return -1;
+    std::string sql = "SELECT last_seq FROM t_msg_seq WHERE scope=" + std::to_string(scope) + " AND owner_id=" + std::to_string(key);
+    PGresult* res = PQexec(g.get(), sql.c_str());
+    int64_t floor = -1;
+    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
+        floor = PQntuples(res) > 0 ? std::stoll(PQgetvalue(res, 0, 0)) : 0;
+    } else {
+        spdlog::error("Seq floor query failed: {} | Error: {}", sql, PQerrorMessage(g.get()));
+    }
+    PQclear(res);
+    return floor;
+}
+
+// 在 key 所在分片上分配 seq 并写入消息, 返回 seq, 失败返回 0.
+// 计数器行锁持有到语句提交, 同一个 key 的 seq 顺序即提交顺序, 离线同步按 seq 翻页不会越过未提交的消息
+int64_t PooledDbClient::InsertMsg(SeqScope scope, const std::string& msg_id, int64_t from_uid, int64_t key, const std::string& content) {
+    auto route = LocateShard(key);
+    if (!route.pool) return 0;
+    int64_t floor = route.previous ? SeqFloor(route.previous, scope, key) : 0;
+    if (floor < 0) return 0;
+    auto g = route.pool->Acquire();
+    if (!g) return 0;
+
+    const bool group = scope == kSeqGroup;
+    const std::string sql = std::string(
+        "WITH s AS (INSERT INTO t_msg_seq (scope, owner_id, last_seq) VALUES (") + std::to_string(scope) + ", $3::bigint, $6::bigint + 1) "
+        "ON CONFLICT (scope, owner_id) DO UPDATE SET last_seq = GREATEST(t_msg_seq.last_seq, $6::bigint) + 1 RETURNING last_seq) " +
+        (group ? "INSERT INTO t_group_msg (msg_id, from_uid, group_id, content, create_time, seq) "
+               : "INSERT INTO t_chat_msg (msg_id, from_uid, to_uid, content, create_time, seq) ") +
+        "SELECT $1::bigint, $2::bigint, $3::bigint, $4, $5::bigint, last_seq FROM s RETURNING seq";
+    std::string from = std::to_string(from_uid);
+    std::string owner = std::to_string(key);
+    std::string now = std::to_string(time(nullptr));
+    std::string floor_str = std::to_string(floor);
+    const char* params[6] = {msg_id.c_str(), from.c_str(), owner.c_str(), content.c_str(), now.c_str(), floor_str.c_str()};
+    PGresult* res = PQexecParams(g.get(), sql.c_str(), 6, nullptr, params, nullptr, nullptr, 0);
+    int64_t seq = 0;
+    if (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) == 1) {
+        seq = std::stoll(PQgetvalue(res, 0, 0));
+    } else {
+        spdlog::error("{} insert failed: msg_id={} key={} | Error: {}", group ? "Group msg" : "Msg", msg_id, key, PQerrorMessage(g.get()));
+    }
+    PQclear(res);
+    // 发送方随后拉取会话, 接收方 / 群成员随后同步, 窗口期内都读主库才能看到刚写入的消息
+    if (seq > 0 && route.pool == pool_) {
+        MarkWrite(from_uid);
+        MarkWrite(group ? GroupStickyKey(key) : key);
+    }
+    return seq;
+}
 
 bool PooledDbClient::Execute(const std::string& sql) {
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    if (!g) return false;
+    PGresult* res = PQexec(g.get(), sql.c_str());
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        spdlog::error("SQL Execute failed: {} | Error: {}", sql, PQerrorMessage(g->conn));
+        spdlog::error("SQL Execute failed: {} | Error: {}", sql, PQerrorMessage(g.get()));
         PQclear(res);
         return false;
     }
@@ -16,10 +130,11 @@ bool PooledDbClient::Execute(const std::string& sql) {
 }
 
 std::string PooledDbClient::GetUserPassword(int64_t uid) {
+    trace::Span span("db.GetUserPassword");
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return "";
+    if (!g) return "";
     std::string sql = "SELECT password FROM t_user WHERE id=" + std::to_string(uid);
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    PGresult* res = PQexec(g.get(), sql.c_str());
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         if (res) PQclear(res);
         return "";
@@ -30,102 +145,93 @@ std::string PooledDbClient::GetUserPassword(int64_t uid) {
     return password;
 }
 
-bool PooledDbClient::SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content) {
-    auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
-    long now = time(nullptr);
-    std::ostringstream oss;
-    oss << "INSERT INTO t_chat_msg (msg_id, from_uid, to_uid, content, create_time) VALUES ('"
-        << msg_id << "', " << from_uid << ", " << to_uid << ", '" << content << "', " << now << ")";
-    PGresult* res = PQexec(g->conn, oss.str().c_str());
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        spdlog::error("insert Msg failed:{} | Error:{}", oss.str(), PQerrorMessage(g->conn));
-        PQclear(res);
-        return false;
-    }
-    PQclear(res);
-    return true;
+// 单聊按接收方分片, 离线同步只需查一个分片
+int64_t PooledDbClient::SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content) {
+    trace::Span span("db.SaveMessage");
+    return InsertMsg(kSeqChat, msg_id, from_uid, to_uid, content);
 }
 
-std::vector<im::ChatMsg> PooledDbClient::GetofflineMsgs(int64_t uid, int64_t last_msg_id) {
-    std::vector<im::ChatMsg> msgs;
-    auto g = pool_->Acquire();
-    if (!g || !g->conn) return msgs;
-    std::string sql = "SELECT msg_id, from_uid, to_uid, content, create_time FROM t_chat_msg WHERE to_uid=" + std::to_string(uid)
-                      + " AND id > " + std::to_string(last_msg_id) + " ORDER BY id ASC LIMIT 100";
-    PGresult* res = PQexec(g->conn, sql.c_str());
-    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
-        int rows = PQntuples(res);
-        for (int i = 0; i < rows; ++i) {
-            im::ChatMsg msg;
-            msg.set_from_uid(std::stoll(PQgetvalue(res, i, 1)));
-            msg.set_to_uid(std::stoll(PQgetvalue(res, i, 2)));
-            msg.set_content(PQgetvalue(res, i, 3));
-            msg.set_create_time(std::stoll(PQgetvalue(res, i, 4)));
-            msgs.push_back(msg);
-        }
-    }
-    if (res) PQclear(res);
-    return msgs;
+// msg_id 由各节点按时钟生成, 与提交顺序无关, 不能作为游标; 各分片的自增 id 互不相关, 也不能
+std::vector<im::ChatMsg> PooledDbClient::GetofflineMsgs(int64_t uid, int64_t after_seq) {
+    trace::Span span("db.GetOfflineMsgs");
+    std::string sql = "SELECT msg_id, from_uid, to_uid, content, create_time, seq FROM t_chat_msg WHERE to_uid=" + std::to_string(uid)
+                      + " AND seq > " + std::to_string(after_seq) + " ORDER BY seq ASC LIMIT " + std::to_string(kMsgPageSize);
+    return QueryShardedMsgs(uid, uid, sql, false);
 }
 
+// 用户名/邮箱/口令/验证消息都来自客户端, 一律用参数化查询
 int64_t PooledDbClient::CreateUser(const std::string& username, const std::string& password, const std::string& email) {
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return -1;
-    std::string sql = "INSERT INTO t_user (username, password, email) VALUES ('" + username + "', '" + password + "', '" + email + "') RETURNING id";
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    if (!g) return -1;
+    const char* params[3] = {username.c_str(), password.c_str(), email.c_str()};
+    PGresult* res = PQexecParams(g.get(), "INSERT INTO t_user (username, password, email) VALUES ($1, $2, $3) RETURNING id",
+                                 3, nullptr, params, nullptr, nullptr, 0);
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         if (res) PQclear(res);
         return -1;
     }
     int64_t uid = std::stoll(PQgetvalue(res, 0, 0));
     PQclear(res);
+    MarkWrite(uid);
     return uid;
 }
 
-bool PooledDbClient::CheckUserByEmail(const std::string& email, const std::string& password, im::HttpLoginRes& user_info) {
+bool PooledDbClient::GetUserByEmail(const std::string& email, UserCredential& credential) {
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
-    std::string sql = "SELECT id, username, password FROM t_user WHERE email='" + email + "'";
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    if (!g) return false;
+    const char* params[1] = {email.c_str()};
+    PGresult* res = PQexecParams(g.get(), "SELECT id, username, password FROM t_user WHERE email = $1",
+                                 1, nullptr, params, nullptr, nullptr, 0);
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         if (res) PQclear(res);
         return false;
     }
-    std::string db_pass = PQgetvalue(res, 0, 2);
-    if (db_pass != password) {
-        PQclear(res);
-        return false;
-    }
-    user_info.set_uid(std::stoll(PQgetvalue(res, 0, 0)));
-    user_info.set_nickname(PQgetvalue(res, 0, 1));
-    user_info.set_token(db_pass);
+    credential.uid = std::stoll(PQgetvalue(res, 0, 0));
+    credential.nickname = PQgetvalue(res, 0, 1);
+    credential.password = PQgetvalue(res, 0, 2);
     PQclear(res);
     return true;
 }
 
+bool PooledDbClient::UpdatePassword(int64_t uid, const std::string& password) {
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    std::string id = std::to_string(uid);
+    const char* params[2] = {password.c_str(), id.c_str()};
+    PGresult* res = PQexecParams(g.get(), "UPDATE t_user SET password = $1 WHERE id = $2", 2, nullptr, params, nullptr, nullptr, 0);
+    bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) spdlog::error("UpdatePassword failed: uid={} | Error: {}", uid, PQerrorMessage(g.get()));
+    PQclear(res);
+    if (!ok) return false;
+    MarkWrite(uid);
+    return true;
+}
+
 bool PooledDbClient::CreateFriendRequest(int64_t from_uid, int64_t to_uid, const std::string& reason, int64_t& out_req_id) {
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
-    long now = time(nullptr);
-    std::string sql = "INSERT INTO t_friend_request (from_uid, to_uid, reason, create_time) VALUES (" + std::to_string(from_uid)
-        + ", " + std::to_string(to_uid) + ", '" + reason + "', " + std::to_string(now) + ") RETURNING id";
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    if (!g) return false;
+    std::string from = std::to_string(from_uid);
+    std::string to = std::to_string(to_uid);
+    std::string now = std::to_string(time(nullptr));
+    const char* params[4] = {from.c_str(), to.c_str(), reason.c_str(), now.c_str()};
+    PGresult* res = PQexecParams(g.get(), "INSERT INTO t_friend_request (from_uid, to_uid, reason, create_time) VALUES ($1, $2, $3, $4) RETURNING id",
+                                 4, nullptr, params, nullptr, nullptr, 0);
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         if (res) PQclear(res);
         return false;
     }
     out_req_id = std::stoll(PQgetvalue(res, 0, 0));
     PQclear(res);
+    MarkWrite(from_uid);
     return true;
 }
 
 std::vector<im::FriendRequest> PooledDbClient::GetFriendRequestsForUser(int64_t uid) {
     std::vector<im::FriendRequest> list;
-    auto g = pool_->Acquire();
-    if (!g || !g->conn) return list;
+    auto g = AcquireRead(uid);
+    if (!g) return list;
     std::string sql = "SELECT id, from_uid, to_uid, reason, create_time, status FROM t_friend_request WHERE to_uid=" + std::to_string(uid) + " AND status=0 ORDER BY id ASC";
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    PGresult* res = PQexec(g.get(), sql.c_str());
     if (PQresultStatus(res) == PGRES_TUPLES_OK) {
         int rows = PQntuples(res);
         for (int i = 0; i < rows; ++i) {
@@ -145,9 +251,9 @@ std::vector<im::FriendRequest> PooledDbClient::GetFriendRequestsForUser(int64_t
 
 bool PooledDbClient::AcceptFriendRequest(int64_t req_id) {
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
+    if (!g) return false;
     std::string sql = "SELECT from_uid, to_uid FROM t_friend_request WHERE id=" + std::to_string(req_id) + " AND status=0";
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    PGresult* res = PQexec(g.get(), sql.c_str());
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         if (res) PQclear(res);
         return false;
@@ -158,8 +264,8 @@ bool PooledDbClient::AcceptFriendRequest(int64_t req_id) {
     long now = time(nullptr);
     std::string ins1 = "INSERT INTO t_friend (uid, friend_uid, create_time) VALUES (" + std::to_string(from_uid) + ", " + std::to_string(to_uid) + ", " + std::to_string(now) + ") ON CONFLICT DO NOTHING";
     std::string ins2 = "INSERT INTO t_friend (uid, friend_uid, create_time) VALUES (" + std::to_string(to_uid) + ", " + std::to_string(from_uid) + ", " + std::to_string(now) + ") ON CONFLICT DO NOTHING";
-    PGresult* r1 = PQexec(g->conn, ins1.c_str());
-    PGresult* r2 = PQexec(g->conn, ins2.c_str());
+    PGresult* r1 = PQexec(g.get(), ins1.c_str());
+    PGresult* r2 = PQexec(g.get(), ins2.c_str());
     if (PQresultStatus(r1) != PGRES_COMMAND_OK || PQresultStatus(r2) != PGRES_COMMAND_OK) {
         if (r1) PQclear(r1);
         if (r2) PQclear(r2);
@@ -168,16 +274,23 @@ bool PooledDbClient::AcceptFriendRequest(int64_t req_id) {
     if (r1) PQclear(r1);
     if (r2) PQclear(r2);
     std::string upd = "UPDATE t_friend_request SET status=1 WHERE id=" + std::to_string(req_id);
-    PGresult* ur = PQexec(g->conn, upd.c_str());
+    PGresult* ur = PQexec(g.get(), upd.c_str());
     if (ur) PQclear(ur);
+    MarkWrite(from_uid);
+    MarkWrite(to_uid);
     return true;
 }
 
+bool PooledDbClient::RejectFriendRequest(int64_t req_id) {
+    return Execute("UPDATE t_friend_request SET status=2 WHERE id=" + std::to_string(req_id));
+}
+
 bool PooledDbClient::AreFriends(int64_t uid1, int64_t uid2) {
-    auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
+    trace::Span span("db.AreFriends");
+    auto g = AcquireRead(uid1);
+    if (!g) return false;
     std::string sql = "SELECT 1 FROM t_friend WHERE uid=" + std::to_string(uid1) + " AND friend_uid=" + std::to_string(uid2) + " LIMIT 1";
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    PGresult* res = PQexec(g.get(), sql.c_str());
     bool ok = (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0);
     if (res) PQclear(res);
     return ok;
@@ -185,10 +298,10 @@ bool PooledDbClient::AreFriends(int64_t uid1, int64_t uid2) {
 
 std::vector<int64_t> PooledDbClient::ListFriends(int64_t uid) {
     std::vector<int64_t> out;
-    auto g = pool_->Acquire();
-    if (!g || !g->conn) return out;
+    auto g = AcquireRead(uid);
+    if (!g) return out;
     std::string sql = "SELECT friend_uid FROM t_friend WHERE uid=" + std::to_string(uid);
-    PGresult* res = PQexec(g->conn, sql.c_str());
+    PGresult* res = PQexec(g.get(), sql.c_str());
     if (PQresultStatus(res) == PGRES_TUPLES_OK) {
         int rows = PQntuples(res);
         for (int i = 0; i < rows; ++i) {
@@ -199,48 +312,46 @@ std::vector<int64_t> PooledDbClient::ListFriends(int64_t uid) {
     return out;
 }
 
-bool PooledDbClient::SaveGroupMessage(const std::string& msg_id, int64_t group_id, int64_t from_uid, const std::string& content) {
+// 读扩散：消息只存一份, 按群ID分片
+int64_t PooledDbClient::SaveGroupMessage(const std::string& msg_id, int64_t group_id, int64_t from_uid, const std::string& content) {
+    return InsertMsg(kSeqGroup, msg_id, from_uid, group_id, content);
+}
+
+std::vector<im::ChatMsg> PooledDbClient::GetGroupMsgs(int64_t group_id, int64_t after_seq) {
+    // 群聊查询：读扩散，只查一份数据
+    std::string sql = "SELECT msg_id, from_uid, group_id, content, create_time, seq FROM t_group_msg WHERE group_id=" + std::to_string(group_id)
+                      + " AND seq > " + std::to_string(after_seq) + " ORDER BY seq ASC LIMIT " + std::to_string(kMsgPageSize);
+    return QueryShardedMsgs(group_id, GroupStickyKey(group_id), sql, true);
+}
+
+// 对象 key 含客户端给出的文件名, 用参数化查询
+bool PooledDbClient::SaveObjectFid(const std::string& object_key, const std::string& fid) {
+    trace::Span span("db.SaveObjectFid");
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return false;
-    long now = time(nullptr);
-    
-    // 读扩散：消息只存一份
-    std::ostringstream oss;
-    oss << "INSERT INTO t_group_msg (msg_id, group_id, from_uid, content, create_time) VALUES ('"
-        << msg_id << "', " << group_id << ", " << from_uid << ", '" << content << "', " << now << ")";
-    
-    PGresult* res = PQexec(g->conn, oss.str().c_str());
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        spdlog::error("Group insert failed: {} | Error: {}", oss.str(), PQerrorMessage(g->conn));
-        PQclear(res);
-        return false;
-    }
+    if (!g) return false;
+    std::string now = std::to_string(time(nullptr));
+    const char* params[3] = {object_key.c_str(), fid.c_str(), now.c_str()};
+    PGresult* res = PQexecParams(g.get(),
+                                 "INSERT INTO t_object_fid (object_key, fid, create_time) VALUES ($1, $2, $3) "
+                                 "ON CONFLICT (object_key) DO UPDATE SET fid = EXCLUDED.fid",
+                                 3, nullptr, params, nullptr, nullptr, 0);
+    bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) spdlog::error("SaveObjectFid failed: key={} | Error: {}", object_key, PQerrorMessage(g.get()));
     PQclear(res);
-    return true;
+    return ok;
 }
 
-std::vector<im::ChatMsg> PooledDbClient::GetGroupMsgs(int64_t group_id, int64_t last_msg_id) {
-    std::vector<im::ChatMsg> msgs;
+// 读主库: 刚上传的对象可能被其它节点立即查询, 副本延迟会让下载地址暂时缺失
+std::string PooledDbClient::GetObjectFid(const std::string& object_key) {
+    trace::Span span("db.GetObjectFid");
     auto g = pool_->Acquire();
-    if (!g || !g->conn) return msgs;
-    
-    // 群聊查询：读扩散，只查一份数据
-    std::string sql = "SELECT msg_id, group_id, from_uid, content, create_time FROM t_group_msg WHERE group_id=" + std::to_string(group_id)
-                      + " AND id > " + std::to_string(last_msg_id) + " ORDER BY id ASC LIMIT 100";
-    
-    PGresult* res = PQexec(g->conn, sql.c_str());
-    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
-        int rows = PQntuples(res);
-        for (int i = 0; i < rows; ++i) {
-            im::ChatMsg msg;
-            msg.set_from_uid(std::stoll(PQgetvalue(res, i, 2)));
-            msg.set_to_uid(std::stoll(PQgetvalue(res, i, 1))); // 群ID作为to_uid
-            msg.set_content(PQgetvalue(res, i, 3));
-            msg.set_create_time(std::stoll(PQgetvalue(res, i, 4)));
-            msgs.push_back(msg);
-        }
+    if (!g) return "";
+    const char* params[1] = {object_key.c_str()};
+    PGresult* res = PQexecParams(g.get(), "SELECT fid FROM t_object_fid WHERE object_key = $1", 1, nullptr, params, nullptr, nullptr, 0);
+    std::string fid;
+    if (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0) {
+        fid = PQgetvalue(res, 0, 0);
     }
-    if (res) PQclear(res);
-    return msgs;
+    PQclear(res);
+    return fid;
 }
-
@@ -1,29 +1,38 @@
 #pragma once
 #include "db_pool.h"
+#include "replica_router.h"
+#include "shard_router.h"
 #include <string>
 #include <vector>
 #include <spdlog/spdlog.h>
 #include "im.pb.h"
+#include "storage.h"
 
-class PooledDbClient {
+class PooledDbClient : public DbClient {
 public:
 
-    explicit PooledDbClient(DbPool* pool) : pool_(pool) {}
+    // router 为空时所有读写都走 pool (主库); shards 为空时消息表也在主库
+    explicit PooledDbClient(DbPool* pool, ReplicaRouter* router = nullptr, ShardRouter* shards = nullptr)
+        : pool_(pool), router_(router), shards_(shards) {}
     bool Execute(const std::string& sql);
-    std::string GetUserPassword(int64_t uid);
-    bool SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content);
-    std::vector<im::ChatMsg> GetofflineMsgs(int64_t uid, int64_t last_msg_id);
-    int64_t CreateUser(const std::string& username, const std::string& password, const std::string& email);
-    bool CheckUserByEmail(const std::string& email, const std::string& password, im::HttpLoginRes& user_info);
-    bool CreateFriendRequest(int64_t from_uid, int64_t to_uid, const std::string& reason, int64_t& out_req_id);
-    std::vector<im::FriendRequest> GetFriendRequestsForUser(int64_t uid);
-    bool AcceptFriendRequest(int64_t req_id);
-    bool AreFriends(int64_t uid1, int64_t uid2);
-    std::vector<int64_t> ListFriends(int64_t uid);
+    std::string GetUserPassword(int64_t uid) override;
+    int64_t SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content) override;
+    std::vector<im::ChatMsg> GetofflineMsgs(int64_t uid, int64_t after_seq) override;
+    int64_t CreateUser(const std::string& username, const std::string& password, const std::string& email) override;
+    bool GetUserByEmail(const std::string& email, UserCredential& credential) override;
+    bool UpdatePassword(int64_t uid, const std::string& password) override;
+    bool CreateFriendRequest(int64_t from_uid, int64_t to_uid, const std::string& reason, int64_t& out_req_id) override;
+    std::vector<im::FriendRequest> GetFriendRequestsForUser(int64_t uid) override;
+    bool AcceptFriendRequest(int64_t req_id) override;
+    bool RejectFriendRequest(int64_t req_id) override;
+    bool AreFriends(int64_t uid1, int64_t uid2) override;
+    std::vector<int64_t> ListFriends(int64_t uid) override;
     bool SaveP2PMessage(const std::string& msg_id , int64_t from_uid , int64_t to_uid , const std::string& content);
     std::vector<im::ChatMsg> GetP2PMsgs(int64_t uid , int64_t last_msg_id);
-    bool SaveGroupMessage(const std::string& msg_id , int64_t group_id , int64_t from_uid , const std::string& content);
-    std::vector<im::ChatMsg> GetGroupMsgs(int64_t group_id , int64_t last_msg_id);
+    int64_t SaveGroupMessage(const std::string& msg_id , int64_t group_id , int64_t from_uid , const std::string& content) override;
+    std::vector<im::ChatMsg> GetGroupMsgs(int64_t group_id , int64_t after_seq) override;
+    bool SaveObjectFid(const std::string& object_key, const std::string& fid) override;
+    std::string GetObjectFid(const std::string& object_key) override;
     int64_t CreateGroup(int64_t owber_uid , const std::string& group_name);
     bool AddGroupMember(int64_t group_id , int64_t member_uid);
     bool RemoveGroupMember(int64_t group_id , int64_t member_uid);
@@ -32,7 +41,24 @@ public:
     bool IsGroupMember(int64_t group_id , int64_t uid);
 
 private:
+    static constexpr size_t kMsgPageSize = 100;
+
+    // 群消息的 read-your-writes 记在负数 key 上, 与 uid 共用 ReplicaRouter 的槽位表
+    static int64_t GroupStickyKey(int64_t group_id) { return -group_id; }
+
+    // t_msg_seq.scope: 每个接收方 / 群各有一个 seq 计数器
+    enum SeqScope { kSeqChat = 1, kSeqGroup = 2 };
+
+    ReplicaRouter::ReadLease AcquireRead(int64_t uid);
+    void MarkWrite(int64_t uid);
+    ShardRouter::Route LocateShard(int64_t key);
+    std::vector<im::ChatMsg> QueryMsgs(DbPool* shard, int64_t uid, const std::string& sql, bool group);
+    std::vector<im::ChatMsg> QueryShardedMsgs(int64_t key, int64_t uid, const std::string& sql, bool group);
+    int64_t InsertMsg(SeqScope scope, const std::string& msg_id, int64_t from_uid, int64_t key, const std::string& content);
+    int64_t SeqFloor(DbPool* previous, SeqScope scope, int64_t key);
 
     DbPool* pool_;
-    
+    ReplicaRouter* router_;
+    ShardRouter* shards_;
+
 };
\ No newline at end of file
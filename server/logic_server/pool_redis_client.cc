@@ -4,8 +4,8 @@
 
 bool PooledRedisClient::Set(const std::string& key, const std::string& value) {
     auto g = pool_->Acquire();
-    if (!g || !g->ctx) return false;
-    redisReply* reply = (redisReply*)redisCommand(g->ctx, "SET %s %s", key.c_str(), value.c_str());
+    if (!g) return false;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "SET %s %s", key.c_str(), value.c_str());
     if (!reply) {
         spdlog::error("Redis SET reply null");
         return false;
@@ -21,8 +21,8 @@ bool PooledRedisClient::Set(const std::string& key, const std::string& value) {
 
 std::optional<std::string> PooledRedisClient::Get(const std::string& key) {
     auto g = pool_->Acquire();
-    if (!g || !g->ctx) return std::nullopt;
-    redisReply* reply = (redisReply*)redisCommand(g->ctx, "GET %s", key.c_str());
+    if (!g) return std::nullopt;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "GET %s", key.c_str());
     if (!reply) return std::nullopt;
     std::optional<std::string> result;
     if (reply->type == REDIS_REPLY_STRING) {
@@ -30,4 +30,173 @@ std::optional<std::string> PooledRedisClient::Get(const std::string& key) {
     }
     freeReplyObject(reply);
     return result;
-}
\ No newline at end of file
+}
+
+bool PooledRedisClient::HSet(const std::string& key, const std::string& field, const std::string& value) {
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "HSET %s %s %s", key.c_str(), field.c_str(), value.c_str());
+    if (!reply) {
+        spdlog::error("Redis HSET reply null");
+        return false;
+    }
+    bool ok = true;
+    if (reply->type == REDIS_REPLY_ERROR) {
+        spdlog::error("Redis HSET error: {}", reply->str);
+        ok = false;
+    }
+    freeReplyObject(reply);
+    return ok;
+}
+
+std::optional<std::string> PooledRedisClient::HGet(const std::string& key, const std::string& field) {
+    auto g = pool_->Acquire();
+    if (!g) return std::nullopt;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "HGET %s %s", key.c_str(), field.c_str());
+    if (!reply) return std::nullopt;
+    std::optional<std::string> result;
+    if (reply->type == REDIS_REPLY_STRING) {
+        result = std::string(reply->str, reply->len);
+    }
+    freeReplyObject(reply);
+    return result;
+}
+
+bool PooledRedisClient::SetIfGreater(const std::string& key, int64_t value) {
+    // 不经过 tonumber: Lua 数字是 double, 超过 2^53 的值比较会出错. 非负十进制串先比长度再比字典序
+    static const char* kScript =
+        "local cur = redis.call('GET', KEYS[1]) or '0' local v = ARGV[1] "
+        "if #v > #cur or (#v == #cur and v > cur) then redis.call('SET', KEYS[1], v) return 1 end return 0";
+    if (value < 0) return true;
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    std::string arg = std::to_string(value);
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "EVAL %s 1 %s %s", kScript, key.c_str(), arg.c_str());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    if (!ok) spdlog::error("Redis SetIfGreater error: {}", reply->str);
+    freeReplyObject(reply);
+    return ok;
+}
+
+bool PooledRedisClient::SetNXOrGet(const std::string& key, const std::string& value, int ttl_sec, std::optional<std::string>& existing) {
+    // 一次往返完成判断和写入; Lua 的 false 对应 nil 回复
+    static const char* kScript =
+        "local v = redis.call('GET', KEYS[1]) if v then return v end "
+        "redis.call('SET', KEYS[1], ARGV[1], 'EX', ARGV[2]) return false";
+    existing.reset();
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    std::string ttl = std::to_string(ttl_sec > 0 ? ttl_sec : 1);
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "EVAL %s 1 %b %b %s", kScript, key.data(), key.size(), value.data(),
+                                                  value.size(), ttl.c_str());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    if (!ok) spdlog::error("Redis SetNXOrGet error: {}", reply->str);
+    if (reply->type == REDIS_REPLY_STRING) existing = std::string(reply->str, reply->len);
+    freeReplyObject(reply);
+    return ok;
+}
+
+bool PooledRedisClient::SetEx(const std::string& key, const std::string& value, int ttl_sec) {
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    std::string ttl = std::to_string(ttl_sec > 0 ? ttl_sec : 1);
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "SET %b %b EX %s", key.data(), key.size(), value.data(), value.size(), ttl.c_str());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    if (!ok) spdlog::error("Redis SET EX error: {}", reply->str);
+    freeReplyObject(reply);
+    return ok;
+}
+
+bool PooledRedisClient::Del(const std::string& key) {
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "DEL %b", key.data(), key.size());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    if (!ok) spdlog::error("Redis DEL error: {}", reply->str);
+    freeReplyObject(reply);
+    return ok;
+}
+
+bool PooledRedisClient::ZAddLex(const std::string& key, const std::vector<std::string>& members, int ttl_sec) {
+    if (members.empty()) return true;
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    argv.reserve(2 + members.size() * 2);
+    argvlen.reserve(argv.capacity());
+    argv.push_back("ZADD");
+    argvlen.push_back(4);
+    argv.push_back(key.c_str());
+    argvlen.push_back(key.size());
+    for (const auto& m : members) {
+        argv.push_back("0");
+        argvlen.push_back(1);
+        argv.push_back(m.c_str());
+        argvlen.push_back(m.size());
+    }
+    redisReply* reply = (redisReply*)redisCommandArgv(g.get(), static_cast<int>(argv.size()), argv.data(), argvlen.data());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    if (!ok) spdlog::error("Redis ZADD error: {}", reply->str);
+    freeReplyObject(reply);
+    if (ok && ttl_sec > 0) {
+        reply = (redisReply*)redisCommand(g.get(), "EXPIRE %s %d", key.c_str(), ttl_sec);
+        if (reply) freeReplyObject(reply);
+    }
+    return ok;
+}
+
+std::vector<std::string> PooledRedisClient::ZRangeByLex(const std::string& key, const std::string& min, const std::string& max) {
+    std::vector<std::string> out;
+    auto g = pool_->Acquire();
+    if (!g) return out;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "ZRANGEBYLEX %s %s %s", key.c_str(), min.c_str(), max.c_str());
+    if (!reply) return out;
+    if (reply->type == REDIS_REPLY_ARRAY) {
+        out.reserve(reply->elements);
+        for (size_t i = 0; i < reply->elements; ++i) {
+            out.emplace_back(reply->element[i]->str, reply->element[i]->len);
+        }
+    }
+    freeReplyObject(reply);
+    return out;
+}
+
+bool PooledRedisClient::ZRemRangeByLex(const std::string& key, const std::string& min, const std::string& max) {
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    redisReply* reply = (redisReply*)redisCommand(g.get(), "ZREMRANGEBYLEX %s %s %s", key.c_str(), min.c_str(), max.c_str());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    freeReplyObject(reply);
+    return ok;
+}
+
+bool PooledRedisClient::ZRem(const std::string& key, const std::vector<std::string>& members) {
+    if (members.empty()) return true;
+    auto g = pool_->Acquire();
+    if (!g) return false;
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    argv.reserve(2 + members.size());
+    argvlen.reserve(argv.capacity());
+    argv.push_back("ZREM");
+    argvlen.push_back(4);
+    argv.push_back(key.c_str());
+    argvlen.push_back(key.size());
+    for (const auto& m : members) {
+        argv.push_back(m.c_str());
+        argvlen.push_back(m.size());
+    }
+    redisReply* reply = (redisReply*)redisCommandArgv(g.get(), static_cast<int>(argv.size()), argv.data(), argvlen.data());
+    if (!reply) return false;
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    if (!ok) spdlog::error("Redis ZREM error: {}", reply->str);
+    freeReplyObject(reply);
+    return ok;
+}
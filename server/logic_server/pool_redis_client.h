@@ -1,13 +1,25 @@
 #pragma once
 #include "redis_pool.h"
+#include "storage.h"
 #include <optional>
 #include <string>
+#include <vector>
 
-class PooledRedisClient {
+class PooledRedisClient : public KvClient {
 public:
     explicit PooledRedisClient(RedisPool* pool) : pool_(pool) {}
-    bool Set(const std::string& key, const std::string& value);
-    std::optional<std::string> Get(const std::string& key);
+    bool Set(const std::string& key, const std::string& value) override;
+    std::optional<std::string> Get(const std::string& key) override;
+    bool HSet(const std::string& key, const std::string& field, const std::string& value) override;
+    std::optional<std::string> HGet(const std::string& key, const std::string& field) override;
+    bool SetIfGreater(const std::string& key, int64_t value) override;
+    bool SetNXOrGet(const std::string& key, const std::string& value, int ttl_sec, std::optional<std::string>& existing) override;
+    bool SetEx(const std::string& key, const std::string& value, int ttl_sec) override;
+    bool Del(const std::string& key) override;
+    bool ZAddLex(const std::string& key, const std::vector<std::string>& members, int ttl_sec) override;
+    std::vector<std::string> ZRangeByLex(const std::string& key, const std::string& min, const std::string& max) override;
+    bool ZRemRangeByLex(const std::string& key, const std::string& min, const std::string& max) override;
+    bool ZRem(const std::string& key, const std::vector<std::string>& members) override;
 private:
     RedisPool* pool_;
 };
\ No newline at end of file
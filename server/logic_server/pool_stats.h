@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../../common/metrics/metrics.h"
+
+struct PoolOptions {
+    size_t min_pool = 2;
+    size_t max_pool = 20;
+    size_t max_pool_limit = 0;         // 槽位数, 运行时 max_pool 最多调到此值; 0 表示与 max_pool 相同
+    int acquire_timeout_ms = 5000;
+    int idle_timeout_sec = 300;        // 超过 min_pool 的空闲连接闲置多久后回收
+    int keepalive_interval_sec = 30;   // 后台保活/巡检周期
+};
+
+// 获取连接等待时间直方图的桶上界 (微秒), 最后一个桶为 +Inf
+constexpr std::array<uint64_t, 10> kPoolWaitBucketsUs = {
+    10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 1000000};
+
+struct PoolStatsSnapshot {
+    size_t in_use = 0;
+    size_t idle = 0;
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+    uint64_t reaped = 0;
+    uint64_t acquired = 0;
+    uint64_t timeouts = 0;
+    uint64_t health_failures = 0;
+    uint64_t wait_sum_us = 0;
+    std::array<uint64_t, kPoolWaitBucketsUs.size() + 1> wait_buckets{};
+};
+
+// 连接池计数器, 全部为 relaxed 原子操作, 不占用池的互斥锁;
+// 快路径每次获取都会记一次, 用按线程分片的 metrics::Counter, 避免各线程争抢同一缓存行
+class PoolStats {
+public:
+    void RecordAcquire(uint64_t wait_us, bool ok) {
+        size_t i = 0;
+        while (i < kPoolWaitBucketsUs.size() && wait_us > kPoolWaitBucketsUs[i]) ++i;
+        wait_buckets_[i].fetch_add(1, std::memory_order_relaxed);
+        wait_sum_us_.fetch_add(wait_us, std::memory_order_relaxed);
+        (ok ? acquired_ : timeouts_).fetch_add(1, std::memory_order_relaxed);
+    }
+    // 无锁快路径命中, 不读时钟, 计入 0 等待桶
+    void RecordFastAcquire() { fast_acquired_.Inc(); }
+    void RecordCreated() { created_.fetch_add(1, std::memory_order_relaxed); }
+    void RecordDestroyed() { destroyed_.fetch_add(1, std::memory_order_relaxed); }
+    void RecordReaped() { reaped_.fetch_add(1, std::memory_order_relaxed); }
+    void RecordHealthFailure() { health_failures_.fetch_add(1, std::memory_order_relaxed); }
+
+    // in_use / idle 由调用方在池锁内填写
+    PoolStatsSnapshot Snapshot(size_t in_use, size_t idle) const {
+        PoolStatsSnapshot s;
+        s.in_use = in_use;
+        s.idle = idle;
+        s.created = created_.load(std::memory_order_relaxed);
+        s.destroyed = destroyed_.load(std::memory_order_relaxed);
+        s.reaped = reaped_.load(std::memory_order_relaxed);
+        uint64_t fast = fast_acquired_.Value();
+        s.acquired = acquired_.load(std::memory_order_relaxed) + fast;
+        s.timeouts = timeouts_.load(std::memory_order_relaxed);
+        s.health_failures = health_failures_.load(std::memory_order_relaxed);
+        s.wait_sum_us = wait_sum_us_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < s.wait_buckets.size(); ++i) {
+            s.wait_buckets[i] = wait_buckets_[i].load(std::memory_order_relaxed);
+        }
+        s.wait_buckets[0] += fast;
+        return s;
+    }
+
+    static std::string Describe(const PoolStatsSnapshot& s) {
+        uint64_t total = s.acquired + s.timeouts;
+        std::string out = "in_use=" + std::to_string(s.in_use) + " idle=" + std::to_string(s.idle) +
+                          " created=" + std::to_string(s.created) + " destroyed=" + std::to_string(s.destroyed) +
+                          " reaped=" + std::to_string(s.reaped) + " acquired=" + std::to_string(s.acquired) +
+                          " timeouts=" + std::to_string(s.timeouts) +
+                          " health_failures=" + std::to_string(s.health_failures) +
+                          " avg_wait_us=" + std::to_string(total ? s.wait_sum_us / total : 0) + " wait_hist=[";
+        for (size_t i = 0; i < s.wait_buckets.size(); ++i) {
+            if (i) out += " ";
+            out += (i < kPoolWaitBucketsUs.size() ? "le" + std::to_string(kPoolWaitBucketsUs[i]) : std::string("inf")) +
+                   ":" + std::to_string(s.wait_buckets[i]);
+        }
+        return out + "]";
+    }
+
+private:
+    std::atomic<uint64_t> created_{0};
+    std::atomic<uint64_t> destroyed_{0};
+    std::atomic<uint64_t> reaped_{0};
+    std::atomic<uint64_t> acquired_{0};
+    metrics::Counter fast_acquired_;
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> health_failures_{0};
+    std::atomic<uint64_t> wait_sum_us_{0};
+    std::array<std::atomic<uint64_t>, kPoolWaitBucketsUs.size() + 1> wait_buckets_{};
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <arpa/inet.h>
+#include <string>
+#include "im.pb.h"
+
+// 组装下行推送包 (Cmd 0x1005): 12 字节包头 + MsgPush
+inline std::string PackPushMsg(const im::ChatMsg& chat_msg) {
+
+    im::MsgPush push_pkg;
+    *push_pkg.mutable_msg() = chat_msg;
+    
+    std::string body_bytes;
+    push_pkg.SerializeToString(&body_bytes);
+
+    uint32_t total_len = 12 + body_bytes.size();
+    uint16_t version = 1;
+    uint16_t cmd_id = 0x1005;
+    uint32_t seq_id = 0;      
+
+    uint32_t net_len = htonl(total_len);
+    uint16_t net_ver = htons(version);
+    uint16_t net_cmd = htons(cmd_id);
+    uint32_t net_seq = htonl(seq_id);
+
+    std::string packet;
+    packet.append((char*)&net_len, 4);
+    packet.append((char*)&net_ver, 2);
+    packet.append((char*)&net_cmd, 2);
+    packet.append((char*)&net_seq, 4);
+    packet.append(body_bytes);
+
+    return packet;
+}
@@ -0,0 +1,193 @@
+#include "push_stream.h"
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+#include "../../common/trace/trace.h"
+
+GatewayPushStream::GatewayPushStream(const std::string& address, const PushStreamOptions& options, StalledFn on_stalled)
+    : address_(address), options_(options), on_stalled_(std::move(on_stalled)) {
+    if (options_.max_batch_frames == 0) options_.max_batch_frames = 1;
+    if (options_.max_inflight_frames == 0) options_.max_inflight_frames = 1;
+    if (options_.ack_timeout_ms <= 0) options_.ack_timeout_ms = 1;
+    // 长时间空闲的流依靠 keepalive 发现网关失联
+    grpc::ChannelArguments args;
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, 10000);
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, 5000);
+    args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    stub_ = im::GatewayService::NewStub(grpc::CreateCustomChannel(address_, grpc::InsecureChannelCredentials(), args));
+    worker_ = std::thread(&GatewayPushStream::Run, this);
+}
+
+GatewayPushStream::~GatewayPushStream() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+        if (active_ctx_) active_ctx_->TryCancel();
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+bool GatewayPushStream::Push(int64_t to_uid, int64_t msg_id, std::string content) {
+    trace::Span span("push.enqueue");
+    uint64_t trace_id = trace::CurrentTraceId();
+    int64_t enqueue_us = trace_id ? trace::NowUs() : 0;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stop_ || backing_off_ || queue_.size() >= options_.max_queue_frames) return false;
+        queue_.push_back({next_frame_id_++, to_uid, msg_id, std::move(content), trace_id, enqueue_us});
+        ++stats_.pushed;
+    }
+    cv_.notify_all();
+    return true;
+}
+
+PushStreamStats GatewayPushStream::Stats() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return stats_;
+}
+
+void GatewayPushStream::DropPendingLocked() {
+    size_t dropped = inflight_.size() + queue_.size();
+    if (dropped == 0) return;
+    stats_.dropped += dropped;
+    inflight_.clear();
+    queue_.clear();
+    spdlog::warn("push stream {} broken, dropped {} frames (recipients will catch up via sync)", address_, dropped);
+}
+
+// 没有待推送数据时不建流; 建流后一直复用, 断开后退避重连
+void GatewayPushStream::Run() {
+    int backoff_ms = options_.reconnect_min_ms;
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_) {
+        cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) break;
+        lk.unlock();
+        bool healthy = ServeStream();
+        lk.lock();
+        DropPendingLocked();
+        if (stop_) break;
+
+        backoff_ms = healthy ? options_.reconnect_min_ms : std::min(backoff_ms * 2, options_.reconnect_max_ms);
+        ++stats_.reconnects;
+        backing_off_ = true;
+        cv_.wait_for(lk, std::chrono::milliseconds(backoff_ms), [this] { return stop_; });
+        backing_off_ = false;
+    }
+}
+
+// 返回本次流是否收到过回执, 用于决定重连退避
+bool GatewayPushStream::ServeStream() {
+    grpc::ClientContext ctx;
+    uint64_t acked_before = 0;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stop_) return false;
+        active_ctx_ = &ctx;
+        broken_ = false;
+        acked_before = stats_.delivered + stats_.not_found;
+    }
+    std::unique_ptr<Stream> stream = stub_->PushStream(&ctx);
+    std::thread reader(&GatewayPushStream::ReadLoop, this, stream.get());
+    std::thread watchdog(&GatewayPushStream::WatchAcks, this, &ctx);
+
+    std::unique_lock<std::mutex> lk(mu_);
+    while (true) {
+        cv_.wait(lk, [this] {
+            return stop_ || broken_ || (!queue_.empty() && inflight_.size() < options_.max_inflight_frames);
+        });
+        if (stop_ || broken_) break;
+
+        im::PushBatch batch;
+        size_t n = std::min({queue_.size(), options_.max_batch_frames, options_.max_inflight_frames - inflight_.size()});
+        auto sent_at = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            Frame& frame = queue_.front();
+            inflight_.emplace_hint(inflight_.end(), frame.id, sent_at);
+            im::PushFrame* out = batch.add_frames();
+            out->set_frame_id(frame.id);
+            out->set_to_uid(frame.to_uid);
+            out->set_msg_id(frame.msg_id);
+            out->set_content(std::move(frame.content));
+            if (frame.trace_id) {
+                out->set_trace_id(frame.trace_id);
+                int64_t now = trace::NowUs();
+                trace::Tracer::Instance().Record(frame.trace_id, "push.queue_wait", frame.enqueue_us, now - frame.enqueue_us);
+            }
+            queue_.pop_front();
+        }
+        ++stats_.batches;
+        lk.unlock();
+        cv_.notify_all();  // 唤醒监视线程开始计时
+        bool ok = stream->Write(batch);
+        lk.lock();
+        if (!ok) {
+            broken_ = true;
+            break;
+        }
+    }
+    broken_ = true;
+    lk.unlock();
+    cv_.notify_all();
+
+    ctx.TryCancel();
+    reader.join();
+    watchdog.join();
+    grpc::Status status = stream->Finish();
+    if (!status.ok() && status.error_code() != grpc::StatusCode::CANCELLED) {
+        spdlog::warn("push stream {} closed: {}", address_, status.error_message());
+    }
+
+    lk.lock();
+    active_ctx_ = nullptr;
+    return stats_.delivered + stats_.not_found > acked_before;
+}
+
+void GatewayPushStream::ReadLoop(Stream* stream) {
+    im::PushResultBatch results;
+    while (stream->Read(&results)) {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            for (const auto& r : results.results()) {
+                if (inflight_.erase(r.frame_id()) == 0) continue;
+                if (r.err_code() == 0) {
+                    ++stats_.delivered;
+                } else {
+                    ++stats_.not_found;
+                }
+            }
+        }
+        cv_.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        broken_ = true;
+    }
+    cv_.notify_all();
+}
+
+// 只看最早的在途帧: 帧按发出顺序编号, 网关按批回执
+void GatewayPushStream::WatchAcks(grpc::ClientContext* ctx) {
+    const auto timeout = std::chrono::milliseconds(options_.ack_timeout_ms);
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_ && !broken_) {
+        if (inflight_.empty()) {
+            cv_.wait(lk, [this] { return stop_ || broken_ || !inflight_.empty(); });
+            continue;
+        }
+        auto deadline = inflight_.begin()->second + timeout;
+        if (std::chrono::steady_clock::now() < deadline) {
+            cv_.wait_until(lk, deadline);
+            continue;
+        }
+        broken_ = true;
+        ++stats_.ack_timeouts;
+        spdlog::warn("push stream {}: {} frames unacked for {}ms, tearing down", address_, inflight_.size(), options_.ack_timeout_ms);
+        lk.unlock();
+        ctx->TryCancel();
+        cv_.notify_all();
+        if (on_stalled_) on_stalled_();
+        return;
+    }
+}
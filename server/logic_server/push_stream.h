@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <grpcpp/grpcpp.h>
+#include "im_service.grpc.pb.h"
+
+struct PushStreamOptions {
+    size_t max_batch_frames = 256;      // 单个 PushBatch 的最大帧数
+    size_t max_inflight_frames = 4096;  // 已发出未回执的帧数上限 (应用层流控窗口)
+    size_t max_queue_frames = 65536;    // 待发送队列上限, 超出时 Push 直接失败
+    int reconnect_min_ms = 100;
+    int reconnect_max_ms = 5000;
+    int ack_timeout_ms = 10000;         // 最早的在途帧超过该时间仍未回执 (含写阻塞) 即判定网关失联, 断流重连
+};
+
+struct PushStreamStats {
+    uint64_t pushed = 0;     // 入队成功
+    uint64_t delivered = 0;  // 网关回执已写入用户连接
+    uint64_t not_found = 0;  // 网关回执用户不在本网关
+    uint64_t dropped = 0;    // 流断开时仍在途/排队的帧
+    uint64_t batches = 0;
+    uint64_t reconnects = 0;
+    uint64_t ack_timeouts = 0;  // 因回执超时断开的次数
+};
+
+// 到单个网关的长连接推送流 (GatewayService::PushStream)
+//
+// Push 只入队; 发送线程把积压的帧合并成一个 PushBatch 写入流, 在途帧数受 max_inflight_frames 限制,
+// 流本身的 HTTP/2 窗口再提供一层背压. 接收线程按 frame_id 回收在途窗口.
+// 流断开时在途和排队的帧按失败处理 (消息已落库, 客户端离线同步可补齐), 之后按指数退避重新建流;
+// 退避期间 Push 直接返回 false. 监视线程在最早的在途帧回执超时后取消流, keepalive 之外也能发现
+// 网关卡死或写被 HTTP/2 窗口长期阻塞; 超时时调用 on_stalled, 由调用方丢弃该网关的路由缓存.
+class GatewayPushStream {
+public:
+    using StalledFn = std::function<void()>;
+
+    GatewayPushStream(const std::string& address, const PushStreamOptions& options = PushStreamOptions(),
+                      StalledFn on_stalled = nullptr);
+    ~GatewayPushStream();
+
+    GatewayPushStream(const GatewayPushStream&) = delete;
+    GatewayPushStream& operator=(const GatewayPushStream&) = delete;
+
+    // content 为已封包的下行数据, msg_id 非 0 时网关等待客户端确认; 返回 false 表示网关不可用或队列已满
+    // 调用线程处于采样追踪中时, trace id 随帧一起发给网关
+    bool Push(int64_t to_uid, int64_t msg_id, std::string content);
+
+    const std::string& Address() const { return address_; }
+    PushStreamStats Stats() const;
+
+private:
+    using Stream = grpc::ClientReaderWriter<im::PushBatch, im::PushResultBatch>;
+
+    struct Frame {
+        uint64_t id;
+        int64_t to_uid;
+        int64_t msg_id;
+        std::string content;
+        uint64_t trace_id;
+        int64_t enqueue_us;  // 仅追踪中的帧记录, 用于统计排队时间
+    };
+
+    void Run();
+    bool ServeStream();
+    void ReadLoop(Stream* stream);
+    void WatchAcks(grpc::ClientContext* ctx);
+    void DropPendingLocked();
+
+    std::string address_;
+    PushStreamOptions options_;
+    StalledFn on_stalled_;
+    std::unique_ptr<im::GatewayService::Stub> stub_;
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Frame> queue_;
+    std::map<uint64_t, std::chrono::steady_clock::time_point> inflight_;  // frame_id -> 发出时间, 首个即最早
+    uint64_t next_frame_id_ = 1;
+    bool broken_ = false;
+    bool backing_off_ = false;
+    bool stop_ = false;
+    grpc::ClientContext* active_ctx_ = nullptr;
+    PushStreamStats stats_;
+    std::thread worker_;
+};
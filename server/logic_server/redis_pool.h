@@ -1,36 +1,24 @@
 #pragma once
 #include <hiredis/hiredis.h>
-#include <mutex>
-#include <condition_variable>
-#include <deque>
-#include <memory>
 #include <string>
+#include "connection_pool.h"
 
-class RedisPool {
-public:
-    RedisPool(const std::string& host, int port, const std::string& password = "", size_t min_pool = 2, size_t max_pool = 50);
-    ~RedisPool();
-
-    struct ConnGuard {
-        redisContext* ctx = nullptr;
-        RedisPool* pool = nullptr;
-        ~ConnGuard();
-    };
+struct RedisConnTraits {
+    using Handle = redisContext*;
+    static constexpr const char* kName = "RedisPool";
 
-    std::unique_ptr<ConnGuard> Acquire(int timeout_ms = 2000);
+    std::string host;
+    int port;
+    std::string password;
 
-private:
-    redisContext* CreateConn();
-    void Release(redisContext* ctx);
+    redisContext* Create();
+    void Destroy(redisContext* ctx);
     bool IsHealthy(redisContext* ctx);
+    bool Ping(redisContext* ctx);
+};
 
-    std::string host_;
-    int port_;
-    std::string password_;
-    size_t min_pool_;
-    size_t max_pool_;
-    std::deque<redisContext*> idle_;
-    size_t total_created_ = 0;
-    std::mutex mu_;
-    std::condition_variable cv_;
-};
\ No newline at end of file
+class RedisPool : public ConnectionPool<RedisConnTraits> {
+public:
+    RedisPool(const std::string& host, int port, const std::string& password = "", const PoolOptions& options = PoolOptions())
+        : ConnectionPool(RedisConnTraits{host, port, password}, options) {}
+};
@@ -0,0 +1,147 @@
+#include "replica_router.h"
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+ReplicaRouter::ReplicaRouter(DbPool* primary, const std::vector<DbPool*>& replicas, const ReplicaOptions& options)
+    : primary_(primary), options_(options) {
+    for (DbPool* pool : replicas) {
+        auto r = std::make_unique<Replica>();
+        r->pool = pool;
+        replicas_.push_back(std::move(r));
+    }
+    if (!replicas_.empty()) {
+        monitor_ = std::thread(&ReplicaRouter::MonitorLoop, this);
+    }
+}
+
+ReplicaRouter::~ReplicaRouter() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (monitor_.joinable()) monitor_.join();
+}
+
+void ReplicaRouter::MarkWrite(int64_t uid) {
+    if (replicas_.empty() || uid == 0) return;
+    auto& slot = sticky_until_ms_[static_cast<uint64_t>(uid) % kStickySlots];
+    int64_t until = NowMs() + options_.read_your_writes_ms;
+    int64_t cur = slot.load(std::memory_order_relaxed);
+    while (cur < until && !slot.compare_exchange_weak(cur, until, std::memory_order_relaxed)) {
+    }
+}
+
+bool ReplicaRouter::IsSticky(int64_t uid) const {
+    if (uid == 0) return false;
+    return sticky_until_ms_[static_cast<uint64_t>(uid) % kStickySlots].load(std::memory_order_relaxed) > NowMs();
+}
+
+ReplicaRouter::Replica* ReplicaRouter::PickReplica() {
+    Replica* best = nullptr;
+    int best_outstanding = 0;
+    size_t n = replicas_.size();
+    size_t start = rr_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < n; ++i) {
+        Replica* r = replicas_[(start + i) % n].get();
+        if (!r->usable.load(std::memory_order_relaxed)) continue;
+        int outstanding = r->outstanding.load(std::memory_order_relaxed);
+        if (!best || outstanding < best_outstanding) {
+            best = r;
+            best_outstanding = outstanding;
+        }
+    }
+    return best;
+}
+
+ReplicaRouter::ReadLease ReplicaRouter::AcquireRead(int64_t uid) {
+    if (!replicas_.empty() && !IsSticky(uid)) {
+        if (Replica* r = PickReplica()) {
+            r->outstanding.fetch_add(1, std::memory_order_relaxed);
+            // 副本池等待时间取主库超时的一半, 超时后回退主库
+            auto g = r->pool->Acquire(r->pool->Options().acquire_timeout_ms / 2);
+            if (g) {
+                return ReadLease(std::move(g), &r->outstanding);
+            }
+            r->outstanding.fetch_sub(1, std::memory_order_relaxed);
+            if (r->usable.exchange(false)) {
+                spdlog::warn("ReplicaRouter: replica acquire failed, fallback to primary until next check");
+            }
+        }
+    }
+    return ReadLease(primary_->Acquire(), nullptr);
+}
+
+// 主库当前 WAL 位置, 作为本轮巡检各副本的追赶目标; 主库不可达时返回空串
+std::string ReplicaRouter::PrimaryLsn() {
+    auto g = primary_->Acquire(options_.check_interval_ms);
+    if (!g) return "";
+    PGresult* res = PQexec(g.get(), "SELECT pg_current_wal_lsn()");
+    std::string lsn;
+    if (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0) lsn = PQgetvalue(res, 0, 0);
+    if (res) PQclear(res);
+    return lsn;
+}
+
+// 已回放到主库巡检时的位置则延迟为 0 (主库空闲时 replay_timestamp 陈旧也不误判), 否则按最后回放事务的时间计.
+// WAL 接收进程不在 (或不是 streaming) 的副本收不到新 WAL, 直接判为不可用; 非特权账号看不到 status, 只看进程是否存在.
+// 拿不到主库位置时退回 "接收位置 == 回放位置" 的判断, 此时仍要求接收进程在线
+bool ReplicaRouter::CheckReplica(Replica& replica, const std::string& primary_lsn, int64_t& lag_ms, bool& receiving) {
+    auto g = replica.pool->Acquire(options_.check_interval_ms);
+    if (!g) return false;
+    const char* sql =
+        "SELECT EXISTS (SELECT 1 FROM pg_stat_wal_receiver WHERE status IS NULL OR status = 'streaming'), "
+        "CASE WHEN $1::pg_lsn IS NOT NULL AND pg_last_wal_replay_lsn() >= $1::pg_lsn THEN 0 "
+        "WHEN $1::pg_lsn IS NULL AND pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+        "ELSE COALESCE(EXTRACT(EPOCH FROM (now() - pg_last_xact_replay_timestamp())) * 1000, 0) END";
+    const char* params[1] = {primary_lsn.empty() ? nullptr : primary_lsn.c_str()};
+    PGresult* res = PQexecParams(g.get(), sql, 1, nullptr, params, nullptr, nullptr, 0);
+    bool ok = PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0;
+    if (ok) {
+        receiving = PQgetvalue(res, 0, 0)[0] == 't';
+        lag_ms = static_cast<int64_t>(std::strtod(PQgetvalue(res, 0, 1), nullptr));
+    } else {
+        spdlog::warn("ReplicaRouter: lag check failed: {}", PQerrorMessage(g.get()));
+    }
+    if (res) PQclear(res);
+    return ok;
+}
+
+void ReplicaRouter::MonitorLoop() {
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_) {
+        lk.unlock();
+        const std::string primary_lsn = PrimaryLsn();
+        for (size_t i = 0; i < replicas_.size(); ++i) {
+            Replica& r = *replicas_[i];
+            int64_t lag_ms = 0;
+            bool receiving = false;
+            bool reachable = CheckReplica(r, primary_lsn, lag_ms, receiving);
+            bool usable = reachable && receiving && lag_ms <= options_.max_lag_ms;
+            if (r.usable.exchange(usable) != usable) {
+                if (usable) {
+                    spdlog::info("ReplicaRouter: replica #{} back in rotation, lag={}ms", i, lag_ms);
+                } else if (reachable && !receiving) {
+                    spdlog::warn("ReplicaRouter: replica #{} WAL receiver not streaming, reads fallback to primary", i);
+                } else if (reachable) {
+                    spdlog::warn("ReplicaRouter: replica #{} lag {}ms exceeds {}ms, reads fallback to primary", i, lag_ms, options_.max_lag_ms);
+                } else {
+                    spdlog::warn("ReplicaRouter: replica #{} unreachable, reads fallback to primary", i);
+                }
+            }
+        }
+        lk.lock();
+        cv_.wait_for(lk, std::chrono::milliseconds(options_.check_interval_ms), [this] { return stop_; });
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "db_pool.h"
+
+struct ReplicaOptions {
+    int max_lag_ms = 1000;            // 复制延迟超过该值的副本不再接收读请求
+    int read_your_writes_ms = 3000;   // 用户写入后该时间窗口内, 其读请求固定走主库
+    int check_interval_ms = 1000;     // 副本健康/延迟巡检周期
+};
+
+// 读写分离路由: 写请求走主库, 只读请求按最少在途请求数分配到可用副本
+// 副本不可达或延迟超限时自动回退主库
+class ReplicaRouter {
+public:
+    // 读连接租约: 归还时扣减所属副本的在途请求计数
+    class ReadLease {
+    public:
+        ReadLease() = default;
+        ReadLease(DbPool::ConnGuard guard, std::atomic<int>* outstanding)
+            : guard_(std::move(guard)), outstanding_(outstanding) {}
+        ReadLease(ReadLease&& other) noexcept
+            : guard_(std::move(other.guard_)), outstanding_(other.outstanding_) {
+            other.outstanding_ = nullptr;
+        }
+        ReadLease& operator=(ReadLease&&) = delete;
+        ~ReadLease() {
+            guard_.reset();
+            if (outstanding_) outstanding_->fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        PGconn* get() const { return guard_.get(); }
+        explicit operator bool() const { return static_cast<bool>(guard_); }
+
+    private:
+        DbPool::ConnGuard guard_;
+        std::atomic<int>* outstanding_ = nullptr;
+    };
+
+    ReplicaRouter(DbPool* primary, const std::vector<DbPool*>& replicas, const ReplicaOptions& options = ReplicaOptions());
+    ~ReplicaRouter();
+
+    DbPool* Primary() const { return primary_; }
+
+    // uid 用于 read-your-writes 判断, 传 0 表示不关联用户
+    ReadLease AcquireRead(int64_t uid);
+
+    // 记录用户写入, 窗口期内其读请求走主库; uid 也可以是调用方约定的其它 key (如群)
+    void MarkWrite(int64_t uid);
+
+private:
+    struct Replica {
+        DbPool* pool;
+        std::atomic<int> outstanding{0};
+        std::atomic<bool> usable{false};  // 首次巡检通过后才加入轮转
+    };
+
+    static constexpr size_t kStickySlots = 4096;
+
+    bool IsSticky(int64_t uid) const;
+    Replica* PickReplica();
+    void MonitorLoop();
+    std::string PrimaryLsn();
+    bool CheckReplica(Replica& replica, const std::string& primary_lsn, int64_t& lag_ms, bool& receiving);
+
+    DbPool* primary_;
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    ReplicaOptions options_;
+    std::atomic<size_t> rr_{0};
+
+    // uid 哈希到固定槽位记录 "主库读截止时间", 冲突只会让更多读落到主库, 不影响正确性
+    std::array<std::atomic<int64_t>, kStickySlots> sticky_until_ms_{};
+
+    bool stop_ = false;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::thread monitor_;
+};
@@ -0,0 +1,219 @@
+#include "s3_client.h"
+#include <algorithm>
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+
+S3Client::S3Client(const std::string& master_endpoint,
+                   const std::string& public_endpoint,
+                   const std::string& bucket,
+                   const std::string& access_key,
+                   const std::string& secret_key,
+                   DbClient* index,
+                   const S3ClientOptions& options)
+    : master_(ParseEndpoint(master_endpoint, "http", 9333)),
+      public_(ParseEndpoint(public_endpoint, "http", 8080)),
+      bucket_(bucket),
+      access_key_(access_key),
+      secret_key_(secret_key),
+      options_(options),
+      index_(index),
+      fid_cache_(options.fid_cache_capacity),
+      http_("seaweedfs", options.http) {
+    auto& registry = metrics::Registry::Instance();
+    status_latency_ = registry.GetHistogram("im_seaweedfs_request_seconds", "SeaweedFS master request latency", {{"op", "status"}});
+    assign_latency_ = registry.GetHistogram("im_seaweedfs_request_seconds", "SeaweedFS master request latency", {{"op", "assign"}});
+    assign_batch_latency_ =
+        registry.GetHistogram("im_seaweedfs_request_seconds", "SeaweedFS master request latency", {{"op", "assign_batch"}});
+    errors_ = registry.GetCounter("im_seaweedfs_errors_total", "SeaweedFS requests with empty or invalid response");
+    pool_hits_ = registry.GetCounter("im_seaweedfs_fid_pool_total", "Upload fid requests by prefetch pool result", {{"result", "hit"}});
+    pool_misses_ = registry.GetCounter("im_seaweedfs_fid_pool_total", "Upload fid requests by prefetch pool result", {{"result", "miss"}});
+    pool_expired_ = registry.GetCounter("im_seaweedfs_fid_pool_total", "Upload fid requests by prefetch pool result", {{"result", "expired"}});
+    pool_size_ = registry.GetGauge("im_seaweedfs_fid_pool_size", "Prefetched SeaweedFS fids ready for upload");
+    cache_hits_ = registry.GetCounter("im_seaweedfs_fid_cache_total", "Object fid lookups by local cache result", {{"result", "hit"}});
+    cache_misses_ = registry.GetCounter("im_seaweedfs_fid_cache_total", "Object fid lookups by local cache result", {{"result", "miss"}});
+
+    if (options_.assign_batch > 1) {
+        options_.assign_low_water = std::clamp(options_.assign_low_water, 1, options_.assign_batch);
+        if (options_.fid_ttl_sec <= 0) options_.fid_ttl_sec = 60;
+        refiller_ = std::thread(&S3Client::RefillLoop, this);
+    }
+}
+
+S3Client::~S3Client() {
+    {
+        std::lock_guard<std::mutex> lk(pool_mu_);
+        stop_ = true;
+    }
+    refill_cv_.notify_all();
+    if (refiller_.joinable()) refiller_.join();
+}
+
+bool S3Client::CheckConnectivity() {
+    std::string response;
+    {
+        metrics::ScopedTimer timer(status_latency_);
+        response = HttpGet(master_.host, master_.port, "/dir/status");
+    }
+    if (response.empty()) {
+        errors_->Inc();
+        spdlog::error("SeaweedFS connectivity check failed: endpoint={}:{}", master_.host, master_.port);
+        return false;
+    }
+    spdlog::info("SeaweedFS connectivity check ok: endpoint={}:{}", master_.host, master_.port);
+    return true;
+}
+
+std::string S3Client::GetPresignedPutUrl(const std::string& object_name, int expires_in_seconds) {
+    (void)expires_in_seconds;
+    std::string fid;
+    if (!TakeFid(fid)) {
+        // 池空 (冷启动、突发或 master 故障恢复中): 同步申请一个
+        std::vector<std::string> fids;
+        if (!Assign(1, fids)) return "";
+        fid = std::move(fids.front());
+    }
+
+    if (!index_->SaveObjectFid(object_name, fid)) {
+        errors_->Inc();
+        spdlog::error("SeaweedFS assign: failed to persist fid for object={}", object_name);
+        return "";
+    }
+    fid_cache_.Put(object_name, fid);
+
+    std::string final_url = BuildPublicBaseUrl() + "/" + fid + "?collection=" + bucket_ + "&filename=" + object_name;
+    if (!access_key_.empty()) {
+        final_url += "&accessKey=" + access_key_;
+    }
+    if (!secret_key_.empty()) {
+        final_url += "&secretKey=" + secret_key_;
+    }
+
+    spdlog::info("SeaweedFS assign success: object={} fid={} upload_url={}", object_name, fid, final_url);
+    return final_url;
+}
+
+std::string S3Client::GetDownloadUrl(const std::string& object_name) {
+    std::string fid;
+    if (fid_cache_.Get(object_name, fid)) {
+        cache_hits_->Inc();
+    } else {
+        cache_misses_->Inc();
+        fid = index_->GetObjectFid(object_name);
+        if (!fid.empty()) fid_cache_.Put(object_name, fid);
+    }
+
+    if (fid.empty()) {
+        spdlog::warn("SeaweedFS download url fallback: missing fid for object={}.", object_name);
+        return "";
+    }
+
+    return BuildPublicBaseUrl() + "/" + fid + "?collection=" + bucket_;
+}
+
+bool S3Client::TakeFid(std::string& fid) {
+    if (!refiller_.joinable()) return false;
+    bool hit = false;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lk(pool_mu_);
+        DropExpiredLocked(Clock::now());
+        if (!fids_.empty()) {
+            fid = std::move(fids_.front().fid);
+            fids_.pop_front();
+            hit = true;
+        }
+        pool_size_->Set(static_cast<int64_t>(fids_.size()));
+        if (fids_.size() < static_cast<size_t>(options_.assign_low_water) && !refill_requested_) {
+            refill_requested_ = true;
+            wake = true;
+        }
+    }
+    if (wake) refill_cv_.notify_one();
+    (hit ? pool_hits_ : pool_misses_)->Inc();
+    return hit;
+}
+
+void S3Client::DropExpiredLocked(Clock::time_point now) {
+    while (!fids_.empty() && fids_.front().expires <= now) {
+        fids_.pop_front();
+        pool_expired_->Inc();
+    }
+}
+
+bool S3Client::Assign(int count, std::vector<std::string>& out) {
+    // count=N 时 master 返回一个 fid, 同一文件键下 fid、fid_1 ... fid_{N-1} 都可用于上传
+    std::string assign_path = "/dir/assign?count=" + std::to_string(count) + "&collection=" + bucket_;
+    std::string response;
+    {
+        metrics::ScopedTimer timer(count > 1 ? assign_batch_latency_ : assign_latency_);
+        response = HttpGet(master_.host, master_.port, assign_path);
+    }
+
+    if (response.empty()) {
+        errors_->Inc();
+        spdlog::error("SeaweedFS assign failed: empty response from {}:{}", master_.host, master_.port);
+        return false;
+    }
+
+    std::string fid = ExtractJsonValue(response, "fid");
+    if (fid.empty()) {
+        errors_->Inc();
+        spdlog::error("SeaweedFS assign failed: invalid response={} ", response);
+        return false;
+    }
+
+    int granted = std::atoi(ExtractJsonValue(response, "count").c_str());
+    if (granted <= 0 || granted > count) granted = 1;
+    out.reserve(out.size() + static_cast<size_t>(granted));
+    out.push_back(fid);
+    for (int i = 1; i < granted; ++i) {
+        out.push_back(fid + "_" + std::to_string(i));
+    }
+    return true;
+}
+
+void S3Client::RefillLoop() {
+    const auto ttl = std::chrono::seconds(options_.fid_ttl_sec);
+    std::chrono::milliseconds backoff(0);
+    std::unique_lock<std::mutex> lk(pool_mu_);
+    while (!stop_) {
+        refill_requested_ = false;
+        DropExpiredLocked(Clock::now());
+        if (fids_.size() < static_cast<size_t>(options_.assign_low_water)) {
+            lk.unlock();
+            std::vector<std::string> fresh;
+            bool ok = Assign(options_.assign_batch, fresh);
+            auto expires = Clock::now() + ttl;
+            lk.lock();
+            for (auto& fid : fresh) fids_.push_back({std::move(fid), expires});
+            pool_size_->Set(static_cast<int64_t>(fids_.size()));
+            if (ok) {
+                backoff = std::chrono::milliseconds(0);
+                continue;
+            }
+            // master 不可用时退避, 期间请求走同步申请
+            backoff = std::min<std::chrono::milliseconds>(std::max<std::chrono::milliseconds>(backoff * 2, std::chrono::milliseconds(500)),
+                                                          std::chrono::seconds(30));
+        }
+        // 睡到最早一批过期 (或退避结束), 取用方低于水位时提前唤醒
+        auto wake_at = backoff.count() > 0 ? Clock::now() + backoff : (fids_.empty() ? Clock::now() + ttl : fids_.front().expires);
+        bool backing_off = backoff.count() > 0;
+        refill_cv_.wait_until(lk, wake_at, [&] { return stop_ || (!backing_off && refill_requested_); });
+    }
+}
+
+std::string S3Client::BuildPublicBaseUrl() const {
+    return public_.scheme + "://" + public_.host + ":" + std::to_string(public_.port);
+}
+
+std::string S3Client::HttpGet(const std::string& host, int port, const std::string& path) {
+    HttpResult result;
+    if (!http_.Get(host, port, path, result)) {
+        return "";
+    }
+    if (result.status / 100 != 2) {
+        spdlog::warn("SeaweedFS {} returned status {}", path, result.status);
+        return "";
+    }
+    return std::move(result.body);
+}
@@ -1,15 +1,16 @@
 #pragma once
 
-#include <arpa/inet.h>
-#include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
-#include <netdb.h>
-#include <spdlog/spdlog.h>
-#include <sstream>
 #include <string>
-#include <sys/socket.h>
-#include <unistd.h>
-#include <unordered_map>
+#include <thread>
+#include <vector>
+#include "../../common/metrics/metrics.h"
+#include "http_client.h"
+#include "lru_cache.h"
+#include "storage.h"
 
 struct ParsedEndpoint {
     std::string scheme;
@@ -61,138 +62,78 @@ inline ParsedEndpoint ParseEndpoint(const std::string& endpoint, const std::stri
     return parsed;
 }
 
+struct S3ClientOptions {
+    HttpClientOptions http;
+    // 预取 fid: 一次 /dir/assign?count=assign_batch, 池内少于 assign_low_water 时后台补充; assign_batch <= 1 关闭预取
+    int assign_batch = 64;
+    int assign_low_water = 16;
+    int fid_ttl_sec = 60;   // 预取的 fid 超过此时间未用即丢弃 (volume 可能已满或转为只读)
+    size_t fid_cache_capacity = 100000;   // 对象 key -> fid 的本地 LRU 容量
+};
+
 class S3Client {
 public:
     S3Client(const std::string& master_endpoint,
              const std::string& public_endpoint,
              const std::string& bucket,
              const std::string& access_key,
-             const std::string& secret_key)
-        : master_(ParseEndpoint(master_endpoint, "http", 9333)),
-          public_(ParseEndpoint(public_endpoint, "http", 8080)),
-          bucket_(bucket),
-          access_key_(access_key),
-          secret_key_(secret_key) {}
-
-    bool CheckConnectivity() {
-        std::string response = HttpGet(master_.host, master_.port, "/dir/status");
-        if (response.empty()) {
-            spdlog::error("SeaweedFS connectivity check failed: endpoint={}:{}", master_.host, master_.port);
-            return false;
-        }
-        spdlog::info("SeaweedFS connectivity check ok: endpoint={}:{}", master_.host, master_.port);
-        return true;
-    }
-
-    std::string GetPresignedPutUrl(const std::string& object_name, int expires_in_seconds = 600) {
-        (void)expires_in_seconds;
-        std::string assign_path = "/dir/assign?count=1&collection=" + bucket_;
-        std::string response = HttpGet(master_.host, master_.port, assign_path);
+             const std::string& secret_key,
+             DbClient* index,
+             const S3ClientOptions& options = S3ClientOptions());
+    ~S3Client();
 
-        if (response.empty()) {
-            spdlog::error("SeaweedFS assign failed: empty response from {}:{}", master_.host, master_.port);
-            return "";
-        }
-
-        std::string fid = ExtractJsonValue(response, "fid");
-        if (fid.empty()) {
-            spdlog::error("SeaweedFS assign failed: invalid response={} ", response);
-            return "";
-        }
+    S3Client(const S3Client&) = delete;
+    S3Client& operator=(const S3Client&) = delete;
 
-        {
-            std::lock_guard<std::mutex> lock(fid_map_mu_);
-            object_fid_map_[object_name] = fid;
-        }
+    bool CheckConnectivity();
 
-        std::string final_url = BuildPublicBaseUrl() + "/" + fid + "?collection=" + bucket_ + "&filename=" + object_name;
-        if (!access_key_.empty()) {
-            final_url += "&accessKey=" + access_key_;
-        }
-        if (!secret_key_.empty()) {
-            final_url += "&secretKey=" + secret_key_;
-        }
+    // 优先使用预取的 fid, 池空时同步向 master 申请; 对象 key -> fid 写入 index 后才返回, 失败返回空串
+    std::string GetPresignedPutUrl(const std::string& object_name, int expires_in_seconds = 600);
+    // 先查本地 LRU, 未命中读 index (任意节点上传的对象都能解析); 找不到返回空串
+    std::string GetDownloadUrl(const std::string& object_name);
 
-        spdlog::info("SeaweedFS assign success: object={} fid={} upload_url={}", object_name, fid, final_url);
-        return final_url;
-    }
+private:
+    using Clock = std::chrono::steady_clock;
 
-    std::string GetDownloadUrl(const std::string& object_name) {
+    struct FidLease {
         std::string fid;
-        {
-            std::lock_guard<std::mutex> lock(fid_map_mu_);
-            auto it = object_fid_map_.find(object_name);
-            if (it != object_fid_map_.end()) {
-                fid = it->second;
-            }
-        }
+        Clock::time_point expires;
+    };
+
+    bool TakeFid(std::string& fid);
+    // 申请 count 个 fid 追加到 out (master 可能少给); 失败返回 false
+    bool Assign(int count, std::vector<std::string>& out);
+    void DropExpiredLocked(Clock::time_point now);
+    void RefillLoop();
+    std::string BuildPublicBaseUrl() const;
+    // 非 2xx 或请求失败返回空串
+    std::string HttpGet(const std::string& host, int port, const std::string& path);
 
-        if (fid.empty()) {
-            spdlog::warn("SeaweedFS download url fallback: missing fid for object={}.", object_name);
-            return "";
-        }
-
-        return BuildPublicBaseUrl() + "/" + fid + "?collection=" + bucket_;
-    }
-
-private:
     ParsedEndpoint master_;
     ParsedEndpoint public_;
     std::string bucket_;
     std::string access_key_;
     std::string secret_key_;
-    std::mutex fid_map_mu_;
-    std::unordered_map<std::string, std::string> object_fid_map_;
-
-    std::string BuildPublicBaseUrl() const {
-        return public_.scheme + "://" + public_.host + ":" + std::to_string(public_.port);
-    }
-
-    std::string HttpGet(const std::string& host, int port, const std::string& path) {
-        int sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (sock < 0) {
-            return "";
-        }
-
-        struct hostent* server = gethostbyname(host.c_str());
-        if (server == NULL) {
-            close(sock);
-            return "";
-        }
-
-        struct sockaddr_in serv_addr;
-        memset(&serv_addr, 0, sizeof(serv_addr));
-        serv_addr.sin_family = AF_INET;
-        memcpy(&serv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-        serv_addr.sin_port = htons(port);
-
-        if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
-            close(sock);
-            return "";
-        }
-
-        std::string request = "GET " + path + " HTTP/1.1\r\n";
-        request += "Host: " + host + "\r\n";
-        request += "Connection: close\r\n\r\n";
-
-        send(sock, request.c_str(), request.length(), 0);
-
-        std::string response;
-        char buffer[4096];
-        while (true) {
-            int bytes = recv(sock, buffer, 4095, 0);
-            if (bytes <= 0) {
-                break;
-            }
-            buffer[bytes] = 0;
-            response += buffer;
-        }
-        close(sock);
-
-        size_t header_end = response.find("\r\n\r\n");
-        if (header_end != std::string::npos) {
-            return response.substr(header_end + 4);
-        }
-        return response;
-    }
+    S3ClientOptions options_;
+    DbClient* index_;
+    ShardedLruCache<std::string> fid_cache_;
+    metrics::Histogram* status_latency_;
+    metrics::Histogram* assign_latency_;
+    metrics::Histogram* assign_batch_latency_;
+    metrics::Counter* errors_;
+    metrics::Counter* pool_hits_;
+    metrics::Counter* pool_misses_;
+    metrics::Counter* pool_expired_;
+    metrics::Gauge* pool_size_;
+    metrics::Counter* cache_hits_;
+    metrics::Counter* cache_misses_;
+    HttpClient http_;
+
+    // 预取的 fid, 按申请时间排列, 同一批的过期时间相同
+    std::mutex pool_mu_;
+    std::condition_variable refill_cv_;
+    std::deque<FidLease> fids_;
+    bool refill_requested_ = false;
+    bool stop_ = false;
+    std::thread refiller_;
 };
@@ -0,0 +1,261 @@
+#include "segmented_log.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+uint32_t Crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void PutU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t GetU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool WriteAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ReadAll(int fd, std::string& out) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return false;
+    out.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = ::pread(fd, &out[done], out.size() - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+SegmentedLog::SegmentedLog(const SegmentedLogOptions& options) : options_(options) {}
+
+SegmentedLog::~SegmentedLog() {
+    {
+        std::lock_guard<std::mutex> lk(sync_mu_);
+        stop_ = true;
+    }
+    sync_cv_.notify_all();
+    if (syncer_.joinable()) syncer_.join();
+    Sync();
+    for (int fd : fds_) ::close(fd);
+}
+
+std::string SegmentedLog::SegmentPath(uint32_t id) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%08u.log", id);
+    return options_.dir + name;
+}
+
+bool SegmentedLog::OpenSegment(uint32_t id, bool truncate_to_zero) {
+    int flags = O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC | (truncate_to_zero ? O_TRUNC : 0);
+    int fd = ::open(SegmentPath(id).c_str(), flags, 0644);
+    if (fd < 0) {
+        spdlog::error("open log segment {} failed: {}", SegmentPath(id), std::strerror(errno));
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lk(fds_mu_);
+    if (fds_.size() <= id) fds_.resize(id + 1, -1);
+    fds_[id] = fd;
+    return true;
+}
+
+bool SegmentedLog::Open(const ReplayFn& replay) {
+    if (::mkdir(options_.dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        spdlog::error("create data dir {} failed: {}", options_.dir, std::strerror(errno));
+        return false;
+    }
+    std::vector<uint32_t> ids;
+    if (DIR* dir = ::opendir(options_.dir.c_str())) {
+        while (dirent* ent = ::readdir(dir)) {
+            unsigned id = 0;
+            char tail = 0;
+            if (std::strlen(ent->d_name) == 12 && std::sscanf(ent->d_name, "%8u.lo%c", &id, &tail) == 2 && tail == 'g') {
+                ids.push_back(id);
+            }
+        }
+        ::closedir(dir);
+    }
+    std::sort(ids.begin(), ids.end());
+    // 段号必须连续, 缺段说明数据目录被改动过
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (ids[i] != i) {
+            spdlog::error("log segment {} missing in {}", i, options_.dir);
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!OpenSegment(ids[i], false) || !ReplaySegment(ids[i], i + 1 == ids.size(), replay)) return false;
+    }
+    if (ids.empty() && !OpenSegment(0, true)) return false;
+
+    {
+        std::lock_guard<std::mutex> lk(write_mu_);
+        struct stat st;
+        sealed_bytes_ = 0;
+        for (size_t i = 0; i + 1 < fds_.size(); ++i) {
+            if (fstat(fds_[i], &st) == 0) sealed_bytes_ += static_cast<uint64_t>(st.st_size);
+        }
+        active_size_ = fstat(fds_.back(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    }
+    spdlog::info("log opened: dir={} segments={} bytes={}", options_.dir, fds_.size(), TotalBytes());
+    if (options_.sync_interval_ms > 0) syncer_ = std::thread(&SegmentedLog::SyncLoop, this);
+    return true;
+}
+
+bool SegmentedLog::ReplaySegment(uint32_t id, bool last, const ReplayFn& replay) {
+    int fd = fds_[id];
+    std::string data;
+    if (!ReadAll(fd, data)) {
+        spdlog::error("read log segment {} failed", SegmentPath(id));
+        return false;
+    }
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(data.data());
+    size_t pos = 0;
+    while (pos + kHeaderLen <= data.size()) {
+        uint32_t len = GetU32(base + pos);
+        uint32_t crc = GetU32(base + pos + 4);
+        if (pos + kHeaderLen + len > data.size() || Crc32(base + pos + 8, len + 1) != crc) break;
+        Location loc{id, len, pos + kHeaderLen};
+        replay(base[pos + 8], std::string_view(data.data() + pos + kHeaderLen, len), loc);
+        pos += kHeaderLen + len;
+    }
+    if (pos == data.size()) return true;
+
+    if (!last) {
+        spdlog::error("log segment {} corrupted at offset {}, {} bytes skipped", SegmentPath(id), pos, data.size() - pos);
+        return true;
+    }
+    // 崩溃时写了一半的记录
+    spdlog::warn("log segment {} has a torn tail at offset {}, truncating {} bytes", SegmentPath(id), pos, data.size() - pos);
+    if (::ftruncate(fd, static_cast<off_t>(pos)) != 0) {
+        spdlog::error("truncate {} failed: {}", SegmentPath(id), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool SegmentedLog::Append(uint8_t type, std::string_view payload, Location* loc) {
+    std::string record(kHeaderLen + payload.size(), '\0');
+    uint8_t* p = reinterpret_cast<uint8_t*>(&record[0]);
+    PutU32(p, static_cast<uint32_t>(payload.size()));
+    p[8] = type;
+    std::memcpy(p + kHeaderLen, payload.data(), payload.size());
+    PutU32(p + 4, Crc32(p + 8, payload.size() + 1));
+
+    std::lock_guard<std::mutex> lk(write_mu_);
+    if (torn_ || (active_size_ > 0 && active_size_ + record.size() > options_.segment_bytes)) {
+        ::fdatasync(fds_.back());
+        if (!OpenSegment(static_cast<uint32_t>(fds_.size()), true)) return false;
+        sealed_bytes_ += active_size_;
+        active_size_ = 0;
+        torn_ = false;
+    }
+    int fd = fds_.back();
+    if (!WriteAll(fd, record.data(), record.size())) {
+        spdlog::error("append log failed: {}", std::strerror(errno));
+        // 截掉写了一部分的记录, 否则之后追加的记录跟在残片后面, 重启回放时会被当作损坏一起跳过
+        if (::ftruncate(fd, static_cast<off_t>(active_size_)) != 0) {
+            spdlog::error("truncate torn record in segment {} failed: {}, switching to a new segment", fds_.size() - 1,
+                          std::strerror(errno));
+            struct stat st;
+            if (fstat(fd, &st) == 0) active_size_ = static_cast<uint64_t>(st.st_size);
+            torn_ = true;
+        }
+        return false;
+    }
+    if (loc) *loc = Location{static_cast<uint32_t>(fds_.size() - 1), static_cast<uint32_t>(payload.size()), active_size_ + kHeaderLen};
+    active_size_ += record.size();
+    if (options_.sync_interval_ms <= 0) {
+        ::fdatasync(fd);
+    } else {
+        dirty_ = true;
+    }
+    return true;
+}
+
+bool SegmentedLog::Read(const Location& loc, std::string& payload) const {
+    int fd;
+    {
+        std::shared_lock<std::shared_mutex> lk(fds_mu_);
+        if (loc.segment >= fds_.size()) return false;
+        fd = fds_[loc.segment];
+    }
+    payload.resize(loc.length);
+    size_t done = 0;
+    while (done < loc.length) {
+        ssize_t n = ::pread(fd, &payload[done], loc.length - done, static_cast<off_t>(loc.offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void SegmentedLog::Sync() {
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lk(write_mu_);
+        if (!dirty_ || fds_.empty()) return;
+        dirty_ = false;
+        fd = fds_.back();
+    }
+    // 不持写锁 fsync; 期间切段的话旧段已在切段时同步过
+    ::fdatasync(fd);
+}
+
+void SegmentedLog::SyncLoop() {
+    std::unique_lock<std::mutex> lk(sync_mu_);
+    while (!sync_cv_.wait_for(lk, std::chrono::milliseconds(options_.sync_interval_ms), [this] { return stop_; })) {
+        lk.unlock();
+        Sync();
+        lk.lock();
+    }
+}
+
+size_t SegmentedLog::SegmentCount() const {
+    std::shared_lock<std::shared_mutex> lk(fds_mu_);
+    return fds_.size();
+}
+
+uint64_t SegmentedLog::TotalBytes() const {
+    std::lock_guard<std::mutex> lk(write_mu_);
+    return sealed_bytes_ + active_size_;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct SegmentedLogOptions {
+    std::string dir = "./data";
+    size_t segment_bytes = 64 << 20;  // 单个段文件上限, 写满后切到新段
+    int sync_interval_ms = 100;       // 后台 fdatasync 周期; 0 表示每条记录写完立即 fdatasync
+};
+
+// 只追加的分段日志: <dir>/00000000.log, 00000001.log, ...
+//
+// 记录格式: [u32 长度][u32 crc32(类型+负载)][u8 类型][负载], 整数为小端.
+// 打开时按段号顺序回放全部记录; 最后一段尾部不完整或校验失败的记录 (写到一半时崩溃) 被截掉,
+// 之后的写入从截断处继续. 中间段出现损坏说明磁盘数据被破坏, 记录错误后跳过该段剩余部分.
+class SegmentedLog {
+public:
+    // 负载在日志中的位置, 供索引保存后按需读回
+    struct Location {
+        uint32_t segment = 0;
+        uint32_t length = 0;
+        uint64_t offset = 0;
+    };
+
+    using ReplayFn = std::function<void(uint8_t type, std::string_view payload, const Location& loc)>;
+
+    explicit SegmentedLog(const SegmentedLogOptions& options);
+    ~SegmentedLog();
+
+    SegmentedLog(const SegmentedLog&) = delete;
+    SegmentedLog& operator=(const SegmentedLog&) = delete;
+
+    // 创建目录并回放已有记录, 失败返回 false (目录不可写等)
+    bool Open(const ReplayFn& replay);
+
+    // 线程安全; 写入失败返回 false
+    bool Append(uint8_t type, std::string_view payload, Location* loc = nullptr);
+
+    // 按 Append/回放给出的位置读回负载, 不加写锁
+    bool Read(const Location& loc, std::string& payload) const;
+
+    void Sync();
+
+    size_t SegmentCount() const;
+    uint64_t TotalBytes() const;
+
+private:
+    static constexpr size_t kHeaderLen = 9;
+
+    std::string SegmentPath(uint32_t id) const;
+    bool OpenSegment(uint32_t id, bool truncate_to_zero);
+    bool ReplaySegment(uint32_t id, bool last, const ReplayFn& replay);
+    void SyncLoop();
+
+    SegmentedLogOptions options_;
+
+    mutable std::shared_mutex fds_mu_;  // 保护 fds_ 的增长, 读路径只持共享锁
+    std::vector<int> fds_;              // 段号 -> fd, 旧段保持只读打开
+
+    mutable std::mutex write_mu_;
+    uint64_t active_size_ = 0;
+    uint64_t sealed_bytes_ = 0;         // 已写满的段的总字节数
+    bool dirty_ = false;
+    bool torn_ = false;                 // 活动段尾部留有截不掉的残片, 下次写入先切到新段
+
+    std::mutex sync_mu_;
+    std::condition_variable sync_cv_;
+    bool stop_ = false;
+    std::thread syncer_;
+};
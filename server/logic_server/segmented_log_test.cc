@@ -0,0 +1,176 @@
+// SegmentedLog 的回放、切段、尾部截断和写入失败后的截断
+#include "segmented_log.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "../../common/test/check.h"
+
+namespace {
+
+struct Record {
+    uint8_t type;
+    std::string payload;
+    SegmentedLog::Location loc;
+};
+
+SegmentedLogOptions Options(const std::string& dir, size_t segment_bytes = 64 << 20) {
+    SegmentedLogOptions options;
+    options.dir = dir;
+    options.segment_bytes = segment_bytes;
+    options.sync_interval_ms = 0;
+    return options;
+}
+
+std::vector<Record> Replay(SegmentedLog& log, bool* ok = nullptr) {
+    std::vector<Record> records;
+    bool opened = log.Open([&](uint8_t type, std::string_view payload, const SegmentedLog::Location& loc) {
+        records.push_back({type, std::string(payload), loc});
+    });
+    if (ok) *ok = opened;
+    return records;
+}
+
+std::string MakeDir() {
+    char tmpl[] = "/tmp/segmented_log_test.XXXXXX";
+    const char* dir = ::mkdtemp(tmpl);
+    return dir ? dir : "";
+}
+
+void RemoveDir(const std::string& dir) {
+    std::string cmd = "rm -rf '" + dir + "'";
+    if (std::system(cmd.c_str()) != 0) std::fprintf(stderr, "cleanup %s failed\n", dir.c_str());
+}
+
+off_t FileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+// 写入后重新打开, 回放出同样的记录, 位置可以读回负载
+void TestReplay() {
+    std::string dir = MakeDir();
+    std::vector<SegmentedLog::Location> locs;
+    {
+        SegmentedLog log(Options(dir));
+        bool ok = false;
+        CHECK(Replay(log, &ok).empty());
+        CHECK(ok);
+        for (int i = 0; i < 100; ++i) {
+            SegmentedLog::Location loc;
+            CHECK(log.Append(static_cast<uint8_t>(i % 7 + 1), "payload-" + std::to_string(i), &loc));
+            locs.push_back(loc);
+        }
+        std::string payload;
+        CHECK(log.Read(locs[42], payload) && payload == "payload-42");
+    }
+    SegmentedLog log(Options(dir));
+    auto records = Replay(log);
+    CHECK(records.size() == 100);
+    for (size_t i = 0; i < records.size() && i < locs.size(); ++i) {
+        CHECK(records[i].type == i % 7 + 1);
+        CHECK(records[i].payload == "payload-" + std::to_string(i));
+        CHECK(records[i].loc.segment == locs[i].segment && records[i].loc.offset == locs[i].offset);
+    }
+    std::string payload;
+    CHECK(log.Read(records.back().loc, payload) && payload == "payload-99");
+    RemoveDir(dir);
+}
+
+// 段写满后切到新段, 回放按段号顺序覆盖全部记录
+void TestRotation() {
+    std::string dir = MakeDir();
+    const std::string body(100, 'x');
+    {
+        SegmentedLog log(Options(dir, 1024));
+        Replay(log);
+        for (int i = 0; i < 50; ++i) CHECK(log.Append(1, body + std::to_string(i)));
+        CHECK(log.SegmentCount() > 1);
+    }
+    SegmentedLog log(Options(dir, 1024));
+    auto records = Replay(log);
+    CHECK(records.size() == 50);
+    for (size_t i = 0; i < records.size(); ++i) CHECK(records[i].payload == body + std::to_string(i));
+    CHECK(records.back().loc.segment + 1 == log.SegmentCount());
+    RemoveDir(dir);
+}
+
+// 崩溃留下的半条记录在打开时被截掉, 之后的写入从截断处继续
+void TestTornTail() {
+    std::string dir = MakeDir();
+    const std::string segment = dir + "/00000000.log";
+    off_t intact = 0;
+    {
+        SegmentedLog log(Options(dir));
+        Replay(log);
+        for (int i = 0; i < 10; ++i) CHECK(log.Append(2, "record-" + std::to_string(i)));
+        intact = static_cast<off_t>(log.TotalBytes());
+    }
+    {
+        int fd = ::open(segment.c_str(), O_WRONLY | O_APPEND);
+        CHECK(fd >= 0);
+        const char torn[] = {20, 0, 0, 0, 1, 2, 3, 4, 2, 'p', 'a', 'r'};
+        CHECK(::write(fd, torn, sizeof(torn)) == static_cast<ssize_t>(sizeof(torn)));
+        ::close(fd);
+    }
+    {
+        SegmentedLog log(Options(dir));
+        CHECK(Replay(log).size() == 10);
+        CHECK(FileSize(segment) == intact);
+        CHECK(log.Append(2, "after-torn"));
+    }
+    SegmentedLog log(Options(dir));
+    auto records = Replay(log);
+    CHECK(records.size() == 11);
+    CHECK(!records.empty() && records.back().payload == "after-torn");
+    RemoveDir(dir);
+}
+
+// 写到一半失败 (这里用 RLIMIT_FSIZE 制造 EFBIG) 时截回写入前的长度, 后续写入和重启回放不受残片影响
+void TestFailedAppendTruncates() {
+    std::string dir = MakeDir();
+    const std::string segment = dir + "/00000000.log";
+    struct rlimit saved;
+    CHECK(::getrlimit(RLIMIT_FSIZE, &saved) == 0);
+    ::signal(SIGXFSZ, SIG_IGN);
+    {
+        SegmentedLog log(Options(dir));
+        Replay(log);
+        CHECK(log.Append(3, "before"));
+        const off_t size = FileSize(segment);
+
+        struct rlimit limit = saved;
+        limit.rlim_cur = static_cast<rlim_t>(size + 16);
+        CHECK(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+        CHECK(!log.Append(3, std::string(256, 'y')));
+        CHECK(::setrlimit(RLIMIT_FSIZE, &saved) == 0);
+
+        CHECK(FileSize(segment) == size);
+        CHECK(static_cast<off_t>(log.TotalBytes()) == size);
+        SegmentedLog::Location loc;
+        CHECK(log.Append(3, "after", &loc));
+        std::string payload;
+        CHECK(log.Read(loc, payload) && payload == "after");
+    }
+    SegmentedLog log(Options(dir));
+    auto records = Replay(log);
+    CHECK(records.size() == 2);
+    CHECK(records.size() == 2 && records[0].payload == "before" && records[1].payload == "after");
+    RemoveDir(dir);
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::warn);
+    TestReplay();
+    TestRotation();
+    TestTornTail();
+    TestFailedAppendTruncates();
+    return test::Report();
+}
@@ -0,0 +1,218 @@
+#include "send_dedup.h"
+#include <algorithm>
+#include <cstdio>
+#include <spdlog/spdlog.h>
+#include "../../common/log/logging.h"
+#include "../../common/trace/trace.h"
+
+namespace {
+
+std::string SendKey(int64_t uid, const std::string& device_id, uint32_t seq_id) {
+    return "IM:SEND:" + std::to_string(uid) + ":" + std::to_string(seq_id) + ":" + device_id;
+}
+
+struct Marker {
+    bool pending = false;
+    uint64_t fingerprint = 0;
+    SendResult result;
+};
+
+std::string Encode(bool pending, uint64_t fingerprint, const SendResult& r) {
+    char buf[80];
+    std::snprintf(buf, sizeof(buf), "%c:%016llx:%lld:%lld", pending ? 'P' : 'D', static_cast<unsigned long long>(fingerprint),
+                  static_cast<long long>(r.msg_id), static_cast<long long>(r.create_time));
+    return buf;
+}
+
+bool Decode(const std::string& value, Marker& m) {
+    char state = 0;
+    unsigned long long fingerprint = 0;
+    long long msg_id = 0, create_time = 0;
+    if (std::sscanf(value.c_str(), "%c:%llx:%lld:%lld", &state, &fingerprint, &msg_id, &create_time) != 4 ||
+        (state != 'P' && state != 'D') || msg_id <= 0) {
+        return false;
+    }
+    m.pending = state == 'P';
+    m.fingerprint = fingerprint;
+    m.result.msg_id = msg_id;
+    m.result.create_time = create_time;
+    return true;
+}
+
+// FNV-1a
+uint64_t Fnv1a(const void* data, size_t len, uint64_t h = 0xcbf29ce484222325ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+uint64_t HashDevice(const std::string& device_id) {
+    return Fnv1a(device_id.data(), device_id.size());
+}
+
+}  // namespace
+
+size_t SendDedup::KeyHash::operator()(const Key& k) const {
+    uint64_t x = static_cast<uint64_t>(k.uid) * 0x9e3779b97f4a7c15ull ^ k.device_hash ^ (static_cast<uint64_t>(k.seq_id) << 17);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    return static_cast<size_t>(x ^ (x >> 31));
+}
+
+SendDedup::SendDedup(KvClient* kv, const SendDedupOptions& options)
+    : kv_(kv),
+      window_(std::max(options.window_sec, 1)),
+      shard_count_(options.shard_count > 0 ? options.shard_count : 1),
+      max_per_generation_(std::max<size_t>(options.max_entries / shard_count_ / 2, 1)),
+      shards_(new Shard[shard_count_]) {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < shard_count_; ++i) shards_[i].rotated_at = now;
+}
+
+uint64_t SendDedup::Fingerprint(int64_t to_uid, const std::string& content) {
+    return Fnv1a(content.data(), content.size(), Fnv1a(&to_uid, sizeof(to_uid)));
+}
+
+SendDedup::Key SendDedup::MakeKey(int64_t uid, const std::string& device_id, uint32_t seq_id) {
+    return Key{uid, HashDevice(device_id), seq_id};
+}
+
+void SendDedup::MaybeRotate(Shard& shard) {
+    auto now = std::chrono::steady_clock::now();
+    if (shard.current.size() < max_per_generation_ && now - shard.rotated_at < window_) return;
+    // 窗口内没有写入时上一代也已过期
+    if (now - shard.rotated_at >= 2 * window_) shard.current.clear();
+    shard.previous.swap(shard.current);
+    shard.current.clear();
+    shard.rotated_at = now;
+}
+
+SendDedup::Entry* SendDedup::Find(Shard& shard, const Key& key) {
+    auto it = shard.current.find(key);
+    if (it != shard.current.end()) return &it->second;
+    it = shard.previous.find(key);
+    return it != shard.previous.end() ? &it->second : nullptr;
+}
+
+SendDedup::Source SendDedup::Lookup(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint, SendResult& result) {
+    Key key = MakeKey(uid, device_id, seq_id);
+    Shard& shard = ShardFor(key);
+    {
+        std::lock_guard<std::mutex> lk(shard.mu);
+        MaybeRotate(shard);
+        Entry* entry = Find(shard, key);
+        if (entry && entry->fingerprint == fingerprint) {
+            // 本节点的首次发送还在入库时交给 Claim 判定
+            if (entry->pending) return Source::NEW;
+            result = entry->result;
+            return Source::LOCAL;
+        }
+    }
+    if (!kv_) return Source::NEW;
+
+    // 重发被路由到本节点: 已入库的直接按首次结果回复, 不再查好友关系; P 标记同样交给 Claim
+    trace::Span span("dedup.Lookup");
+    std::optional<std::string> value = kv_->Get(SendKey(uid, device_id, seq_id));
+    Marker first;
+    if (!value || !Decode(*value, first) || first.pending || first.fingerprint != fingerprint) return Source::NEW;
+    std::lock_guard<std::mutex> lk(shard.mu);
+    if (!Find(shard, key)) shard.current[key] = Entry{first.result, fingerprint, false};
+    result = first.result;
+    return Source::SHARED;
+}
+
+SendDedup::Source SendDedup::Claim(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint, SendResult& result) {
+    Key key = MakeKey(uid, device_id, seq_id);
+    Shard& shard = ShardFor(key);
+    {
+        // 先占进程内窗口: 同一节点上并发到达的重发看到首次的登记
+        std::lock_guard<std::mutex> lk(shard.mu);
+        MaybeRotate(shard);
+        Entry* entry = Find(shard, key);
+        if (entry && entry->fingerprint == fingerprint) {
+            if (entry->pending) return Source::PENDING;
+            result = entry->result;
+            return Source::LOCAL;
+        }
+        shard.previous.erase(key);
+        shard.current[key] = Entry{result, fingerprint, true};
+    }
+    if (!kv_) return Source::NEW;
+
+    trace::Span span("dedup.Claim");
+    const std::string marker_key = SendKey(uid, device_id, seq_id);
+    const int ttl = static_cast<int>(window_.count());
+    std::optional<std::string> existing;
+    if (!kv_->SetNXOrGet(marker_key, Encode(true, fingerprint, result), ttl, existing)) {
+        static logging::RateLimit limit(10);
+        logging::Limited(limit, spdlog::default_logger(), spdlog::level::warn, "Send dedup marker unavailable, uid={} seq_id={} checked locally only",
+                         uid, seq_id);
+        return Source::NEW;
+    }
+    if (!existing) return Source::NEW;
+    Marker first;
+    if (!Decode(*existing, first) || first.fingerprint != fingerprint) {
+        // 旧格式或 seq_id 被另一条消息复用: 覆盖为本次的登记
+        if (!kv_->SetEx(marker_key, Encode(true, fingerprint, result), ttl)) {
+            spdlog::warn("Send dedup marker overwrite failed: uid={} seq_id={}", uid, seq_id);
+        }
+        return Source::NEW;
+    }
+    std::lock_guard<std::mutex> lk(shard.mu);
+    if (first.pending) {
+        // 首次发送在其它节点上还没入库完; 本地不留记录, 下次重发重新查 Redis
+        shard.current.erase(key);
+        return Source::PENDING;
+    }
+    result = first.result;
+    shard.current[key] = Entry{first.result, fingerprint, false};
+    return Source::SHARED;
+}
+
+void SendDedup::Commit(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint, const SendResult& result) {
+    Key key = MakeKey(uid, device_id, seq_id);
+    Shard& shard = ShardFor(key);
+    {
+        std::lock_guard<std::mutex> lk(shard.mu);
+        MaybeRotate(shard);
+        Entry* entry = Find(shard, key);
+        if (entry && entry->fingerprint == fingerprint) {
+            entry->result = result;
+            entry->pending = false;
+        } else {
+            shard.current[key] = Entry{result, fingerprint, false};
+        }
+    }
+    if (!kv_) return;
+    if (!kv_->SetEx(SendKey(uid, device_id, seq_id), Encode(false, fingerprint, result), static_cast<int>(window_.count()))) {
+        static logging::RateLimit limit(10);
+        logging::Limited(limit, spdlog::default_logger(), spdlog::level::warn,
+                         "Send dedup marker commit failed, uid={} seq_id={}: retries on other nodes wait for it to expire", uid, seq_id);
+    }
+}
+
+void SendDedup::Release(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint) {
+    Key key = MakeKey(uid, device_id, seq_id);
+    Shard& shard = ShardFor(key);
+    {
+        std::lock_guard<std::mutex> lk(shard.mu);
+        Entry* entry = Find(shard, key);
+        if (!entry || entry->fingerprint != fingerprint) return;
+        shard.current.erase(key);
+        shard.previous.erase(key);
+    }
+    if (kv_ && !kv_->Del(SendKey(uid, device_id, seq_id))) {
+        spdlog::warn("Send dedup marker release failed: uid={} seq_id={}", uid, seq_id);
+    }
+}
+
+size_t SendDedup::Size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::lock_guard<std::mutex> lk(shards_[i].mu);
+        total += shards_[i].current.size() + shards_[i].previous.size();
+    }
+    return total;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "storage.h"
+
+struct SendDedupOptions {
+    int window_sec = 300;
+    size_t max_entries = 1000000;
+    size_t shard_count = 16;
+};
+
+// 首次发送分配的结果, 重发时原样返回
+struct SendResult {
+    int64_t msg_id = 0;
+    int64_t create_time = 0;
+};
+
+// MsgSendReq 的重发去重, 按 (uid, device_id, seq_id) 识别同一次发送, 再以内容指纹 (to_uid + 正文) 确认:
+// 指纹不同说明 seq_id 被复用 (客户端重连后重新计数等), 按新消息处理并覆盖旧记录.
+//
+//   进程内窗口  按 key 哈希分片, 每片两代哈希表: 每 window_sec 或当前代写满时轮换, 丢弃上上代,
+//              条目保留 window_sec ~ 2 * window_sec; 内存上限约 max_entries 条
+//   IM:SEND:<uid>:<seq_id>:<device_id>  Redis 标记, TTL 为 window_sec; 重发被网关路由到其它 logic server 节点时由它判重.
+//              值为 "P|D:<指纹>:msg_id:create_time", P 表示首次发送还在入库, D 表示已入库
+//
+// 登记时先写 P, 入库成功后 Commit 改为 D, 入库失败 Release 删除; 看到 P 的重发返回 PENDING, 由客户端稍后再重发,
+// 不会在消息尚未落库时就回复成功. Redis 不可用时只靠进程内窗口, 宁可放过跨节点的重发也不拒绝发送.
+class SendDedup {
+public:
+    enum class Source { NEW, LOCAL, SHARED, PENDING };
+
+    // kv 为空时只用进程内窗口 (单机部署)
+    SendDedup(KvClient* kv, const SendDedupOptions& options);
+
+    SendDedup(const SendDedup&) = delete;
+    SendDedup& operator=(const SendDedup&) = delete;
+
+    static uint64_t Fingerprint(int64_t to_uid, const std::string& content);
+
+    // 入库前的只读检查: 先查进程内窗口, 未命中再读 Redis 标记. 同一条消息已入库 (本节点或其它节点) 时返回 LOCAL / SHARED,
+    // result 为首次的结果; 否则返回 NEW, 由调用方校验后再 Claim
+    Source Lookup(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint, SendResult& result);
+
+    // 以新分配的 result 登记本次发送. 首次出现返回 NEW, 之后由调用方入库, 再 Commit 或 Release;
+    // 已入库过 (本节点或其它节点) 时返回 LOCAL / SHARED, result 改为首次的结果; 首次发送还没入库完时返回 PENDING
+    Source Claim(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint, SendResult& result);
+    // 入库成功: 之后的重发返回 result
+    void Commit(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint, const SendResult& result);
+    // 入库失败: 撤销登记, 重发按新消息处理
+    void Release(int64_t uid, const std::string& device_id, uint32_t seq_id, uint64_t fingerprint);
+
+    size_t Size() const;
+
+private:
+    struct Key {
+        int64_t uid;
+        uint64_t device_hash;
+        uint32_t seq_id;
+        bool operator==(const Key& o) const { return uid == o.uid && device_hash == o.device_hash && seq_id == o.seq_id; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const;
+    };
+    struct Entry {
+        SendResult result;
+        uint64_t fingerprint = 0;
+        bool pending = true;
+    };
+    using Generation = std::unordered_map<Key, Entry, KeyHash>;
+
+    struct Shard {
+        mutable std::mutex mu;
+        Generation current;
+        Generation previous;
+        std::chrono::steady_clock::time_point rotated_at;
+    };
+
+    static Key MakeKey(int64_t uid, const std::string& device_id, uint32_t seq_id);
+    Shard& ShardFor(const Key& key) { return shards_[KeyHash()(key) % shard_count_]; }
+    // 调用方持有 shard.mu
+    void MaybeRotate(Shard& shard);
+    static Entry* Find(Shard& shard, const Key& key);
+
+    KvClient* kv_;
+    const std::chrono::seconds window_;
+    const size_t shard_count_;
+    const size_t max_per_generation_;
+    std::unique_ptr<Shard[]> shards_;
+};
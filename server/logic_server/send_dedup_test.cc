@@ -0,0 +1,209 @@
+// SendDedup: 进程内窗口, 内容指纹, 跨节点标记的 P / D 两阶段登记与入库前的只读检查
+#include "send_dedup.h"
+#include <map>
+#include <spdlog/spdlog.h>
+#include "../../common/test/check.h"
+
+namespace {
+
+// 只实现 SendDedup 用到的字符串命令, 可模拟 Redis 不可用
+class FakeKv : public KvClient {
+public:
+    bool down = false;
+    std::map<std::string, std::string> values;
+
+    bool Set(const std::string& key, const std::string& value) override { return SetEx(key, value, 0); }
+    std::optional<std::string> Get(const std::string& key) override {
+        if (down) return std::nullopt;
+        auto it = values.find(key);
+        if (it == values.end()) return std::nullopt;
+        return it->second;
+    }
+    bool HSet(const std::string&, const std::string&, const std::string&) override { return false; }
+    std::optional<std::string> HGet(const std::string&, const std::string&) override { return std::nullopt; }
+    bool SetIfGreater(const std::string&, int64_t) override { return false; }
+    bool SetNXOrGet(const std::string& key, const std::string& value, int, std::optional<std::string>& existing) override {
+        if (down) return false;
+        existing = Get(key);
+        if (!existing) values[key] = value;
+        return true;
+    }
+    bool SetEx(const std::string& key, const std::string& value, int) override {
+        if (down) return false;
+        values[key] = value;
+        return true;
+    }
+    bool Del(const std::string& key) override {
+        if (down) return false;
+        values.erase(key);
+        return true;
+    }
+    bool ZAddLex(const std::string&, const std::vector<std::string>&, int) override { return false; }
+    std::vector<std::string> ZRangeByLex(const std::string&, const std::string&, const std::string&) override { return {}; }
+    bool ZRemRangeByLex(const std::string&, const std::string&, const std::string&) override { return false; }
+    bool ZRem(const std::string&, const std::vector<std::string>&) override { return false; }
+};
+
+SendResult Result(int64_t msg_id) {
+    SendResult r;
+    r.msg_id = msg_id;
+    r.create_time = 1700000000;
+    return r;
+}
+
+void TestLocalRetry() {
+    SendDedup dedup(nullptr, SendDedupOptions());
+    const uint64_t fp = SendDedup::Fingerprint(2, "hello");
+    SendResult sent = Result(100);
+    CHECK(dedup.Claim(1, "phone", 7, fp, sent) == SendDedup::Source::NEW);
+    // 入库完成前的重发不能回复成功
+    SendResult retry = Result(101);
+    CHECK(dedup.Claim(1, "phone", 7, fp, retry) == SendDedup::Source::PENDING);
+    CHECK(dedup.Lookup(1, "phone", 7, fp, retry) == SendDedup::Source::NEW);
+
+    dedup.Commit(1, "phone", 7, fp, sent);
+    CHECK(dedup.Lookup(1, "phone", 7, fp, retry) == SendDedup::Source::LOCAL);
+    CHECK(retry.msg_id == 100);
+    retry = Result(102);
+    CHECK(dedup.Claim(1, "phone", 7, fp, retry) == SendDedup::Source::LOCAL);
+    CHECK(retry.msg_id == 100);
+    // 其它设备 / seq_id 互不影响
+    retry = Result(103);
+    CHECK(dedup.Claim(1, "tablet", 7, fp, retry) == SendDedup::Source::NEW);
+    retry = Result(104);
+    CHECK(dedup.Claim(1, "phone", 8, fp, retry) == SendDedup::Source::NEW);
+}
+
+void TestReusedSeqIdWithOtherContent() {
+    SendDedup dedup(nullptr, SendDedupOptions());
+    const uint64_t first = SendDedup::Fingerprint(2, "hello");
+    const uint64_t second = SendDedup::Fingerprint(2, "bye");
+    CHECK(first != second);
+    CHECK(first != SendDedup::Fingerprint(3, "hello"));
+    SendResult sent = Result(100);
+    CHECK(dedup.Claim(1, "phone", 1, first, sent) == SendDedup::Source::NEW);
+    dedup.Commit(1, "phone", 1, first, sent);
+    // 重连后 seq_id 重新计数: 内容不同即为新消息
+    SendResult next = Result(200);
+    CHECK(dedup.Lookup(1, "phone", 1, second, next) == SendDedup::Source::NEW);
+    CHECK(dedup.Claim(1, "phone", 1, second, next) == SendDedup::Source::NEW);
+    CHECK(next.msg_id == 200);
+    dedup.Commit(1, "phone", 1, second, next);
+    SendResult retry;
+    CHECK(dedup.Claim(1, "phone", 1, second, retry) == SendDedup::Source::LOCAL);
+    CHECK(retry.msg_id == 200);
+}
+
+void TestReleaseAfterFailedSave() {
+    FakeKv kv;
+    SendDedup dedup(&kv, SendDedupOptions());
+    const uint64_t fp = SendDedup::Fingerprint(2, "hello");
+    SendResult sent = Result(100);
+    CHECK(dedup.Claim(1, "phone", 7, fp, sent) == SendDedup::Source::NEW);
+    CHECK(kv.values.size() == 1);
+    dedup.Release(1, "phone", 7, fp);
+    CHECK(kv.values.empty());
+    SendResult retry = Result(101);
+    CHECK(dedup.Claim(1, "phone", 7, fp, retry) == SendDedup::Source::NEW);
+    CHECK(retry.msg_id == 101);
+}
+
+void TestAcrossNodes() {
+    FakeKv kv;
+    SendDedup node_a(&kv, SendDedupOptions());
+    SendDedup node_b(&kv, SendDedupOptions());
+    const uint64_t fp = SendDedup::Fingerprint(2, "hello");
+    SendResult sent = Result(100);
+    CHECK(node_a.Claim(1, "phone", 7, fp, sent) == SendDedup::Source::NEW);
+    // 首次发送在 A 上还没入库完
+    SendResult retry = Result(101);
+    CHECK(node_b.Claim(1, "phone", 7, fp, retry) == SendDedup::Source::PENDING);
+    node_a.Commit(1, "phone", 7, fp, sent);
+    retry = Result(102);
+    CHECK(node_b.Claim(1, "phone", 7, fp, retry) == SendDedup::Source::SHARED);
+    CHECK(retry.msg_id == 100 && retry.create_time == sent.create_time);
+    // 之后 B 本地即可判重
+    retry = Result(103);
+    CHECK(node_b.Lookup(1, "phone", 7, fp, retry) == SendDedup::Source::LOCAL);
+    CHECK(retry.msg_id == 100);
+
+    // 另一条内容复用了同一 seq_id: 覆盖标记, 按新消息处理
+    const uint64_t other = SendDedup::Fingerprint(2, "other");
+    SendResult next = Result(200);
+    CHECK(node_a.Claim(1, "phone", 7, other, next) == SendDedup::Source::NEW);
+    node_a.Commit(1, "phone", 7, other, next);
+    SendDedup node_c(&kv, SendDedupOptions());
+    retry = Result(201);
+    CHECK(node_c.Claim(1, "phone", 7, other, retry) == SendDedup::Source::SHARED);
+    CHECK(retry.msg_id == 200);
+}
+
+// 重发落到没见过这次发送的节点: 入库前只读 Redis 标记即可判重, 不必先走好友校验和 Claim
+void TestLookupSharedMarker() {
+    FakeKv kv;
+    SendDedup node_a(&kv, SendDedupOptions());
+    SendDedup node_b(&kv, SendDedupOptions());
+    const uint64_t fp = SendDedup::Fingerprint(2, "hello");
+    SendResult sent = Result(100);
+    CHECK(node_a.Claim(1, "phone", 7, fp, sent) == SendDedup::Source::NEW);
+    // P 标记: 交给 Claim 回复 PENDING
+    SendResult retry = Result(101);
+    CHECK(node_b.Lookup(1, "phone", 7, fp, retry) == SendDedup::Source::NEW);
+    CHECK(retry.msg_id == 101);
+    node_a.Commit(1, "phone", 7, fp, sent);
+    CHECK(node_b.Lookup(1, "phone", 7, fp, retry) == SendDedup::Source::SHARED);
+    CHECK(retry.msg_id == 100 && retry.create_time == sent.create_time);
+    // 已写入 B 的进程内窗口, Redis 不可用时仍能判重
+    kv.down = true;
+    retry = Result(102);
+    CHECK(node_b.Lookup(1, "phone", 7, fp, retry) == SendDedup::Source::LOCAL);
+    CHECK(retry.msg_id == 100);
+    kv.down = false;
+    // 指纹不同 (seq_id 被另一条消息复用) 不算重发
+    const uint64_t other = SendDedup::Fingerprint(2, "other");
+    SendDedup node_c(&kv, SendDedupOptions());
+    retry = Result(103);
+    CHECK(node_c.Lookup(1, "phone", 7, other, retry) == SendDedup::Source::NEW);
+    CHECK(retry.msg_id == 103);
+}
+
+void TestRedisDown() {
+    FakeKv kv;
+    kv.down = true;
+    SendDedup dedup(&kv, SendDedupOptions());
+    const uint64_t fp = SendDedup::Fingerprint(2, "hello");
+    SendResult sent = Result(100);
+    CHECK(dedup.Claim(1, "phone", 7, fp, sent) == SendDedup::Source::NEW);
+    dedup.Commit(1, "phone", 7, fp, sent);
+    // 只靠进程内窗口
+    SendResult retry = Result(101);
+    CHECK(dedup.Claim(1, "phone", 7, fp, retry) == SendDedup::Source::LOCAL);
+    CHECK(retry.msg_id == 100);
+}
+
+void TestBoundedSize() {
+    SendDedupOptions options;
+    options.max_entries = 64;
+    options.shard_count = 1;
+    SendDedup dedup(nullptr, options);
+    for (uint32_t seq = 1; seq <= 1000; ++seq) {
+        SendResult sent = Result(seq);
+        dedup.Claim(1, "phone", seq, 1, sent);
+        dedup.Commit(1, "phone", seq, 1, sent);
+    }
+    CHECK(dedup.Size() <= 64);
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::err);
+    TestLocalRetry();
+    TestReusedSeqIdWithOtherContent();
+    TestReleaseAfterFailedSave();
+    TestAcrossNodes();
+    TestLookupSharedMarker();
+    TestRedisDown();
+    TestBoundedSize();
+    return test::Report();
+}
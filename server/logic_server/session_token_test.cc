@@ -0,0 +1,66 @@
+// 会话令牌的签发/校验, 以及毫秒级吊销判定: 登出后同一秒内重新登录的令牌仍然有效, 旧的秒级时间戳按原语义处理
+#include "../../common/auth/session_token.h"
+#include "../../common/test/check.h"
+
+namespace {
+
+SessionTokenCodec MakeCodec() {
+    return SessionTokenCodec("k1", {{"k1", "secret-1"}, {"k0", "secret-0"}}, 3600);
+}
+
+void TestIssueAndVerify() {
+    SessionTokenCodec codec = MakeCodec();
+    int64_t now_ms = NowMs();
+    SessionToken token;
+    CHECK(codec.Verify(codec.Issue(42, "dev|a", now_ms), token) == SessionTokenCodec::VerifyResult::OK);
+    CHECK(token.uid == 42);
+    CHECK(token.device_id == "dev|a");
+    CHECK(token.issued_at == now_ms);
+    CHECK(token.expires_at == now_ms / 1000 + 3600);
+    CHECK(token.key_id == "k1");
+    CHECK(SessionTokenCodec::Matches(token, 42, "dev|a"));
+    CHECK(!SessionTokenCodec::Matches(token, 42, "dev|b"));
+
+    std::string raw = codec.Issue(42, "dev", now_ms);
+    raw.back() = raw.back() == 'A' ? 'B' : 'A';
+    CHECK(codec.Verify(raw, token) == SessionTokenCodec::VerifyResult::BAD_SIGNATURE);
+    CHECK(codec.Verify("v1.k9.e30.e30", token) == SessionTokenCodec::VerifyResult::UNKNOWN_KEY);
+    CHECK(codec.Verify("opaque", token) == SessionTokenCodec::VerifyResult::MALFORMED);
+}
+
+void TestLogoutThenLoginSameSecond() {
+    SessionTokenCodec codec = MakeCodec();
+    // 同一秒内: 旧令牌签发 -> 登出 -> 重新登录
+    int64_t second_start = NowMs() / 1000 * 1000;
+    SessionToken before, after;
+    CHECK(codec.Verify(codec.Issue(7, "dev", second_start + 100), before) == SessionTokenCodec::VerifyResult::OK);
+    int64_t not_before = second_start + 300;
+    CHECK(codec.Verify(codec.Issue(7, "dev", second_start + 301), after) == SessionTokenCodec::VerifyResult::OK);
+
+    CHECK(RevokedBy(before.issued_at, NotBeforeMs(not_before)));
+    CHECK(!RevokedBy(after.issued_at, NotBeforeMs(not_before)));
+    // 与登出落在同一毫秒的令牌按已吊销处理
+    CHECK(RevokedBy(not_before, NotBeforeMs(not_before)));
+}
+
+void TestLegacySecondTimestamps() {
+    int64_t now_sec = NowMs() / 1000;
+    // 旧版本写入的秒级 not_before 覆盖该秒内签发的全部令牌
+    CHECK(NotBeforeMs(now_sec) == now_sec * 1000 + 999);
+    CHECK(RevokedBy(IssuedAtMs(now_sec), NotBeforeMs(now_sec)));
+    CHECK(RevokedBy(now_sec * 1000 + 999, NotBeforeMs(now_sec)));
+    CHECK(!RevokedBy((now_sec + 1) * 1000, NotBeforeMs(now_sec)));
+    CHECK(!RevokedBy(IssuedAtMs(now_sec + 1), NotBeforeMs(now_sec)));
+    // 毫秒值原样返回
+    CHECK(IssuedAtMs(now_sec * 1000 + 5) == now_sec * 1000 + 5);
+    CHECK(NotBeforeMs(now_sec * 1000 + 5) == now_sec * 1000 + 5);
+}
+
+}  // namespace
+
+int main() {
+    TestIssueAndVerify();
+    TestLogoutThenLoginSameSecond();
+    TestLegacySecondTimestamps();
+    return test::Report();
+}
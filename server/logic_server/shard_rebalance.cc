@@ -0,0 +1,221 @@
+// 消息分片在线迁移工具
+//
+// 扩容流程:
+//   1. 在 config.yaml 的 postgres.message_shards 中加入新分片, state: "migrating", 滚动重启 logic server.
+//      此后新消息按新的哈希环写入新分片, 读取时合并新旧两个分片, 服务不中断.
+//   2. 运行 shard_rebalance, 把归属发生变化的 key 的存量消息从旧分片搬到新分片.
+//      按 key 分批: 先在目标分片插入 (按 msg_id 去重, 保留原 seq) 并把该 key 的 seq 计数器抬到已有的最大 seq,
+//      提交后再删除源分片的行, 中途失败可直接重跑.
+//   3. 把新分片改为 state: "active" 并滚动重启, 读取不再合并旧分片.
+//
+// 用法: shard_rebalance [--config ../config.yaml] [--batch 500] [--dry-run]
+#include <libpq-fe.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../../common/config/config.h"
+#include "shard_router.h"
+
+namespace {
+
+struct TableSpec {
+    const char* name;
+    const char* key_col;
+    const char* columns;  // 需要迁移的列, 不含自增 id
+    int seq_scope;        // t_msg_seq.scope, 与 PooledDbClient 一致
+};
+
+// 和 PooledDbClient 的分片键保持一致: 单聊按接收方, 群聊按群ID
+const TableSpec kTables[] = {
+    {"t_chat_msg", "to_uid", "msg_id, from_uid, to_uid, content, create_time, seq", 1},
+    {"t_group_msg", "group_id", "msg_id, group_id, from_uid, content, create_time, seq", 2},
+};
+constexpr int kColumnCount = 6;
+
+struct ShardConn {
+    std::string name;
+    PGconn* conn;
+};
+
+struct Totals {
+    int64_t keys = 0;
+    int64_t rows = 0;
+};
+
+bool ExecOk(PGconn* conn, const char* sql) {
+    PGresult* res = PQexec(conn, sql);
+    bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) spdlog::error("{} failed: {}", sql, PQerrorMessage(conn));
+    PQclear(res);
+    return ok;
+}
+
+std::vector<int64_t> ListKeys(PGconn* conn, const TableSpec& table, int64_t after, int limit) {
+    std::vector<int64_t> keys;
+    std::string sql = std::string("SELECT DISTINCT ") + table.key_col + " FROM " + table.name + " WHERE " + table.key_col +
+                      " > " + std::to_string(after) + " ORDER BY 1 LIMIT " + std::to_string(limit);
+    PGresult* res = PQexec(conn, sql.c_str());
+    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
+        for (int i = 0; i < PQntuples(res); ++i) keys.push_back(std::stoll(PQgetvalue(res, i, 0)));
+    } else {
+        spdlog::error("list keys failed: {} | Error: {}", sql, PQerrorMessage(conn));
+    }
+    PQclear(res);
+    return keys;
+}
+
+int64_t CountRows(PGconn* conn, const TableSpec& table, int64_t key) {
+    std::string sql = std::string("SELECT count(*) FROM ") + table.name + " WHERE " + table.key_col + "=" + std::to_string(key);
+    PGresult* res = PQexec(conn, sql.c_str());
+    int64_t n = PQresultStatus(res) == PGRES_TUPLES_OK ? std::stoll(PQgetvalue(res, 0, 0)) : 0;
+    PQclear(res);
+    return n;
+}
+
+// 分批把一个 key 的全部消息从 src 搬到 dst, 返回搬运行数, 失败返回 -1
+int64_t MoveKey(PGconn* src, PGconn* dst, const TableSpec& table, int64_t key, int batch) {
+    const std::string select_sql = std::string("SELECT id, ") + table.columns + " FROM " + table.name + " WHERE " +
+                                   table.key_col + "=" + std::to_string(key) + " ORDER BY id LIMIT " + std::to_string(batch);
+    // 内容可能含任意字符, 插入使用参数化语句; 按 (key, msg_id) 去重保证重跑幂等
+    const std::string insert_sql = std::string("INSERT INTO ") + table.name + " (" + table.columns +
+                                   ") SELECT $1::bigint, $2::bigint, $3::bigint, $4::text, $5::bigint, $6::bigint WHERE NOT EXISTS (SELECT 1 FROM " +
+                                   table.name + " WHERE " + table.key_col + "=" + std::to_string(key) + " AND msg_id=$1::bigint)";
+    // 搬完后目标分片上的计数器不能小于搬来的 seq, 否则旧分片下线后新消息的 seq 会重复
+    const std::string seq_sql = std::string("INSERT INTO t_msg_seq (scope, owner_id, last_seq) SELECT ") +
+                                std::to_string(table.seq_scope) + ", " + std::to_string(key) + ", max(seq) FROM " + table.name +
+                                " WHERE " + table.key_col + "=" + std::to_string(key) +
+                                " HAVING max(seq) IS NOT NULL ON CONFLICT (scope, owner_id) DO UPDATE SET last_seq = "
+                                "GREATEST(t_msg_seq.last_seq, EXCLUDED.last_seq)";
+    int64_t moved = 0;
+    while (true) {
+        PGresult* rows = PQexec(src, select_sql.c_str());
+        if (PQresultStatus(rows) != PGRES_TUPLES_OK) {
+            spdlog::error("select {} key={} failed: {}", table.name, key, PQerrorMessage(src));
+            PQclear(rows);
+            return -1;
+        }
+        int n = PQntuples(rows);
+        if (n == 0) {
+            PQclear(rows);
+            return moved;
+        }
+
+        bool ok = ExecOk(dst, "BEGIN");
+        std::string ids = "{";
+        for (int i = 0; ok && i < n; ++i) {
+            const char* params[kColumnCount];
+            for (int c = 0; c < kColumnCount; ++c) params[c] = PQgetvalue(rows, i, c + 1);
+            PGresult* ins = PQexecParams(dst, insert_sql.c_str(), kColumnCount, nullptr, params, nullptr, nullptr, 0);
+            if (PQresultStatus(ins) != PGRES_COMMAND_OK) {
+                spdlog::error("insert {} key={} failed: {}", table.name, key, PQerrorMessage(dst));
+                ok = false;
+            }
+            PQclear(ins);
+            if (i > 0) ids += ",";
+            ids += PQgetvalue(rows, i, 0);
+        }
+        ids += "}";
+        PQclear(rows);
+        if (ok) ok = ExecOk(dst, seq_sql.c_str());
+        if (!ok) {
+            ExecOk(dst, "ROLLBACK");
+            return -1;
+        }
+        if (!ExecOk(dst, "COMMIT")) return -1;
+
+        // 目标分片已提交后才删除源数据; 删除失败时重跑只会重复插入被去重的行
+        const char* del_params[1] = {ids.c_str()};
+        std::string delete_sql = std::string("DELETE FROM ") + table.name + " WHERE id = ANY($1::bigint[])";
+        PGresult* del = PQexecParams(src, delete_sql.c_str(), 1, nullptr, del_params, nullptr, nullptr, 0);
+        bool deleted = PQresultStatus(del) == PGRES_COMMAND_OK;
+        if (!deleted) spdlog::error("delete {} key={} failed: {}", table.name, key, PQerrorMessage(src));
+        PQclear(del);
+        if (!deleted) return -1;
+        moved += n;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    spdlog::set_pattern("[%H:%M:%S][%^%L%$][Rebalance]%v");
+
+    std::string config_file = "../config.yaml";
+    int batch = 500;
+    bool dry_run = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--config") && i + 1 < argc) {
+            config_file = argv[++i];
+        } else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) {
+            batch = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--dry-run")) {
+            dry_run = true;
+        } else {
+            spdlog::error("usage: {} [--config file] [--batch n] [--dry-run]", argv[0]);
+            return 1;
+        }
+    }
+
+    Config& config = Config::Instance();
+    if (!config.Load(config_file)) return 1;
+    const auto& db_cfg = config.GetPostgresConfig();
+    if (db_cfg.message_shards.empty()) {
+        spdlog::info("no message_shards configured, nothing to do");
+        return 0;
+    }
+
+    // 目标哈希环与 logic server 一致: 包含全部分片 (含 migrating)
+    ConsistentHashRing ring;
+    std::vector<ShardConn> shards;
+    for (uint32_t i = 0; i < db_cfg.message_shards.size(); ++i) {
+        const auto& shard = db_cfg.message_shards[i];
+        std::string conninfo = "dbname=" + db_cfg.dbname + " user=" + db_cfg.user + " password=" + db_cfg.password +
+                               " hostaddr=" + shard.host + " port=" + std::to_string(shard.port) + " connect_timeout=3";
+        PGconn* conn = PQconnectdb(conninfo.c_str());
+        if (PQstatus(conn) != CONNECTION_OK) {
+            spdlog::error("connect shard {} ({}:{}) failed: {}", shard.name, shard.host, shard.port, PQerrorMessage(conn));
+            PQfinish(conn);
+            for (auto& s : shards) PQfinish(s.conn);
+            return 1;
+        }
+        ring.AddNode(i, shard.name);
+        shards.push_back({shard.name, conn});
+    }
+
+    bool failed = false;
+    Totals totals;
+    for (uint32_t src = 0; src < shards.size() && !failed; ++src) {
+        for (const auto& table : kTables) {
+            int64_t cursor = INT64_MIN;
+            while (!failed) {
+                auto keys = ListKeys(shards[src].conn, table, cursor, 1000);
+                if (keys.empty()) break;
+                cursor = keys.back();
+                for (int64_t key : keys) {
+                    uint32_t owner = ring.Locate(key);
+                    if (owner == src) continue;
+                    int64_t rows = dry_run ? CountRows(shards[src].conn, table, key)
+                                           : MoveKey(shards[src].conn, shards[owner].conn, table, key, batch);
+                    if (rows < 0) {
+                        failed = true;
+                        break;
+                    }
+                    ++totals.keys;
+                    totals.rows += rows;
+                    spdlog::info("{} {}={} : {} -> {}, {} rows", table.name, table.key_col, key, shards[src].name,
+                                 shards[owner].name, rows);
+                }
+            }
+        }
+    }
+
+    for (auto& s : shards) PQfinish(s.conn);
+    spdlog::info("{}{} keys, {} rows{}", dry_run ? "[dry-run] " : "", totals.keys, totals.rows,
+                 failed ? ", stopped on error (safe to rerun)" : "");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+#include "shard_router.h"
+#include <algorithm>
+#include <climits>
+
+uint64_t ConsistentHashRing::HashKey(int64_t key) {
+    // splitmix64, 打散连续的 uid
+    uint64_t x = static_cast<uint64_t>(key) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t ConsistentHashRing::HashName(const std::string& name) {
+    // FNV-1a 64
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return HashKey(static_cast<int64_t>(h));
+}
+
+void ConsistentHashRing::AddNode(uint32_t node, const std::string& name) {
+    for (int i = 0; i < virtual_nodes_; ++i) {
+        points_.emplace_back(HashName(name + "#" + std::to_string(i)), node);
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+uint32_t ConsistentHashRing::Locate(int64_t key) const {
+    if (points_.empty()) return UINT32_MAX;
+    uint64_t h = HashKey(key);
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(h, 0u));
+    if (it == points_.end()) it = points_.begin();
+    return it->second;
+}
+
+ShardRouter::ShardRouter(const std::vector<MessageShard>& shards) : shards_(shards) {
+    for (uint32_t i = 0; i < shards_.size(); ++i) {
+        ring_.AddNode(i, shards_[i].name);
+        if (!shards_[i].migrating) stable_ring_.AddNode(i, shards_[i].name);
+    }
+}
+
+ShardRouter::Route ShardRouter::Locate(int64_t key) const {
+    Route route;
+    uint32_t owner = ring_.Locate(key);
+    if (owner == UINT32_MAX) return route;
+    route.pool = shards_[owner].pool;
+    if (shards_[owner].migrating) {
+        uint32_t prev = stable_ring_.Locate(key);
+        if (prev != UINT32_MAX && prev != owner) route.previous = shards_[prev].pool;
+    }
+    return route;
+}
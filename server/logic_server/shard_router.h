@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "db_pool.h"
+
+// 一致性哈希环, 每个节点按名字生成若干虚拟节点; 增加节点只会迁移约 1/N 的 key
+class ConsistentHashRing {
+public:
+    explicit ConsistentHashRing(int virtual_nodes = 160) : virtual_nodes_(virtual_nodes) {}
+
+    void AddNode(uint32_t node, const std::string& name);
+    // 环为空时返回 UINT32_MAX
+    uint32_t Locate(int64_t key) const;
+    bool Empty() const { return points_.empty(); }
+
+    static uint64_t HashKey(int64_t key);
+    static uint64_t HashName(const std::string& name);
+
+private:
+    int virtual_nodes_;
+    std::vector<std::pair<uint64_t, uint32_t>> points_;  // 按 hash 升序
+};
+
+struct MessageShard {
+    std::string name;
+    DbPool* pool;
+    bool migrating;  // 新加入的分片: 已接收写入, 存量数据尚未迁移完成
+};
+
+// 消息存储分片路由: 单聊按接收方 uid, 群聊按 group_id 落到分片
+class ShardRouter {
+public:
+    struct Route {
+        DbPool* pool = nullptr;      // 当前归属分片, 读写都走这里
+        DbPool* previous = nullptr;  // 迁移期间的旧归属, 非空时读请求需要合并两边的数据
+    };
+
+    explicit ShardRouter(const std::vector<MessageShard>& shards);
+
+    Route Locate(int64_t key) const;
+    const std::vector<MessageShard>& Shards() const { return shards_; }
+
+private:
+    std::vector<MessageShard> shards_;
+    ConsistentHashRing ring_;         // 全部分片
+    ConsistentHashRing stable_ring_;  // 仅 active 分片, 即迁移前的归属
+};
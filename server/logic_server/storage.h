@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "im.pb.h"
+
+// logic server 的存储接口, 按 storage.backend 选择实现:
+//   postgres  PooledDbClient (Postgres 主库/副本/分片) + PooledRedisClient (Redis)
+//   embedded  EmbeddedStore 同时实现两个接口, 数据在本地分段日志 + 内存索引, 单机部署和压测用
+
+// 用户的登录凭据, 口令的校验由 PasswordHasher 完成
+struct UserCredential {
+    int64_t uid = 0;
+    std::string nickname;
+    std::string password;  // 存储值: scrypt 编码串, 或迁移前的明文
+};
+
+// 用户 / 好友 / 消息
+class DbClient {
+public:
+    virtual ~DbClient() = default;
+
+    // 口令的存储值, 用户不存在返回空串
+    virtual std::string GetUserPassword(int64_t uid) = 0;
+    // 返回消息在接收方内的 seq (从 1 连续递增, 顺序与提交顺序一致), 失败返回 0
+    virtual int64_t SaveMessage(const std::string& msg_id, int64_t from_uid, int64_t to_uid, const std::string& content) = 0;
+    // seq > after_seq 的单聊消息, 按 seq 升序, 每次最多一页
+    virtual std::vector<im::ChatMsg> GetofflineMsgs(int64_t uid, int64_t after_seq) = 0;
+    // password 为口令的存储值 (已哈希); 失败返回 -1
+    virtual int64_t CreateUser(const std::string& username, const std::string& password, const std::string& email) = 0;
+    // 用户不存在或查询失败返回 false
+    virtual bool GetUserByEmail(const std::string& email, UserCredential& credential) = 0;
+    // 替换口令的存储值 (明文或低参数的哈希在登录成功后重算)
+    virtual bool UpdatePassword(int64_t uid, const std::string& password) = 0;
+    virtual bool CreateFriendRequest(int64_t from_uid, int64_t to_uid, const std::string& reason, int64_t& out_req_id) = 0;
+    virtual std::vector<im::FriendRequest> GetFriendRequestsForUser(int64_t uid) = 0;
+    virtual bool AcceptFriendRequest(int64_t req_id) = 0;
+    virtual bool RejectFriendRequest(int64_t req_id) = 0;
+    virtual bool AreFriends(int64_t uid1, int64_t uid2) = 0;
+    virtual std::vector<int64_t> ListFriends(int64_t uid) = 0;
+    // 同 SaveMessage / GetofflineMsgs, seq 在群内分配
+    virtual int64_t SaveGroupMessage(const std::string& msg_id, int64_t group_id, int64_t from_uid, const std::string& content) = 0;
+    virtual std::vector<im::ChatMsg> GetGroupMsgs(int64_t group_id, int64_t after_seq) = 0;
+    // 上传对象 key -> SeaweedFS fid, 供任意节点生成下载地址
+    virtual bool SaveObjectFid(const std::string& object_key, const std::string& fid) = 0;
+    // 不存在或查询失败返回空串
+    virtual std::string GetObjectFid(const std::string& object_key) = 0;
+};
+
+// 会话路由 / 网关租约 / 已送达游标 / 令牌吊销表, 语义同对应的 Redis 命令
+class KvClient {
+public:
+    virtual ~KvClient() = default;
+
+    virtual bool Set(const std::string& key, const std::string& value) = 0;
+    virtual std::optional<std::string> Get(const std::string& key) = 0;
+    virtual bool HSet(const std::string& key, const std::string& field, const std::string& value) = 0;
+    virtual std::optional<std::string> HGet(const std::string& key, const std::string& field) = 0;
+    // 非负整数值只增不减, value 不大于当前值时不修改 (按 64 位整数精确比较); 只有出错时返回 false
+    virtual bool SetIfGreater(const std::string& key, int64_t value) = 0;
+    // key 不存在时写入 value 并设置 TTL (SET NX EX), 已存在时不修改, 由 existing 返回当前值. 出错返回 false
+    virtual bool SetNXOrGet(const std::string& key, const std::string& value, int ttl_sec, std::optional<std::string>& existing) = 0;
+    // 无条件写入并设置 TTL (SET EX)
+    virtual bool SetEx(const std::string& key, const std::string& value, int ttl_sec) = 0;
+    // key 不存在也算成功
+    virtual bool Del(const std::string& key) = 0;
+    // 有序集合按成员字典序使用 (score 统一为 0), 区间语法同 ZRANGEBYLEX, 如 "(abc" "[abc" "-" "+"
+    virtual bool ZAddLex(const std::string& key, const std::vector<std::string>& members, int ttl_sec) = 0;
+    virtual std::vector<std::string> ZRangeByLex(const std::string& key, const std::string& min, const std::string& max) = 0;
+    virtual bool ZRemRangeByLex(const std::string& key, const std::string& min, const std::string& max) = 0;
+    virtual bool ZRem(const std::string& key, const std::vector<std::string>& members) = 0;
+};